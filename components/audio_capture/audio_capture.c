@@ -0,0 +1,336 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_capture.c
+  * @brief   This file is the PDM microphone capture pipeline implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <string.h>
+#include "audio_capture.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "driver/i2s_pdm.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define AUDIO_CAPTURE_RING_MASK (AUDIO_CAPTURE_RING_SAMPLES - 1)
+#define AUDIO_CAPTURE_READ_TIMEOUT_MS 100
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#define ringLoad(counter) __atomic_load_n(&(counter), __ATOMIC_ACQUIRE)
+#define ringStore(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELEASE)
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "AUDIO_CAPTURE";
+
+/** @abstract I2S PDM receive channel */
+static i2s_chan_handle_t rx_channel = NULL;
+
+/** @abstract Capture task handle */
+static TaskHandle_t capture_task = NULL;
+
+/** @abstract Flag keeping the capture task alive */
+static volatile bool capture_running = false;
+
+/** @abstract Given by the capture task when it exits */
+static SemaphoreHandle_t capture_stopped = NULL;
+
+/** @abstract Given by the capture task after every block written to the ring */
+static SemaphoreHandle_t data_ready = NULL;
+
+/** @abstract Single-producer single-consumer ring buffer in PSRAM */
+static int16_t * ring = NULL;
+
+/** @abstract Total samples written to the ring, owned by the capture task */
+static uint32_t ring_head = 0;
+
+/** @abstract Total samples read from the ring, owned by the consumer */
+static uint32_t ring_tail = 0;
+
+/** @abstract Internal RAM landing buffer for one DMA frame */
+static int16_t dma_block[AUDIO_CAPTURE_DMA_FRAME_NUM];
+
+/** @abstract Pipeline statistics */
+static audio_capture_stats_t stats;
+
+/** @abstract Guards the statistics, they are updated by the overflow ISR and the capture task */
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function onReceiveQueueOverflow
+ *
+ * @abstract This function is an ISR callback called when the DMA overwrote a buffer nobody read
+ *
+ * @param[in] handle: I2S channel handle
+ *
+ * @param[in] event: I2S event data
+ *
+ * @param[in] user_ctx: Unused
+ *
+ * @return false, no task was woken
+ */
+static bool onReceiveQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t * event, void * user_ctx);
+
+/*
+ * @function ringWrite
+ *
+ * @abstract This function appends a block to the ring buffer, dropping it whole if it does not fit
+ *
+ * @param[in] samples: Samples to append
+ *
+ * @param[in] count: Number of samples
+ *
+ * @return None
+ */
+static void ringWrite(const int16_t * samples, uint32_t count);
+
+/*
+ * @function vAudioCaptureTask
+ *
+ * @abstract This function moves DMA frames into the ring buffer
+ *
+ * @param[in] pvParameters: Unused
+ *
+ * @return None
+ */
+static void vAudioCaptureTask(void * pvParameters);
+
+/*
+ * @function releaseCapture
+ *
+ * @abstract This function frees everything a failed init allocated and leaves the pipeline uninitialised
+ *
+ * @return None
+ */
+static void releaseCapture(void);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static bool IRAM_ATTR onReceiveQueueOverflow(i2s_chan_handle_t handle, i2s_event_data_t * event, void * user_ctx) {
+    portENTER_CRITICAL_ISR(&stats_lock);
+    stats.dma_overruns++;
+    portEXIT_CRITICAL_ISR(&stats_lock);
+
+    return false;
+}
+
+static void ringWrite(const int16_t * samples, uint32_t count) {
+    const uint32_t head = ring_head;
+    const uint32_t occupancy = head - ringLoad(ring_tail);
+
+    if (occupancy + count > AUDIO_CAPTURE_RING_SAMPLES) {
+        portENTER_CRITICAL(&stats_lock);
+        stats.ring_overruns++;
+        stats.dropped_samples += count;
+        portEXIT_CRITICAL(&stats_lock);
+        return;
+    }
+
+    const uint32_t offset = head & AUDIO_CAPTURE_RING_MASK;
+    const uint32_t first = (count < AUDIO_CAPTURE_RING_SAMPLES - offset) ? count : AUDIO_CAPTURE_RING_SAMPLES - offset;
+
+    memcpy(&ring[offset], samples, first * sizeof(int16_t));
+    memcpy(ring, &samples[first], (count - first) * sizeof(int16_t));
+
+    ringStore(ring_head, head + count);
+
+    portENTER_CRITICAL(&stats_lock);
+    stats.captured_samples += count;
+    if (occupancy + count > stats.peak_occupancy) {
+        stats.peak_occupancy = occupancy + count;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    xSemaphoreGive(data_ready);
+}
+
+static void vAudioCaptureTask(void * pvParameters) {
+    while (capture_running) {
+        size_t bytes_read = 0;
+
+        esp_err_t error = i2s_channel_read(rx_channel, dma_block, sizeof(dma_block), &bytes_read,
+                                           pdMS_TO_TICKS(AUDIO_CAPTURE_READ_TIMEOUT_MS));
+
+        if (error == ESP_OK && bytes_read > 0) {
+            ringWrite(dma_block, bytes_read / sizeof(int16_t));
+        } else if (error != ESP_ERR_TIMEOUT) {
+            ESP_LOGE(TAG, "I2S read failed; err=%s", esp_err_to_name(error));
+        }
+    }
+
+    xSemaphoreGive(capture_stopped);
+    vTaskDelete(NULL);
+}
+
+static void releaseCapture(void) {
+    if (rx_channel != NULL) {
+        i2s_del_channel(rx_channel);
+        rx_channel = NULL;
+    }
+
+    if (data_ready != NULL) {
+        vSemaphoreDelete(data_ready);
+        data_ready = NULL;
+    }
+
+    if (capture_stopped != NULL) {
+        vSemaphoreDelete(capture_stopped);
+        capture_stopped = NULL;
+    }
+
+    heap_caps_free(ring);
+    ring = NULL;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+esp_err_t audio_capture_init(uint32_t sample_rate_hz) {
+    if (sample_rate_hz < AUDIO_CAPTURE_MIN_SAMPLE_RATE_HZ || sample_rate_hz > AUDIO_CAPTURE_MAX_SAMPLE_RATE_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (rx_channel != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ring = heap_caps_malloc(AUDIO_CAPTURE_RING_SAMPLES * sizeof(int16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    capture_stopped = xSemaphoreCreateBinary();
+    data_ready = xSemaphoreCreateBinary();
+
+    if (ring == NULL || capture_stopped == NULL || data_ready == NULL) {
+        ESP_LOGE(TAG, "Failed allocating capture buffers");
+        releaseCapture();
+        return ESP_ERR_NO_MEM;
+    }
+
+    i2s_chan_config_t channel_config = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+    channel_config.dma_desc_num = AUDIO_CAPTURE_DMA_DESC_NUM;
+    channel_config.dma_frame_num = AUDIO_CAPTURE_DMA_FRAME_NUM;
+
+    esp_err_t error = i2s_new_channel(&channel_config, NULL, &rx_channel);
+    if (error != ESP_OK) {
+        releaseCapture();
+        return error;
+    }
+
+    i2s_pdm_rx_config_t pdm_config = {
+            .clk_cfg = I2S_PDM_RX_CLK_DEFAULT_CONFIG(sample_rate_hz),
+            .slot_cfg = I2S_PDM_RX_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
+            .gpio_cfg = {
+                    .clk = AUDIO_CAPTURE_PDM_CLK_PIN,
+                    .din = AUDIO_CAPTURE_PDM_DIN_PIN,
+                    .invert_flags = {
+                            .clk_inv = false,
+                    },
+            },
+    };
+
+    error = i2s_channel_init_pdm_rx_mode(rx_channel, &pdm_config);
+    if (error != ESP_OK) {
+        releaseCapture();
+        return error;
+    }
+
+    i2s_event_callbacks_t callbacks = {
+            .on_recv = NULL,
+            .on_recv_q_ovf = onReceiveQueueOverflow,
+            .on_sent = NULL,
+            .on_send_q_ovf = NULL,
+    };
+
+    error = i2s_channel_register_event_callback(rx_channel, &callbacks, NULL);
+    if (error != ESP_OK) {
+        releaseCapture();
+        return error;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    memset(&stats, 0, sizeof(stats));
+    stats.sample_rate_hz = sample_rate_hz;
+    stats.capacity = AUDIO_CAPTURE_RING_SAMPLES;
+    portEXIT_CRITICAL(&stats_lock);
+
+    ESP_LOGI(TAG, "PDM capture configured at %lu Hz, ring %u samples in PSRAM",
+             (unsigned long)sample_rate_hz, (unsigned)AUDIO_CAPTURE_RING_SAMPLES);
+
+    return ESP_OK;
+}
+
+esp_err_t audio_capture_start(void) {
+    if (rx_channel == NULL || capture_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t error = i2s_channel_enable(rx_channel);
+    if (error != ESP_OK) {
+        return error;
+    }
+
+    capture_running = true;
+
+    if (xTaskCreatePinnedToCore(vAudioCaptureTask, "AUDIO", AUDIO_CAPTURE_TASK_STACK_SIZE, NULL,
+                                AUDIO_CAPTURE_TASK_PRIORITY, &capture_task, AUDIO_CAPTURE_TASK_CORE) != pdPASS) {
+        capture_running = false;
+        i2s_channel_disable(rx_channel);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t audio_capture_stop(void) {
+    if (!capture_running) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    capture_running = false;
+    xSemaphoreTake(capture_stopped, portMAX_DELAY);
+    capture_task = NULL;
+
+    return i2s_channel_disable(rx_channel);
+}
+
+size_t audio_capture_read(int16_t * samples, size_t max_samples, TickType_t timeout) {
+    if (ring == NULL) {
+        return 0;
+    }
+
+    if (audio_capture_available() == 0) {
+        xSemaphoreTake(data_ready, timeout);
+    }
+
+    const uint32_t tail = ring_tail;
+    const uint32_t available = ringLoad(ring_head) - tail;
+    const uint32_t count = (available < max_samples) ? available : (uint32_t)max_samples;
+    const uint32_t offset = tail & AUDIO_CAPTURE_RING_MASK;
+    const uint32_t first = (count < AUDIO_CAPTURE_RING_SAMPLES - offset) ? count : AUDIO_CAPTURE_RING_SAMPLES - offset;
+
+    memcpy(samples, &ring[offset], first * sizeof(int16_t));
+    memcpy(&samples[first], ring, (count - first) * sizeof(int16_t));
+
+    ringStore(ring_tail, tail + count);
+
+    return count;
+}
+
+size_t audio_capture_available(void) {
+    return ringLoad(ring_head) - ringLoad(ring_tail);
+}
+
+void audio_capture_get_stats(audio_capture_stats_t * out) {
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+    out->occupancy = (uint32_t)audio_capture_available();
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,147 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_capture.h
+  * @brief   This file is the header file for the PDM microphone capture pipeline
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _AUDIO_CAPTURE_H_
+#define _AUDIO_CAPTURE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Capture pipeline statistics */
+typedef struct audio_capture_stats_t {
+    uint32_t sample_rate_hz;
+    uint32_t capacity;
+    uint32_t occupancy;
+    uint32_t peak_occupancy;
+    uint32_t dma_overruns;
+    uint32_t ring_overruns;
+    uint32_t dropped_samples;
+    uint64_t captured_samples;
+} audio_capture_stats_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract PDM microphone clock GPIO */
+#define AUDIO_CAPTURE_PDM_CLK_PIN 42
+/** @abstract PDM microphone data GPIO */
+#define AUDIO_CAPTURE_PDM_DIN_PIN 41
+
+/** @abstract Lowest supported sample rate */
+#define AUDIO_CAPTURE_MIN_SAMPLE_RATE_HZ 8000
+/** @abstract Highest supported sample rate */
+#define AUDIO_CAPTURE_MAX_SAMPLE_RATE_HZ 16000
+
+/** @abstract Number of DMA descriptors; two give double buffering between the I2S DMA and the capture task */
+#define AUDIO_CAPTURE_DMA_DESC_NUM 2
+/** @abstract Samples per DMA buffer (20 ms at 16 kHz) */
+#define AUDIO_CAPTURE_DMA_FRAME_NUM 320
+
+/** @abstract PSRAM ring buffer capacity in samples, power of two (2 s at 16 kHz) */
+#define AUDIO_CAPTURE_RING_SAMPLES (1u << 15)
+
+/** @abstract Capture task stack size */
+#define AUDIO_CAPTURE_TASK_STACK_SIZE 3072
+/** @abstract Capture task priority, above the sensor tasks since it only moves DMA buffers */
+#define AUDIO_CAPTURE_TASK_PRIORITY (tskIDLE_PRIORITY + 4)
+/** @abstract Core the capture task runs on, away from the BLE host */
+#define AUDIO_CAPTURE_TASK_CORE 1
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function audio_capture_init
+ *
+ * @abstract This function configures the I2S PDM receiver and allocates the PSRAM ring buffer
+ *
+ * @param[in] sample_rate_hz: Sample rate, AUDIO_CAPTURE_MIN_SAMPLE_RATE_HZ to AUDIO_CAPTURE_MAX_SAMPLE_RATE_HZ
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t audio_capture_init(uint32_t sample_rate_hz);
+
+/*
+ * @function audio_capture_start
+ *
+ * @abstract This function enables the I2S channel and starts the capture task
+ *
+ * @param None
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t audio_capture_start(void);
+
+/*
+ * @function audio_capture_stop
+ *
+ * @abstract This function stops the capture task and disables the I2S channel
+ *
+ * @param None
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t audio_capture_stop(void);
+
+/*
+ * @function audio_capture_read
+ *
+ * @abstract This function copies captured samples out of the ring buffer. Only one consumer task may read.
+ *
+ * @param[out] samples: Destination buffer
+ *
+ * @param[in] max_samples: Destination capacity in samples
+ *
+ * @param[in] timeout: Time to wait for data when the ring is empty
+ *
+ * @return Number of samples copied
+ */
+size_t audio_capture_read(int16_t * samples, size_t max_samples, TickType_t timeout);
+
+/*
+ * @function audio_capture_available
+ *
+ * @abstract This function returns the number of samples waiting in the ring buffer
+ *
+ * @param None
+ *
+ * @return Number of samples
+ */
+size_t audio_capture_available(void);
+
+/*
+ * @function audio_capture_get_stats
+ *
+ * @abstract This function returns a snapshot of the capture statistics
+ *
+ * @param[out] stats: Statistics
+ *
+ * @return None
+ */
+void audio_capture_get_stats(audio_capture_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _AUDIO_CAPTURE_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,267 @@
+/**
+  **********************************************************************************************************************
+  * @file    ima_adpcm.c
+  * @brief   This file is the IMA-ADPCM block codec implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <math.h>
+#include <string.h>
+#include "ima_adpcm.h"
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#include "esp_timer.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define IMA_ADPCM_MAX_STEP_INDEX 88
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+/* The per-sample loops run from IRAM and the tables from DRAM so encoding never waits on flash cache misses */
+#ifdef ESP_PLATFORM
+#define IMA_ADPCM_HOT IRAM_ATTR
+#define IMA_ADPCM_TABLE DRAM_ATTR
+#else
+#define IMA_ADPCM_HOT
+#define IMA_ADPCM_TABLE
+#endif
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Quantizer step sizes */
+static const int16_t IMA_ADPCM_TABLE step_table[IMA_ADPCM_MAX_STEP_INDEX + 1] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31,
+    34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143,
+    157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658,
+    724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024,
+    3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+/** @abstract Step index adjustment per 4-bit code */
+static const int8_t IMA_ADPCM_TABLE index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function encodeSample
+ *
+ * @abstract This function quantizes one sample and advances the state exactly as the decoder will
+ *
+ * @param[in,out] predictor: Predicted sample
+ *
+ * @param[in,out] step_index: Step table index
+ *
+ * @param[in] sample: PCM sample
+ *
+ * @return 4-bit code
+ */
+static inline uint8_t encodeSample(int32_t * predictor, int32_t * step_index, int16_t sample);
+
+/*
+ * @function decodeSample
+ *
+ * @abstract This function reconstructs one sample from its 4-bit code
+ *
+ * @param[in,out] predictor: Predicted sample
+ *
+ * @param[in,out] step_index: Step table index
+ *
+ * @param[in] code: 4-bit code
+ *
+ * @return PCM sample
+ */
+static inline int16_t decodeSample(int32_t * predictor, int32_t * step_index, uint8_t code);
+
+/*
+ * @function nowMicroseconds
+ *
+ * @abstract This function returns a monotonic timestamp
+ *
+ * @param None
+ *
+ * @return Time in microseconds
+ */
+static int64_t nowMicroseconds(void);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static inline uint8_t encodeSample(int32_t * predictor, int32_t * step_index, int16_t sample) {
+    int32_t step = step_table[*step_index];
+    int32_t diff = (int32_t)sample - *predictor;
+    int32_t delta = step >> 3;
+    uint8_t code = 0;
+
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+        delta += step;
+    }
+
+    int32_t next = (code & 8) ? *predictor - delta : *predictor + delta;
+    *predictor = next > INT16_MAX ? INT16_MAX : (next < INT16_MIN ? INT16_MIN : next);
+
+    int32_t index = *step_index + index_table[code];
+    *step_index = index < 0 ? 0 : (index > IMA_ADPCM_MAX_STEP_INDEX ? IMA_ADPCM_MAX_STEP_INDEX : index);
+
+    return code;
+}
+
+static inline int16_t decodeSample(int32_t * predictor, int32_t * step_index, uint8_t code) {
+    const int32_t step = step_table[*step_index];
+    int32_t delta = step >> 3;
+
+    if (code & 4) {
+        delta += step;
+    }
+    if (code & 2) {
+        delta += step >> 1;
+    }
+    if (code & 1) {
+        delta += step >> 2;
+    }
+
+    int32_t next = (code & 8) ? *predictor - delta : *predictor + delta;
+    *predictor = next > INT16_MAX ? INT16_MAX : (next < INT16_MIN ? INT16_MIN : next);
+
+    int32_t index = *step_index + index_table[code];
+    *step_index = index < 0 ? 0 : (index > IMA_ADPCM_MAX_STEP_INDEX ? IMA_ADPCM_MAX_STEP_INDEX : index);
+
+    return (int16_t)*predictor;
+}
+
+static int64_t nowMicroseconds(void) {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+IMA_ADPCM_HOT size_t ima_adpcm_encode_block(ima_adpcm_state_t * state, const int16_t * samples, size_t count,
+                                            uint8_t * block, int16_t * reconstructed) {
+    /* Keep the state in registers for the whole block */
+    int32_t predictor = state->predictor;
+    int32_t step_index = state->step_index;
+
+    count &= ~(size_t)1;
+
+    block[0] = (uint8_t)(predictor & 0xFF);
+    block[1] = (uint8_t)((predictor >> 8) & 0xFF);
+    block[2] = (uint8_t)step_index;
+    block[3] = 0;
+
+    uint8_t * data = &block[IMA_ADPCM_HEADER_BYTES];
+
+    for (size_t i = 0; i < count; i += 2) {
+        uint8_t low = encodeSample(&predictor, &step_index, samples[i]);
+        if (reconstructed) {
+            reconstructed[i] = (int16_t)predictor;
+        }
+        uint8_t high = encodeSample(&predictor, &step_index, samples[i + 1]);
+        if (reconstructed) {
+            reconstructed[i + 1] = (int16_t)predictor;
+        }
+        *data++ = (uint8_t)(low | (high << 4));
+    }
+
+    state->predictor = (int16_t)predictor;
+    state->step_index = (uint8_t)step_index;
+
+    return IMA_ADPCM_HEADER_BYTES + count / 2;
+}
+
+IMA_ADPCM_HOT size_t ima_adpcm_decode_block(const uint8_t * block, size_t length, int16_t * samples) {
+    if (length < IMA_ADPCM_HEADER_BYTES || block[2] > IMA_ADPCM_MAX_STEP_INDEX) {
+        return 0;
+    }
+
+    int32_t predictor = (int16_t)(block[0] | (block[1] << 8));
+    int32_t step_index = block[2];
+    const size_t bytes = length - IMA_ADPCM_HEADER_BYTES;
+    const uint8_t * data = &block[IMA_ADPCM_HEADER_BYTES];
+
+    for (size_t i = 0; i < bytes; i++) {
+        samples[2 * i] = decodeSample(&predictor, &step_index, data[i] & 0x0F);
+        samples[2 * i + 1] = decodeSample(&predictor, &step_index, data[i] >> 4);
+    }
+
+    return 2 * bytes;
+}
+
+void ima_adpcm_benchmark(const int16_t * samples, size_t count, uint32_t iterations, ima_adpcm_benchmark_t * result) {
+    uint8_t block[IMA_ADPCM_BLOCK_BYTES];
+    int16_t reconstructed[IMA_ADPCM_BLOCK_SAMPLES];
+    int16_t decoded[IMA_ADPCM_BLOCK_SAMPLES];
+    ima_adpcm_state_t state;
+    int64_t encode_us = 0;
+    int64_t decode_us = 0;
+    double signal_power = 0.0;
+    double noise_power = 0.0;
+
+    memset(result, 0, sizeof(*result));
+    result->bit_exact = true;
+    count -= count % IMA_ADPCM_BLOCK_SAMPLES;
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        memset(&state, 0, sizeof(state));
+
+        for (size_t offset = 0; offset < count; offset += IMA_ADPCM_BLOCK_SAMPLES) {
+            int64_t start = nowMicroseconds();
+            size_t length = ima_adpcm_encode_block(&state, &samples[offset], IMA_ADPCM_BLOCK_SAMPLES, block,
+                                                   reconstructed);
+            int64_t middle = nowMicroseconds();
+            size_t decoded_count = ima_adpcm_decode_block(block, length, decoded);
+            decode_us += nowMicroseconds() - middle;
+            encode_us += middle - start;
+
+            if (decoded_count != IMA_ADPCM_BLOCK_SAMPLES ||
+                memcmp(decoded, reconstructed, sizeof(decoded)) != 0) {
+                result->bit_exact = false;
+            }
+
+            if (iteration == 0) {
+                for (size_t i = 0; i < IMA_ADPCM_BLOCK_SAMPLES; i++) {
+                    double error = (double)samples[offset + i] - decoded[i];
+                    signal_power += (double)samples[offset + i] * samples[offset + i];
+                    noise_power += error * error;
+                }
+            }
+        }
+    }
+
+    const uint64_t total = (uint64_t)count * iterations;
+    result->samples = (uint32_t)total;
+    result->encode_samples_per_s = encode_us > 0 ? (uint32_t)(total * 1000000 / (uint64_t)encode_us) : 0;
+    result->decode_samples_per_s = decode_us > 0 ? (uint32_t)(total * 1000000 / (uint64_t)decode_us) : 0;
+    result->snr_centi_db = noise_power > 0.0 ? (int32_t)(1000.0 * log10(signal_power / noise_power)) : INT32_MAX;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
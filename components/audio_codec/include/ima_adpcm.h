@@ -0,0 +1,114 @@
+/**
+  **********************************************************************************************************************
+  * @file    ima_adpcm.h
+  * @brief   This file is the header file for the IMA-ADPCM block codec
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _IMA_ADPCM_H_
+#define _IMA_ADPCM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Codec state shared by the encoder and the decoder */
+typedef struct ima_adpcm_state_t {
+    int16_t predictor;
+    uint8_t step_index;
+} ima_adpcm_state_t;
+
+/** @brief Benchmark results */
+typedef struct ima_adpcm_benchmark_t {
+    uint32_t samples;
+    uint32_t encode_samples_per_s;
+    uint32_t decode_samples_per_s;
+    int32_t snr_centi_db;
+    bool bit_exact;
+} ima_adpcm_benchmark_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Samples per block (16 ms at 16 kHz), even */
+#define IMA_ADPCM_BLOCK_SAMPLES 256
+
+/** @abstract Block header: predictor (int16 LE), step index, reserved */
+#define IMA_ADPCM_HEADER_BYTES 4
+
+/** @abstract Encoded block size: header followed by two 4-bit codes per byte, low nibble first */
+#define IMA_ADPCM_BLOCK_BYTES (IMA_ADPCM_HEADER_BYTES + IMA_ADPCM_BLOCK_SAMPLES / 2)
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ima_adpcm_encode_block
+ *
+ * @abstract This function encodes one block. The header stores the state at the start of the block so every block
+ *           decodes on its own and a lost notification does not corrupt the following ones.
+ *
+ * @param[in,out] state: Encoder state carried between blocks
+ *
+ * @param[in] samples: PCM samples
+ *
+ * @param[in] count: Number of samples, even, at most IMA_ADPCM_BLOCK_SAMPLES
+ *
+ * @param[out] block: Encoded block, IMA_ADPCM_HEADER_BYTES + count / 2 bytes
+ *
+ * @param[out] reconstructed: Samples as the decoder will reproduce them, may be NULL
+ *
+ * @return Encoded block size in bytes
+ */
+size_t ima_adpcm_encode_block(ima_adpcm_state_t * state, const int16_t * samples, size_t count, uint8_t * block,
+                              int16_t * reconstructed);
+
+/*
+ * @function ima_adpcm_decode_block
+ *
+ * @abstract This function decodes one block
+ *
+ * @param[in] block: Encoded block
+ *
+ * @param[in] length: Encoded block size in bytes
+ *
+ * @param[out] samples: PCM samples, 2 * (length - IMA_ADPCM_HEADER_BYTES) values
+ *
+ * @return Number of decoded samples, 0 if the block is malformed
+ */
+size_t ima_adpcm_decode_block(const uint8_t * block, size_t length, int16_t * samples);
+
+/*
+ * @function ima_adpcm_benchmark
+ *
+ * @abstract This function encodes and decodes a signal block by block, checks that the decoder reproduces the
+ *           encoder's reconstruction bit for bit and measures throughput and SNR
+ *
+ * @param[in] samples: PCM signal
+ *
+ * @param[in] count: Number of samples, multiple of IMA_ADPCM_BLOCK_SAMPLES
+ *
+ * @param[in] iterations: Number of passes over the signal
+ *
+ * @param[out] result: Benchmark results
+ *
+ * @return None
+ */
+void ima_adpcm_benchmark(const int16_t * samples, size_t count, uint32_t iterations, ima_adpcm_benchmark_t * result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _IMA_ADPCM_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
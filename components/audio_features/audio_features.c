@@ -0,0 +1,224 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_features.c
+  * @brief   This file is the breath-sound spectral feature extractor implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "audio_features.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract log2 of the FFT output scaling (1 / FFT_Q15_POINTS) applied to amplitudes */
+#define AUDIO_FEATURES_FFT_SCALE_LOG2 8
+/** @abstract Fraction bits of the logarithms used by the flatness measure */
+#define AUDIO_FEATURES_FLATNESS_LOG2_BITS 4
+/** @abstract Bins entering the flatness measure, DC excluded */
+#define AUDIO_FEATURES_FLATNESS_BINS (FFT_Q15_BINS - 1)
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract First bin of each band, log-spaced from ~30 Hz to Nyquist (bins of 31.25 Hz at 16 kHz) */
+static const uint16_t band_edges[AUDIO_FEATURES_BANDS + 1] = {
+    1, 3, 6, 12, 24, 48, 96, 160, FFT_Q15_BINS,
+};
+
+/** @abstract 2^(-i/16) in Q8, converts the fractional part of the log flatness back to a ratio */
+static const uint16_t flatness_fraction[1 << AUDIO_FEATURES_FLATNESS_LOG2_BITS] = {
+    256, 245, 235, 225, 215, 206, 197, 189, 181, 173, 166, 159, 152, 146, 140, 134,
+};
+
+/** @abstract FFT scratch buffer */
+static int16_t fft_work[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+
+/** @abstract Power spectrum of the current frame */
+static uint32_t fft_power[FFT_Q15_BINS];
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function log2Fixed
+ *
+ * @abstract This function returns log2 of a value in fixed point, linearly interpolated inside each octave
+ *
+ * @param[in] value: Input value
+ *
+ * @param[in] fraction_bits: Fraction bits of the result
+ *
+ * @return log2(value) * 2^fraction_bits, 0 for values below 1
+ */
+static int32_t log2Fixed(uint64_t value, uint32_t fraction_bits);
+
+/*
+ * @function flatness
+ *
+ * @abstract This function computes the spectral flatness of the power spectrum in fft_power
+ *
+ * @param[in] total: Sum of the power over AUDIO_FEATURES_FLATNESS_BINS bins
+ *
+ * @return Geometric over arithmetic mean in Q8, saturated to 255
+ */
+static uint8_t flatness(uint64_t total);
+
+/*
+ * @function energyToByte
+ *
+ * @abstract This function converts a scaled spectral energy to the transmitted log scale
+ *
+ * @param[in] energy: Energy summed from fft_q15_real_power output
+ *
+ * @param[in] exponent: Block exponent returned by fft_q15_real_power
+ *
+ * @return Energy in quarter log2 steps, saturated to 0..255
+ */
+static uint8_t energyToByte(uint64_t energy, int exponent);
+
+/*
+ * @function nowMicroseconds
+ *
+ * @abstract This function returns a monotonic timestamp
+ *
+ * @param None
+ *
+ * @return Time in microseconds
+ */
+static int64_t nowMicroseconds(void);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int32_t log2Fixed(uint64_t value, uint32_t fraction_bits) {
+    if (value == 0) {
+        return 0;
+    }
+
+    const int32_t msb = 63 - __builtin_clzll(value);
+    const uint32_t mask = (1u << fraction_bits) - 1;
+    const uint32_t fraction = msb >= (int32_t)fraction_bits ?
+            (uint32_t)(value >> (msb - (int32_t)fraction_bits)) & mask :
+            (uint32_t)(value << ((int32_t)fraction_bits - msb)) & mask;
+
+    return (msb << fraction_bits) + (int32_t)fraction;
+}
+
+static uint8_t flatness(uint64_t total) {
+    if (total == 0) {
+        return 0;
+    }
+
+    /* Both means in the log domain: log2(GM) is the mean of the logs, empty bins count as 1 */
+    int32_t log_sum = 0;
+    for (uint32_t k = 1; k <= AUDIO_FEATURES_FLATNESS_BINS; k++) {
+        log_sum += log2Fixed(fft_power[k] ? fft_power[k] : 1, AUDIO_FEATURES_FLATNESS_LOG2_BITS);
+    }
+
+    const int32_t log_geometric = log_sum / AUDIO_FEATURES_FLATNESS_BINS;
+    const int32_t log_arithmetic = log2Fixed(total / AUDIO_FEATURES_FLATNESS_BINS,
+                                             AUDIO_FEATURES_FLATNESS_LOG2_BITS);
+    const int32_t distance = log_arithmetic > log_geometric ? log_arithmetic - log_geometric : 0;
+    const uint32_t octaves = (uint32_t)distance >> AUDIO_FEATURES_FLATNESS_LOG2_BITS;
+
+    if (octaves >= 9) {
+        return 0;
+    }
+
+    const uint32_t ratio = flatness_fraction[distance & ((1 << AUDIO_FEATURES_FLATNESS_LOG2_BITS) - 1)] >> octaves;
+
+    return ratio > UINT8_MAX ? UINT8_MAX : (uint8_t)ratio;
+}
+
+static uint8_t energyToByte(uint64_t energy, int exponent) {
+    if (energy == 0) {
+        return 0;
+    }
+
+    int32_t value = log2Fixed(energy, 2) + 4 * 2 * (AUDIO_FEATURES_FFT_SCALE_LOG2 - exponent);
+
+    return value < 0 ? 0 : (value > UINT8_MAX ? UINT8_MAX : (uint8_t)value);
+}
+
+static int64_t nowMicroseconds(void) {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void audio_features_compute(const int16_t * frame, uint32_t sample_rate_hz, audio_features_t * features) {
+    uint16_t crossings = 0;
+
+    for (uint32_t n = 1; n < AUDIO_FEATURES_FRAME_SAMPLES; n++) {
+        crossings += (uint16_t)((frame[n - 1] < 0) != (frame[n] < 0));
+    }
+
+    const int exponent = fft_q15_real_power(frame, fft_work, fft_power);
+
+    uint64_t total = 0;
+    uint64_t weighted = 0;
+
+    for (uint32_t band = 0; band < AUDIO_FEATURES_BANDS; band++) {
+        uint64_t energy = 0;
+
+        for (uint32_t k = band_edges[band]; k < band_edges[band + 1]; k++) {
+            energy += fft_power[k];
+            weighted += (uint64_t)fft_power[k] * k;
+        }
+
+        features->band_energy[band] = energyToByte(energy, exponent);
+        total += energy;
+    }
+
+    features->frame_energy = energyToByte(total, exponent);
+    features->flatness = flatness(total);
+    features->centroid_hz = total > 0 ?
+            (uint16_t)(weighted * sample_rate_hz / (total * AUDIO_FEATURES_FRAME_SAMPLES)) : 0;
+    features->zero_crossings = crossings;
+}
+
+size_t audio_features_pack(const audio_features_t * features, uint8_t * record) {
+    memcpy(record, features->band_energy, AUDIO_FEATURES_BANDS);
+    record[AUDIO_FEATURES_BANDS] = features->frame_energy;
+    record[AUDIO_FEATURES_BANDS + 1] = features->flatness;
+    record[AUDIO_FEATURES_BANDS + 2] = (uint8_t)(features->centroid_hz & 0xFF);
+    record[AUDIO_FEATURES_BANDS + 3] = (uint8_t)(features->centroid_hz >> 8);
+    record[AUDIO_FEATURES_BANDS + 4] = (uint8_t)(features->zero_crossings & 0xFF);
+    record[AUDIO_FEATURES_BANDS + 5] = (uint8_t)(features->zero_crossings >> 8);
+
+    return AUDIO_FEATURES_RECORD_BYTES;
+}
+
+void audio_features_benchmark(uint32_t iterations, audio_features_benchmark_t * result) {
+    static int16_t frame[AUDIO_FEATURES_FRAME_SAMPLES];
+    audio_features_t features;
+    uint32_t noise = 0x2545F491;
+
+    for (uint32_t n = 0; n < AUDIO_FEATURES_FRAME_SAMPLES; n++) {
+        noise = noise * 1664525u + 1013904223u;
+        frame[n] = (int16_t)(noise >> 18);
+    }
+
+    const int64_t start = nowMicroseconds();
+    for (uint32_t i = 0; i < iterations; i++) {
+        audio_features_compute(frame, 16000, &features);
+    }
+    const int64_t elapsed = nowMicroseconds() - start;
+
+    result->frames = iterations;
+    result->frames_per_s = elapsed > 0 ? (uint32_t)((int64_t)iterations * 1000000 / elapsed) : 0;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
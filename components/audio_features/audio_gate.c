@@ -0,0 +1,150 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_gate.c
+  * @brief   This file is the breath-sound activity gate implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "audio_gate.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Fraction bits of the noise floor tracker */
+#define AUDIO_GATE_FLOOR_FRACTION_BITS 4
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Delay line holding the pre-roll frames */
+static int16_t delay_frames[AUDIO_GATE_PREROLL_FRAMES][AUDIO_FEATURES_FRAME_SAMPLES];
+
+/** @abstract Features of the frames in the delay line */
+static audio_features_t delay_features[AUDIO_GATE_PREROLL_FRAMES];
+
+/** @abstract Slot of the oldest frame in the delay line */
+static uint32_t delay_head = 0;
+
+/** @abstract Flag storing whether frames are filtered */
+static bool gate_enabled = true;
+
+/** @abstract Noise floor in quarter log2 steps with AUDIO_GATE_FLOOR_FRACTION_BITS fraction bits */
+static int32_t noise_floor = -1;
+
+/** @abstract Consecutive active frames */
+static uint32_t active_run = 0;
+
+/** @abstract Delayed frames still to release after the last trigger */
+static uint32_t open_countdown = 0;
+
+/** @abstract Gate statistics */
+static audio_gate_stats_t stats;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function isActive
+ *
+ * @abstract This function classifies a frame as breath sound and tracks the noise floor
+ *
+ * @param[in] features: Frame features
+ *
+ * @return true if the frame is loud and noise-like enough
+ */
+static bool isActive(const audio_features_t * features);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static bool isActive(const audio_features_t * features) {
+    const int32_t energy = (int32_t)features->frame_energy << AUDIO_GATE_FLOOR_FRACTION_BITS;
+
+    /* Follow quiet frames quickly and let the floor creep up slowly so breaths do not raise it */
+    if (noise_floor < 0) {
+        noise_floor = energy;
+    } else if (energy < noise_floor) {
+        noise_floor -= (noise_floor - energy) >> 2;
+    } else {
+        noise_floor += AUDIO_GATE_FLOOR_RISE;
+    }
+
+    stats.noise_floor = (uint8_t)(noise_floor >> AUDIO_GATE_FLOOR_FRACTION_BITS);
+
+    return features->frame_energy >= stats.noise_floor + AUDIO_GATE_ENERGY_MARGIN &&
+           features->flatness >= AUDIO_GATE_FLATNESS_MIN;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void audio_gate_init(bool enabled) {
+    gate_enabled = enabled;
+    delay_head = 0;
+    noise_floor = -1;
+    active_run = 0;
+    open_countdown = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+void audio_gate_set_enabled(bool enabled) {
+    gate_enabled = enabled;
+}
+
+bool audio_gate_process(const int16_t * frame, const audio_features_t * features, int16_t * delayed_frame,
+                        audio_features_t * delayed_features) {
+    const bool warm = stats.frames_in >= AUDIO_GATE_PREROLL_FRAMES;
+
+    stats.frames_in++;
+
+    if (isActive(features)) {
+        stats.active_frames++;
+        active_run++;
+    } else {
+        active_run = 0;
+    }
+
+    /* A trigger covers every delayed frame from the pre-roll before it to the end of the hangover after it */
+    if (active_run >= AUDIO_GATE_ATTACK_FRAMES) {
+        open_countdown = AUDIO_GATE_PREROLL_FRAMES + AUDIO_GATE_HANGOVER_FRAMES + 1;
+    }
+
+    /* Swap the new frame into the slot of the oldest one */
+    if (warm) {
+        memcpy(delayed_frame, delay_frames[delay_head], sizeof(delay_frames[0]));
+        *delayed_features = delay_features[delay_head];
+    }
+    memcpy(delay_frames[delay_head], frame, sizeof(delay_frames[0]));
+    delay_features[delay_head] = *features;
+    delay_head = (delay_head + 1) % AUDIO_GATE_PREROLL_FRAMES;
+
+    const bool open = warm && open_countdown > 0;
+    if (open_countdown > 0) {
+        open_countdown--;
+    }
+
+    if (open && !stats.open) {
+        stats.events++;
+    }
+    stats.open = open;
+
+    if (!warm) {
+        return false;
+    }
+
+    if (open) {
+        stats.frames_open++;
+    }
+    if (open || !gate_enabled) {
+        stats.frames_streamed++;
+        return true;
+    }
+
+    return false;
+}
+
+void audio_gate_get_stats(audio_gate_stats_t * out) {
+    *out = stats;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
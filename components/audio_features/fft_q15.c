@@ -0,0 +1,325 @@
+/**
+  **********************************************************************************************************************
+  * @file    fft_q15.c
+  * @brief   This file is the fixed-point radix-4 FFT implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include "fft_q15.h"
+#ifdef ESP_PLATFORM
+#include "esp_attr.h"
+#endif
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Largest component magnitude fed to the butterflies */
+#define FFT_Q15_HEADROOM_LIMIT (1 << 14)
+/** @abstract Twiddle fraction bits, Q14 keeps unity exact so W^0 leaves a butterfly output unchanged */
+#define FFT_Q15_TWIDDLE_SHIFT 14
+/** @abstract Frames fft_q15_check_kernel runs through both kernels */
+#define FFT_Q15_CHECK_FRAMES 4
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#ifdef ESP_PLATFORM
+#define FFT_Q15_HOT IRAM_ATTR
+#else
+#define FFT_Q15_HOT
+#endif
+
+#define mulQ15(a, b) ((int32_t)(((int32_t)(a) * (int32_t)(b) + (1 << 14)) >> 15))
+#define halve(value) ((int32_t)(value) >> 1)
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Currently selected butterfly kernel */
+static fft_q15_kernel_t fft_kernel = FFT_Q15_KERNEL_SIMD;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+#if FFT_Q15_HAS_SIMD
+/*
+ * @function fft_q15_stage_s3
+ *
+ * @abstract This function runs one radix-4 stage with the ESP32-S3 vector unit (fft_q15_s3.S), four butterflies per
+ *           iteration with the arithmetic of butterfly
+ *
+ * @param[in,out] data: FFT_Q15_POINTS interleaved values, 16-byte aligned
+ *
+ * @param[in] twiddles: Stage twiddles from fft_q15_stage_twiddles, 16-byte aligned
+ *
+ * @param[in] quarter: Butterflies per group, a multiple of FFT_Q15_VECTOR_BUTTERFLIES
+ *
+ * @param[in] groups: Number of groups
+ *
+ * @return None
+ */
+extern void fft_q15_stage_s3(int16_t * data, const int16_t * twiddles, uint32_t quarter, uint32_t groups);
+#endif
+
+/*
+ * @function rotate
+ *
+ * @abstract This function multiplies a complex value by a Q14 twiddle, truncating, and stores it
+ *
+ * @param[in] re: Real part
+ *
+ * @param[in] im: Imaginary part
+ *
+ * @param[in] twiddle: Interleaved Q15 twiddle
+ *
+ * @param[out] out: Interleaved destination
+ *
+ * @return None
+ */
+static inline void rotate(int32_t re, int32_t im, const int16_t * twiddle, int16_t * out);
+
+/*
+ * @function butterfly
+ *
+ * @abstract This function computes one radix-4 butterfly in place, lane for lane what the vector kernel computes
+ *
+ * @param[in,out] x0: First input, the others follow at quarter complex values apart
+ *
+ * @param[in] quarter: Distance between the inputs in complex values
+ *
+ * @param[in] twiddle: W^k of this butterfly, W^2k and W^3k follow 8 values later each; NULL for W^0
+ *
+ * @return None
+ */
+static inline void butterfly(int16_t * x0, uint32_t quarter, const int16_t * twiddle);
+
+/*
+ * @function stageReference
+ *
+ * @abstract This function runs one radix-4 stage in portable C
+ *
+ * @param[in,out] data: FFT_Q15_POINTS interleaved values
+ *
+ * @param[in] twiddles: Stage twiddles from fft_q15_stage_twiddles
+ *
+ * @param[in] quarter: Butterflies per group
+ *
+ * @param[in] groups: Number of groups
+ *
+ * @return None
+ */
+static void stageReference(int16_t * data, const int16_t * twiddles, uint32_t quarter, uint32_t groups);
+
+/*
+ * @function fillCheckFrame
+ *
+ * @abstract This function fills one of the fft_q15_check_kernel test frames: noise, full-scale corners, an impulse
+ *           and a full-scale constant
+ *
+ * @param[in] index: Frame index, below FFT_Q15_CHECK_FRAMES
+ *
+ * @param[out] data: FFT_Q15_POINTS interleaved values
+ *
+ * @return None
+ */
+static void fillCheckFrame(uint32_t index, int16_t * data);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static inline void rotate(int32_t re, int32_t im, const int16_t * twiddle, int16_t * out) {
+    out[0] = (int16_t)((re * twiddle[0] - im * twiddle[1]) >> FFT_Q15_TWIDDLE_SHIFT);
+    out[1] = (int16_t)((re * twiddle[1] + im * twiddle[0]) >> FFT_Q15_TWIDDLE_SHIFT);
+}
+
+static inline void butterfly(int16_t * x0, uint32_t quarter, const int16_t * twiddle) {
+    int16_t * x1 = x0 + 2 * quarter;
+    int16_t * x2 = x1 + 2 * quarter;
+    int16_t * x3 = x2 + 2 * quarter;
+
+    /* Halving before and after the first additions scales by 1/4 and keeps every sum within 16 bits */
+    const int32_t t0r = halve(halve(x0[0]) + halve(x2[0])), t0i = halve(halve(x0[1]) + halve(x2[1]));
+    const int32_t t1r = halve(halve(x0[0]) - halve(x2[0])), t1i = halve(halve(x0[1]) - halve(x2[1]));
+    const int32_t t2r = halve(halve(x1[0]) + halve(x3[0])), t2i = halve(halve(x1[1]) + halve(x3[1]));
+    const int32_t t3r = halve(halve(x1[0]) - halve(x3[0])), t3i = halve(halve(x1[1]) - halve(x3[1]));
+
+    x0[0] = (int16_t)(t0r + t2r);
+    x0[1] = (int16_t)(t0i + t2i);
+
+    if (twiddle == NULL) {
+        x1[0] = (int16_t)(t1r + t3i);
+        x1[1] = (int16_t)(t1i - t3r);
+        x2[0] = (int16_t)(t0r - t2r);
+        x2[1] = (int16_t)(t0i - t2i);
+        x3[0] = (int16_t)(t1r - t3i);
+        x3[1] = (int16_t)(t1i + t3r);
+    } else {
+        rotate(t1r + t3i, t1i - t3r, twiddle, x1);
+        rotate(t0r - t2r, t0i - t2i, twiddle + 8, x2);
+        rotate(t1r - t3i, t1i + t3r, twiddle + 16, x3);
+    }
+}
+
+static void stageReference(int16_t * data, const int16_t * twiddles, uint32_t quarter, uint32_t groups) {
+    for (uint32_t group = 0; group < groups; group++) {
+        int16_t * base = &data[8 * quarter * group];
+
+        for (uint32_t k = 0; k < quarter; k++) {
+            /* Twiddles are stored as W^k, W^2k, W^3k vectors of FFT_Q15_VECTOR_BUTTERFLIES values each */
+            const uint32_t block = k / FFT_Q15_VECTOR_BUTTERFLIES;
+            const uint32_t lane = k % FFT_Q15_VECTOR_BUTTERFLIES;
+            butterfly(&base[2 * k], quarter, &twiddles[24 * block + 2 * lane]);
+        }
+    }
+}
+
+static void fillCheckFrame(uint32_t index, int16_t * data) {
+    uint32_t noise = 0x2545F491;
+
+    for (uint32_t n = 0; n < 2 * FFT_Q15_POINTS; n++) {
+        noise = noise * 1664525u + 1013904223u;
+
+        switch (index) {
+            case 0:
+                data[n] = (int16_t)((int32_t)(noise >> 17) - FFT_Q15_HEADROOM_LIMIT);
+                break;
+            case 1:
+                data[n] = (noise & 0x80000000u) ? FFT_Q15_HEADROOM_LIMIT : -FFT_Q15_HEADROOM_LIMIT;
+                break;
+            case 2:
+                data[n] = (n == 2) ? FFT_Q15_HEADROOM_LIMIT : 0;
+                break;
+            default:
+                data[n] = (n & 1) ? -FFT_Q15_HEADROOM_LIMIT : FFT_Q15_HEADROOM_LIMIT;
+                break;
+        }
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void fft_q15_set_kernel(fft_q15_kernel_t kernel) {
+    fft_kernel = kernel;
+}
+
+bool fft_q15_check_kernel(int16_t * work) {
+    const fft_q15_kernel_t previous_kernel = fft_kernel;
+    bool bit_exact = true;
+
+    for (uint32_t frame = 0; frame < FFT_Q15_CHECK_FRAMES && bit_exact; frame++) {
+        uint32_t reference_hash = 2166136261u;
+        uint32_t simd_hash = 2166136261u;
+
+        /* FNV-1a over the output, so the check needs a single frame buffer */
+        fft_q15_set_kernel(FFT_Q15_KERNEL_REFERENCE);
+        fillCheckFrame(frame, work);
+        fft_q15_complex(work);
+        for (uint32_t n = 0; n < 2 * FFT_Q15_POINTS; n++) {
+            reference_hash = (reference_hash ^ (uint16_t)work[n]) * 16777619u;
+        }
+
+        fft_q15_set_kernel(FFT_Q15_KERNEL_SIMD);
+        fillCheckFrame(frame, work);
+        fft_q15_complex(work);
+        for (uint32_t n = 0; n < 2 * FFT_Q15_POINTS; n++) {
+            simd_hash = (simd_hash ^ (uint16_t)work[n]) * 16777619u;
+        }
+
+        bit_exact = reference_hash == simd_hash;
+    }
+
+    fft_q15_set_kernel(bit_exact ? previous_kernel : FFT_Q15_KERNEL_REFERENCE);
+
+    return bit_exact;
+}
+
+FFT_Q15_HOT void fft_q15_complex(int16_t * data) {
+    const int16_t * twiddles = fft_q15_stage_twiddles;
+
+    for (uint32_t quarter = FFT_Q15_POINTS / 4; quarter >= FFT_Q15_VECTOR_BUTTERFLIES; quarter >>= 2) {
+        const uint32_t groups = FFT_Q15_POINTS / (4 * quarter);
+
+#if FFT_Q15_HAS_SIMD
+        if (fft_kernel == FFT_Q15_KERNEL_SIMD) {
+            fft_q15_stage_s3(data, twiddles, quarter, groups);
+        } else {
+            stageReference(data, twiddles, quarter, groups);
+        }
+#else
+        stageReference(data, twiddles, quarter, groups);
+#endif
+        twiddles += 6 * quarter;
+    }
+
+    /* The last stage combines neighbours inside one vector and needs no twiddles, it stays scalar */
+    for (uint32_t base = 0; base < FFT_Q15_POINTS; base += 4) {
+        butterfly(&data[2 * base], 1, NULL);
+    }
+
+    /* Undo the base-4 digit-reversed output order */
+    for (uint32_t i = 0; i < FFT_Q15_POINTS; i++) {
+        const uint32_t j = fft_q15_digit_reverse[i];
+        if (j > i) {
+            int16_t re = data[2 * i];
+            int16_t im = data[2 * i + 1];
+            data[2 * i] = data[2 * j];
+            data[2 * i + 1] = data[2 * j + 1];
+            data[2 * j] = re;
+            data[2 * j + 1] = im;
+        }
+    }
+}
+
+FFT_Q15_HOT int fft_q15_real_power(const int16_t * samples, int16_t * work, uint32_t * power) {
+    int32_t peak = 0;
+
+    /* Window, pack even samples as real and odd samples as imaginary parts */
+    for (uint32_t n = 0; n < FFT_Q15_REAL_POINTS; n++) {
+        int32_t value = mulQ15(samples[n], fft_q15_hann[n]);
+        work[n] = (int16_t)value;
+        if (abs(value) > peak) {
+            peak = abs(value);
+        }
+    }
+
+    /* Block floating point: scale so the largest component sits just below the butterfly headroom limit */
+    int exponent = 0;
+    if (peak >= FFT_Q15_HEADROOM_LIMIT) {
+        exponent = -1;
+    } else if (peak > 0) {
+        while ((peak << (exponent + 1)) < FFT_Q15_HEADROOM_LIMIT) {
+            exponent++;
+        }
+    }
+
+    for (uint32_t n = 0; n < FFT_Q15_REAL_POINTS; n++) {
+        work[n] = (int16_t)(exponent >= 0 ? work[n] * (1 << exponent) : work[n] >> 1);
+    }
+
+    fft_q15_complex(work);
+
+    /* Split the packed spectrum: X[k] = (Z[k] + Z*[M-k]) / 2 - j * W^k * (Z[k] - Z*[M-k]) / 2 */
+    const int32_t dc_re = work[0];
+    const int32_t dc_im = work[1];
+    power[0] = (uint32_t)((dc_re + dc_im) * (dc_re + dc_im));
+    power[FFT_Q15_POINTS] = (uint32_t)((dc_re - dc_im) * (dc_re - dc_im));
+
+    for (uint32_t k = 1; k < FFT_Q15_POINTS; k++) {
+        const int32_t ar = work[2 * k];
+        const int32_t ai = work[2 * k + 1];
+        const int32_t br = work[2 * (FFT_Q15_POINTS - k)];
+        const int32_t bi = -work[2 * (FFT_Q15_POINTS - k) + 1];
+
+        const int32_t er = (ar + br) >> 1;
+        const int32_t ei = (ai + bi) >> 1;
+        const int32_t pr = (ai - bi) >> 1;
+        const int32_t pi = -((ar - br) >> 1);
+
+        const int16_t * twiddle = &fft_q15_split_twiddles[2 * k];
+        const int32_t xr = er + mulQ15(pr, twiddle[0]) - mulQ15(pi, twiddle[1]);
+        const int32_t xi = ei + mulQ15(pr, twiddle[1]) + mulQ15(pi, twiddle[0]);
+
+        power[k] = (uint32_t)(xr * xr) + (uint32_t)(xi * xi);
+    }
+
+    return exponent;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,184 @@
+/**
+  **********************************************************************************************************************
+  * @file    fft_q15_tables.c
+  * @brief   This file holds the precomputed FFT tables, kept in flash
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include "fft_q15.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+/** @abstract Radix-4 twiddles exp(-j*2*pi*m/256) in Q14, per stage and per four butterflies: W^k, W^2k, W^3k */
+const int16_t fft_q15_stage_twiddles[FFT_Q15_STAGE_TWIDDLES] __attribute__((aligned(FFT_Q15_ALIGN))) = {
+    /* quarter 64, stride 1 */
+    16384, 0, 16379, -402, 16364, -804, 16340, -1205,
+    16384, 0, 16364, -804, 16305, -1606, 16207, -2404,
+    16384, 0, 16340, -1205, 16207, -2404, 15986, -3590,
+    16305, -1606, 16261, -2006, 16207, -2404, 16143, -2801,
+    16069, -3196, 15893, -3981, 15679, -4756, 15426, -5520,
+    15679, -4756, 15286, -5897, 14811, -7005, 14256, -8076,
+    16069, -3196, 15986, -3590, 15893, -3981, 15791, -4370,
+    15137, -6270, 14811, -7005, 14449, -7723, 14053, -8423,
+    13623, -9102, 12916, -10080, 12140, -11003, 11297, -11866,
+    15679, -4756, 15557, -5139, 15426, -5520, 15286, -5897,
+    13623, -9102, 13160, -9760, 12665, -10394, 12140, -11003,
+    10394, -12665, 9434, -13395, 8423, -14053, 7366, -14635,
+    15137, -6270, 14978, -6639, 14811, -7005, 14635, -7366,
+    11585, -11585, 11003, -12140, 10394, -12665, 9760, -13160,
+    6270, -15137, 5139, -15557, 3981, -15893, 2801, -16143,
+    14449, -7723, 14256, -8076, 14053, -8423, 13842, -8765,
+    9102, -13623, 8423, -14053, 7723, -14449, 7005, -14811,
+    1606, -16305, 402, -16379, -804, -16364, -2006, -16261,
+    13623, -9102, 13395, -9434, 13160, -9760, 12916, -10080,
+    6270, -15137, 5520, -15426, 4756, -15679, 3981, -15893,
+    -3196, -16069, -4370, -15791, -5520, -15426, -6639, -14978,
+    12665, -10394, 12406, -10702, 12140, -11003, 11866, -11297,
+    3196, -16069, 2404, -16207, 1606, -16305, 804, -16364,
+    -7723, -14449, -8765, -13842, -9760, -13160, -10702, -12406,
+    11585, -11585, 11297, -11866, 11003, -12140, 10702, -12406,
+    0, -16384, -804, -16364, -1606, -16305, -2404, -16207,
+    -11585, -11585, -12406, -10702, -13160, -9760, -13842, -8765,
+    10394, -12665, 10080, -12916, 9760, -13160, 9434, -13395,
+    -3196, -16069, -3981, -15893, -4756, -15679, -5520, -15426,
+    -14449, -7723, -14978, -6639, -15426, -5520, -15791, -4370,
+    9102, -13623, 8765, -13842, 8423, -14053, 8076, -14256,
+    -6270, -15137, -7005, -14811, -7723, -14449, -8423, -14053,
+    -16069, -3196, -16261, -2006, -16364, -804, -16379, 402,
+    7723, -14449, 7366, -14635, 7005, -14811, 6639, -14978,
+    -9102, -13623, -9760, -13160, -10394, -12665, -11003, -12140,
+    -16305, 1606, -16143, 2801, -15893, 3981, -15557, 5139,
+    6270, -15137, 5897, -15286, 5520, -15426, 5139, -15557,
+    -11585, -11585, -12140, -11003, -12665, -10394, -13160, -9760,
+    -15137, 6270, -14635, 7366, -14053, 8423, -13395, 9434,
+    4756, -15679, 4370, -15791, 3981, -15893, 3590, -15986,
+    -13623, -9102, -14053, -8423, -14449, -7723, -14811, -7005,
+    -12665, 10394, -11866, 11297, -11003, 12140, -10080, 12916,
+    3196, -16069, 2801, -16143, 2404, -16207, 2006, -16261,
+    -15137, -6270, -15426, -5520, -15679, -4756, -15893, -3981,
+    -9102, 13623, -8076, 14256, -7005, 14811, -5897, 15286,
+    1606, -16305, 1205, -16340, 804, -16364, 402, -16379,
+    -16069, -3196, -16207, -2404, -16305, -1606, -16364, -804,
+    -4756, 15679, -3590, 15986, -2404, 16207, -1205, 16340,
+    /* quarter 16, stride 4 */
+    16384, 0, 16305, -1606, 16069, -3196, 15679, -4756,
+    16384, 0, 16069, -3196, 15137, -6270, 13623, -9102,
+    16384, 0, 15679, -4756, 13623, -9102, 10394, -12665,
+    15137, -6270, 14449, -7723, 13623, -9102, 12665, -10394,
+    11585, -11585, 9102, -13623, 6270, -15137, 3196, -16069,
+    6270, -15137, 1606, -16305, -3196, -16069, -7723, -14449,
+    11585, -11585, 10394, -12665, 9102, -13623, 7723, -14449,
+    0, -16384, -3196, -16069, -6270, -15137, -9102, -13623,
+    -11585, -11585, -14449, -7723, -16069, -3196, -16305, 1606,
+    6270, -15137, 4756, -15679, 3196, -16069, 1606, -16305,
+    -11585, -11585, -13623, -9102, -15137, -6270, -16069, -3196,
+    -15137, 6270, -12665, 10394, -9102, 13623, -4756, 15679,
+    /* quarter 4, stride 16 */
+    16384, 0, 15137, -6270, 11585, -11585, 6270, -15137,
+    16384, 0, 11585, -11585, 0, -16384, -11585, -11585,
+    16384, 0, 6270, -15137, -11585, -11585, -15137, 6270,
+};
+
+/** @abstract Real-FFT split twiddles exp(-j*2*pi*k/512), interleaved real/imaginary Q15 */
+const int16_t fft_q15_split_twiddles[2 * FFT_Q15_POINTS] = {
+    32767, 0, 32766, -402, 32758, -804, 32746, -1206, 32729, -1608, 32706, -2009, 32679, -2411, 32647, -2811,
+    32610, -3212, 32568, -3612, 32522, -4011, 32470, -4410, 32413, -4808, 32352, -5205, 32286, -5602, 32214, -5998,
+    32138, -6393, 32058, -6787, 31972, -7180, 31881, -7571, 31786, -7962, 31686, -8351, 31581, -8740, 31471, -9127,
+    31357, -9512, 31238, -9896, 31114, -10279, 30986, -10660, 30853, -11039, 30715, -11417, 30572, -11793, 30425, -12167,
+    30274, -12540, 30118, -12910, 29957, -13279, 29792, -13646, 29622, -14010, 29448, -14373, 29269, -14733, 29086, -15091,
+    28899, -15447, 28707, -15800, 28511, -16151, 28311, -16500, 28106, -16846, 27897, -17190, 27684, -17531, 27467, -17869,
+    27246, -18205, 27020, -18538, 26791, -18868, 26557, -19195, 26320, -19520, 26078, -19841, 25833, -20160, 25583, -20475,
+    25330, -20788, 25073, -21097, 24812, -21403, 24548, -21706, 24279, -22006, 24008, -22302, 23732, -22595, 23453, -22884,
+    23170, -23170, 22884, -23453, 22595, -23732, 22302, -24008, 22006, -24279, 21706, -24548, 21403, -24812, 21097, -25073,
+    20788, -25330, 20475, -25583, 20160, -25833, 19841, -26078, 19520, -26320, 19195, -26557, 18868, -26791, 18538, -27020,
+    18205, -27246, 17869, -27467, 17531, -27684, 17190, -27897, 16846, -28106, 16500, -28311, 16151, -28511, 15800, -28707,
+    15447, -28899, 15091, -29086, 14733, -29269, 14373, -29448, 14010, -29622, 13646, -29792, 13279, -29957, 12910, -30118,
+    12540, -30274, 12167, -30425, 11793, -30572, 11417, -30715, 11039, -30853, 10660, -30986, 10279, -31114, 9896, -31238,
+    9512, -31357, 9127, -31471, 8740, -31581, 8351, -31686, 7962, -31786, 7571, -31881, 7180, -31972, 6787, -32058,
+    6393, -32138, 5998, -32214, 5602, -32286, 5205, -32352, 4808, -32413, 4410, -32470, 4011, -32522, 3612, -32568,
+    3212, -32610, 2811, -32647, 2411, -32679, 2009, -32706, 1608, -32729, 1206, -32746, 804, -32758, 402, -32766,
+    0, -32768, -402, -32766, -804, -32758, -1206, -32746, -1608, -32729, -2009, -32706, -2411, -32679, -2811, -32647,
+    -3212, -32610, -3612, -32568, -4011, -32522, -4410, -32470, -4808, -32413, -5205, -32352, -5602, -32286, -5998, -32214,
+    -6393, -32138, -6787, -32058, -7180, -31972, -7571, -31881, -7962, -31786, -8351, -31686, -8740, -31581, -9127, -31471,
+    -9512, -31357, -9896, -31238, -10279, -31114, -10660, -30986, -11039, -30853, -11417, -30715, -11793, -30572, -12167, -30425,
+    -12540, -30274, -12910, -30118, -13279, -29957, -13646, -29792, -14010, -29622, -14373, -29448, -14733, -29269, -15091, -29086,
+    -15447, -28899, -15800, -28707, -16151, -28511, -16500, -28311, -16846, -28106, -17190, -27897, -17531, -27684, -17869, -27467,
+    -18205, -27246, -18538, -27020, -18868, -26791, -19195, -26557, -19520, -26320, -19841, -26078, -20160, -25833, -20475, -25583,
+    -20788, -25330, -21097, -25073, -21403, -24812, -21706, -24548, -22006, -24279, -22302, -24008, -22595, -23732, -22884, -23453,
+    -23170, -23170, -23453, -22884, -23732, -22595, -24008, -22302, -24279, -22006, -24548, -21706, -24812, -21403, -25073, -21097,
+    -25330, -20788, -25583, -20475, -25833, -20160, -26078, -19841, -26320, -19520, -26557, -19195, -26791, -18868, -27020, -18538,
+    -27246, -18205, -27467, -17869, -27684, -17531, -27897, -17190, -28106, -16846, -28311, -16500, -28511, -16151, -28707, -15800,
+    -28899, -15447, -29086, -15091, -29269, -14733, -29448, -14373, -29622, -14010, -29792, -13646, -29957, -13279, -30118, -12910,
+    -30274, -12540, -30425, -12167, -30572, -11793, -30715, -11417, -30853, -11039, -30986, -10660, -31114, -10279, -31238, -9896,
+    -31357, -9512, -31471, -9127, -31581, -8740, -31686, -8351, -31786, -7962, -31881, -7571, -31972, -7180, -32058, -6787,
+    -32138, -6393, -32214, -5998, -32286, -5602, -32352, -5205, -32413, -4808, -32470, -4410, -32522, -4011, -32568, -3612,
+    -32610, -3212, -32647, -2811, -32679, -2411, -32706, -2009, -32729, -1608, -32746, -1206, -32758, -804, -32766, -402,
+};
+
+/** @abstract Base-4 digit reversal permutation */
+const uint8_t fft_q15_digit_reverse[FFT_Q15_POINTS] = {
+    0, 64, 128, 192, 16, 80, 144, 208, 32, 96, 160, 224, 48, 112, 176, 240,
+    4, 68, 132, 196, 20, 84, 148, 212, 36, 100, 164, 228, 52, 116, 180, 244,
+    8, 72, 136, 200, 24, 88, 152, 216, 40, 104, 168, 232, 56, 120, 184, 248,
+    12, 76, 140, 204, 28, 92, 156, 220, 44, 108, 172, 236, 60, 124, 188, 252,
+    1, 65, 129, 193, 17, 81, 145, 209, 33, 97, 161, 225, 49, 113, 177, 241,
+    5, 69, 133, 197, 21, 85, 149, 213, 37, 101, 165, 229, 53, 117, 181, 245,
+    9, 73, 137, 201, 25, 89, 153, 217, 41, 105, 169, 233, 57, 121, 185, 249,
+    13, 77, 141, 205, 29, 93, 157, 221, 45, 109, 173, 237, 61, 125, 189, 253,
+    2, 66, 130, 194, 18, 82, 146, 210, 34, 98, 162, 226, 50, 114, 178, 242,
+    6, 70, 134, 198, 22, 86, 150, 214, 38, 102, 166, 230, 54, 118, 182, 246,
+    10, 74, 138, 202, 26, 90, 154, 218, 42, 106, 170, 234, 58, 122, 186, 250,
+    14, 78, 142, 206, 30, 94, 158, 222, 46, 110, 174, 238, 62, 126, 190, 254,
+    3, 67, 131, 195, 19, 83, 147, 211, 35, 99, 163, 227, 51, 115, 179, 243,
+    7, 71, 135, 199, 23, 87, 151, 215, 39, 103, 167, 231, 55, 119, 183, 247,
+    11, 75, 139, 203, 27, 91, 155, 219, 43, 107, 171, 235, 59, 123, 187, 251,
+    15, 79, 143, 207, 31, 95, 159, 223, 47, 111, 175, 239, 63, 127, 191, 255,
+};
+
+/** @abstract Periodic Hann window, Q15 */
+const int16_t fft_q15_hann[FFT_Q15_REAL_POINTS] = {
+    0, 1, 5, 11, 20, 31, 44, 60, 79, 100, 123, 149, 177, 208, 241, 277,
+    315, 355, 398, 443, 491, 541, 593, 648, 705, 765, 827, 891, 958, 1027, 1098, 1171,
+    1247, 1325, 1406, 1488, 1573, 1660, 1749, 1841, 1935, 2030, 2128, 2229, 2331, 2435, 2542, 2651,
+    2761, 2874, 2989, 3105, 3224, 3345, 3468, 3592, 3719, 3847, 3978, 4110, 4244, 4380, 4518, 4657,
+    4799, 4942, 5087, 5233, 5381, 5531, 5682, 5835, 5990, 6146, 6304, 6463, 6624, 6786, 6950, 7115,
+    7282, 7449, 7619, 7789, 7961, 8134, 8308, 8484, 8661, 8839, 9018, 9198, 9379, 9561, 9745, 9929,
+    10114, 10300, 10487, 10676, 10864, 11054, 11245, 11436, 11628, 11821, 12014, 12208, 12403, 12598, 12794, 12991,
+    13188, 13385, 13583, 13781, 13980, 14179, 14378, 14578, 14778, 14978, 15179, 15379, 15580, 15781, 15982, 16183,
+    16384, 16585, 16786, 16987, 17188, 17389, 17589, 17790, 17990, 18190, 18390, 18589, 18788, 18987, 19185, 19383,
+    19580, 19777, 19974, 20170, 20365, 20560, 20754, 20947, 21140, 21332, 21523, 21714, 21904, 22092, 22281, 22468,
+    22654, 22839, 23023, 23207, 23389, 23570, 23750, 23929, 24107, 24284, 24460, 24634, 24807, 24979, 25149, 25319,
+    25486, 25653, 25818, 25982, 26144, 26305, 26464, 26622, 26778, 26933, 27086, 27237, 27387, 27535, 27681, 27826,
+    27969, 28111, 28250, 28388, 28524, 28658, 28790, 28921, 29049, 29176, 29300, 29423, 29544, 29663, 29779, 29894,
+    30007, 30117, 30226, 30333, 30437, 30539, 30640, 30738, 30833, 30927, 31019, 31108, 31195, 31280, 31362, 31443,
+    31521, 31597, 31670, 31741, 31810, 31877, 31941, 32003, 32063, 32120, 32175, 32227, 32277, 32325, 32370, 32413,
+    32453, 32491, 32527, 32560, 32591, 32619, 32645, 32668, 32689, 32708, 32724, 32737, 32748, 32757, 32763, 32767,
+    32767, 32767, 32763, 32757, 32748, 32737, 32724, 32708, 32689, 32668, 32645, 32619, 32591, 32560, 32527, 32491,
+    32453, 32413, 32370, 32325, 32277, 32227, 32175, 32120, 32063, 32003, 31941, 31877, 31810, 31741, 31670, 31597,
+    31521, 31443, 31362, 31280, 31195, 31108, 31019, 30927, 30833, 30738, 30640, 30539, 30437, 30333, 30226, 30117,
+    30007, 29894, 29779, 29663, 29544, 29423, 29300, 29176, 29049, 28921, 28790, 28658, 28524, 28388, 28250, 28111,
+    27969, 27826, 27681, 27535, 27387, 27237, 27086, 26933, 26778, 26622, 26464, 26305, 26144, 25982, 25818, 25653,
+    25486, 25319, 25149, 24979, 24807, 24634, 24460, 24284, 24107, 23929, 23750, 23570, 23389, 23207, 23023, 22839,
+    22654, 22468, 22281, 22092, 21904, 21714, 21523, 21332, 21140, 20947, 20754, 20560, 20365, 20170, 19974, 19777,
+    19580, 19383, 19185, 18987, 18788, 18589, 18390, 18190, 17990, 17790, 17589, 17389, 17188, 16987, 16786, 16585,
+    16384, 16183, 15982, 15781, 15580, 15379, 15179, 14978, 14778, 14578, 14378, 14179, 13980, 13781, 13583, 13385,
+    13188, 12991, 12794, 12598, 12403, 12208, 12014, 11821, 11628, 11436, 11245, 11054, 10864, 10676, 10487, 10300,
+    10114, 9929, 9745, 9561, 9379, 9198, 9018, 8839, 8661, 8484, 8308, 8134, 7961, 7789, 7619, 7449,
+    7282, 7115, 6950, 6786, 6624, 6463, 6304, 6146, 5990, 5835, 5682, 5531, 5381, 5233, 5087, 4942,
+    4799, 4657, 4518, 4380, 4244, 4110, 3978, 3847, 3719, 3592, 3468, 3345, 3224, 3105, 2989, 2874,
+    2761, 2651, 2542, 2435, 2331, 2229, 2128, 2030, 1935, 1841, 1749, 1660, 1573, 1488, 1406, 1325,
+    1247, 1171, 1098, 1027, 958, 891, 827, 765, 705, 648, 593, 541, 491, 443, 398, 355,
+    315, 277, 241, 208, 177, 149, 123, 100, 79, 60, 44, 31, 20, 11, 5, 1,
+};
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,108 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_features.h
+  * @brief   This file is the header file for the breath-sound spectral feature extractor
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _AUDIO_FEATURES_H_
+#define _AUDIO_FEATURES_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+#include "fft_q15.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Features of one audio frame
+ *
+ * Energies are log2 of the power in quarter steps (0.75 dB), 0 meaning silence. Spectral flatness is the ratio of
+ * the geometric to the arithmetic mean of the power spectrum in Q8: close to 255 for broadband noise such as breath
+ * sounds, close to 0 for tones.
+ *
+ */
+typedef struct audio_features_t {
+    uint8_t band_energy[8];
+    uint8_t frame_energy;
+    uint8_t flatness;
+    uint16_t centroid_hz;
+    uint16_t zero_crossings;
+} audio_features_t;
+
+/** @brief Benchmark results */
+typedef struct audio_features_benchmark_t {
+    uint32_t frames;
+    uint32_t frames_per_s;
+} audio_features_benchmark_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Samples per frame (32 ms at 16 kHz) */
+#define AUDIO_FEATURES_FRAME_SAMPLES FFT_Q15_REAL_POINTS
+
+/** @abstract Number of spectral bands */
+#define AUDIO_FEATURES_BANDS 8
+
+/** @abstract Packed record: band energies, frame energy, flatness, centroid (uint16 LE), zero crossings (uint16 LE) */
+#define AUDIO_FEATURES_RECORD_BYTES (AUDIO_FEATURES_BANDS + 1 + 1 + 2 + 2)
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function audio_features_compute
+ *
+ * @abstract This function computes band energies, spectral flatness, spectral centroid and zero-crossing count of
+ *           one frame
+ *
+ * @param[in] frame: AUDIO_FEATURES_FRAME_SAMPLES PCM samples
+ *
+ * @param[in] sample_rate_hz: Sample rate used to express the centroid in Hz
+ *
+ * @param[out] features: Frame features
+ *
+ * @return None
+ */
+void audio_features_compute(const int16_t * frame, uint32_t sample_rate_hz, audio_features_t * features);
+
+/*
+ * @function audio_features_pack
+ *
+ * @abstract This function serializes frame features for transmission
+ *
+ * @param[in] features: Frame features
+ *
+ * @param[out] record: AUDIO_FEATURES_RECORD_BYTES bytes
+ *
+ * @return Record size in bytes
+ */
+size_t audio_features_pack(const audio_features_t * features, uint8_t * record);
+
+/*
+ * @function audio_features_benchmark
+ *
+ * @abstract This function measures how many frames per second the feature stage processes
+ *
+ * @param[in] iterations: Number of frames to process
+ *
+ * @param[out] result: Benchmark results
+ *
+ * @return None
+ */
+void audio_features_benchmark(uint32_t iterations, audio_features_benchmark_t * result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _AUDIO_FEATURES_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,122 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_gate.h
+  * @brief   This file is the header file for the breath-sound activity gate
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _AUDIO_GATE_H_
+#define _AUDIO_GATE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "audio_features.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Gate statistics
+ *
+ * frames_open counts the frames the detector selected, frames_streamed the frames actually released. With the gate
+ * disabled every frame is released, so the two counters give the gated and ungated stream size side by side.
+ *
+ */
+typedef struct audio_gate_stats_t {
+    uint32_t frames_in;
+    uint32_t frames_open;
+    uint32_t frames_streamed;
+    uint32_t active_frames;
+    uint32_t events;
+    uint8_t noise_floor;
+    bool open;
+} audio_gate_stats_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Frames held back so the stream can start before the detector fires (256 ms at 16 kHz) */
+#define AUDIO_GATE_PREROLL_FRAMES 8
+
+/** @abstract Consecutive active frames needed to open the gate */
+#define AUDIO_GATE_ATTACK_FRAMES 2
+
+/** @abstract Frames kept open after the last active frame (512 ms at 16 kHz) */
+#define AUDIO_GATE_HANGOVER_FRAMES 16
+
+/** @abstract Frame energy above the noise floor marking activity, in quarter log2 steps (12 dB) */
+#define AUDIO_GATE_ENERGY_MARGIN 16
+
+/** @abstract Minimum spectral flatness (Q8) of an active frame, rejects tonal sounds such as speech or alarms */
+#define AUDIO_GATE_FLATNESS_MIN 64
+
+/** @abstract Noise floor rise per frame in 1/16 quarter log2 steps (~1.5 dB/s at 16 kHz) */
+#define AUDIO_GATE_FLOOR_RISE 1
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function audio_gate_init
+ *
+ * @abstract This function resets the detector, the pre-roll delay line and the statistics
+ *
+ * @param[in] enabled: false releases every frame while still running the detector
+ *
+ * @return None
+ */
+void audio_gate_init(bool enabled);
+
+/*
+ * @function audio_gate_set_enabled
+ *
+ * @abstract This function enables or bypasses the gate
+ *
+ * @param[in] enabled: false releases every frame while still running the detector
+ *
+ * @return None
+ */
+void audio_gate_set_enabled(bool enabled);
+
+/*
+ * @function audio_gate_process
+ *
+ * @abstract This function runs the detector on a new frame and releases the frame captured
+ *           AUDIO_GATE_PREROLL_FRAMES earlier when it belongs to a breath event
+ *
+ * @param[in] frame: AUDIO_FEATURES_FRAME_SAMPLES PCM samples
+ *
+ * @param[in] features: Features of frame
+ *
+ * @param[out] delayed_frame: AUDIO_FEATURES_FRAME_SAMPLES PCM samples of the released frame
+ *
+ * @param[out] delayed_features: Features of the released frame
+ *
+ * @return true if the delayed frame should be streamed
+ */
+bool audio_gate_process(const int16_t * frame, const audio_features_t * features, int16_t * delayed_frame,
+                        audio_features_t * delayed_features);
+
+/*
+ * @function audio_gate_get_stats
+ *
+ * @abstract This function returns a copy of the gate statistics
+ *
+ * @param[out] out: Statistics
+ *
+ * @return None
+ */
+void audio_gate_get_stats(audio_gate_stats_t * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _AUDIO_GATE_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,125 @@
+/**
+  **********************************************************************************************************************
+  * @file    fft_q15.h
+  * @brief   This file is the header file for the fixed-point radix-4 FFT
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _FFT_Q15_H_
+#define _FFT_Q15_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Butterfly kernel selection */
+typedef enum fft_q15_kernel_t {
+    FFT_Q15_KERNEL_REFERENCE = 0,
+    FFT_Q15_KERNEL_SIMD,
+} fft_q15_kernel_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Complex FFT size, a power of four */
+#define FFT_Q15_POINTS 256
+/** @abstract Real input frame size handled by packing even/odd samples into one complex FFT */
+#define FFT_Q15_REAL_POINTS (2 * FFT_Q15_POINTS)
+/** @abstract Number of power spectrum bins, DC to Nyquist inclusive */
+#define FFT_Q15_BINS (FFT_Q15_POINTS + 1)
+/** @abstract Alignment of the FFT buffers and twiddles in bytes (one 128-bit vector register) */
+#define FFT_Q15_ALIGN 16
+/** @abstract Butterflies one vector register holds, stages with fewer per group run in C on every target */
+#define FFT_Q15_VECTOR_BUTTERFLIES 4
+/** @abstract Stage twiddle table size: W^k, W^2k, W^3k for every butterfly of the 64, 16 and 4 butterfly stages */
+#define FFT_Q15_STAGE_TWIDDLES (6 * (64 + 16 + 4))
+
+/** @abstract Vector butterflies are available when building for ESP32-S3, host checks define it to run the model */
+#ifndef FFT_Q15_HAS_SIMD
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define FFT_Q15_HAS_SIMD 1
+#else
+#define FFT_Q15_HAS_SIMD 0
+#endif
+#endif
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+/** @abstract Radix-4 stage twiddle table in flash (fft_q15_tables.c) */
+extern const int16_t fft_q15_stage_twiddles[FFT_Q15_STAGE_TWIDDLES];
+/** @abstract Real-FFT split twiddle table in flash */
+extern const int16_t fft_q15_split_twiddles[2 * FFT_Q15_POINTS];
+/** @abstract Base-4 digit reversal permutation in flash */
+extern const uint8_t fft_q15_digit_reverse[FFT_Q15_POINTS];
+/** @abstract Periodic Hann window in flash */
+extern const int16_t fft_q15_hann[FFT_Q15_REAL_POINTS];
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function fft_q15_set_kernel
+ *
+ * @abstract This function selects the butterfly kernel used by fft_q15_complex. SIMD falls back to the reference
+ *           kernel on targets without vector instructions.
+ *
+ * @param[in] kernel: Kernel to use
+ *
+ * @return None
+ */
+void fft_q15_set_kernel(fft_q15_kernel_t kernel);
+
+/*
+ * @function fft_q15_check_kernel
+ *
+ * @abstract This function runs test frames through both kernels and falls back to the reference kernel when the
+ *           vector kernel is not bit-exact
+ *
+ * @param[out] work: Scratch buffer, 2 * FFT_Q15_POINTS values, FFT_Q15_ALIGN aligned
+ *
+ * @return true when the kernels agree
+ */
+bool fft_q15_check_kernel(int16_t * work);
+
+/*
+ * @function fft_q15_complex
+ *
+ * @abstract This function computes an in-place radix-4 decimation-in-frequency FFT scaled by 1/FFT_Q15_POINTS.
+ *           Each butterfly halves its inputs, adds, halves again and rotates by a Q14 twiddle, truncating every
+ *           step, so all intermediates fit in 16-bit vector lanes. Input components must stay within +/-16384.
+ *
+ * @param[in,out] data: FFT_Q15_POINTS interleaved real/imaginary Q15 values, FFT_Q15_ALIGN aligned, natural order
+ *                      on return
+ *
+ * @return None
+ */
+void fft_q15_complex(int16_t * data);
+
+/*
+ * @function fft_q15_real_power
+ *
+ * @abstract This function applies the Hann window to a real frame, normalizes it to full headroom and returns
+ *           its power spectrum. The true power of bin k is power[k] * 2^(2 * (8 - exponent)).
+ *
+ * @param[in] samples: FFT_Q15_REAL_POINTS PCM samples
+ *
+ * @param[out] work: Scratch buffer, 2 * FFT_Q15_POINTS values, FFT_Q15_ALIGN aligned
+ *
+ * @param[out] power: FFT_Q15_BINS power values
+ *
+ * @return Block exponent: left shift applied to the windowed frame before the FFT
+ */
+int fft_q15_real_power(const int16_t * samples, int16_t * work, uint32_t * power);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _FFT_Q15_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
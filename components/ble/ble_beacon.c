@@ -0,0 +1,101 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_beacon.c
+  * @brief   This file is the connectionless broadcast payload implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include "ble_beacon.h"
+#include "freertos/FreeRTOS.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Latest readings in payload units */
+static int16_t temperature_centi = 0;
+static uint16_t humidity_centi = 0;
+static uint16_t pressure_deci_hpa = 0;
+static uint8_t breath_class = 0;
+
+/** @abstract BLE_BEACON_FLAG_* of the readings recorded so far */
+static uint8_t flags = 0;
+
+/** @abstract Payload counter, lets receivers spot missed refreshes and duplicates */
+static uint16_t sequence = 0;
+
+/** @abstract Guards the readings, they are written by the sensor tasks and read by the refresh timer */
+static portMUX_TYPE beacon_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function saturate16
+ *
+ * @abstract This function clamps a value to the int16 range
+ *
+ * @param[in] value: Value
+ *
+ * @return Clamped value
+ */
+static int16_t saturate16(int32_t value);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int16_t saturate16(int32_t value) {
+    return value > INT16_MAX ? INT16_MAX : value < INT16_MIN ? INT16_MIN : (int16_t)value;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_beacon_set_environment(int32_t temperature, uint32_t humidity, uint32_t pressure) {
+    /* Q22.10 %RH to 0.01 %RH and Q24.8 Pa to 10 Pa, rounded */
+    const uint32_t humidity_value = (humidity * 100u + 512u) >> 10;
+    const uint32_t pressure_value = (pressure + 1280u) / 2560u;
+
+    portENTER_CRITICAL(&beacon_lock);
+    temperature_centi = saturate16(temperature);
+    humidity_centi = humidity_value > UINT16_MAX ? UINT16_MAX : (uint16_t)humidity_value;
+    pressure_deci_hpa = pressure_value > UINT16_MAX ? UINT16_MAX : (uint16_t)pressure_value;
+    flags |= BLE_BEACON_FLAG_ENVIRONMENT;
+    portEXIT_CRITICAL(&beacon_lock);
+}
+
+void ble_beacon_set_breath_class(uint8_t label) {
+    portENTER_CRITICAL(&beacon_lock);
+    breath_class = label;
+    flags |= BLE_BEACON_FLAG_BREATH_CLASS;
+    portEXIT_CRITICAL(&beacon_lock);
+}
+
+size_t ble_beacon_encode(uint8_t * payload) {
+    portENTER_CRITICAL(&beacon_lock);
+    const uint16_t temperature = (uint16_t)temperature_centi;
+    const uint16_t humidity = humidity_centi;
+    const uint16_t pressure = pressure_deci_hpa;
+    const uint8_t label = breath_class;
+    const uint8_t valid = flags;
+    const uint16_t number = sequence++;
+    portEXIT_CRITICAL(&beacon_lock);
+
+    payload[0] = BLE_BEACON_VERSION;
+    payload[1] = (uint8_t)number;
+    payload[2] = (uint8_t)(number >> 8);
+    payload[3] = valid;
+    payload[4] = (uint8_t)temperature;
+    payload[5] = (uint8_t)(temperature >> 8);
+    payload[6] = (uint8_t)humidity;
+    payload[7] = (uint8_t)(humidity >> 8);
+    payload[8] = (uint8_t)pressure;
+    payload[9] = (uint8_t)(pressure >> 8);
+    payload[10] = label;
+
+    return BLE_BEACON_PAYLOAD_BYTES;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
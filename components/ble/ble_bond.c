@@ -0,0 +1,218 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_bond.c
+  * @brief   This file is the BLE bonding and fast reconnect implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_bond.h"
+#include "ble_conn.h"
+#include "ble_tx.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "host/ble_hs.h"
+#include "services/gatt/ble_svc_gatt.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract 32-bit FNV-1a parameters */
+#define FNV_OFFSET_BASIS 0x811C9DC5u
+#define FNV_PRIME 0x01000193u
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_BOND";
+
+/** @abstract Bonding counters, layout_hash accumulates while the services register */
+static ble_bond_stats_t stats = {
+    .layout_hash = FNV_OFFSET_BASIS,
+};
+
+/** @abstract Connections whose central was bonded when it connected, BLE_HS_CONN_HANDLE_NONE marks a free entry */
+static uint16_t returning[BLE_CONN_MAX] = {
+    [0 ... BLE_CONN_MAX - 1] = BLE_HS_CONN_HANDLE_NONE,
+};
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function hashBytes
+ *
+ * @abstract This function folds bytes into the layout hash
+ *
+ * @param[in] data: Bytes
+ *
+ * @param[in] length: Number of bytes
+ *
+ * @return None
+ */
+static void hashBytes(const void * data, size_t length);
+
+/*
+ * @function isBonded
+ *
+ * @abstract This function looks up the stored keys of the central on a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return true if a bond exists
+ */
+static bool isBonded(uint16_t conn_handle);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static void hashBytes(const void * data, size_t length) {
+    const uint8_t * bytes = data;
+
+    for (size_t i = 0; i < length; i++) {
+        stats.layout_hash = (stats.layout_hash ^ bytes[i]) * FNV_PRIME;
+    }
+}
+
+static bool isBonded(uint16_t conn_handle) {
+    struct ble_gap_conn_desc desc;
+    struct ble_store_key_sec key;
+    struct ble_store_value_sec value;
+
+    if (ble_gap_conn_find(conn_handle, &desc) != 0) {
+        return false;
+    }
+
+    memset(&key, 0, sizeof(key));
+    key.peer_addr = desc.peer_id_addr;
+
+    return ble_store_read_peer_sec(&key, &value) == 0;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_bond_layout_add(uint16_t handle, const ble_uuid_t * uuid, uint16_t flags) {
+    uint8_t flat[16];
+
+    if (ble_uuid_flat(uuid, flat) != 0) {
+        return;
+    }
+
+    hashBytes(&handle, sizeof(handle));
+    hashBytes(flat, (size_t)ble_uuid_length(uuid));
+    hashBytes(&flags, sizeof(flags));
+}
+
+void ble_bond_layout_check(void) {
+    nvs_handle_t nvs;
+    uint32_t stored = 0;
+
+    if (nvs_open(BLE_BOND_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGW(TAG, "Layout hash not persisted");
+        return;
+    }
+
+    const esp_err_t err = nvs_get_u32(nvs, BLE_BOND_NVS_LAYOUT_KEY, &stored);
+
+    if (err == ESP_OK && stored == stats.layout_hash) {
+        ESP_LOGI(TAG, "GATT layout %08lx unchanged, bonded centrals keep their cache", (unsigned long)stored);
+    } else {
+        if (err == ESP_OK) {
+            /* Indicates connected centrals now and marks the bonded ones to be indicated when they reconnect */
+            ESP_LOGW(TAG, "GATT layout changed %08lx -> %08lx, signaling Service Changed", (unsigned long)stored,
+                     (unsigned long)stats.layout_hash);
+            ble_svc_gatt_changed(0x0001, 0xFFFF);
+        }
+
+        nvs_set_u32(nvs, BLE_BOND_NVS_LAYOUT_KEY, stats.layout_hash);
+        nvs_commit(nvs);
+    }
+
+    nvs_close(nvs);
+}
+
+void ble_bond_on_connect(uint16_t conn_handle) {
+    if (!isBonded(conn_handle)) {
+        return;
+    }
+
+    for (size_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (returning[i] == BLE_HS_CONN_HANDLE_NONE) {
+            returning[i] = conn_handle;
+            break;
+        }
+    }
+
+    /* A Security Request makes the central start encryption with the stored keys instead of waiting for it */
+    const int rc = ble_gap_security_initiate(conn_handle);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Security request on connection %u failed; rc=%d", conn_handle, rc);
+    }
+}
+
+void ble_bond_on_disconnect(uint16_t conn_handle) {
+    for (size_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (returning[i] == conn_handle) {
+            returning[i] = BLE_HS_CONN_HANDLE_NONE;
+        }
+    }
+}
+
+void ble_bond_on_encryption(uint16_t conn_handle, int status) {
+    struct ble_gap_conn_desc desc;
+    ble_conn_state_t state;
+    bool returned = false;
+
+    for (size_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (returning[i] == conn_handle) {
+            returning[i] = BLE_HS_CONN_HANDLE_NONE;
+            returned = true;
+        }
+    }
+
+    if (status != 0 || ble_gap_conn_find(conn_handle, &desc) != 0 || !desc.sec_state.bonded) {
+        return;
+    }
+
+    if (!returned) {
+        stats.pairings++;
+        ESP_LOGI(TAG, "Central on connection %u bonded", conn_handle);
+        return;
+    }
+
+    const uint32_t elapsed_ms = ble_conn_get(conn_handle, &state) ?
+            (uint32_t)((esp_timer_get_time() - state.connected_us) / 1000) : 0;
+
+    stats.reconnects++;
+    stats.last_reconnect_ms = elapsed_ms;
+    ESP_LOGI(TAG, "Bonded central on connection %u encrypted after %lu ms", conn_handle, (unsigned long)elapsed_ms);
+
+    /* The host restored the central's subscriptions with the bond, stream to it right away */
+    ble_tx_kick();
+}
+
+int ble_bond_on_repeat_pairing(const struct ble_gap_repeat_pairing * repeat_pairing) {
+    struct ble_gap_conn_desc desc;
+
+    if (repeat_pairing->new_key_size < repeat_pairing->cur_key_size ||
+        repeat_pairing->new_authenticated < repeat_pairing->cur_authenticated ||
+        repeat_pairing->new_sc < repeat_pairing->cur_sc ||
+        ble_gap_conn_find(repeat_pairing->conn_handle, &desc) != 0) {
+        stats.repairings_refused++;
+        ESP_LOGW(TAG, "Weaker repeat pairing on connection %u refused", repeat_pairing->conn_handle);
+        return BLE_GAP_REPEAT_PAIRING_IGNORE;
+    }
+
+    /* The central lost its keys; forget the old bond and let the pairing complete */
+    ble_store_util_delete_peer(&desc.peer_id_addr);
+    ble_bond_on_disconnect(repeat_pairing->conn_handle);
+
+    return BLE_GAP_REPEAT_PAIRING_RETRY;
+}
+
+void ble_bond_get_stats(ble_bond_stats_t * out) {
+    *out = stats;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,406 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_coc.c
+  * @brief   This file is the L2CAP connection-oriented bulk channel implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_coc.h"
+#include "ble_conn.h"
+#include "ble_tx.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define BLE_COC_TX_BUFFER_MASK (BLE_COC_TX_BUFFER_BYTES - 1)
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_COC";
+
+/** @abstract Receive SDU buffer pool */
+static os_membuf_t rx_memory[OS_MEMPOOL_SIZE(BLE_COC_RX_SDU_BUFFERS, BLE_COC_SDU_BYTES)];
+static struct os_mempool rx_mempool;
+static struct os_mbuf_pool rx_mbuf_pool;
+
+/** @abstract Open channel, NULL while no central is connected to the PSM */
+static struct ble_l2cap_chan * channel = NULL;
+
+/** @abstract Set while the peer ran out of credits for the SDU in flight, cleared by the TX unstalled event */
+static bool stalled = false;
+
+/** @abstract Record ring buffer, guarded by coc_lock */
+static uint8_t tx_buffer[BLE_COC_TX_BUFFER_BYTES];
+
+/** @abstract Total bytes written to and sent from the ring */
+static uint32_t tx_head = 0;
+static uint32_t tx_tail = 0;
+
+/** @abstract Guards the channel, the ring and the transmit counters */
+static SemaphoreHandle_t coc_lock = NULL;
+
+/** @abstract Transmit scheduler source of the channel, its capacity is counted in bytes */
+static ble_tx_source_t coc_source;
+
+/** @abstract Channel counters */
+static ble_coc_stats_t stats;
+
+/** @abstract Time and sent bytes of the previous ble_coc_get_stats call */
+static int64_t rate_since_us = 0;
+static uint32_t rate_bytes = 0;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function recordBytes
+ *
+ * @abstract This function returns the length of the record starting at a ring position, header included
+ *
+ * @param[in] position: Ring position
+ *
+ * @return Record length
+ */
+static uint32_t recordBytes(uint32_t position);
+
+/*
+ * @function ringPut
+ *
+ * @abstract This function copies bytes into the ring at a position, wrapping at its end
+ *
+ * @param[in] position: Ring position
+ *
+ * @param[in] data: Bytes to copy
+ *
+ * @param[in] length: Number of bytes
+ *
+ * @return None
+ */
+static void ringPut(uint32_t position, const void * data, uint32_t length);
+
+/*
+ * @function queueRecord
+ *
+ * @abstract This function implements ble_coc_write and ble_coc_write_lossless
+ *
+ * @param[in] type: BLE_COC_RECORD_* type
+ *
+ * @param[in] data: Record payload
+ *
+ * @param[in] length: Payload length
+ *
+ * @param[in] lossless: Refuse the record rather than drop queued ones, bypassing the overload policy
+ *
+ * @return 0 if the record was queued, NimBLE error code otherwise
+ */
+static int queueRecord(uint8_t type, const void * data, uint16_t length, bool lossless);
+
+/*
+ * @function postReceiveBuffer
+ *
+ * @abstract This function gives the stack a buffer for the next SDU, which also returns credits to the peer
+ *
+ * @param[in] chan: Channel
+ *
+ * @return 0 on success, NimBLE error code otherwise
+ */
+static int postReceiveBuffer(struct ble_l2cap_chan * chan);
+
+/*
+ * @function sendRecords
+ *
+ * @abstract This function is the transmit scheduler callback, it packs the oldest whole records into one SDU
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 if an SDU was sent, BLE_HS_EAGAIN if the ring is empty, NimBLE error code otherwise
+ */
+static int sendRecords(void * context);
+
+/*
+ * @function onL2capEvent
+ *
+ * @abstract This function is a callback that gets called when an L2CAP event occurs on the server channel
+ *
+ * @param[in] event: L2CAP event
+ *
+ * @param[in] arg: Unused
+ *
+ * @return 0 on success, NimBLE error code to reject a connection
+ */
+static int onL2capEvent(struct ble_l2cap_event * event, void * arg);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint32_t recordBytes(uint32_t position) {
+    const uint32_t length = tx_buffer[(position + 1) & BLE_COC_TX_BUFFER_MASK] |
+                            (uint32_t)tx_buffer[(position + 2) & BLE_COC_TX_BUFFER_MASK] << 8;
+
+    return BLE_COC_RECORD_HEADER_BYTES + length;
+}
+
+static void ringPut(uint32_t position, const void * data, uint32_t length) {
+    const uint32_t offset = position & BLE_COC_TX_BUFFER_MASK;
+    const uint32_t first = length < BLE_COC_TX_BUFFER_BYTES - offset ? length : BLE_COC_TX_BUFFER_BYTES - offset;
+
+    memcpy(&tx_buffer[offset], data, first);
+    memcpy(tx_buffer, (const uint8_t *)data + first, length - first);
+}
+
+static int queueRecord(uint8_t type, const void * data, uint16_t length, bool lossless) {
+    const uint32_t needed = BLE_COC_RECORD_HEADER_BYTES + length;
+    const uint8_t header[BLE_COC_RECORD_HEADER_BYTES] = {type, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8)};
+
+    if (needed > BLE_COC_SDU_BYTES) {
+        return BLE_HS_EMSGSIZE;
+    }
+
+    if (channel == NULL) {
+        return BLE_HS_ENOTCONN;
+    }
+
+    xSemaphoreTake(coc_lock, portMAX_DELAY);
+
+    if (channel == NULL) {
+        xSemaphoreGive(coc_lock);
+        return BLE_HS_ENOTCONN;
+    }
+
+    const uint32_t free_bytes = BLE_COC_TX_BUFFER_BYTES - (tx_head - tx_tail);
+
+    if (lossless ? free_bytes < needed : !ble_tx_admit(&coc_source, tx_head - tx_tail)) {
+        xSemaphoreGive(coc_lock);
+        return BLE_HS_EBUSY;
+    }
+
+    while (BLE_COC_TX_BUFFER_BYTES - (tx_head - tx_tail) < needed) {
+        tx_tail += recordBytes(tx_tail);
+        ble_tx_dropped_oldest(&coc_source, 1);
+    }
+
+    ringPut(tx_head, header, sizeof(header));
+    ringPut(tx_head + sizeof(header), data, length);
+    tx_head += needed;
+
+    xSemaphoreGive(coc_lock);
+
+    ble_tx_kick();
+
+    return 0;
+}
+
+static int postReceiveBuffer(struct ble_l2cap_chan * chan) {
+    struct os_mbuf * sdu_rx = os_mbuf_get_pkthdr(&rx_mbuf_pool, 0);
+
+    if (sdu_rx == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    int rc = ble_l2cap_recv_ready(chan, sdu_rx);
+    if (rc != 0) {
+        os_mbuf_free_chain(sdu_rx);
+    }
+
+    return rc;
+}
+
+static int sendRecords(void * context) {
+    int rc = BLE_HS_EAGAIN;
+
+    xSemaphoreTake(coc_lock, portMAX_DELAY);
+
+    if (channel == NULL) {
+        rc = BLE_HS_ENOTCONN;
+    } else if (stalled) {
+        rc = BLE_HS_EBUSY;
+    } else if (tx_head != tx_tail) {
+        const uint32_t limit = stats.peer_sdu_size < BLE_COC_SDU_BYTES ? stats.peer_sdu_size : BLE_COC_SDU_BYTES;
+        uint32_t length = 0;
+
+        /* Whole records only, the central splits an SDU at the record headers */
+        while (tx_tail + length != tx_head && length + recordBytes(tx_tail + length) <= limit) {
+            length += recordBytes(tx_tail + length);
+        }
+
+        struct os_mbuf * om = length > 0 ? os_msys_get_pkthdr((uint16_t)length, 0) : NULL;
+
+        if (length == 0) {
+            /* A record larger than the peer SDU can never be sent */
+            tx_tail += recordBytes(tx_tail);
+            rc = BLE_HS_EMSGSIZE;
+        } else if (om == NULL) {
+            rc = BLE_HS_ENOMEM;
+        } else {
+            const uint32_t offset = tx_tail & BLE_COC_TX_BUFFER_MASK;
+            const uint32_t room = BLE_COC_TX_BUFFER_BYTES - offset;
+            const uint32_t first = length < room ? length : room;
+
+            rc = os_mbuf_append(om, &tx_buffer[offset], (uint16_t)first);
+            if (rc == 0 && length > first) {
+                rc = os_mbuf_append(om, tx_buffer, (uint16_t)(length - first));
+            }
+
+            /* The stack owns the SDU once it was accepted, stalled or not */
+            rc = rc == 0 ? ble_l2cap_send(channel, om) : BLE_HS_ENOMEM;
+
+            if (rc == 0 || rc == BLE_HS_ESTALLED) {
+                tx_tail += length;
+                stats.sdus_sent++;
+                stats.bytes_sent += length;
+                ble_conn_count_tx(stats.conn_handle, true, length);
+
+                if (rc == BLE_HS_ESTALLED) {
+                    stalled = true;
+                    stats.stalls++;
+                }
+                rc = 0;
+            } else {
+                os_mbuf_free_chain(om);
+                if (rc == BLE_HS_EBUSY) {
+                    stalled = true;
+                }
+            }
+        }
+    }
+
+    xSemaphoreGive(coc_lock);
+
+    return rc;
+}
+
+static int onL2capEvent(struct ble_l2cap_event * event, void * arg) {
+    struct ble_l2cap_chan_info info;
+
+    switch (event->type) {
+        case BLE_L2CAP_EVENT_COC_CONNECTED:
+            if (event->connect.status != 0) {
+                ESP_LOGW(TAG, "Channel setup failed; status=%d", event->connect.status);
+                return 0;
+            }
+
+            xSemaphoreTake(coc_lock, portMAX_DELAY);
+            channel = event->connect.chan;
+            stalled = false;
+            tx_tail = tx_head;
+            stats.connected = true;
+            stats.conn_handle = event->connect.conn_handle;
+            if (ble_l2cap_get_chan_info(channel, &info) == 0) {
+                stats.peer_sdu_size = info.peer_coc_mtu;
+            }
+            xSemaphoreGive(coc_lock);
+
+            ESP_LOGI(TAG, "Channel open on connection %u, peer SDU %u B", event->connect.conn_handle,
+                     stats.peer_sdu_size);
+            ble_tx_kick();
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_DISCONNECTED:
+            xSemaphoreTake(coc_lock, portMAX_DELAY);
+            channel = NULL;
+            tx_tail = tx_head;
+            stats.connected = false;
+            xSemaphoreGive(coc_lock);
+
+            ESP_LOGI(TAG, "Channel closed on connection %u", event->disconnect.conn_handle);
+            return 0;
+
+        case BLE_L2CAP_EVENT_COC_ACCEPT:
+            stats.peer_sdu_size = event->accept.peer_sdu_size;
+            return postReceiveBuffer(event->accept.chan);
+
+        case BLE_L2CAP_EVENT_COC_DATA_RECEIVED:
+            if (event->receive.sdu_rx != NULL) {
+                stats.sdus_received++;
+                stats.bytes_received += OS_MBUF_PKTLEN(event->receive.sdu_rx);
+                os_mbuf_free_chain(event->receive.sdu_rx);
+            }
+            return postReceiveBuffer(event->receive.chan);
+
+        case BLE_L2CAP_EVENT_COC_TX_UNSTALLED:
+            stalled = false;
+            ble_tx_kick();
+            return 0;
+
+        default:
+            return 0;
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int ble_coc_init(void) {
+    int rc = os_mempool_init(&rx_mempool, BLE_COC_RX_SDU_BUFFERS, BLE_COC_SDU_BYTES, rx_memory, "coc_sdu_pool");
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = os_mbuf_pool_init(&rx_mbuf_pool, &rx_mempool, BLE_COC_SDU_BYTES, BLE_COC_RX_SDU_BUFFERS);
+    if (rc != 0) {
+        return rc;
+    }
+
+    coc_lock = xSemaphoreCreateMutex();
+    if (coc_lock == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    rate_since_us = esp_timer_get_time();
+
+    if (!ble_tx_register(&coc_source, "L2CAP Bulk", sendRecords, NULL, BLE_COC_TX_BUFFER_BYTES)) {
+        return BLE_HS_ENOMEM;
+    }
+
+    rc = ble_l2cap_create_server(BLE_COC_PSM, BLE_COC_SDU_BYTES, onL2capEvent, NULL);
+    if (rc == 0) {
+        ESP_LOGI(TAG, "Listening on PSM 0x%04x, SDU %u B", BLE_COC_PSM, BLE_COC_SDU_BYTES);
+    }
+
+    return rc;
+}
+
+int ble_coc_write(uint8_t type, const void * data, uint16_t length) {
+    return queueRecord(type, data, length, false);
+}
+
+int ble_coc_write_lossless(uint8_t type, const void * data, uint16_t length) {
+    return queueRecord(type, data, length, true);
+}
+
+uint16_t ble_coc_payload_limit(uint16_t conn_handle) {
+    uint16_t limit = 0;
+
+    xSemaphoreTake(coc_lock, portMAX_DELAY);
+
+    if (channel != NULL && stats.conn_handle == conn_handle) {
+        const uint16_t sdu = stats.peer_sdu_size < BLE_COC_SDU_BYTES ? stats.peer_sdu_size : BLE_COC_SDU_BYTES;
+        limit = sdu > BLE_COC_RECORD_HEADER_BYTES ? sdu - BLE_COC_RECORD_HEADER_BYTES : 0;
+    }
+
+    xSemaphoreGive(coc_lock);
+
+    return limit;
+}
+
+void ble_coc_get_stats(ble_coc_stats_t * out) {
+    const int64_t now = esp_timer_get_time();
+
+    xSemaphoreTake(coc_lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(coc_lock);
+
+    out->bytes_per_s = now > rate_since_us ?
+            (uint32_t)((int64_t)(out->bytes_sent - rate_bytes) * 1000000 / (now - rate_since_us)) : 0;
+    rate_since_us = now;
+    rate_bytes = out->bytes_sent;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
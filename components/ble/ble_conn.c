@@ -0,0 +1,417 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_conn.c
+  * @brief   This file is the per-connection link state table implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_conn.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Handle value marking a free slot, above the 0x0EFF connection handle range */
+#define BLE_CONN_HANDLE_NONE 0xFFFF
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_CONN";
+
+/** @abstract Connection records, written by the NimBLE host task and read by the streaming tasks */
+static ble_conn_state_t connections[BLE_CONN_MAX] = {
+    [0 ... BLE_CONN_MAX - 1] = { .conn_handle = BLE_CONN_HANDLE_NONE },
+};
+
+/** @abstract Guards connections */
+static portMUX_TYPE connections_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function findConnection
+ *
+ * @abstract This function looks up a connection record, the caller holds connections_lock
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return Pointer to the record, NULL if the connection is not tracked
+ */
+static ble_conn_state_t * findConnection(uint16_t conn_handle);
+
+/*
+ * @function notificationPdus
+ *
+ * @abstract This function returns how many link-layer PDUs a notification occupies, the caller holds
+ *           connections_lock
+ *
+ * @param[in] state: Connection record
+ *
+ * @param[in] length: Notification value length
+ *
+ * @return Number of PDUs
+ */
+static uint16_t notificationPdus(const ble_conn_state_t * state, uint16_t length);
+
+/*
+ * @function releasePending
+ *
+ * @abstract This function removes one reserved notification from the queue, the caller holds connections_lock
+ *
+ * @param[in,out] state: Connection record
+ *
+ * @param[in] index: Position in the pending list, 0 is the oldest
+ *
+ * @return None
+ */
+static void releasePending(ble_conn_state_t * state, uint8_t index);
+
+/*
+ * @function drainQueue
+ *
+ * @abstract This function releases, oldest first, the notifications the peer would have received by now at
+ *           BLE_CONN_PDUS_PER_EVENT per connection event since the last completion, so a lost BLE_GAP_EVENT_NOTIFY_TX
+ *           cannot hold the queue forever; the caller holds connections_lock
+ *
+ * @param[in,out] state: Connection record
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+static void drainQueue(ble_conn_state_t * state, int64_t now_us);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static ble_conn_state_t * findConnection(uint16_t conn_handle) {
+    for (uint32_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (connections[i].conn_handle == conn_handle) {
+            return &connections[i];
+        }
+    }
+
+    return NULL;
+}
+
+static uint16_t notificationPdus(const ble_conn_state_t * state, uint16_t length) {
+    const uint16_t octets = state->tx_octets ? state->tx_octets : BLE_CONN_DEFAULT_OCTETS;
+
+    return (uint16_t)((length + BLE_CONN_NOTIFY_OVERHEAD + octets - 1) / octets);
+}
+
+static void releasePending(ble_conn_state_t * state, uint8_t index) {
+    const uint16_t pdus = state->pending_pdus[index];
+
+    state->queue_depth = state->queue_depth > pdus ? state->queue_depth - pdus : 0;
+    state->pending_count--;
+
+    memmove(&state->pending_handles[index], &state->pending_handles[index + 1],
+            (state->pending_count - index) * sizeof(state->pending_handles[0]));
+    memmove(&state->pending_pdus[index], &state->pending_pdus[index + 1],
+            (state->pending_count - index) * sizeof(state->pending_pdus[0]));
+}
+
+static void drainQueue(ble_conn_state_t * state, int64_t now_us) {
+    const int64_t interval_us = (int64_t)(state->conn_interval ? state->conn_interval : BLE_CONN_DEFAULT_INTERVAL) *
+                                1250;
+    int64_t drained = (now_us - state->queue_updated_us) * BLE_CONN_PDUS_PER_EVENT / interval_us;
+    int64_t consumed = 0;
+
+    while (state->pending_count > 0 && state->pending_pdus[0] <= drained) {
+        drained -= state->pending_pdus[0];
+        consumed += state->pending_pdus[0];
+        releasePending(state, 0);
+    }
+
+    if (state->pending_count == 0) {
+        state->queue_updated_us = now_us;
+    } else {
+        state->queue_updated_us += consumed * interval_us / BLE_CONN_PDUS_PER_EVENT;
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+ble_conn_state_t * ble_conn_add(uint16_t conn_handle) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state == NULL) {
+        state = findConnection(BLE_CONN_HANDLE_NONE);
+    }
+
+    if (state != NULL) {
+        memset(state, 0, sizeof(*state));
+        state->conn_handle = conn_handle;
+        state->mtu = BLE_CONN_DEFAULT_MTU;
+        state->tx_phy = 1;
+        state->rx_phy = 1;
+        state->tx_octets = BLE_CONN_DEFAULT_OCTETS;
+        state->tx_time = BLE_CONN_DEFAULT_TIME;
+        state->rx_octets = BLE_CONN_DEFAULT_OCTETS;
+        state->rx_time = BLE_CONN_DEFAULT_TIME;
+        state->queue_updated_us = esp_timer_get_time();
+        state->connected_us = state->queue_updated_us;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+
+    return state;
+}
+
+void ble_conn_remove(uint16_t conn_handle) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->conn_handle = BLE_CONN_HANDLE_NONE;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_set_mtu(uint16_t conn_handle, uint16_t mtu) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->mtu = mtu;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_set_params(uint16_t conn_handle, uint16_t interval, uint16_t latency, uint16_t supervision_timeout) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->conn_interval = interval;
+        state->conn_latency = latency;
+        state->supervision_timeout = supervision_timeout;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_set_phy(uint16_t conn_handle, uint8_t tx_phy, uint8_t rx_phy) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->tx_phy = tx_phy;
+        state->rx_phy = rx_phy;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_set_data_length(uint16_t conn_handle, uint16_t tx_octets, uint16_t tx_time, uint16_t rx_octets,
+                              uint16_t rx_time) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->tx_octets = tx_octets;
+        state->tx_time = tx_time;
+        state->rx_octets = rx_octets;
+        state->rx_time = rx_time;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_set_subscription(uint16_t conn_handle, uint32_t bits, bool enabled) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        state->subscriptions = enabled ? (state->subscriptions | bits) : (state->subscriptions & ~bits);
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+bool ble_conn_queue_reserve(uint16_t conn_handle, uint16_t attr_handle, uint16_t length) {
+    const int64_t now_us = esp_timer_get_time();
+    bool reserved = false;
+
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        drainQueue(state, now_us);
+
+        const uint16_t pdus = notificationPdus(state, length);
+
+        /* An idle peer always takes one notification, even one larger than the queue bound */
+        if (state->pending_count == 0 ||
+            (state->pending_count < BLE_CONN_MAX_PENDING && state->queue_depth + pdus <= BLE_CONN_MAX_QUEUE_PDUS)) {
+            state->pending_handles[state->pending_count] = attr_handle;
+            state->pending_pdus[state->pending_count] = (uint8_t)(pdus < UINT8_MAX ? pdus : UINT8_MAX);
+            state->pending_count++;
+            state->queue_depth += state->pending_pdus[state->pending_count - 1];
+            reserved = true;
+        } else {
+            state->dropped++;
+        }
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+
+    return reserved;
+}
+
+void ble_conn_queue_cancel(uint16_t conn_handle) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL && state->pending_count > 0) {
+        releasePending(state, state->pending_count - 1);
+        state->dropped++;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_queue_complete(uint16_t conn_handle, uint16_t attr_handle, int status) {
+    const int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        for (uint8_t i = 0; i < state->pending_count; i++) {
+            if (state->pending_handles[i] == attr_handle) {
+                releasePending(state, i);
+                state->queue_updated_us = now_us;
+                if (status != 0) {
+                    state->dropped++;
+                }
+                break;
+            }
+        }
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+size_t ble_conn_list(uint32_t bits, uint16_t * handles) {
+    size_t count = 0;
+
+    portENTER_CRITICAL(&connections_lock);
+
+    for (uint32_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (connections[i].conn_handle != BLE_CONN_HANDLE_NONE &&
+            (bits == 0 || (connections[i].subscriptions & bits) != 0)) {
+            handles[count++] = connections[i].conn_handle;
+        }
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+
+    return count;
+}
+
+bool ble_conn_get(uint16_t conn_handle, ble_conn_state_t * state) {
+    portENTER_CRITICAL(&connections_lock);
+
+    const ble_conn_state_t * found = findConnection(conn_handle);
+    if (found != NULL) {
+        *state = *found;
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+
+    return found != NULL;
+}
+
+uint16_t ble_conn_payload_limit(uint16_t conn_handle) {
+    ble_conn_state_t state;
+
+    if (conn_handle == BLE_CONN_HANDLE_NONE || !ble_conn_get(conn_handle, &state) || state.mtu <= 3) {
+        return 0;
+    }
+
+    const uint16_t limit = state.mtu - 3;
+    const uint16_t packet = limit + BLE_CONN_NOTIFY_OVERHEAD;
+
+    /* A packet spilling a few bytes into one more PDU costs a whole extra PDU; stop at the last full one instead */
+    if (state.tx_octets == 0 || packet <= state.tx_octets || packet % state.tx_octets == 0) {
+        return limit;
+    }
+
+    return (uint16_t)((packet / state.tx_octets) * state.tx_octets - BLE_CONN_NOTIFY_OVERHEAD);
+}
+
+uint16_t ble_conn_min_payload_limit(uint32_t bits) {
+    uint16_t handles[BLE_CONN_MAX];
+    const size_t count = ble_conn_list(bits, handles);
+    uint16_t limit = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const uint16_t payload = ble_conn_payload_limit(handles[i]);
+
+        if (payload != 0 && (limit == 0 || payload < limit)) {
+            limit = payload;
+        }
+    }
+
+    return limit;
+}
+
+void ble_conn_count_tx(uint16_t conn_handle, bool coc, uint32_t bytes) {
+    portENTER_CRITICAL(&connections_lock);
+
+    ble_conn_state_t * state = findConnection(conn_handle);
+    if (state != NULL) {
+        if (coc) {
+            state->coc_tx_bytes += bytes;
+        } else {
+            state->gatt_tx_bytes += bytes;
+        }
+    }
+
+    portEXIT_CRITICAL(&connections_lock);
+}
+
+void ble_conn_log_all(void) {
+    uint16_t handles[BLE_CONN_MAX];
+    const size_t count = ble_conn_list(0, handles);
+
+    for (size_t i = 0; i < count; i++) {
+        ble_conn_log(handles[i]);
+    }
+}
+
+void ble_conn_log(uint16_t conn_handle) {
+    ble_conn_state_t state;
+
+    if (!ble_conn_get(conn_handle, &state)) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Connection %u: MTU %u, interval %u.%02u ms, latency %u, timeout %u ms, PHY tx %u rx %u, "
+                  "data length tx %u B/%u us rx %u B/%u us, subscriptions 0x%02lx, %lu dropped",
+             state.conn_handle, state.mtu,
+             state.conn_interval * 5 / 4, (state.conn_interval * 125) % 100,
+             state.conn_latency, state.supervision_timeout * 10,
+             state.tx_phy, state.rx_phy,
+             state.tx_octets, state.tx_time, state.rx_octets, state.rx_time,
+             (unsigned long)state.subscriptions, (unsigned long)state.dropped);
+
+    const int64_t elapsed_us = esp_timer_get_time() - state.connected_us;
+    if (elapsed_us > 0) {
+        ESP_LOGI(TAG, "Connection %u: GATT %lu B (%lu B/s), L2CAP %lu B (%lu B/s)", state.conn_handle,
+                 (unsigned long)state.gatt_tx_bytes, (unsigned long)(state.gatt_tx_bytes * 1000000LL / elapsed_us),
+                 (unsigned long)state.coc_tx_bytes, (unsigned long)(state.coc_tx_bytes * 1000000LL / elapsed_us));
+    }
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
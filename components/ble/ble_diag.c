@@ -0,0 +1,317 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_diag.c
+  * @brief   This file is the BLE throughput and latency self-test implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_diag.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putU16
+ *
+ * @abstract This function stores a little-endian uint16
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU16(uint8_t * data, uint16_t value);
+
+/*
+ * @function putU32
+ *
+ * @abstract This function stores a little-endian uint32
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU32(uint8_t * data, uint32_t value);
+
+/*
+ * @function getU32
+ *
+ * @abstract This function loads a little-endian uint32
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint32_t getU32(const uint8_t * data);
+
+/*
+ * @function addRoundTrip
+ *
+ * @abstract This function adds a round-trip time to the statistics and the histogram
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[in] rtt_us: Round-trip time
+ *
+ * @return None
+ */
+static void addRoundTrip(ble_diag_t * diag, uint32_t rtt_us);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint8_t * putU16(uint8_t * data, uint16_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    return data + 2;
+}
+
+static uint8_t * putU32(uint8_t * data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    return data + 4;
+}
+
+static uint32_t getU32(const uint8_t * data) {
+    return data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void addRoundTrip(ble_diag_t * diag, uint32_t rtt_us) {
+    size_t bin = 0;
+
+    while (bin < BLE_DIAG_RTT_BINS - 1 && rtt_us >= (uint32_t)BLE_DIAG_RTT_FIRST_BIN_US << bin) {
+        bin++;
+    }
+
+    if (diag->rtt_histogram[bin] < UINT16_MAX) {
+        diag->rtt_histogram[bin]++;
+    }
+
+    if (diag->rtt_count == 0 || rtt_us < diag->rtt_min_us) {
+        diag->rtt_min_us = rtt_us;
+    }
+    if (rtt_us > diag->rtt_max_us) {
+        diag->rtt_max_us = rtt_us;
+    }
+
+    diag->rtt_sum_us += rtt_us;
+    diag->rtt_count++;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_diag_init(ble_diag_t * diag) {
+    memset(diag, 0, sizeof(*diag));
+}
+
+bool ble_diag_control(ble_diag_t * diag, const uint8_t * data, size_t length, int64_t now_us) {
+    if (length < 1) {
+        return false;
+    }
+
+    switch (data[0]) {
+        case BLE_DIAG_OP_START: {
+            if (length != BLE_DIAG_CONTROL_BYTES) {
+                return false;
+            }
+
+            const uint16_t frame_bytes = data[1] | (uint16_t)data[2] << 8;
+            const uint16_t rate_hz = data[3] | (uint16_t)data[4] << 8;
+            const uint16_t duration_s = data[5] | (uint16_t)data[6] << 8;
+
+            if (frame_bytes < BLE_DIAG_FRAME_HEADER_BYTES || frame_bytes > BLE_DIAG_FRAME_MAX_BYTES) {
+                return false;
+            }
+
+            /* A new run starts from clean counters, the round-trip statistics included */
+            ble_diag_init(diag);
+            diag->running = true;
+            diag->frame_bytes = frame_bytes;
+            diag->rate_hz = rate_hz;
+            diag->duration_ms = (uint32_t)duration_s * 1000u;
+            diag->started_us = now_us;
+            diag->probe_sent_us = now_us;
+            return true;
+        }
+
+        case BLE_DIAG_OP_STOP:
+            if (diag->running) {
+                diag->running = false;
+                diag->stopped_us = now_us;
+            }
+            return true;
+
+        case BLE_DIAG_OP_RESET:
+            ble_diag_init(diag);
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+size_t ble_diag_next(ble_diag_t * diag, uint8_t * frame, size_t max_length, int64_t now_us, bool * probe) {
+    if (!diag->running) {
+        return 0;
+    }
+
+    const int64_t elapsed_us = now_us - diag->started_us;
+
+    if (diag->duration_ms > 0 && elapsed_us >= (int64_t)diag->duration_ms * 1000) {
+        diag->running = false;
+        diag->stopped_us = diag->started_us + (int64_t)diag->duration_ms * 1000;
+        return 0;
+    }
+
+    /* An unanswered probe is given up after one period, so a lost reply does not stall the measurement */
+    if (now_us - diag->probe_sent_us >= (int64_t)BLE_DIAG_PROBE_MS * 1000) {
+        uint8_t * cursor = frame;
+
+        *cursor++ = BLE_DIAG_PROBE;
+        cursor = putU32(cursor, diag->probe_id + 1);
+        cursor = putU32(cursor, (uint32_t)now_us);
+
+        *probe = true;
+        return (size_t)(cursor - frame);
+    }
+
+    if (diag->rate_hz > 0) {
+        /* The first frame is due at the start, then one every 1 / rate */
+        const uint32_t due = (uint32_t)(elapsed_us * diag->rate_hz / 1000000) + 1;
+
+        if (diag->sequence >= due) {
+            return 0;
+        }
+
+        if (due - diag->sequence > BLE_DIAG_MAX_BACKLOG) {
+            const uint32_t dropped = due - diag->sequence - BLE_DIAG_MAX_BACKLOG;
+            diag->frames_dropped += dropped;
+            diag->sequence += dropped;
+        }
+    }
+
+    size_t length = diag->frame_bytes < max_length ? diag->frame_bytes : max_length;
+    if (length < BLE_DIAG_FRAME_HEADER_BYTES) {
+        return 0;
+    }
+
+    putU32(putU32(frame, diag->sequence), (uint32_t)now_us);
+    for (size_t i = BLE_DIAG_FRAME_HEADER_BYTES; i < length; i++) {
+        frame[i] = (uint8_t)(diag->sequence + i);
+    }
+
+    *probe = false;
+    return length;
+}
+
+void ble_diag_sent(ble_diag_t * diag, size_t length, bool probe, int64_t now_us) {
+    if (probe) {
+        diag->probe_id++;
+        diag->probe_sent_us = now_us;
+        diag->probe_pending = true;
+        return;
+    }
+
+    diag->sequence++;
+    diag->frames_sent++;
+    diag->bytes_sent += (uint32_t)length;
+}
+
+void ble_diag_refused(ble_diag_t * diag, bool no_memory) {
+    if (no_memory) {
+        diag->no_memory++;
+    } else {
+        diag->busy++;
+    }
+}
+
+int ble_diag_ping(ble_diag_t * diag, const uint8_t * data, size_t length, uint8_t * echo, int64_t rx_us,
+                  int64_t tx_us) {
+    if (length < BLE_DIAG_PING_HEADER_BYTES) {
+        return -1;
+    }
+
+    const uint32_t id = getU32(&data[1]);
+
+    switch (data[0]) {
+        case BLE_DIAG_PING: {
+            const size_t stamp_length = length - BLE_DIAG_PING_HEADER_BYTES;
+            if (stamp_length > BLE_DIAG_PING_STAMP_MAX_BYTES) {
+                return -1;
+            }
+
+            uint8_t * cursor = echo;
+            *cursor++ = BLE_DIAG_ECHO;
+            cursor = putU32(cursor, id);
+            memcpy(cursor, &data[BLE_DIAG_PING_HEADER_BYTES], stamp_length);
+            cursor += stamp_length;
+            cursor = putU32(cursor, (uint32_t)rx_us);
+            cursor = putU32(cursor, (uint32_t)tx_us);
+            return (int)(cursor - echo);
+        }
+
+        case BLE_DIAG_PROBE_REPLY:
+            if (length != BLE_DIAG_PING_HEADER_BYTES + 4) {
+                return -1;
+            }
+
+            /* Only the outstanding probe counts, a late reply would skew the histogram */
+            if (diag->probe_pending && id == diag->probe_id) {
+                diag->probe_pending = false;
+                addRoundTrip(diag, (uint32_t)rx_us - getU32(&data[BLE_DIAG_PING_HEADER_BYTES]));
+            }
+            return 0;
+
+        default:
+            return -1;
+    }
+}
+
+size_t ble_diag_report(const ble_diag_t * diag, uint8_t * report, uint16_t conn_interval, int64_t now_us) {
+    const int64_t end_us = diag->running ? now_us : diag->stopped_us;
+    const int64_t elapsed_us = diag->started_us > 0 && end_us > diag->started_us ? end_us - diag->started_us : 0;
+    const uint32_t bytes_per_s = elapsed_us > 0 ? (uint32_t)((uint64_t)diag->bytes_sent * 1000000 / elapsed_us) : 0;
+    uint32_t packets_per_event = 0;
+
+    if (conn_interval > 0 && elapsed_us > 0) {
+        /* Connection events in the run: elapsed / (interval * 1250 us), scaled by 100 */
+        const uint64_t events_x100 = (uint64_t)elapsed_us * 100 / ((uint64_t)conn_interval * 1250);
+        packets_per_event = events_x100 > 0 ? (uint32_t)((uint64_t)diag->frames_sent * 10000 / events_x100) : 0;
+    }
+
+    uint8_t * cursor = report;
+    cursor = putU32(cursor, (uint32_t)(elapsed_us / 1000));
+    cursor = putU32(cursor, diag->frames_sent);
+    cursor = putU32(cursor, diag->bytes_sent);
+    cursor = putU32(cursor, bytes_per_s);
+    cursor = putU32(cursor, diag->frames_dropped);
+    cursor = putU32(cursor, diag->busy);
+    cursor = putU32(cursor, diag->no_memory);
+    cursor = putU16(cursor, packets_per_event > UINT16_MAX ? UINT16_MAX : (uint16_t)packets_per_event);
+    cursor = putU16(cursor, conn_interval);
+    cursor = putU32(cursor, diag->rtt_count);
+    cursor = putU32(cursor, diag->rtt_min_us);
+    cursor = putU32(cursor, diag->rtt_count > 0 ? (uint32_t)(diag->rtt_sum_us / diag->rtt_count) : 0);
+    cursor = putU32(cursor, diag->rtt_max_us);
+    for (size_t i = 0; i < BLE_DIAG_RTT_BINS; i++) {
+        cursor = putU16(cursor, diag->rtt_histogram[i]);
+    }
+
+    return (size_t)(cursor - report);
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,510 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_download.c
+  * @brief   This file is the resumable download of recorded sessions implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_download.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putU16
+ *
+ * @abstract This function stores a little-endian uint16
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU16(uint8_t * data, uint16_t value);
+
+/*
+ * @function putU32
+ *
+ * @abstract This function stores a little-endian uint32
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU32(uint8_t * data, uint32_t value);
+
+/*
+ * @function putU64
+ *
+ * @abstract This function stores a little-endian uint64
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU64(uint8_t * data, uint64_t value);
+
+/*
+ * @function getU64
+ *
+ * @abstract This function loads a little-endian uint64
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint64_t getU64(const uint8_t * data);
+
+/*
+ * @function startDownload
+ *
+ * @abstract This function replaces the running download with a new one
+ *
+ * @param[out] download: Download
+ *
+ * @param[in] state: BLE_DOWNLOAD_STATE_LISTING or BLE_DOWNLOAD_STATE_READING
+ *
+ * @param[in] seek: Log positions the download starts at and its progress runs up to
+ *
+ * @param[in] from_ms: First time of the DATA or SUMMARY records sent
+ *
+ * @param[in] to_ms: Last time of the DATA or SUMMARY records sent
+ *
+ * @param[in] window: Requested window
+ *
+ * @param[in] level: Summary level, BLE_DOWNLOAD_LEVEL_RAW for the DATA records
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return false if the window or the level is out of range
+ */
+static bool startDownload(ble_download_t * download, uint8_t state, const ble_download_seek_t * seek,
+                          int64_t from_ms, int64_t to_ms, uint8_t window, uint8_t level, int64_t now_us);
+
+/*
+ * @function resendOnTimeout
+ *
+ * @abstract This function goes back to the last acknowledged record once BLE_DOWNLOAD_ACK_TIMEOUT_MS passed without
+ *           an acknowledgement
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+static void resendOnTimeout(ble_download_t * download, int64_t now_us);
+
+/*
+ * @function pushUnacked
+ *
+ * @abstract This function adds the position of a sent record or DONE frame to the window
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+static void pushUnacked(ble_download_t * download, int64_t now_us);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint8_t * putU16(uint8_t * data, uint16_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    return data + 2;
+}
+
+static uint8_t * putU32(uint8_t * data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    return data + 4;
+}
+
+static uint8_t * putU64(uint8_t * data, uint64_t value) {
+    putU32(data, (uint32_t)value);
+    return putU32(data + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t getU64(const uint8_t * data) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+
+    return value;
+}
+
+static bool startDownload(ble_download_t * download, uint8_t state, const ble_download_seek_t * seek,
+                          int64_t from_ms, int64_t to_ms, uint8_t window, uint8_t level, int64_t now_us) {
+    if (window < 1 || window > BLE_DOWNLOAD_MAX_WINDOW || from_ms > to_ms ||
+        (level != BLE_DOWNLOAD_LEVEL_RAW && level >= SESSION_STORE_SUMMARY_LEVELS)) {
+        return false;
+    }
+
+    /* The previous state is kept so that the change is indicated */
+    const uint8_t status_state = download->status_state;
+    const int64_t status_sent_us = download->status_sent_us;
+
+    ble_download_init(download);
+    download->status_state = status_state;
+    download->status_sent_us = status_sent_us;
+
+    download->state = state;
+    download->window = window;
+    download->level = level;
+    download->from_ms = from_ms;
+    download->to_ms = to_ms;
+    download->start_position = seek->position;
+    download->end_position = seek->end_position;
+    download->position = seek->position;
+    download->acked_position = seek->position;
+    download->sent_position = seek->position;
+    download->started_us = now_us;
+
+    return true;
+}
+
+static void resendOnTimeout(ble_download_t * download, int64_t now_us) {
+    if (download->unacked_count > 0 && now_us - download->ack_wait_us >= (int64_t)BLE_DOWNLOAD_ACK_TIMEOUT_MS * 1000) {
+        /* Go back to the last acknowledged record; the central drops frames it holds by their position */
+        download->position = download->acked_position;
+        download->unacked_count = 0;
+        download->record_length = 0;
+        download->done_pending = false;
+        download->done_sent = false;
+        download->retransmissions++;
+    }
+}
+
+static void pushUnacked(ble_download_t * download, int64_t now_us) {
+    if (download->unacked_count == 0) {
+        download->ack_wait_us = now_us;
+    }
+
+    const uint8_t slot = (download->unacked_head + download->unacked_count) % BLE_DOWNLOAD_MAX_WINDOW;
+    download->unacked[slot] = download->position;
+    download->unacked_count++;
+
+    if (download->position > download->sent_position) {
+        download->sent_position = download->position;
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_download_init(ble_download_t * download) {
+    memset(download, 0, sizeof(*download));
+}
+
+void ble_download_seek(const uint8_t * data, size_t length, ble_download_seek_t * seek) {
+    int64_t to_ms = INT64_MAX;
+
+    seek->position = 0;
+    seek->end_position = 0;
+
+    if (length < BLE_DOWNLOAD_LIST_BYTES ||
+        (data[0] != BLE_DOWNLOAD_OP_LIST && length < BLE_DOWNLOAD_READ_BYTES)) {
+        return;
+    }
+
+    switch (data[0]) {
+        case BLE_DOWNLOAD_OP_LIST:
+            seek->position = getU64(&data[1]);
+            break;
+
+        case BLE_DOWNLOAD_OP_READ: {
+            const int64_t from_ms = (int64_t)getU64(&data[1]);
+            const uint8_t level = length > BLE_DOWNLOAD_READ_BYTES ? data[18] : BLE_DOWNLOAD_LEVEL_RAW;
+
+            /* An empty log starts at 0 and ends at once, any other failure shows when the first record is read */
+            if ((level == BLE_DOWNLOAD_LEVEL_RAW ? session_store_seek(from_ms, &seek->position) :
+                 session_store_seek_summaries(level, from_ms, &seek->position)) != ESP_OK) {
+                seek->position = 0;
+            }
+            to_ms = (int64_t)getU64(&data[9]);
+            break;
+        }
+
+        case BLE_DOWNLOAD_OP_RESUME:
+            seek->position = getU64(&data[1]);
+            to_ms = (int64_t)getU64(&data[9]);
+            break;
+
+        default:
+            return;
+    }
+
+    /* Progress runs up to the block holding the end of the range, or the newest block */
+    if (session_store_seek(to_ms, &seek->end_position) != ESP_OK) {
+        seek->end_position = seek->position;
+    }
+}
+
+bool ble_download_control(ble_download_t * download, const uint8_t * data, size_t length,
+                          const ble_download_seek_t * seek, int64_t now_us) {
+    if (length < 1) {
+        return false;
+    }
+
+    switch (data[0]) {
+        case BLE_DOWNLOAD_OP_LIST:
+            if (length != BLE_DOWNLOAD_LIST_BYTES) {
+                return false;
+            }
+            return startDownload(download, BLE_DOWNLOAD_STATE_LISTING, seek, INT64_MIN, INT64_MAX, data[9],
+                                 BLE_DOWNLOAD_LEVEL_RAW, now_us);
+
+        case BLE_DOWNLOAD_OP_READ:
+            if (length != BLE_DOWNLOAD_READ_BYTES && length != BLE_DOWNLOAD_READ_BYTES + 1) {
+                return false;
+            }
+            return startDownload(download, BLE_DOWNLOAD_STATE_READING, seek, (int64_t)getU64(&data[1]),
+                                 (int64_t)getU64(&data[9]), data[17],
+                                 length > BLE_DOWNLOAD_READ_BYTES ? data[18] : BLE_DOWNLOAD_LEVEL_RAW, now_us);
+
+        case BLE_DOWNLOAD_OP_RESUME:
+            if (length != BLE_DOWNLOAD_READ_BYTES && length != BLE_DOWNLOAD_READ_BYTES + 1) {
+                return false;
+            }
+            return startDownload(download, BLE_DOWNLOAD_STATE_READING, seek, INT64_MIN, (int64_t)getU64(&data[9]),
+                                 data[17], length > BLE_DOWNLOAD_READ_BYTES ? data[18] : BLE_DOWNLOAD_LEVEL_RAW,
+                                 now_us);
+
+        case BLE_DOWNLOAD_OP_ACK: {
+            if (length != BLE_DOWNLOAD_ACK_BYTES) {
+                return false;
+            }
+
+            const uint64_t position = getU64(&data[1]);
+
+            /* A stale acknowledgement, or one past anything sent, changes nothing */
+            if (download->state == BLE_DOWNLOAD_STATE_IDLE || position < download->acked_position ||
+                position > download->sent_position) {
+                return true;
+            }
+
+            download->acked_position = position;
+            while (download->unacked_count > 0 && download->unacked[download->unacked_head] <= position) {
+                download->unacked_head = (download->unacked_head + 1) % BLE_DOWNLOAD_MAX_WINDOW;
+                download->unacked_count--;
+                download->ack_wait_us = now_us;
+            }
+
+            if (position > download->position) {
+                /* Acknowledged before the retransmission got there: only the acknowledgement had been lost */
+                download->position = position;
+                download->record_length = 0;
+                download->done_pending = false;
+            }
+
+            if (download->done_sent && download->unacked_count == 0) {
+                download->state = BLE_DOWNLOAD_STATE_IDLE;
+                download->stopped_us = now_us;
+            }
+            return true;
+        }
+
+        case BLE_DOWNLOAD_OP_ABORT:
+            if (download->state != BLE_DOWNLOAD_STATE_IDLE) {
+                download->state = BLE_DOWNLOAD_STATE_IDLE;
+                download->result = BLE_DOWNLOAD_RESULT_ABORTED;
+                download->stopped_us = now_us;
+            }
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+bool ble_download_read_due(ble_download_t * download, ble_download_read_t * read, int64_t now_us) {
+    if (download->state == BLE_DOWNLOAD_STATE_IDLE) {
+        return false;
+    }
+
+    resendOnTimeout(download, now_us);
+
+    if (download->record_length > 0 || download->done_pending || download->done_sent ||
+        download->unacked_count >= download->window) {
+        return false;
+    }
+
+    read->state = download->state;
+    read->level = download->level;
+    read->from_ms = download->from_ms;
+    read->to_ms = download->to_ms;
+    read->position = download->position;
+    return true;
+}
+
+void ble_download_read(ble_download_read_t * read) {
+    read->next = read->position;
+    read->done = false;
+    read->record_length = 0;
+
+    while (1) {
+        uint64_t next = read->next;
+        size_t length;
+        int64_t first_ms;
+        int64_t last_ms;
+
+        const esp_err_t error = read->state == BLE_DOWNLOAD_STATE_LISTING ?
+                session_store_read_sessions(&next, read->record, sizeof(read->record), &length) :
+                read->level != BLE_DOWNLOAD_LEVEL_RAW ?
+                session_store_read_summaries(read->level, &next, read->record, sizeof(read->record), &length) :
+                session_store_read(&next, read->record, sizeof(read->record), &length);
+
+        if (error != ESP_OK) {
+            /* Listing always runs to the end of the log, a read that gets there may continue once more is written */
+            read->result = error != ESP_ERR_NOT_FOUND ? BLE_DOWNLOAD_RESULT_ERROR :
+                           read->state == BLE_DOWNLOAD_STATE_LISTING ? BLE_DOWNLOAD_RESULT_COMPLETE :
+                           BLE_DOWNLOAD_RESULT_END_OF_LOG;
+            read->done = true;
+            return;
+        }
+
+        /* Session records pass like in session_store_read_range, they frame the DATA or SUMMARY records of the range */
+        if (read->state == BLE_DOWNLOAD_STATE_READING &&
+            session_store_data_span(read->record, length, &first_ms, &last_ms) > 0) {
+            if (first_ms > read->to_ms) {
+                /* DONE stays before this record, a RESUME with a later end continues with it */
+                read->result = BLE_DOWNLOAD_RESULT_COMPLETE;
+                read->done = true;
+                return;
+            }
+
+            if (last_ms < read->from_ms) {
+                read->next = next;
+                continue;
+            }
+        }
+
+        read->next = next;
+        read->record_length = (uint16_t)length;
+        return;
+    }
+}
+
+size_t ble_download_next(ble_download_t * download, const ble_download_read_t * read, uint8_t * frame,
+                         size_t max_length, int64_t now_us) {
+    if (download->state == BLE_DOWNLOAD_STATE_IDLE || max_length <= BLE_DOWNLOAD_FRAME_HEADER_BYTES) {
+        return 0;
+    }
+
+    resendOnTimeout(download, now_us);
+
+    if (download->record_length == 0 && !download->done_pending) {
+        /* A new request, an acknowledgement or a retransmission since the read leaves it for the next pass */
+        if (download->done_sent || download->unacked_count >= download->window || read == NULL ||
+            read->state != download->state || read->level != download->level ||
+            read->from_ms != download->from_ms || read->to_ms != download->to_ms ||
+            read->position != download->position) {
+            return 0;
+        }
+
+        download->position = read->next;
+        if (read->done) {
+            download->result = read->result;
+            download->done_pending = true;
+        } else {
+            memcpy(download->record, read->record, read->record_length);
+            download->record_length = read->record_length;
+            download->record_offset = 0;
+        }
+    }
+
+    uint8_t * cursor = frame;
+
+    if (download->done_pending) {
+        *cursor++ = BLE_DOWNLOAD_FRAME_DONE;
+        cursor = putU64(cursor, download->position);
+        cursor = putU16(cursor, 0);
+        *cursor++ = download->result;
+        return (size_t)(cursor - frame);
+    }
+
+    const size_t remaining = download->record_length - download->record_offset;
+    const size_t fragment = remaining < max_length - BLE_DOWNLOAD_FRAME_HEADER_BYTES ? remaining :
+                            max_length - BLE_DOWNLOAD_FRAME_HEADER_BYTES;
+
+    *cursor++ = BLE_DOWNLOAD_FRAME_RECORD;
+    cursor = putU64(cursor, download->position);
+    cursor = putU16(cursor, download->record_offset);
+    memcpy(cursor, &download->record[download->record_offset], fragment);
+
+    return BLE_DOWNLOAD_FRAME_HEADER_BYTES + fragment;
+}
+
+void ble_download_sent(ble_download_t * download, size_t length, int64_t now_us) {
+    download->bytes_sent += (uint32_t)length;
+
+    if (download->done_pending) {
+        download->done_pending = false;
+        download->done_sent = true;
+        pushUnacked(download, now_us);
+        return;
+    }
+
+    download->record_offset += (uint16_t)(length - BLE_DOWNLOAD_FRAME_HEADER_BYTES);
+    if (download->record_offset >= download->record_length) {
+        download->record_length = 0;
+        pushUnacked(download, now_us);
+    }
+}
+
+bool ble_download_status_due(const ble_download_t * download, int64_t now_us) {
+    return download->state != download->status_state ||
+           (download->state != BLE_DOWNLOAD_STATE_IDLE &&
+            now_us - download->status_sent_us >= (int64_t)BLE_DOWNLOAD_STATUS_MS * 1000);
+}
+
+size_t ble_download_status(ble_download_t * download, uint8_t * status, int64_t now_us) {
+    const int64_t end_us = download->state != BLE_DOWNLOAD_STATE_IDLE ? now_us : download->stopped_us;
+    const int64_t elapsed_us = download->started_us > 0 && end_us > download->started_us ?
+                               end_us - download->started_us : 0;
+    const uint64_t span = download->end_position - download->start_position;
+    uint32_t progress = 0;
+
+    if (download->state == BLE_DOWNLOAD_STATE_IDLE && download->started_us > 0 &&
+        download->result != BLE_DOWNLOAD_RESULT_ERROR && download->result != BLE_DOWNLOAD_RESULT_ABORTED) {
+        progress = 1000;
+    } else if (download->end_position > download->start_position) {
+        const uint64_t done = download->acked_position - download->start_position;
+        progress = done >= span ? 1000 : (uint32_t)(done * 1000 / span);
+    }
+
+    uint8_t * cursor = status;
+    *cursor++ = download->state;
+    *cursor++ = download->result;
+    cursor = putU16(cursor, (uint16_t)progress);
+    cursor = putU64(cursor, download->acked_position);
+    cursor = putU32(cursor, elapsed_us > 0 ? (uint32_t)((uint64_t)download->bytes_sent * 1000000 / elapsed_us) : 0);
+    cursor = putU32(cursor, download->retransmissions);
+
+    download->status_sent_us = now_us;
+    download->status_state = download->state;
+
+    return (size_t)(cursor - status);
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
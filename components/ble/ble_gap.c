@@ -18,6 +18,13 @@
 #include "console/console.h"
 #include "services/gap/ble_svc_gap.h"
 #include "ble_gatt.h"
+#include "ble_conn.h"
+#include "ble_link.h"
+#include "ble_tx.h"
+#include "ble_coc.h"
+#include "ble_beacon.h"
+#include "ble_bond.h"
+#include "esp_timer.h"
 
 /* Private typedef ---------------------------------------------------------------------------------------------------*/
 
@@ -30,12 +37,13 @@ static const char * TAG = "BLE_GAP";
 
 static uint8_t own_addr_type;
 
+/** @abstract Set while the advertising accepts connections, cleared while it only broadcasts */
+static bool adv_connectable = false;
+
+/** @abstract Advertising data refresh timer of the broadcast mode */
+static esp_timer_handle_t beacon_timer = NULL;
+
 /* External variables ------------------------------------------------------------------------------------------------*/
-uint16_t conn_handle;
-uint8_t temperature_notification_enabled;
-uint8_t humidity_notification_enabled;
-uint8_t pressure_notification_enabled;
-uint8_t audio_notification_enabled;
 uint16_t temperature_notify_handle;
 uint16_t humidity_notify_handle;
 uint16_t pressure_notify_handle;
@@ -53,6 +61,29 @@ uint16_t audio_notify_handle;
  */
 static void bleprph_advertise(void);
 
+/*
+ * @function setAdvertisingData
+ *
+ * @abstract This function sets the advertising data: flags, TX power, the service UUID and in broadcast mode the
+ *           latest readings as service data
+ *
+ * @param None
+ *
+ * @return 0 on success, NimBLE error code otherwise
+ */
+static int setAdvertisingData(void);
+
+/*
+ * @function onBeaconTimer
+ *
+ * @abstract This function is a timer callback that refreshes the broadcast readings while advertising runs
+ *
+ * @param[in] arg: Unused
+ *
+ * @return None
+ */
+static void onBeaconTimer(void * arg);
+
 /*
  * @function bleprph_gap_event
  *
@@ -97,13 +128,26 @@ static void bleprph_on_sync(void);
  *
  * @abstract This function prints logs regarrding subscribing to the characteristics
  *
+ * @param[in] conn_handle: Connection handle
+ *
  * @param[in] attr_handle: Handle to the characteristic
  *
- * @param[in] curr_notify: Notification's subscription status
+ * @param[in] curr_notify: Notification or indication subscription status
+ *
+ * @return None
+ */
+static void subscribe_event(uint16_t conn_handle, uint16_t attr_handle, uint8_t curr_notify);
+
+/*
+ * @function track_connection
+ *
+ * @abstract This function starts tracking the link state of a new connection
+ *
+ * @param[in] conn_handle: Connection handle
  *
  * @return None
  */
-static void subscribe_event(uint16_t attr_handle, uint8_t curr_notify);
+static void track_connection(uint16_t conn_handle);
 
 /* Private function definitions --------------------------------------------------------------------------------------*/
 static void bleprph_advertise(void) {
@@ -111,14 +155,56 @@ static void bleprph_advertise(void) {
     struct ble_gap_adv_params adv_params;
     struct ble_hs_adv_fields fields;
     const char *name;
+    uint16_t handles[BLE_CONN_MAX];
     int rc;
 
+    rc = setAdvertisingData();
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Error setting advertisement data; rc=%d\n", rc);
+        return;
+    }
+
+    /* The device name goes to the scan response, active scanners still get it */
+    memset(&fields, 0, sizeof fields);
+    name = ble_svc_gap_device_name();
+    fields.name = (uint8_t *)name;
+    fields.name_len = strlen(name);
+    fields.name_is_complete = 1;
+
+    rc = ble_gap_adv_rsp_set_fields(&fields);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Error setting scan response data; rc=%d\n", rc);
+        return;
+    }
+
+    /* Begin advertising; in broadcast mode keep it up without connections while every slot is taken. */
+    adv_connectable = ble_conn_list(0, handles) < BLE_CONN_MAX;
+    if (!adv_connectable && !BLE_BEACON_ENABLED) {
+        return;
+    }
+
+    memset(&adv_params, 0, sizeof adv_params);
+    adv_params.conn_mode = adv_connectable ? BLE_GAP_CONN_MODE_UND : BLE_GAP_CONN_MODE_NON;
+    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
+    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER,
+                           &adv_params, bleprph_gap_event, NULL);
+    if (rc != 0) {
+        ESP_LOGE(TAG, "Error enabling advertisement; rc=%d\n", rc);
+        return;
+    }
+
+}
+
+static int setAdvertisingData(void) {
+
+    struct ble_hs_adv_fields fields;
+
     /**
      *  Set the advertisement data included in our advertisements:
      *     o Flags (indicates advertisement type and other general info).
      *     o Advertising tx power.
-     *     o Device name.
      *     o 16-bit service UUIDs (alert notifications).
+     *     o Service data with the latest readings, in broadcast mode.
      */
 
     memset(&fields, 0, sizeof fields);
@@ -137,10 +223,6 @@ static void bleprph_advertise(void) {
     fields.tx_pwr_lvl_is_present = 1;
     fields.tx_pwr_lvl = BLE_HS_ADV_TX_PWR_LVL_AUTO;
 
-    name = ble_svc_gap_device_name();
-    fields.name = (uint8_t *)name;
-    fields.name_len = strlen(name);
-    fields.name_is_complete = 1;
     fields.uuids16 = (ble_uuid16_t[]) {
             BLE_UUID16_INIT(DEVICE_SVR_SVC_UUID)
     };
@@ -148,21 +230,27 @@ static void bleprph_advertise(void) {
     fields.num_uuids16 = 1;
     fields.uuids16_is_complete = 1;
 
-    rc = ble_gap_adv_set_fields(&fields);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Error setting advertisement data; rc=%d\n", rc);
-        return;
-    }
+#if BLE_BEACON_ENABLED
+    /* Service data starts with the 16-bit UUID it belongs to; 22 of the 31 legacy advertising bytes are used */
+    uint8_t service_data[2 + BLE_BEACON_PAYLOAD_BYTES] = {
+            (uint8_t)(DEVICE_SVR_SVC_UUID & 0xFF), (uint8_t)(DEVICE_SVR_SVC_UUID >> 8)
+    };
 
-    /* Begin advertising. */
-    memset(&adv_params, 0, sizeof adv_params);
-    adv_params.conn_mode = BLE_GAP_CONN_MODE_UND;
-    adv_params.disc_mode = BLE_GAP_DISC_MODE_GEN;
-    rc = ble_gap_adv_start(own_addr_type, NULL, BLE_HS_FOREVER,
-                           &adv_params, bleprph_gap_event, NULL);
-    if (rc != 0) {
-        ESP_LOGE(TAG, "Error enabling advertisement; rc=%d\n", rc);
-        return;
+    fields.svc_data_uuid16 = service_data;
+    fields.svc_data_uuid16_len = 2 + ble_beacon_encode(&service_data[2]);
+#endif
+
+    return ble_gap_adv_set_fields(&fields);
+
+}
+
+static void onBeaconTimer(void * arg) {
+
+    if (ble_gap_adv_active()) {
+        int rc = setAdvertisingData();
+        if (rc != 0) {
+            ESP_LOGW(TAG, "Error refreshing advertisement data; rc=%d", rc);
+        }
     }
 
 }
@@ -182,6 +270,9 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
             if (event->connect.status == 0) {
                 rc = ble_gap_conn_find(event->connect.conn_handle, &desc);
                 assert(rc == 0);
+                track_connection(event->connect.conn_handle);
+                ble_bond_on_connect(event->connect.conn_handle);
+                ble_link_on_connect(event->connect.conn_handle);
             }
 
             rc = ble_att_set_preferred_mtu(512);
@@ -197,26 +288,25 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
             }
 
 
-            if (event->connect.status != 0) {
-                /* Connection failed; resume advertising. */
-                bleprph_advertise();
-            }
-
-
-            conn_handle = event->connect.conn_handle;
+            /* Resume advertising; it only broadcasts once every connection slot is taken. */
+            bleprph_advertise();
 
             return 0;
 
         case BLE_GAP_EVENT_DISCONNECT:
             ESP_LOGD(TAG, "Disconnect; reason=%d \n", event->disconnect.reason);
 
-            temperature_notification_enabled = 0;
-            humidity_notification_enabled = 0;
-            pressure_notification_enabled = 0;
-            audio_notification_enabled = 0;
+            ble_conn_remove(event->disconnect.conn.conn_handle);
+            ble_link_on_disconnect(event->disconnect.conn.conn_handle);
+            ble_bond_on_disconnect(event->disconnect.conn.conn_handle);
 
-            /* Connection terminated; resume advertising. */
-            bleprph_advertise();
+            /* Connection terminated; resume connectable advertising unless it still runs for the other centrals. */
+            if (ble_gap_adv_active() && !adv_connectable) {
+                ble_gap_adv_stop();
+            }
+            if (!ble_gap_adv_active()) {
+                bleprph_advertise();
+            }
             return 0;
 
         case BLE_GAP_EVENT_CONN_UPDATE:
@@ -225,6 +315,9 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
                         event->conn_update.status);
             rc = ble_gap_conn_find(event->conn_update.conn_handle, &desc);
             assert(rc == 0);
+            ble_conn_set_params(desc.conn_handle, desc.conn_itvl, desc.conn_latency, desc.supervision_timeout);
+            ble_conn_log(desc.conn_handle);
+            ble_link_on_conn_update(desc.conn_handle, event->conn_update.status);
             return 0;
 
         case BLE_GAP_EVENT_ADV_COMPLETE:
@@ -239,6 +332,7 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
                         event->enc_change.status);
             rc = ble_gap_conn_find(event->enc_change.conn_handle, &desc);
             assert(rc == 0);
+            ble_bond_on_encryption(event->enc_change.conn_handle, event->enc_change.status);
             return 0;
 
         case BLE_GAP_EVENT_SUBSCRIBE:
@@ -252,7 +346,27 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
                         event->subscribe.prev_indicate,
                         event->subscribe.cur_indicate);
 
-            subscribe_event(event->subscribe.attr_handle, event->subscribe.cur_notify);
+            /* The Memory Status characteristics indicate, the others notify */
+            subscribe_event(event->subscribe.conn_handle, event->subscribe.attr_handle,
+                            event->subscribe.cur_notify || event->subscribe.cur_indicate);
+
+            ble_conn_state_t state;
+            if (ble_conn_get(event->subscribe.conn_handle, &state)) {
+                ble_link_set_streaming(event->subscribe.conn_handle, state.subscriptions != 0);
+            }
+
+            /* A new subscriber may take the backlog */
+            ble_tx_kick();
+
+            return 0;
+
+        case BLE_GAP_EVENT_NOTIFY_TX:
+            /* A transmission completed, its PDUs leave the queue and queued notifications may fit now */
+            if (!event->notify_tx.indication) {
+                ble_conn_queue_complete(event->notify_tx.conn_handle, event->notify_tx.attr_handle,
+                                        event->notify_tx.status);
+            }
+            ble_tx_kick();
 
             return 0;
 
@@ -261,23 +375,44 @@ static int bleprph_gap_event(struct ble_gap_event *event, void *arg) {
                         event->mtu.conn_handle,
                         event->mtu.channel_id,
                         event->mtu.value);
+            ble_conn_set_mtu(event->mtu.conn_handle, event->mtu.value);
+            ble_conn_log(event->mtu.conn_handle);
             return 0;
 
-        case BLE_GAP_EVENT_REPEAT_PAIRING:
-            /* We already have a bond with the peer, but it is attempting to
-             * establish a new secure link.  This app sacrifices security for
-             * convenience: just throw away the old bond and accept the new link.
-             */
+        case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+            ESP_LOGD(TAG, "PHY update event; conn_handle=%d status=%d tx=%d rx=%d\n",
+                        event->phy_updated.conn_handle,
+                        event->phy_updated.status,
+                        event->phy_updated.tx_phy,
+                        event->phy_updated.rx_phy);
+            if (event->phy_updated.status == 0) {
+                ble_conn_set_phy(event->phy_updated.conn_handle, event->phy_updated.tx_phy,
+                                 event->phy_updated.rx_phy);
+                ble_conn_log(event->phy_updated.conn_handle);
+            }
+            ble_link_on_phy_update(event->phy_updated.conn_handle, event->phy_updated.status);
+            return 0;
 
-            /* Delete the old bond. */
-            rc = ble_gap_conn_find(event->repeat_pairing.conn_handle, &desc);
-            assert(rc == 0);
-            ble_store_util_delete_peer(&desc.peer_id_addr);
+        case BLE_GAP_EVENT_DATA_LEN_CHG:
+            ESP_LOGD(TAG, "Data length event; conn_handle=%d tx=%d/%d rx=%d/%d\n",
+                        event->data_len_chg.conn_handle,
+                        event->data_len_chg.max_tx_octets,
+                        event->data_len_chg.max_tx_time,
+                        event->data_len_chg.max_rx_octets,
+                        event->data_len_chg.max_rx_time);
+            ble_conn_set_data_length(event->data_len_chg.conn_handle,
+                                     event->data_len_chg.max_tx_octets, event->data_len_chg.max_tx_time,
+                                     event->data_len_chg.max_rx_octets, event->data_len_chg.max_rx_time);
+            ble_conn_log(event->data_len_chg.conn_handle);
+            ble_link_on_data_len_change(event->data_len_chg.conn_handle, event->data_len_chg.max_tx_octets);
+            return 0;
 
-            /* Return BLE_GAP_REPEAT_PAIRING_RETRY to indicate that the host should
-             * continue with the pairing operation.
+        case BLE_GAP_EVENT_REPEAT_PAIRING:
+            /* We already have a bond with the peer, but it is attempting to
+             * establish a new secure link.  Accept it only if it is not weaker
+             * than the bond, which is the case when the peer lost its keys.
              */
-            return BLE_GAP_REPEAT_PAIRING_RETRY;
+            return ble_bond_on_repeat_pairing(&event->repeat_pairing);
 
         case BLE_GAP_EVENT_PASSKEY_ACTION:
             ESP_LOGD(TAG, "PASSKEY_ACTION_EVENT started \n");
@@ -345,25 +480,45 @@ static void bleprph_on_sync(void) {
     uint8_t addr_val[6] = {0};
     rc = ble_hs_id_copy_addr(own_addr_type, addr_val, NULL);
 
+    /* The services are registered by now; tell bonded centrals if their cached database went stale */
+    ble_bond_layout_check();
+
     /* Begin advertising. */
     bleprph_advertise();
 
 }
 
-static void subscribe_event(uint16_t attr_handle, uint8_t curr_notify) {
+static void subscribe_event(uint16_t conn_handle, uint16_t attr_handle, uint8_t curr_notify) {
+
+    uint32_t subscription = gatt_svr_subscription(attr_handle);
+
+    if (subscription != 0) {
+        ble_conn_set_subscription(conn_handle, subscription, curr_notify);
+    }
+
+}
+
+static void track_connection(uint16_t conn_handle) {
+
+    struct ble_gap_conn_desc desc;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+
+    if (ble_conn_add(conn_handle) == NULL) {
+        ESP_LOGE(TAG, "No link state slot for connection %d", conn_handle);
+        return;
+    }
 
-    if (attr_handle == temperature_notify_handle) {
-        temperature_notification_enabled = curr_notify;
-    } else if (attr_handle == humidity_notify_handle) {
-        humidity_notification_enabled = curr_notify;
-    } else if (attr_handle == pressure_notify_handle) {
-        pressure_notification_enabled = curr_notify;
-    } else if (attr_handle == audio_notify_handle) {
-        audio_notification_enabled = curr_notify;
-    } else {
+    if (ble_gap_conn_find(conn_handle, &desc) == 0) {
+        ble_conn_set_params(conn_handle, desc.conn_itvl, desc.conn_latency, desc.supervision_timeout);
+    }
 
+    if (ble_gap_read_le_phy(conn_handle, &tx_phy, &rx_phy) == 0) {
+        ble_conn_set_phy(conn_handle, tx_phy, rx_phy);
     }
 
+    ble_conn_log(conn_handle);
+
 }
 /* Exported function declarations ------------------------------------------------------------------------------------*/
 void ble_store_config_init(void);
@@ -381,11 +536,6 @@ void bleprph_host_task(void *param) {
 
 void ble_init(void) {
 
-    temperature_notification_enabled = 0;
-    humidity_notification_enabled = 0;
-    pressure_notification_enabled = 0;
-    audio_notification_enabled = 0;
-
     int rc;
 
     /* Initialize NVS — it is used to store PHY calibration data */
@@ -407,9 +557,8 @@ void ble_init(void) {
     ble_hs_cfg.store_status_cb = ble_store_util_status_rr;
 
     ble_hs_cfg.sm_io_cap = 3;
-#ifdef CONFIG_EXAMPLE_BONDING
+    /* Bond so a returning central resumes encryption, its subscriptions and its cached GATT database */
     ble_hs_cfg.sm_bonding = 1;
-#endif
 #ifdef CONFIG_EXAMPLE_MITM
     ble_hs_cfg.sm_mitm = 1;
 #endif
@@ -418,23 +567,41 @@ void ble_init(void) {
 #else
     ble_hs_cfg.sm_sc = 0;
 #endif
-#ifdef CONFIG_EXAMPLE_BONDING
-    ble_hs_cfg.sm_our_key_dist = 1;
-    ble_hs_cfg.sm_their_key_dist = 1;
-#endif
+    /* Identity keys let the bond follow a central that uses a resolvable private address */
+    ble_hs_cfg.sm_our_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
+    ble_hs_cfg.sm_their_key_dist = BLE_SM_PAIR_KEY_DIST_ENC | BLE_SM_PAIR_KEY_DIST_ID;
 
     ESP_LOGI(TAG, "GATT SVR init");
     rc = gatt_svr_init();
     assert(rc == 0);
 
+    ESP_LOGI(TAG, "L2CAP CoC init");
+    rc = ble_coc_init();
+    assert(rc == 0);
+
+    /* Every transmit source is registered by now */
+    ESP_LOGI(TAG, "TX scheduler start");
+    rc = ble_tx_start() ? 0 : BLE_HS_ENOMEM;
+    assert(rc == 0);
+
     /* Set the default device name. */
     ESP_LOGI(TAG, "Set device name to %s", DEVICE_NAME);
     rc = ble_svc_gap_device_name_set(DEVICE_NAME);
     assert(rc == 0);
 
-    /* XXX Need to have template for store */
+    /* Bonds and the subscriptions of bonded centrals persist in NVS (CONFIG_BT_NIMBLE_NVS_PERSIST) */
     ESP_LOGI(TAG, "Store config");
     ble_store_config_init();
+
+    if (BLE_BEACON_ENABLED) {
+        const esp_timer_create_args_t beacon_timer_args = {
+                .callback = onBeaconTimer,
+                .name = "ble_beacon",
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&beacon_timer_args, &beacon_timer));
+        ESP_ERROR_CHECK(esp_timer_start_periodic(beacon_timer, (uint64_t)BLE_BEACON_REFRESH_MS * 1000));
+    }
+
     ESP_LOGI(TAG, "Nimble task init");
     nimble_port_freertos_init(bleprph_host_task);
 
@@ -16,12 +16,27 @@
 #include "services/gatt/ble_svc_gatt.h"
 #include "ble_gap.h"
 #include "ble_gatt.h"
+#include "ble_stream.h"
+#include "ble_snapshot.h"
+#include "ble_conn.h"
+#include "ble_tx.h"
+#include "ble_coc.h"
+#include "ble_bond.h"
+#include "ble_diag.h"
+#include "ble_time.h"
+#include "ble_download.h"
+#include "rtc_driver.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 /* Private define ----------------------------------------------------------------------------------------------------*/
 #define DEVICE_MODEL_NUMBER "ID-169"
 #define DEVICE_SERIAL_NUMBER "S/N 001"
 #define DEVICE_FIRMWARE_REVISION "1.0.0"
 #define DEVICE_MANUFACTURER_NAME "Politechnika Gdańska"
+/** @abstract Size of the handle-indexed dispatch table, must exceed the highest attribute handle */
+#define GATT_SVR_MAX_HANDLES 128
 
 /* Private macros ----------------------------------------------------------------------------------------------------*/
 
@@ -129,29 +144,161 @@ static const ble_uuid128_t gatt_svr_chr_microphone_memory_status_uuid =
         BLE_UUID128_INIT(0xAE, 0x6A, 0xB6, 0xAE, 0x40, 0x0F, 0xC8, 0x86,
                         0xF2, 0x4E, 0x11, 0xCF, 0x6F, 0x41, 0xE1, 0x7D);
 
-/** @abstract Holding Temperature Stream characteristic value */
-static uint8_t * gatt_svr_chr_temperature_stream_value = NULL;
+// E7 ED E4 8F E6 13 4C E4 AB 0A A6 CE 5C 21 F1 E6
+/** @abstract BLE Self-test Service UUID */
+static const ble_uuid128_t gatt_svr_svc_selftest_service_uuid =
+        BLE_UUID128_INIT(0xE6, 0xF1, 0x21, 0x5C, 0xCE, 0xA6, 0x0A, 0xAB,
+                        0xE4, 0x4C, 0x13, 0xE6, 0x8F, 0xE4, 0xED, 0xE7);
+
+// AC 8E A7 68 0D 43 4C F5 BD B6 C1 9D 2D B1 70 3E
+/** @brief BLE Self-test Control Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_selftest_control_uuid =
+        BLE_UUID128_INIT(0x3E, 0x70, 0xB1, 0x2D, 0x9D, 0xC1, 0xB6, 0xBD,
+                        0xF5, 0x4C, 0x43, 0x0D, 0x68, 0xA7, 0x8E, 0xAC);
+
+// D1 09 E7 A3 DA 2D 48 67 89 EF 7F A5 07 6C 45 A9
+/** @brief BLE Self-test Stream Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_selftest_stream_uuid =
+        BLE_UUID128_INIT(0xA9, 0x45, 0x6C, 0x07, 0xA5, 0x7F, 0xEF, 0x89,
+                        0x67, 0x48, 0x2D, 0xDA, 0xA3, 0xE7, 0x09, 0xD1);
+
+// 01 59 D3 79 35 C2 44 F9 A2 46 D2 DE E1 C5 18 2F
+/** @brief BLE Self-test Ping Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_selftest_ping_uuid =
+        BLE_UUID128_INIT(0x2F, 0x18, 0xC5, 0xE1, 0xDE, 0xD2, 0x46, 0xA2,
+                        0xF9, 0x44, 0xC2, 0x35, 0x79, 0xD3, 0x59, 0x01);
+
+// D9 4A 4C 5E 28 44 4D 61 86 91 23 42 D5 5F 9E 62
+/** @brief BLE Self-test Report Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_selftest_report_uuid =
+        BLE_UUID128_INIT(0x62, 0x9E, 0x5F, 0xD5, 0x42, 0x23, 0x91, 0x86,
+                        0x61, 0x4D, 0x44, 0x28, 0x5E, 0x4C, 0x4A, 0xD9);
 
-/** @abstract Holding Humidity Stream characteristic value */
-static uint8_t * gatt_svr_chr_humidity_stream_value = NULL;
+// 4D 52 60 C8 E9 38 49 43 B9 15 0B 8E 65 D2 57 BD
+/** @abstract BLE Time Sync Service UUID */
+static const ble_uuid128_t gatt_svr_svc_time_sync_service_uuid =
+        BLE_UUID128_INIT(0xBD, 0x57, 0xD2, 0x65, 0x8E, 0x0B, 0x15, 0xB9,
+                        0x43, 0x49, 0x38, 0xE9, 0xC8, 0x60, 0x52, 0x4D);
+
+// E4 8B 74 B3 ED AB 41 54 B0 0C E4 2D 21 9C A0 37
+/** @brief BLE Time Sync Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_time_sync_uuid =
+        BLE_UUID128_INIT(0x37, 0xA0, 0x9C, 0x21, 0x2D, 0xE4, 0x0C, 0xB0,
+                        0x54, 0x41, 0xAB, 0xED, 0xB3, 0x74, 0x8B, 0xE4);
+
+// AB A6 80 5E 51 94 43 0E 88 11 B9 F9 2D 8D D5 16
+/** @abstract BLE Download Service UUID */
+static const ble_uuid128_t gatt_svr_svc_download_service_uuid =
+        BLE_UUID128_INIT(0x16, 0xD5, 0x8D, 0x2D, 0xF9, 0xB9, 0x11, 0x88,
+                        0x0E, 0x43, 0x94, 0x51, 0x5E, 0x80, 0xA6, 0xAB);
+
+// E7 DB 69 32 2A 4A 41 4E 9B 9F D1 EF C6 C0 AD F5
+/** @brief BLE Download Control Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_download_control_uuid =
+        BLE_UUID128_INIT(0xF5, 0xAD, 0xC0, 0xC6, 0xEF, 0xD1, 0x9F, 0x9B,
+                        0x4E, 0x41, 0x4A, 0x2A, 0x32, 0x69, 0xDB, 0xE7);
+
+// E7 A1 4A FD C6 B5 4C 89 B0 6D F0 60 B4 72 47 29
+/** @brief BLE Download Data Characteristic UUID */
+static const ble_uuid128_t gatt_svr_chr_download_data_uuid =
+        BLE_UUID128_INIT(0x29, 0x47, 0x72, 0xB4, 0x60, 0xF0, 0x6D, 0xB0,
+                        0x89, 0x4C, 0xB5, 0xC6, 0xFD, 0x4A, 0xA1, 0xE7);
+
+/** @abstract Temperature Stream characteristic value, a single-sample frame with the latest sample */
+static ble_snapshot_t gatt_svr_chr_temperature_stream_value;
+
+/** @abstract Humidity Stream characteristic value, a single-sample frame with the latest sample */
+static ble_snapshot_t gatt_svr_chr_humidity_stream_value;
+
+/** @abstract Pressure Stream characteristic value, a single-sample frame with the latest sample */
+static ble_snapshot_t gatt_svr_chr_pressure_stream_value;
+
+/** @abstract Pending Temperature Stream samples */
+static ble_stream_channel_t temperature_stream;
+
+/** @abstract Pending Humidity Stream samples */
+static ble_stream_channel_t humidity_stream;
+
+/** @abstract Pending Pressure Stream samples */
+static ble_stream_channel_t pressure_stream;
+
+/** @abstract Notification mbuf usage */
+static gatt_svr_mbuf_stats_t mbuf_stats;
+
+/** @abstract Guards the mbuf counters, they are updated with and without tx_lock held */
+static portMUX_TYPE mbuf_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/** @abstract Guards the stream channels and the audio queue, shared by the producers and the transmit scheduler */
+static SemaphoreHandle_t tx_lock = NULL;
+
+/** @abstract Transmit scheduler sources */
+static ble_tx_source_t temperature_source;
+static ble_tx_source_t humidity_source;
+static ble_tx_source_t pressure_source;
+static ble_tx_source_t audio_source;
+static ble_tx_source_t selftest_source;
+static ble_tx_source_t download_source;
+
+/** @abstract Throughput and latency self-test, guarded by tx_lock */
+static ble_diag_t selftest;
+
+/** @abstract Connection that started the self-test, its interval scales the report */
+static uint16_t selftest_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+
+/** @abstract Wakes the transmit scheduler at the frame rate of a paced self-test */
+static esp_timer_handle_t selftest_timer = NULL;
+
+/** @abstract Session download, guarded by tx_lock */
+static ble_download_t download;
+
+/** @abstract Connection that requested the download, frames and progress go to it only */
+static uint16_t download_conn_handle = BLE_HS_CONN_HANDLE_NONE;
+
+/** @abstract Frame being sent, guarded by tx_lock */
+static uint8_t download_frame[BLE_DOWNLOAD_FRAME_MAX_BYTES];
+
+/** @abstract Record read for the download without tx_lock, only touched by the transmit scheduler task */
+static ble_download_read_t download_read;
 
-/** @abstract Holding Pressure Stream characteristic value */
-static uint8_t * gatt_svr_chr_pressure_stream_value = NULL;
+/** @abstract Audio frames waiting for the transmit scheduler */
+static uint8_t audio_queue[AUDIO_STREAM_QUEUE_FRAMES][AUDIO_STREAM_FRAME_MAX_BYTES];
+
+/** @abstract Lengths of the queued audio frames */
+static uint16_t audio_queue_length[AUDIO_STREAM_QUEUE_FRAMES];
 
-/** @abstract Holding Audio Stream characteristic value */
-static uint8_t * gatt_svr_chr_audio_stream_value = NULL;
+/** @abstract Total audio frames queued and sent */
+static uint32_t audio_queue_head = 0;
+static uint32_t audio_queue_tail = 0;
 
+/** @abstract Current Time characteristic value handle */
+static uint16_t current_time_handle;
+
+/** @abstract Device Information characteristics value handles */
+static uint16_t model_number_handle;
+static uint16_t serial_number_handle;
+static uint16_t firmware_revision_handle;
+static uint16_t manufacturer_name_handle;
+
+/** @abstract Memory Status characteristics value handles */
+static uint16_t temperature_memory_status_handle;
+static uint16_t humidity_memory_status_handle;
+static uint16_t pressure_memory_status_handle;
+static uint16_t audio_memory_status_handle;
+
+/** @abstract Self-test characteristics value handles */
+static uint16_t selftest_control_handle;
+static uint16_t selftest_stream_handle;
+static uint16_t selftest_ping_handle;
+static uint16_t selftest_report_handle;
+
+/** @abstract Time Sync Service handles */
+static uint16_t time_sync_handle;
+
+/** @abstract Download characteristics value handles */
+static uint16_t download_control_handle;
+static uint16_t download_data_handle;
 
 /* External variables ------------------------------------------------------------------------------------------------*/
-uint16_t cry_notify_handle;
-uint16_t current_sound_notify_handle;
-uint16_t current_light_pattern_notify_handle;
-uint16_t current_routine_notify_handle;
-uint8_t cry_notification_enabled;
-uint8_t current_sound_notification_enabled;
-uint8_t current_light_pattern_notification_enabled;
-uint8_t current_routine_notification_enabled;
-uint8_t already_cried;
 
 /* Private function declarations -------------------------------------------------------------------------------------*/
 /**
@@ -174,7 +321,8 @@ static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max
 
 /**
  *
- * @brief This function is a callback that gets called when a GATT event occurs.
+ * @brief This function is a callback that gets called when a GATT event occurs. It dispatches the access to the
+ *        handlers registered for the attribute handle.
  *
  * @param[in] conn_handle: BLE connection handle
  *
@@ -189,7 +337,494 @@ static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max
 static int gatt_svr_chr_access_all(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt,
                                    void *arg);
 
+/*
+ * @function readString
+ *
+ * @abstract This function answers a read of a constant string characteristic
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: NUL-terminated string
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int readString(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function readStream
+ *
+ * @abstract This function answers a stream characteristic read with a frame holding the latest sample, without
+ *           waiting for the sampling task
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Characteristic value snapshot
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int readStream(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function readCurrentTime
+ *
+ * @abstract This function answers a Current Time characteristic read
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int readCurrentTime(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function writeCurrentTime
+ *
+ * @abstract This function handles a Current Time characteristic write
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int writeCurrentTime(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function pushSample
+ *
+ * @abstract This function publishes a sample as the characteristic value, queues it for notification unless the
+ *           overload policy refuses it and copies the raw sample to the L2CAP bulk channel
+ *
+ * @param[in,out] channel: Stream channel
+ *
+ * @param[in,out] source: Transmit scheduler source of the channel
+ *
+ * @param[out] value: Characteristic value snapshot
+ *
+ * @param[in] timestamp_ms: Sample time
+ *
+ * @param[in] sample: Raw sample value
+ *
+ * @return None
+ */
+static void pushSample(ble_stream_channel_t * channel, ble_tx_source_t * source, ble_snapshot_t * value,
+                       int64_t timestamp_ms, int32_t sample);
+
+/*
+ * @function allocMbuf
+ *
+ * @abstract This function takes a notification mbuf from the NimBLE msys pool with room for the ATT headers and
+ *           tracks pool pressure
+ *
+ * @param None
+ *
+ * @return mbuf, NULL if the pool is exhausted
+ */
+static struct os_mbuf * allocMbuf(void);
+
+/*
+ * @function freeMbuf
+ *
+ * @abstract This function returns a notification mbuf that was not handed to the stack to its pool
+ *
+ * @param[in] om: mbuf
+ *
+ * @return None
+ */
+static void freeMbuf(struct os_mbuf * om);
+
+/*
+ * @function notifySubscribers
+ *
+ * @abstract This function sends one encoded value to every connection subscribed to a characteristic, skipping
+ *           peers whose queue is full so a slow central cannot stall the others. The last subscriber gets the
+ *           mbuf itself, the others a pool copy of it.
+ *
+ * @param[in] subscription: BLE_CONN_SUB_* bit of the characteristic
+ *
+ * @param[in] handle: Characteristic value handle
+ *
+ * @param[in] om: Encoded value, always consumed
+ *
+ * @return
+ *  - 0 if at least one subscriber got the value
+ *  - BLE_HS_ENOTCONN if nobody is subscribed
+ *  - other NimBLE error code if every subscriber was skipped or failed
+ */
+static int notifySubscribers(uint32_t subscription, uint16_t handle, struct os_mbuf * om);
+
+/*
+ * @function sendStream
+ *
+ * @abstract This function notifies the next batch of a stream channel once it is full or old enough, encoding the
+ *           samples straight from the channel FIFO into a pool mbuf
+ *
+ * @param[in,out] channel: Stream channel
+ *
+ * @param[in] subscription: BLE_CONN_SUB_* bit of the characteristic
+ *
+ * @param[in] handle: Characteristic value handle
+ *
+ * @return 0 if a batch was sent, NimBLE error code otherwise
+ */
+static int sendStream(ble_stream_channel_t * channel, uint32_t subscription, uint16_t handle);
+
+/*
+ * @function sendTemperature
+ *
+ * @abstract This function is the transmit scheduler callback of the Temperature Stream characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return sendStream result
+ */
+static int sendTemperature(void * context);
+
+/*
+ * @function sendHumidity
+ *
+ * @abstract This function is the transmit scheduler callback of the Humidity Stream characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return sendStream result
+ */
+static int sendHumidity(void * context);
+
+/*
+ * @function sendPressure
+ *
+ * @abstract This function is the transmit scheduler callback of the Pressure Stream characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return sendStream result
+ */
+static int sendPressure(void * context);
+
+/*
+ * @function sendAudio
+ *
+ * @abstract This function is the transmit scheduler callback of the Microphone Stream characteristic, it sends the
+ *           oldest queued audio frame and keeps it queued while the link or the host buffers are full
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 if a frame was sent, BLE_HS_EAGAIN if the queue is empty, NimBLE error code otherwise
+ */
+static int sendAudio(void * context);
+
+/*
+ * @function sendSelfTest
+ *
+ * @abstract This function is the transmit scheduler callback of the self-test, it sends the due probe on the Ping
+ *           characteristic or the due frame on the Self-test Stream characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 if a frame was sent, BLE_HS_EAGAIN if none is due, NimBLE error code otherwise
+ */
+static int sendSelfTest(void * context);
+
+/*
+ * @function onSelfTestTimer
+ *
+ * @abstract This function is a timer callback that wakes the transmit scheduler when a paced frame is due
+ *
+ * @param[in] arg: Unused
+ *
+ * @return None
+ */
+static void onSelfTestTimer(void * arg);
+
+/*
+ * @function writeSelfTestControl
+ *
+ * @abstract This function starts, stops or resets the self-test
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int writeSelfTestControl(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function writeSelfTestPing
+ *
+ * @abstract This function echoes a ping back to the writer with the device receive and transmit times, or records the
+ *           round trip of a probe reply
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int writeSelfTestPing(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function readSelfTestReport
+ *
+ * @abstract This function answers a Self-test Report read with the throughput, loss and round-trip statistics
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int readSelfTestReport(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function notifyConnection
+ *
+ * @abstract This function notifies a characteristic value to one connection, within its queue budget
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] handle: Characteristic value handle
+ *
+ * @param[in] data: Value
+ *
+ * @param[in] length: Value length
+ *
+ * @return 0 on success, BLE_HS_EBUSY or BLE_HS_ENOMEM to retry later, NimBLE error code otherwise
+ */
+static int notifyConnection(uint16_t conn_handle, uint16_t handle, const uint8_t * data, uint16_t length);
+
+/*
+ * @function downloadPayloadLimit
+ *
+ * @abstract This function returns the largest download frame the downloading central takes now. Callers hold
+ *           tx_lock.
+ *
+ * @param[out] coc_limit: Payload limit of the L2CAP bulk channel, 0 if it is not open
+ *
+ * @return Payload limit, 0 if the central cannot take frames
+ */
+static uint16_t downloadPayloadLimit(uint16_t * coc_limit);
+
+/*
+ * @function sendDownload
+ *
+ * @abstract This function is the transmit scheduler callback of the session download. It sends the next frame over
+ *           the L2CAP bulk channel if the downloading central has it open, as a Download Data notification otherwise,
+ *           and indicates the progress on a Memory Status characteristic. The record is read from the session store
+ *           without tx_lock, which the sample producers take.
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 if a frame was sent, BLE_HS_EAGAIN if none is due, NimBLE error code otherwise
+ */
+static int sendDownload(void * context);
+
+/*
+ * @function indicateDownloadStatus
+ *
+ * @abstract This function indicates the download status on the first Memory Status characteristic the downloading
+ *           central subscribed to. Callers hold tx_lock.
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+static void indicateDownloadStatus(int64_t now_us);
+
+/*
+ * @function writeDownloadControl
+ *
+ * @abstract This function handles a Download Control characteristic write
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] ctxt: Access context
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, ATT error code otherwise
+ */
+static int writeDownloadControl(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function writeTimeSync
+ *
+ * @abstract This function handles a Time Sync characteristic write, the reply is notified straight to the writer
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, BLE_ATT_ERR_* otherwise
+ */
+static int writeTimeSync(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/*
+ * @function readTimeSync
+ *
+ * @abstract This function handles a Time Sync characteristic read
+ *
+ * @param[in] conn_handle: BLE connection handle
+ *
+ * @param[in] ctxt: BLE context for an access to a GATT characteristic
+ *
+ * @param[in] context: Unused
+ *
+ * @return 0 on success, BLE_ATT_ERR_INSUFFICIENT_RES otherwise
+ */
+static int readTimeSync(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
 /* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Characteristic access handler */
+typedef int (* gatt_chr_handler_t)(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context);
+
+/** @brief Per-characteristic dispatch entry, NULL handlers reject the operation */
+typedef struct {
+    const char * name;
+    gatt_chr_handler_t read;
+    gatt_chr_handler_t write;
+    const void * context;
+    uint32_t subscription;
+} gatt_chr_entry_t;
+
+static const gatt_chr_entry_t current_time_entry = {
+    .name = "Current Time",
+    .read = readCurrentTime,
+    .write = writeCurrentTime,
+};
+
+static const gatt_chr_entry_t model_number_entry = {
+    .name = "Device Model Number",
+    .read = readString,
+    .context = DEVICE_MODEL_NUMBER,
+};
+
+static const gatt_chr_entry_t serial_number_entry = {
+    .name = "Device Serial Number",
+    .read = readString,
+    .context = DEVICE_SERIAL_NUMBER,
+};
+
+static const gatt_chr_entry_t firmware_revision_entry = {
+    .name = "Device Firmware Revision",
+    .read = readString,
+    .context = DEVICE_FIRMWARE_REVISION,
+};
+
+static const gatt_chr_entry_t manufacturer_name_entry = {
+    .name = "Device Manufacturer Name",
+    .read = readString,
+    .context = DEVICE_MANUFACTURER_NAME,
+};
+
+static const gatt_chr_entry_t temperature_stream_entry = {
+    .name = "Temperature Stream",
+    .read = readStream,
+    .context = &gatt_svr_chr_temperature_stream_value,
+    .subscription = BLE_CONN_SUB_TEMPERATURE,
+};
+
+static const gatt_chr_entry_t humidity_stream_entry = {
+    .name = "Humidity Stream",
+    .read = readStream,
+    .context = &gatt_svr_chr_humidity_stream_value,
+    .subscription = BLE_CONN_SUB_HUMIDITY,
+};
+
+static const gatt_chr_entry_t pressure_stream_entry = {
+    .name = "Pressure Stream",
+    .read = readStream,
+    .context = &gatt_svr_chr_pressure_stream_value,
+    .subscription = BLE_CONN_SUB_PRESSURE,
+};
+
+static const gatt_chr_entry_t audio_stream_entry = {
+    .name = "Microphone Stream",
+    .subscription = BLE_CONN_SUB_AUDIO,
+};
+
+static const gatt_chr_entry_t temperature_memory_status_entry = {
+    .name = "Temperature Memory Status",
+    .subscription = BLE_CONN_SUB_TEMPERATURE_STATUS,
+};
+
+static const gatt_chr_entry_t humidity_memory_status_entry = {
+    .name = "Humidity Memory Status",
+    .subscription = BLE_CONN_SUB_HUMIDITY_STATUS,
+};
+
+static const gatt_chr_entry_t pressure_memory_status_entry = {
+    .name = "Pressure Memory Status",
+    .subscription = BLE_CONN_SUB_PRESSURE_STATUS,
+};
+
+static const gatt_chr_entry_t audio_memory_status_entry = {
+    .name = "Microphone Memory Status",
+    .subscription = BLE_CONN_SUB_AUDIO_STATUS,
+};
+
+static const gatt_chr_entry_t selftest_control_entry = {
+    .name = "Self-test Control",
+    .write = writeSelfTestControl,
+};
+
+static const gatt_chr_entry_t selftest_stream_entry = {
+    .name = "Self-test Stream",
+    .subscription = BLE_CONN_SUB_SELFTEST,
+};
+
+static const gatt_chr_entry_t selftest_ping_entry = {
+    .name = "Self-test Ping",
+    .write = writeSelfTestPing,
+    .subscription = BLE_CONN_SUB_SELFTEST_PING,
+};
+
+static const gatt_chr_entry_t selftest_report_entry = {
+    .name = "Self-test Report",
+    .read = readSelfTestReport,
+};
+
+static const gatt_chr_entry_t time_sync_entry = {
+    .name = "Time Sync",
+    .read = readTimeSync,
+    .write = writeTimeSync,
+};
+
+static const gatt_chr_entry_t download_control_entry = {
+    .name = "Download Control",
+    .write = writeDownloadControl,
+};
+
+static const gatt_chr_entry_t download_data_entry = {
+    .name = "Download Data",
+    .subscription = BLE_CONN_SUB_DOWNLOAD,
+};
+
+/** @abstract Dispatch entries indexed by value handle, filled in while NimBLE registers the services */
+static const gatt_chr_entry_t * chr_table[GATT_SVR_MAX_HANDLES];
+
+/*
+ * Bonded centrals cache the attribute handles this table produces. Append new services and characteristics at the
+ * end: any other edit moves handles, which the layout hash detects and announces with Service Changed.
+ */
 static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
     {
     .type = BLE_GATT_SVC_TYPE_PRIMARY,
@@ -198,7 +833,8 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
             { {
                       .uuid = &gatt_svr_chr_current_time_uuid.u,
                       .access_cb = gatt_svr_chr_access_all,
-                      .val_handle = &cry_notify_handle,
+                      .arg = (void *)&current_time_entry,
+                      .val_handle = &current_time_handle,
                       .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE,
               },
               {
@@ -213,25 +849,29 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
             { {
                       .uuid = &gatt_svr_chr_model_number_uuid.u,
                       .access_cb = gatt_svr_chr_access_all,
-                      .val_handle = &cry_notify_handle,
+                      .arg = (void *)&model_number_entry,
+                      .val_handle = &model_number_handle,
                       .flags = BLE_GATT_CHR_F_READ,
               },
               {
                       .uuid = &gatt_svr_chr_serial_number_uuid.u,
                       .access_cb = gatt_svr_chr_access_all,
-                      .val_handle = &cry_notify_handle,
+                      .arg = (void *)&serial_number_entry,
+                      .val_handle = &serial_number_handle,
                       .flags = BLE_GATT_CHR_F_READ,
               },
               {
                       .uuid = &gatt_svr_chr_firmware_revision_uuid.u,
                       .access_cb = gatt_svr_chr_access_all,
-                      .val_handle = &cry_notify_handle,
+                      .arg = (void *)&firmware_revision_entry,
+                      .val_handle = &firmware_revision_handle,
                       .flags = BLE_GATT_CHR_F_READ,
               },
               {
                       .uuid = &gatt_svr_chr_manufacturer_name_uuid.u,
                       .access_cb = gatt_svr_chr_access_all,
-                      .val_handle = &cry_notify_handle,
+                      .arg = (void *)&manufacturer_name_entry,
+                      .val_handle = &manufacturer_name_handle,
                       .flags = BLE_GATT_CHR_F_READ,
               },
               {
@@ -246,13 +886,15 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
          { {
                .uuid = &gatt_svr_chr_temperature_stream_uuid.u,
                .access_cb = gatt_svr_chr_access_all,
-               .val_handle = &cry_notify_handle,
+               .arg = (void *)&temperature_stream_entry,
+               .val_handle = &temperature_notify_handle,
                .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
            },
            {
                .uuid = &gatt_svr_chr_temperature_memory_status_uuid.u,
                .access_cb = gatt_svr_chr_access_all,
-               .val_handle = &cry_notify_handle,
+               .arg = (void *)&temperature_memory_status_entry,
+               .val_handle = &temperature_memory_status_handle,
                .flags = BLE_GATT_CHR_F_INDICATE,
            },
            {
@@ -267,13 +909,15 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
         { {
                   .uuid = &gatt_svr_chr_humidity_stream_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
+                  .arg = (void *)&humidity_stream_entry,
+                  .val_handle = &humidity_notify_handle,
                   .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
           },
           {
                   .uuid = &gatt_svr_chr_humidity_memory_status_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
+                  .arg = (void *)&humidity_memory_status_entry,
+                  .val_handle = &humidity_memory_status_handle,
                   .flags = BLE_GATT_CHR_F_INDICATE,
           },
           {
@@ -288,13 +932,15 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
         { {
                   .uuid = &gatt_svr_chr__pressure_stream_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
+                  .arg = (void *)&pressure_stream_entry,
+                  .val_handle = &pressure_notify_handle,
                   .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
           },
           {
                   .uuid = &gatt_svr_chr_pressure_memory_status_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
+                  .arg = (void *)&pressure_memory_status_entry,
+                  .val_handle = &pressure_memory_status_handle,
                   .flags = BLE_GATT_CHR_F_INDICATE,
           },
           {
@@ -309,13 +955,15 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
         { {
                   .uuid = &gatt_svr_chr_microphone_stream_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
-                  .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_NOTIFY,
+                  .arg = (void *)&audio_stream_entry,
+                  .val_handle = &audio_notify_handle,
+                  .flags = BLE_GATT_CHR_F_NOTIFY,
           },
           {
                   .uuid = &gatt_svr_chr_microphone_memory_status_uuid.u,
                   .access_cb = gatt_svr_chr_access_all,
-                  .val_handle = &cry_notify_handle,
+                  .arg = (void *)&audio_memory_status_entry,
+                  .val_handle = &audio_memory_status_handle,
                   .flags = BLE_GATT_CHR_F_INDICATE,
           },
           {
@@ -324,22 +972,99 @@ static const struct ble_gatt_svc_def gatt_svr_svcs[] = {
         },
     },
     {
-     0, /* No more services. */
+    .type = BLE_GATT_SVC_TYPE_PRIMARY,
+    .uuid = &gatt_svr_svc_selftest_service_uuid.u,
+    .characteristics = (struct ble_gatt_chr_def[])
+        { {
+                  .uuid = &gatt_svr_chr_selftest_control_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&selftest_control_entry,
+                  .val_handle = &selftest_control_handle,
+                  .flags = BLE_GATT_CHR_F_WRITE,
+          },
+          {
+                  .uuid = &gatt_svr_chr_selftest_stream_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&selftest_stream_entry,
+                  .val_handle = &selftest_stream_handle,
+                  .flags = BLE_GATT_CHR_F_NOTIFY,
+          },
+          {
+                  .uuid = &gatt_svr_chr_selftest_ping_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&selftest_ping_entry,
+                  .val_handle = &selftest_ping_handle,
+                  .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP | BLE_GATT_CHR_F_NOTIFY,
+          },
+          {
+                  .uuid = &gatt_svr_chr_selftest_report_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&selftest_report_entry,
+                  .val_handle = &selftest_report_handle,
+                  .flags = BLE_GATT_CHR_F_READ,
+          },
+          {
+                  0, /* No more characteristics in this service. */
+          }
+        },
     },
-};
-
-/* Private function definitions --------------------------------------------------------------------------------------*/
-static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max_len, void *dst, uint16_t *len) {
-
-    uint16_t om_len;
-    int rc;
-
-    om_len = OS_MBUF_PKTLEN(om);
-
-    if (om_len < min_len || om_len > max_len) {
-        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
-    }
-
+    {
+    .type = BLE_GATT_SVC_TYPE_PRIMARY,
+    .uuid = &gatt_svr_svc_time_sync_service_uuid.u,
+    .characteristics = (struct ble_gatt_chr_def[])
+        { {
+                  .uuid = &gatt_svr_chr_time_sync_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&time_sync_entry,
+                  .val_handle = &time_sync_handle,
+                  .flags = BLE_GATT_CHR_F_READ | BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP |
+                           BLE_GATT_CHR_F_NOTIFY,
+          },
+          {
+                  0, /* No more characteristics in this service. */
+          }
+        },
+    },
+    {
+    .type = BLE_GATT_SVC_TYPE_PRIMARY,
+    .uuid = &gatt_svr_svc_download_service_uuid.u,
+    .characteristics = (struct ble_gatt_chr_def[])
+        { {
+                  .uuid = &gatt_svr_chr_download_control_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&download_control_entry,
+                  .val_handle = &download_control_handle,
+                  .flags = BLE_GATT_CHR_F_WRITE | BLE_GATT_CHR_F_WRITE_NO_RSP,
+          },
+          {
+                  .uuid = &gatt_svr_chr_download_data_uuid.u,
+                  .access_cb = gatt_svr_chr_access_all,
+                  .arg = (void *)&download_data_entry,
+                  .val_handle = &download_data_handle,
+                  .flags = BLE_GATT_CHR_F_NOTIFY,
+          },
+          {
+                  0, /* No more characteristics in this service. */
+          }
+        },
+    },
+    {
+     0, /* No more services. */
+    },
+};
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max_len, void *dst, uint16_t *len) {
+
+    uint16_t om_len;
+    int rc;
+
+    om_len = OS_MBUF_PKTLEN(om);
+
+    if (om_len < min_len || om_len > max_len) {
+        return BLE_ATT_ERR_INVALID_ATTR_VALUE_LEN;
+    }
+
     rc = ble_hs_mbuf_to_flat(om, dst, max_len, len);
 
     if (rc != 0) {
@@ -353,127 +1078,774 @@ static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max
 static int gatt_svr_chr_access_all(uint16_t conn_handle, uint16_t attr_handle, struct ble_gatt_access_ctxt *ctxt,
                                    void *arg) {
 
-    const ble_uuid_t *uuid;
-    int rc;
-    char write_response_table[512];
+    const gatt_chr_entry_t * entry = attr_handle < GATT_SVR_MAX_HANDLES ? chr_table[attr_handle] : NULL;
+
+    if (entry == NULL) {
+        /* Unknown characteristic; the nimble stack should not have called this function */
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    switch (ctxt->op) {
+        case BLE_GATT_ACCESS_OP_READ_CHR:
+
+            ESP_LOGD(TAG, "%s characteristic: read requested", entry->name);
+
+            return entry->read != NULL ? entry->read(conn_handle, ctxt, entry->context) :
+                   BLE_ATT_ERR_READ_NOT_PERMITTED;
+
+        case BLE_GATT_ACCESS_OP_WRITE_CHR:
+
+            ESP_LOGD(TAG, "%s characteristic: write requested", entry->name);
+
+            return entry->write != NULL ? entry->write(conn_handle, ctxt, entry->context) :
+                   BLE_ATT_ERR_WRITE_NOT_PERMITTED;
+
+        default:
+            return BLE_ATT_ERR_UNLIKELY;
+    }
+
+}
+
+static int readString(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    const char * value = context;
+
+    return os_mbuf_append(ctxt->om, value, strlen(value)) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+
+}
+
+static int readStream(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    uint8_t frame[BLE_SNAPSHOT_MAX_BYTES];
+    size_t length = ble_snapshot_read(context, frame);
+
+    if (length == 0) {
+        return BLE_ATT_ERR_UNLIKELY;
+    }
+
+    return os_mbuf_append(ctxt->om, frame, length) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+
+}
+
+static int readCurrentTime(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    const uint8_t * current_time = get_time();
+
+    return os_mbuf_append(ctxt->om, current_time, 10) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+
+}
+
+static int writeCurrentTime(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
 
-    uuid = ctxt->chr->uuid;
+    uint8_t current_time[10];
+    uint16_t length;
 
-    /* Determine which characteristic is being accessed by examining its
-     * 128-bit UUID.
-     */
+    int rc = gatt_svr_chr_write(ctxt->om, sizeof(current_time), sizeof(current_time), current_time, &length);
+    if (rc != 0) {
+        return rc;
+    }
 
-    if (ble_uuid_cmp(uuid, &gatt_svr_chr_temperature_stream_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
+    /* Steps the clock to second resolution, the Time Sync exchange corrects it finer and without jumps */
+    return set_time(current_time) ? 0 : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
 
-                ESP_LOGI(TAG, "Temperature Stream characteristic: read requested");
+}
 
-                //TODO: Replace with real data
-                char *temperatureStream = "abc";
+static void pushSample(ble_stream_channel_t * channel, ble_tx_source_t * source, ble_snapshot_t * value,
+                       int64_t timestamp_ms, int32_t sample) {
 
-                rc = os_mbuf_append(ctxt->om, temperatureStream, strlen(temperatureStream));
+    uint8_t frame[BLE_STREAM_HEADER_BYTES];
+    const uint8_t quality = rtc_time_quality();
 
-                //free(temperatureStream);
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    if (ble_tx_admit(source, (uint32_t)ble_stream_pending(channel))) {
+        const uint32_t dropped = channel->dropped;
 
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+        ble_stream_push(channel, timestamp_ms, sample, quality);
+        if (channel->dropped != dropped) {
+            ble_tx_dropped_oldest(source, channel->dropped - dropped);
         }
+    } else {
+        ble_stream_observe(channel, timestamp_ms, sample, quality);
+    }
 
+    const size_t length = ble_stream_encode_latest(channel, frame);
 
-    } else if (ble_uuid_cmp(uuid, &gatt_svr_chr_model_number_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
+    xSemaphoreGive(tx_lock);
 
-                ESP_LOGI(TAG, "Device Model Number characteristic: read requested");
+    ble_snapshot_write(value, frame, length);
+    ble_tx_kick();
 
-                rc = os_mbuf_append(ctxt->om, DEVICE_MODEL_NUMBER, strlen(DEVICE_MODEL_NUMBER));
+    /* Stream id, timestamp, value, little-endian, and time quality */
+    const uint64_t time = (uint64_t)timestamp_ms;
+    const uint8_t record[14] = {
+        channel->id,
+        (uint8_t)time, (uint8_t)(time >> 8), (uint8_t)(time >> 16), (uint8_t)(time >> 24),
+        (uint8_t)(time >> 32), (uint8_t)(time >> 40), (uint8_t)(time >> 48), (uint8_t)(time >> 56),
+        (uint8_t)sample, (uint8_t)((uint32_t)sample >> 8), (uint8_t)((uint32_t)sample >> 16),
+        (uint8_t)((uint32_t)sample >> 24),
+        quality,
+    };
+    ble_coc_write(BLE_COC_RECORD_SENSOR, record, sizeof(record));
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
 
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+static struct os_mbuf * allocMbuf(void) {
+
+    struct os_mbuf * om = ble_hs_mbuf_att_pkt();
+    const uint16_t free_blocks = (uint16_t)os_msys_num_free();
+
+    portENTER_CRITICAL(&mbuf_stats_lock);
+    if (om == NULL) {
+        mbuf_stats.alloc_failures++;
+    } else {
+        mbuf_stats.allocated++;
+        if (free_blocks < mbuf_stats.min_free_blocks) {
+            mbuf_stats.min_free_blocks = free_blocks;
         }
-    } else if (ble_uuid_cmp(uuid, &gatt_svr_chr_serial_number_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
+    }
+    portEXIT_CRITICAL(&mbuf_stats_lock);
 
-                ESP_LOGI(TAG, "Device Serial Number characteristic: read requested");
+    return om;
+
+}
 
-                rc = os_mbuf_append(ctxt->om, DEVICE_SERIAL_NUMBER, strlen(DEVICE_SERIAL_NUMBER));
+static void freeMbuf(struct os_mbuf * om) {
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    portENTER_CRITICAL(&mbuf_stats_lock);
+    mbuf_stats.returned++;
+    portEXIT_CRITICAL(&mbuf_stats_lock);
 
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+    os_mbuf_free_chain(om);
+
+}
+
+static int notifySubscribers(uint32_t subscription, uint16_t handle, struct os_mbuf * om) {
+
+    uint16_t handles[BLE_CONN_MAX];
+    const uint16_t length = OS_MBUF_PKTLEN(om);
+    const size_t count = ble_conn_list(subscription, handles);
+    size_t accepted = 0;
+    int result = BLE_HS_ENOTCONN;
+
+    for (size_t i = 0; i < count; i++) {
+        /* An oversize notification would be truncated by the stack */
+        ble_conn_state_t state;
+        if (!ble_conn_get(handles[i], &state) || length > state.mtu - 3) {
+            result = BLE_HS_EMSGSIZE;
+            continue;
         }
-    } else if (ble_uuid_cmp(uuid, &gatt_svr_chr_firmware_revision_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
 
-                ESP_LOGI(TAG, "Device Firmware Revision characteristic: read requested");
+        if (!ble_conn_queue_reserve(handles[i], handle, length)) {
+            result = BLE_HS_EBUSY;
+            continue;
+        }
+
+        handles[accepted++] = handles[i];
+    }
+
+    if (accepted == 0) {
+        freeMbuf(om);
+        return result;
+    }
+
+    for (size_t i = 0; i < accepted; i++) {
+        struct os_mbuf * copy = om;
 
-                rc = os_mbuf_append(ctxt->om, DEVICE_FIRMWARE_REVISION, strlen(DEVICE_FIRMWARE_REVISION));
+        if (i + 1 < accepted) {
+            copy = allocMbuf();
+            if (copy != NULL && os_mbuf_appendfrom(copy, om, 0, length) != 0) {
+                freeMbuf(copy);
+                copy = NULL;
+            }
+        }
+
+        if (copy == NULL) {
+            ble_conn_queue_cancel(handles[i]);
+            result = result == 0 ? 0 : BLE_HS_ENOMEM;
+            continue;
+        }
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+        /* The stack takes ownership of the mbuf and reports the attempt with BLE_GAP_EVENT_NOTIFY_TX, also on
+         * failure, which releases the reservation */
+        int rc = ble_gatts_notify_custom(handles[i], handle, copy);
 
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+        if (rc != 0) {
+            result = result == 0 ? 0 : rc;
+        } else {
+            ble_conn_count_tx(handles[i], false, length);
+            result = 0;
         }
-    } else if (ble_uuid_cmp(uuid, &gatt_svr_chr_manufacturer_name_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
+    }
+
+    return result;
+
+}
+
+static int sendStream(ble_stream_channel_t * channel, uint32_t subscription, uint16_t handle) {
+
+    size_t count;
+    bool full;
+
+    /* One encoding for every subscriber, sized for the most constrained link */
+    size_t max_length = ble_conn_min_payload_limit(subscription);
+    if (max_length < BLE_STREAM_HEADER_BYTES) {
+        return BLE_HS_ENOTCONN;
+    }
 
-                ESP_LOGI(TAG, "Device Manufacturer Name characteristic: read requested");
+    /* Size the batch first so waiting for it to fill up costs no pool buffers. The age is taken against the clock,
+     * not the newest sample, so a partial batch still leaves once the sensor stops producing */
+    const int64_t now_ms = rtc_now_us() / 1000;
+    if (ble_stream_encode(channel, NULL, max_length, &count, &full) == 0 ||
+        (!full && ble_stream_age_ms(channel, now_ms) < SENSOR_STREAM_MAX_LATENCY_MS)) {
+        return BLE_HS_EAGAIN;
+    }
+
+    struct os_mbuf * om = allocMbuf();
+    if (om == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    /* Encode in place so the frame is never staged in a flat buffer */
+    if (max_length > OS_MBUF_TRAILINGSPACE(om)) {
+        max_length = OS_MBUF_TRAILINGSPACE(om);
+    }
+
+    uint8_t * frame = os_mbuf_extend(om, (uint16_t)max_length);
+    if (frame == NULL) {
+        freeMbuf(om);
+        return BLE_HS_ENOMEM;
+    }
+
+    const size_t length = ble_stream_encode(channel, frame, max_length, &count, &full);
+    os_mbuf_adj(om, -(int)(max_length - length));
+
+    /* Samples stay queued until at least one subscriber took the batch; peers skipped for backpressure see a gap
+     * in the sequence numbers */
+    int rc = notifySubscribers(subscription, handle, om);
+
+    if (rc == 0) {
+        ble_stream_consume(channel, count);
+    }
 
-                rc = os_mbuf_append(ctxt->om, DEVICE_MANUFACTURER_NAME, strlen(DEVICE_MANUFACTURER_NAME));
+    return rc;
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+}
+
+static int sendTemperature(void * context) {
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    int rc = sendStream(&temperature_stream, BLE_CONN_SUB_TEMPERATURE, temperature_notify_handle);
+    xSemaphoreGive(tx_lock);
+
+    return rc;
+
+}
+
+static int sendHumidity(void * context) {
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    int rc = sendStream(&humidity_stream, BLE_CONN_SUB_HUMIDITY, humidity_notify_handle);
+    xSemaphoreGive(tx_lock);
+
+    return rc;
+
+}
 
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+static int sendPressure(void * context) {
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    int rc = sendStream(&pressure_stream, BLE_CONN_SUB_PRESSURE, pressure_notify_handle);
+    xSemaphoreGive(tx_lock);
+
+    return rc;
+
+}
+
+static int sendAudio(void * context) {
+
+    int rc = BLE_HS_EAGAIN;
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    if (audio_queue_head != audio_queue_tail) {
+        const uint32_t slot = audio_queue_tail % AUDIO_STREAM_QUEUE_FRAMES;
+        struct os_mbuf * om = allocMbuf();
+
+        if (om == NULL) {
+            rc = BLE_HS_ENOMEM;
+        } else if (os_mbuf_append(om, audio_queue[slot], audio_queue_length[slot]) != 0) {
+            freeMbuf(om);
+            rc = BLE_HS_ENOMEM;
+        } else {
+            rc = notifySubscribers(BLE_CONN_SUB_AUDIO, audio_notify_handle, om);
+        }
+
+        if (rc == BLE_HS_ENOTCONN) {
+            /* Nobody listens any more, stale audio is worthless to the next subscriber */
+            audio_queue_tail = audio_queue_head;
+        } else if (rc != BLE_HS_EBUSY && rc != BLE_HS_ENOMEM) {
+            audio_queue_tail++;
         }
-    } else if (ble_uuid_cmp(uuid, &gatt_svr_chr_current_time_uuid.u) == 0) {
-        switch (ctxt->op) {
-            case BLE_GATT_ACCESS_OP_READ_CHR:
+    }
+
+    xSemaphoreGive(tx_lock);
+
+    return rc;
 
-                ESP_LOGI(TAG, "Current Time characteristic: read requested");
+}
 
-                // TODO: Replace with real data
-                char * tmpCurrTime = "0000000000";
+static int sendSelfTest(void * context) {
 
-                rc = os_mbuf_append(ctxt->om, tmpCurrTime, strlen(tmpCurrTime));
+    uint8_t frame[BLE_DIAG_FRAME_MAX_BYTES];
+    int rc = BLE_HS_EAGAIN;
+    bool probe = false;
 
-                return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
 
-            case BLE_GATT_ACCESS_OP_WRITE_CHR:
+    const int64_t now_us = esp_timer_get_time();
+    const size_t max_length = ble_conn_min_payload_limit(BLE_CONN_SUB_SELFTEST);
+    size_t length = ble_diag_next(&selftest, frame, max_length, now_us, &probe);
 
-                ESP_LOGI(TAG, "Current Time characteristic: write requested");
+    if (length > 0 && probe && ble_conn_min_payload_limit(BLE_CONN_SUB_SELFTEST_PING) == 0) {
+        /* Nobody listens for probes, skip this one and go on with the stream */
+        ble_diag_sent(&selftest, length, true, now_us);
+        length = ble_diag_next(&selftest, frame, max_length, now_us, &probe);
+    }
 
-                //rc = os_mbuf_append(ctxt->om, DEVICE_MANUFACTURER_NAME, strlen(DEVICE_MANUFACTURER_NAME));
+    if (length > 0) {
+        struct os_mbuf * om = allocMbuf();
+
+        if (om == NULL) {
+            rc = BLE_HS_ENOMEM;
+        } else if (os_mbuf_append(om, frame, length) != 0) {
+            freeMbuf(om);
+            rc = BLE_HS_ENOMEM;
+        } else if (probe) {
+            rc = notifySubscribers(BLE_CONN_SUB_SELFTEST_PING, selftest_ping_handle, om);
+        } else {
+            rc = notifySubscribers(BLE_CONN_SUB_SELFTEST, selftest_stream_handle, om);
+        }
 
-                //return rc == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
-            default:
-                assert(0);
-                return BLE_ATT_ERR_UNLIKELY;
+        if (rc == 0) {
+            ble_diag_sent(&selftest, length, probe, now_us);
+        } else if (rc == BLE_HS_EBUSY || rc == BLE_HS_ENOMEM) {
+            ble_diag_refused(&selftest, rc == BLE_HS_ENOMEM);
+        } else {
+            /* The tester went away or the frame can never fit, end the run */
+            ble_diag_control(&selftest, (const uint8_t[]) {BLE_DIAG_OP_STOP}, 1, now_us);
         }
     }
 
-    /* Unknown characteristic; the nimble stack should not have called this
-     * function.
-     */
-    assert(0);
-    return BLE_ATT_ERR_UNLIKELY;
+    if (!selftest.running) {
+        esp_timer_stop(selftest_timer);
+    }
+
+    xSemaphoreGive(tx_lock);
+
+    return rc;
 
 }
+
+static void onSelfTestTimer(void * arg) {
+
+    ble_tx_kick();
+
+}
+
+static int writeSelfTestControl(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    uint8_t value[BLE_DIAG_CONTROL_BYTES];
+    uint16_t length;
+
+    int rc = gatt_svr_chr_write(ctxt->om, 1, sizeof(value), value, &length);
+    if (rc != 0) {
+        return rc;
+    }
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    const bool valid = ble_diag_control(&selftest, value, length, esp_timer_get_time());
+
+    esp_timer_stop(selftest_timer);
+    if (valid && selftest.running) {
+        selftest_conn_handle = conn_handle;
+        if (selftest.rate_hz > 0) {
+            /* Faster rates are served in scheduler bursts */
+            const uint32_t period_us = 1000000u / selftest.rate_hz;
+            esp_timer_start_periodic(selftest_timer, period_us < 1000u ? 1000u : period_us);
+        }
+        ESP_LOGI(TAG, "Self-test started: %u B frames at %u Hz for %lu s", selftest.frame_bytes, selftest.rate_hz,
+                 (unsigned long)(selftest.duration_ms / 1000));
+    }
+
+    xSemaphoreGive(tx_lock);
+
+    ble_tx_kick();
+
+    return valid ? 0 : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+
+}
+
+static int writeSelfTestPing(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    const int64_t rx_us = esp_timer_get_time();
+    uint8_t value[BLE_DIAG_PING_MAX_BYTES];
+    uint8_t echo[BLE_DIAG_PING_MAX_BYTES];
+    uint16_t length;
+
+    int rc = gatt_svr_chr_write(ctxt->om, BLE_DIAG_PING_HEADER_BYTES, sizeof(value), value, &length);
+    if (rc != 0) {
+        return rc;
+    }
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    const int echo_length = ble_diag_ping(&selftest, value, length, echo, rx_us, esp_timer_get_time());
+    xSemaphoreGive(tx_lock);
+
+    if (echo_length < 0) {
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    if (echo_length > 0) {
+        /* Straight back to the writer, bypassing the scheduler queues that would add to the round trip */
+        struct os_mbuf * om = allocMbuf();
+
+        if (om == NULL) {
+            return 0;
+        }
+
+        if (os_mbuf_append(om, echo, (uint16_t)echo_length) != 0) {
+            freeMbuf(om);
+            return 0;
+        }
+
+        if (ble_gatts_notify_custom(conn_handle, selftest_ping_handle, om) == 0) {
+            ble_conn_count_tx(conn_handle, false, (uint32_t)echo_length);
+        }
+    }
+
+    return 0;
+
+}
+
+static int readSelfTestReport(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    uint8_t report[BLE_DIAG_REPORT_BYTES];
+    ble_conn_state_t state;
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+    const uint16_t conn_interval = ble_conn_get(selftest_conn_handle, &state) ? state.conn_interval : 0;
+    const size_t length = ble_diag_report(&selftest, report, conn_interval, esp_timer_get_time());
+    xSemaphoreGive(tx_lock);
+
+    return os_mbuf_append(ctxt->om, report, length) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+
+}
+
+static int writeTimeSync(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    const int64_t rx_us = rtc_now_us();
+    uint8_t value[BLE_TIME_WRITE_BYTES];
+    uint8_t reply[BLE_TIME_REPLY_MAX_BYTES];
+    uint16_t length;
+
+    int rc = gatt_svr_chr_write(ctxt->om, sizeof(value), sizeof(value), value, &length);
+    if (rc != 0) {
+        return rc;
+    }
+
+    const int reply_length = ble_time_write(value, length, rx_us, reply);
+    if (reply_length < 0) {
+        return BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+    }
+
+    /* Straight back to the writer like the ping echo, queueing would only add to the round trip */
+    struct os_mbuf * om = allocMbuf();
+
+    if (om == NULL) {
+        return 0;
+    }
+
+    if (os_mbuf_append(om, reply, (uint16_t)reply_length) != 0) {
+        freeMbuf(om);
+        return 0;
+    }
+
+    if (ble_gatts_notify_custom(conn_handle, time_sync_handle, om) == 0) {
+        ble_conn_count_tx(conn_handle, false, (uint32_t)reply_length);
+    }
+
+    return 0;
+
+}
+
+static int readTimeSync(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    uint8_t status[BLE_TIME_STATUS_BYTES];
+    const size_t length = ble_time_status(status);
+
+    return os_mbuf_append(ctxt->om, status, length) == 0 ? 0 : BLE_ATT_ERR_INSUFFICIENT_RES;
+
+}
+
+static int notifyConnection(uint16_t conn_handle, uint16_t handle, const uint8_t * data, uint16_t length) {
+
+    if (!ble_conn_queue_reserve(conn_handle, handle, length)) {
+        return BLE_HS_EBUSY;
+    }
+
+    struct os_mbuf * om = allocMbuf();
+
+    if (om == NULL || os_mbuf_append(om, data, length) != 0) {
+        if (om != NULL) {
+            freeMbuf(om);
+        }
+        ble_conn_queue_cancel(conn_handle);
+        return BLE_HS_ENOMEM;
+    }
+
+    /* The stack takes ownership of the mbuf and releases the reservation through BLE_GAP_EVENT_NOTIFY_TX */
+    int rc = ble_gatts_notify_custom(conn_handle, handle, om);
+
+    if (rc != 0) {
+        return rc;
+    }
+
+    ble_conn_count_tx(conn_handle, false, length);
+
+    return 0;
+
+}
+
+static uint16_t downloadPayloadLimit(uint16_t * coc_limit) {
+
+    ble_conn_state_t state;
+
+    /* The bulk channel takes frames of a whole SDU without ATT headers, so it is preferred when open */
+    *coc_limit = ble_coc_payload_limit(download_conn_handle);
+
+    return *coc_limit > 0 ? *coc_limit :
+           ble_conn_get(download_conn_handle, &state) && (state.subscriptions & BLE_CONN_SUB_DOWNLOAD) != 0 ?
+           ble_conn_payload_limit(download_conn_handle) : 0;
+
+}
+
+static int sendDownload(void * context) {
+
+    ble_conn_state_t state;
+    uint16_t coc_limit;
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    int64_t now_us = esp_timer_get_time();
+
+    if (download.state != BLE_DOWNLOAD_STATE_IDLE && !ble_conn_get(download_conn_handle, &state)) {
+        /* The central resumes from its last acknowledged position once it reconnects */
+        ble_download_control(&download, (const uint8_t[]) {BLE_DOWNLOAD_OP_ABORT}, 1, NULL, now_us);
+    }
+
+    const bool read_due = downloadPayloadLimit(&coc_limit) > 0 &&
+                          ble_download_read_due(&download, &download_read, now_us);
+
+    xSemaphoreGive(tx_lock);
+
+    if (read_due) {
+        ble_download_read(&download_read);
+    }
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    now_us = esp_timer_get_time();
+
+    const uint16_t limit = downloadPayloadLimit(&coc_limit);
+    const size_t length = limit > 0 ? ble_download_next(&download, read_due ? &download_read : NULL, download_frame,
+                                                        limit, now_us) : 0;
+    int rc = limit > 0 || download.state == BLE_DOWNLOAD_STATE_IDLE ? BLE_HS_EAGAIN : BLE_HS_ENOTCONN;
+
+    if (length > 0) {
+        rc = coc_limit > 0 ? ble_coc_write_lossless(BLE_COC_RECORD_DOWNLOAD, download_frame, (uint16_t)length) :
+             notifyConnection(download_conn_handle, download_data_handle, download_frame, (uint16_t)length);
+
+        if (rc == 0) {
+            ble_download_sent(&download, length, now_us);
+        }
+    }
+
+    if (ble_download_status_due(&download, now_us)) {
+        indicateDownloadStatus(now_us);
+    }
+
+    xSemaphoreGive(tx_lock);
+
+    return rc;
+
+}
+
+static void indicateDownloadStatus(int64_t now_us) {
+
+    const uint32_t subscriptions[] = {
+            BLE_CONN_SUB_TEMPERATURE_STATUS, BLE_CONN_SUB_HUMIDITY_STATUS, BLE_CONN_SUB_PRESSURE_STATUS,
+            BLE_CONN_SUB_AUDIO_STATUS,
+    };
+    const uint16_t handles[] = {
+            temperature_memory_status_handle, humidity_memory_status_handle, pressure_memory_status_handle,
+            audio_memory_status_handle,
+    };
+    uint8_t status[BLE_DOWNLOAD_STATUS_BYTES];
+    ble_conn_state_t state;
+
+    /* Marked sent either way, a central that is gone or not listening is not retried every pass */
+    const size_t length = ble_download_status(&download, status, now_us);
+
+    if (!ble_conn_get(download_conn_handle, &state)) {
+        return;
+    }
+
+    for (size_t i = 0; i < sizeof(handles) / sizeof(handles[0]); i++) {
+        if ((state.subscriptions & subscriptions[i]) == 0) {
+            continue;
+        }
+
+        struct os_mbuf * om = allocMbuf();
+
+        if (om == NULL) {
+            return;
+        }
+
+        if (os_mbuf_append(om, status, length) != 0) {
+            freeMbuf(om);
+            return;
+        }
+
+        if (ble_gatts_indicate_custom(download_conn_handle, handles[i], om) == 0) {
+            ble_conn_count_tx(download_conn_handle, false, (uint32_t)length);
+        }
+        return;
+    }
+
+}
+
+static int writeDownloadControl(uint16_t conn_handle, struct ble_gatt_access_ctxt * ctxt, const void * context) {
+
+    uint8_t value[BLE_DOWNLOAD_CONTROL_MAX_BYTES];
+    uint16_t length;
+
+    int rc = gatt_svr_chr_write(ctxt->om, 1, sizeof(value), value, &length);
+    if (rc != 0) {
+        return rc;
+    }
+
+    const bool request = value[0] == BLE_DOWNLOAD_OP_LIST || value[0] == BLE_DOWNLOAD_OP_READ ||
+                         value[0] == BLE_DOWNLOAD_OP_RESUME;
+    ble_download_seek_t seek;
+    bool valid = true;
+
+    /* The seeks read the session store, tx_lock is only taken to apply the request */
+    if (request) {
+        ble_download_seek(value, length, &seek);
+    }
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    /* Acknowledgements and aborts only count from the central that runs the download */
+    if (request || conn_handle == download_conn_handle) {
+        valid = ble_download_control(&download, value, length, &seek, esp_timer_get_time());
+    }
+
+    if (valid && request) {
+        download_conn_handle = conn_handle;
+        ESP_LOGI(TAG, "Download %s from position %llu, window %u", download.state == BLE_DOWNLOAD_STATE_LISTING ?
+                 "of sessions" : download.level != BLE_DOWNLOAD_LEVEL_RAW ? "of summaries" : "of records",
+                 (unsigned long long)download.position, download.window);
+    }
+
+    xSemaphoreGive(tx_lock);
+
+    ble_tx_kick();
+
+    return valid ? 0 : BLE_ATT_ERR_VALUE_NOT_ALLOWED;
+
+}
+
 /* Exported function definitions -------------------------------------------------------------------------------------*/
+void push_temperature_sample(int64_t timestamp_ms, int32_t temperature) {
+
+    pushSample(&temperature_stream, &temperature_source, &gatt_svr_chr_temperature_stream_value, timestamp_ms,
+               temperature);
+
+}
+
+void push_humidity_sample(int64_t timestamp_ms, uint32_t humidity) {
+
+    pushSample(&humidity_stream, &humidity_source, &gatt_svr_chr_humidity_stream_value, timestamp_ms,
+               (int32_t)humidity);
+
+}
+
+void push_pressure_sample(int64_t timestamp_ms, uint32_t pressure) {
+
+    pushSample(&pressure_stream, &pressure_source, &gatt_svr_chr_pressure_stream_value, timestamp_ms,
+               (int32_t)pressure);
+
+}
+
+int push_audio_frame(const uint8_t * data, uint16_t length) {
+
+    if (length > AUDIO_STREAM_FRAME_MAX_BYTES) {
+        return BLE_HS_EMSGSIZE;
+    }
+
+    /* The bulk channel carries the frame independently of the GATT subscriptions */
+    const int coc_rc = ble_coc_write(BLE_COC_RECORD_AUDIO, data, length);
+
+    if (ble_conn_min_payload_limit(BLE_CONN_SUB_AUDIO) == 0) {
+        return coc_rc;
+    }
+
+    xSemaphoreTake(tx_lock, portMAX_DELAY);
+
+    if (!ble_tx_admit(&audio_source, audio_queue_head - audio_queue_tail)) {
+        xSemaphoreGive(tx_lock);
+        return BLE_HS_EBUSY;
+    }
+
+    if (audio_queue_head - audio_queue_tail == AUDIO_STREAM_QUEUE_FRAMES) {
+        audio_queue_tail++;
+        ble_tx_dropped_oldest(&audio_source, 1);
+    }
+
+    const uint32_t slot = audio_queue_head % AUDIO_STREAM_QUEUE_FRAMES;
+    memcpy(audio_queue[slot], data, length);
+    audio_queue_length[slot] = length;
+    audio_queue_head++;
+
+    xSemaphoreGive(tx_lock);
+
+    ble_tx_kick();
+
+    return 0;
+
+}
+
+void gatt_svr_get_mbuf_stats(gatt_svr_mbuf_stats_t * stats) {
+
+    portENTER_CRITICAL(&mbuf_stats_lock);
+    *stats = mbuf_stats;
+    portEXIT_CRITICAL(&mbuf_stats_lock);
+    stats->free_blocks = (uint16_t)os_msys_num_free();
+    stats->total_blocks = (uint16_t)os_msys_count();
+
+}
+
+uint32_t gatt_svr_subscription(uint16_t attr_handle) {
+
+    const gatt_chr_entry_t * entry = attr_handle < GATT_SVR_MAX_HANDLES ? chr_table[attr_handle] : NULL;
+
+    return entry != NULL ? entry->subscription : 0;
+
+}
+
 void gatt_svr_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg) {
 
     char buf[BLE_UUID_STR_LEN];
@@ -483,6 +1855,7 @@ void gatt_svr_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg) {
             MODLOG_DFLT(DEBUG, "Registered service %s with handle=%d\n",
                         ble_uuid_to_str(ctxt->svc.svc_def->uuid, buf),
                         ctxt->svc.handle);
+            ble_bond_layout_add(ctxt->svc.handle, ctxt->svc.svc_def->uuid, 0);
             break;
 
         case BLE_GATT_REGISTER_OP_CHR:
@@ -491,12 +1864,19 @@ void gatt_svr_register_cb(struct ble_gatt_register_ctxt *ctxt, void *arg) {
                         ble_uuid_to_str(ctxt->chr.chr_def->uuid, buf),
                         ctxt->chr.def_handle,
                         ctxt->chr.val_handle);
+
+            if (ctxt->chr.chr_def->access_cb == gatt_svr_chr_access_all) {
+                assert(ctxt->chr.val_handle < GATT_SVR_MAX_HANDLES);
+                chr_table[ctxt->chr.val_handle] = ctxt->chr.chr_def->arg;
+            }
+            ble_bond_layout_add(ctxt->chr.val_handle, ctxt->chr.chr_def->uuid, ctxt->chr.chr_def->flags);
             break;
 
         case BLE_GATT_REGISTER_OP_DSC:
             MODLOG_DFLT(DEBUG, "Registering descriptor %s with handle=%d\n",
                         ble_uuid_to_str(ctxt->dsc.dsc_def->uuid, buf),
                         ctxt->dsc.handle);
+            ble_bond_layout_add(ctxt->dsc.handle, ctxt->dsc.dsc_def->uuid, ctxt->dsc.dsc_def->att_flags);
             break;
 
         default:
@@ -523,11 +1903,40 @@ int gatt_svr_init(void) {
         return rc;
     }
 
-    // Allocate initially with 0 value holders for BLE characteristics payloads
-    gatt_svr_chr_temperature_stream_value = (uint8_t *)calloc(1, sizeof(uint8_t));
-    gatt_svr_chr_humidity_stream_value = (uint8_t *)calloc(1, sizeof(uint8_t));
-    gatt_svr_chr_pressure_stream_value = (uint8_t *)calloc(1, sizeof(uint8_t));
-    gatt_svr_chr_audio_stream_value = (uint8_t *)calloc(1, sizeof(uint8_t));
+    ble_stream_init(&temperature_stream, BLE_STREAM_ID_TEMPERATURE, SENSOR_STREAM_PERIOD_MS);
+    ble_stream_init(&humidity_stream, BLE_STREAM_ID_HUMIDITY, SENSOR_STREAM_PERIOD_MS);
+    ble_stream_init(&pressure_stream, BLE_STREAM_ID_PRESSURE, SENSOR_STREAM_PERIOD_MS);
+    portENTER_CRITICAL(&mbuf_stats_lock);
+    memset(&mbuf_stats, 0, sizeof(mbuf_stats));
+    mbuf_stats.min_free_blocks = (uint16_t)os_msys_count();
+    portEXIT_CRITICAL(&mbuf_stats_lock);
+
+    ble_snapshot_init(&gatt_svr_chr_temperature_stream_value);
+    ble_snapshot_init(&gatt_svr_chr_humidity_stream_value);
+    ble_snapshot_init(&gatt_svr_chr_pressure_stream_value);
+
+    tx_lock = xSemaphoreCreateMutex();
+    if (tx_lock == NULL) {
+        return BLE_HS_ENOMEM;
+    }
+
+    ble_tx_register(&temperature_source, "Temperature Stream", sendTemperature, NULL, BLE_STREAM_FIFO_SAMPLES);
+    ble_tx_register(&humidity_source, "Humidity Stream", sendHumidity, NULL, BLE_STREAM_FIFO_SAMPLES);
+    ble_tx_register(&pressure_source, "Pressure Stream", sendPressure, NULL, BLE_STREAM_FIFO_SAMPLES);
+    ble_tx_register(&audio_source, "Microphone Stream", sendAudio, NULL, AUDIO_STREAM_QUEUE_FRAMES);
+    ble_tx_register(&selftest_source, "Self-test Stream", sendSelfTest, NULL, BLE_DIAG_MAX_BACKLOG);
+    ble_tx_register(&download_source, "Session Download", sendDownload, NULL, BLE_DOWNLOAD_MAX_WINDOW);
+
+    ble_diag_init(&selftest);
+    ble_download_init(&download);
+
+    const esp_timer_create_args_t selftest_timer_args = {
+            .callback = onSelfTestTimer,
+            .name = "ble_selftest",
+    };
+    if (esp_timer_create(&selftest_timer_args, &selftest_timer) != ESP_OK) {
+        return BLE_HS_ENOMEM;
+    }
 
     return 0;
 
@@ -0,0 +1,271 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_link.c
+  * @brief   This file is the link tuning state machine implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_link.h"
+#include "ble_conn.h"
+#include "esp_log.h"
+#include "host/ble_hs.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Tuning record of one connection */
+typedef struct ble_link_t {
+    bool in_use;
+    uint16_t conn_handle;
+    uint8_t attempts;
+    bool applied;
+    bool requested_streaming;
+    ble_link_status_t status;
+} ble_link_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_LINK";
+
+/** @abstract Streaming parameters: 7.5-15 ms first, then 15-30 ms which centrals limiting the interval accept */
+static const struct ble_gap_upd_params streaming_params[BLE_LINK_PARAM_ATTEMPTS] = {
+    { .itvl_min = 6, .itvl_max = 12, .latency = 0, .supervision_timeout = 400 },
+    { .itvl_min = 12, .itvl_max = 24, .latency = 0, .supervision_timeout = 400 },
+};
+
+/** @abstract Idle parameters: 400-500 ms with peripheral latency first, then 100-200 ms */
+static const struct ble_gap_upd_params idle_params[BLE_LINK_PARAM_ATTEMPTS] = {
+    { .itvl_min = 320, .itvl_max = 400, .latency = 2, .supervision_timeout = 600 },
+    { .itvl_min = 80, .itvl_max = 160, .latency = 4, .supervision_timeout = 600 },
+};
+
+/** @abstract Tuning records */
+static ble_link_t links[BLE_CONN_MAX];
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function findLink
+ *
+ * @abstract This function looks up the tuning record of a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return Pointer to the record, NULL if the connection is unknown
+ */
+static ble_link_t * findLink(uint16_t conn_handle);
+
+/*
+ * @function requestParams
+ *
+ * @abstract This function requests the connection parameters of the wanted mode for the current attempt
+ *
+ * @param[in,out] link: Tuning record
+ *
+ * @return None
+ */
+static void requestParams(ble_link_t * link);
+
+/*
+ * @function reportLink
+ *
+ * @abstract This function logs the parameters achieved on a connection
+ *
+ * @param[in] link: Tuning record
+ *
+ * @return None
+ */
+static void reportLink(const ble_link_t * link);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static ble_link_t * findLink(uint16_t conn_handle) {
+    for (uint32_t i = 0; i < BLE_CONN_MAX; i++) {
+        if (links[i].in_use && links[i].conn_handle == conn_handle) {
+            return &links[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void requestParams(ble_link_t * link) {
+    const bool streaming = link->status.streaming_wanted;
+    const struct ble_gap_upd_params * params = streaming ? &streaming_params[link->attempts] :
+                                                           &idle_params[link->attempts];
+
+    link->status.step = BLE_LINK_STEP_PARAMS;
+
+    int rc = ble_gap_update_params(link->conn_handle, params);
+
+    if (rc == 0) {
+        link->status.params_pending = true;
+        link->requested_streaming = streaming;
+    } else if (rc == BLE_HS_EALREADY) {
+        /* The central runs its own update; its completion re-evaluates the wanted mode */
+        link->status.params_pending = false;
+    } else {
+        ESP_LOGW(TAG, "Connection %u: parameter update not possible; rc=%d", link->conn_handle, rc);
+        link->status.params_pending = false;
+        link->status.params_refusals++;
+        link->applied = true;
+        link->status.streaming_applied = streaming;
+        link->status.step = BLE_LINK_STEP_READY;
+        reportLink(link);
+    }
+}
+
+static void reportLink(const ble_link_t * link) {
+    ble_conn_state_t state;
+
+    if (!ble_conn_get(link->conn_handle, &state)) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Connection %u tuned for %s: PHY %s%s, data length %u B%s, interval %u.%02u ms, latency %u%s",
+             link->conn_handle,
+             link->status.streaming_applied ? "streaming" : "idle",
+             state.tx_phy == 2 ? "2M" : (state.tx_phy == 3 ? "coded" : "1M"),
+             link->status.phy_refused ? " (2M refused)" : "",
+             state.tx_octets,
+             link->status.data_length_refused ? " (extension refused)" : "",
+             state.conn_interval * 5 / 4, (state.conn_interval * 125) % 100,
+             state.conn_latency,
+             link->status.params_refusals ? " (central refused our parameters)" : "");
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_link_on_connect(uint16_t conn_handle) {
+    ble_link_t * link = findLink(conn_handle);
+
+    for (uint32_t i = 0; link == NULL && i < BLE_CONN_MAX; i++) {
+        if (!links[i].in_use) {
+            link = &links[i];
+        }
+    }
+
+    if (link == NULL) {
+        return;
+    }
+
+    memset(link, 0, sizeof(*link));
+    link->in_use = true;
+    link->conn_handle = conn_handle;
+    link->status.step = BLE_LINK_STEP_PHY;
+
+    /* Data length update has no instant and may run alongside the PHY update; DATA_LEN_CHG reports the outcome */
+    if (ble_gap_set_data_len(conn_handle, BLE_LINK_TX_OCTETS, BLE_LINK_TX_TIME) != 0) {
+        link->status.data_length_refused = true;
+    }
+
+    /* PHY and connection parameter updates both use an instant, so they run one after the other */
+    int rc = ble_gap_set_prefered_le_phy(conn_handle, BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_2M_MASK,
+                                         BLE_GAP_LE_PHY_CODED_ANY);
+    if (rc != 0) {
+        ESP_LOGW(TAG, "Connection %u: 2M PHY request failed; rc=%d", conn_handle, rc);
+        link->status.phy_refused = true;
+        requestParams(link);
+    }
+}
+
+void ble_link_on_disconnect(uint16_t conn_handle) {
+    ble_link_t * link = findLink(conn_handle);
+
+    if (link != NULL) {
+        link->in_use = false;
+    }
+}
+
+void ble_link_on_phy_update(uint16_t conn_handle, int status) {
+    ble_link_t * link = findLink(conn_handle);
+    ble_conn_state_t state;
+
+    if (link == NULL || link->status.step != BLE_LINK_STEP_PHY) {
+        return;
+    }
+
+    if (status != 0 || !ble_conn_get(conn_handle, &state) || state.tx_phy != BLE_GAP_LE_PHY_2M) {
+        link->status.phy_refused = true;
+    }
+
+    requestParams(link);
+}
+
+void ble_link_on_data_len_change(uint16_t conn_handle, uint16_t max_tx_octets) {
+    ble_link_t * link = findLink(conn_handle);
+
+    /* The controller settles on the smaller of both sides' limits, so a short result means the peer refused */
+    if (link != NULL) {
+        link->status.data_length_refused = max_tx_octets < BLE_LINK_TX_OCTETS;
+    }
+}
+
+void ble_link_on_conn_update(uint16_t conn_handle, int status) {
+    ble_link_t * link = findLink(conn_handle);
+
+    if (link == NULL || link->status.step == BLE_LINK_STEP_PHY) {
+        return;
+    }
+
+    if (link->status.params_pending) {
+        link->status.params_pending = false;
+
+        if (status == 0) {
+            link->attempts = 0;
+            link->applied = true;
+            link->status.streaming_applied = link->requested_streaming;
+        } else {
+            link->status.params_refusals++;
+            link->attempts++;
+
+            /* Out of fallbacks: keep what the central gave us */
+            if (link->attempts >= BLE_LINK_PARAM_ATTEMPTS) {
+                link->attempts = 0;
+                link->applied = true;
+                link->status.streaming_applied = link->requested_streaming;
+            }
+        }
+    }
+
+    /* Retry with the next fallback, or follow a mode change made while the procedure ran */
+    if (!link->applied || link->status.streaming_wanted != link->status.streaming_applied) {
+        requestParams(link);
+        return;
+    }
+
+    link->status.step = BLE_LINK_STEP_READY;
+    reportLink(link);
+}
+
+void ble_link_set_streaming(uint16_t conn_handle, bool streaming) {
+    ble_link_t * link = findLink(conn_handle);
+
+    if (link == NULL || link->status.streaming_wanted == streaming) {
+        return;
+    }
+
+    link->status.streaming_wanted = streaming;
+    link->attempts = 0;
+
+    /* Before READY the running step picks up the new mode when it finishes */
+    if (link->status.step == BLE_LINK_STEP_READY && !link->status.params_pending) {
+        requestParams(link);
+    }
+}
+
+bool ble_link_get_status(uint16_t conn_handle, ble_link_status_t * status) {
+    const ble_link_t * link = findLink(conn_handle);
+
+    if (link != NULL) {
+        *status = link->status;
+    }
+
+    return link != NULL;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
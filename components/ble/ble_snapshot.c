@@ -0,0 +1,70 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_snapshot.c
+  * @brief   This file is the lock-free latest-value store implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_snapshot.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#define sequenceLoad(counter) __atomic_load_n(&(counter), __ATOMIC_ACQUIRE)
+#define sequenceStore(counter, value) __atomic_store_n(&(counter), (value), __ATOMIC_RELEASE)
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_snapshot_init(ble_snapshot_t * snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+void ble_snapshot_write(ble_snapshot_t * snapshot, const void * data, size_t length) {
+    const uint32_t next = snapshot->sequence + 1;
+    ble_snapshot_slot_t * slot = &snapshot->slots[next & 1];
+
+    if (length > BLE_SNAPSHOT_MAX_BYTES) {
+        length = BLE_SNAPSHOT_MAX_BYTES;
+    }
+
+    memcpy(slot->data, data, length);
+    slot->length = (uint8_t)length;
+
+    sequenceStore(snapshot->sequence, next);
+}
+
+size_t ble_snapshot_read(const ble_snapshot_t * snapshot, void * data) {
+    for (;;) {
+        const uint32_t sequence = sequenceLoad(snapshot->sequence);
+
+        if (sequence == 0) {
+            return 0;
+        }
+
+        /* The writer fills the other slot first, so this one changes only after another value was published */
+        const ble_snapshot_slot_t * slot = &snapshot->slots[sequence & 1];
+        const size_t length = slot->length <= BLE_SNAPSHOT_MAX_BYTES ? slot->length : BLE_SNAPSHOT_MAX_BYTES;
+        memcpy(data, slot->data, length);
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        if (sequenceLoad(snapshot->sequence) == sequence) {
+            return length;
+        }
+    }
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
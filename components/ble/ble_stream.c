@@ -0,0 +1,231 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_stream.c
+  * @brief   This file is the batched sensor stream encoder implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_stream.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define BLE_STREAM_FIFO_MASK (BLE_STREAM_FIFO_SAMPLES - 1)
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putLittleEndian
+ *
+ * @abstract This function stores a value in little-endian byte order
+ *
+ * @param[out] destination: Destination buffer
+ *
+ * @param[in] value: Value to store
+ *
+ * @param[in] bytes: Number of bytes
+ *
+ * @return None
+ */
+static void putLittleEndian(uint8_t * destination, uint64_t value, size_t bytes);
+
+/*
+ * @function putDelta
+ *
+ * @abstract This function stores a sample difference as a zigzag varint
+ *
+ * @param[out] destination: Destination buffer, at least BLE_STREAM_MAX_DELTA_BYTES long
+ *
+ * @param[in] delta: Difference to the previous sample
+ *
+ * @return Number of bytes written
+ */
+static size_t putDelta(uint8_t * destination, int32_t delta);
+
+/*
+ * @function putHeader
+ *
+ * @abstract This function stores a frame header
+ *
+ * @param[in] channel: Channel
+ *
+ * @param[in] first: First sample of the frame
+ *
+ * @param[in] period_ms: Sample spacing in the frame
+ *
+ * @param[in] count: Number of samples in the frame
+ *
+ * @param[out] frame: Destination buffer
+ *
+ * @return None
+ */
+static void putHeader(const ble_stream_channel_t * channel, const ble_stream_sample_t * first, uint16_t period_ms,
+                      size_t count, uint8_t * frame);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static void putLittleEndian(uint8_t * destination, uint64_t value, size_t bytes) {
+    for (size_t i = 0; i < bytes; i++) {
+        destination[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static size_t putDelta(uint8_t * destination, int32_t delta) {
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    size_t length = 0;
+
+    while (zigzag >= 0x80) {
+        destination[length++] = (uint8_t)(zigzag | 0x80);
+        zigzag >>= 7;
+    }
+    destination[length++] = (uint8_t)zigzag;
+
+    return length;
+}
+
+static void putHeader(const ble_stream_channel_t * channel, const ble_stream_sample_t * first, uint16_t period_ms,
+                      size_t count, uint8_t * frame) {
+    frame[0] = channel->id;
+    putLittleEndian(&frame[1], channel->sequence, 2);
+    putLittleEndian(&frame[3], (uint64_t)first->timestamp_ms, 8);
+    putLittleEndian(&frame[11], period_ms, 2);
+    frame[13] = (uint8_t)count;
+    frame[14] = first->quality;
+    putLittleEndian(&frame[15], (uint32_t)first->value, 4);
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void ble_stream_init(ble_stream_channel_t * channel, uint8_t id, uint16_t period_ms) {
+    memset(channel, 0, sizeof(*channel));
+    channel->id = id;
+    channel->period_ms = period_ms;
+}
+
+void ble_stream_push(ble_stream_channel_t * channel, int64_t timestamp_ms, int32_t value, uint8_t quality) {
+    if (channel->head - channel->tail == BLE_STREAM_FIFO_SAMPLES) {
+        channel->tail++;
+        channel->dropped++;
+    }
+
+    ble_stream_sample_t * sample = &channel->samples[channel->head & BLE_STREAM_FIFO_MASK];
+    sample->timestamp_ms = timestamp_ms;
+    sample->value = value;
+    sample->quality = quality;
+    channel->head++;
+
+    ble_stream_observe(channel, timestamp_ms, value, quality);
+}
+
+void ble_stream_observe(ble_stream_channel_t * channel, int64_t timestamp_ms, int32_t value, uint8_t quality) {
+    channel->latest.timestamp_ms = timestamp_ms;
+    channel->latest.value = value;
+    channel->latest.quality = quality;
+    channel->latest_valid = true;
+}
+
+size_t ble_stream_pending(const ble_stream_channel_t * channel) {
+    return channel->head - channel->tail;
+}
+
+size_t ble_stream_encode(const ble_stream_channel_t * channel, uint8_t * frame, size_t max_length, size_t * count,
+                         bool * full) {
+    uint8_t delta[BLE_STREAM_MAX_DELTA_BYTES];
+    const size_t pending = ble_stream_pending(channel);
+
+    *count = 0;
+    *full = false;
+
+    if (pending == 0 || max_length < BLE_STREAM_HEADER_BYTES) {
+        return 0;
+    }
+
+    const ble_stream_sample_t * first = &channel->samples[channel->tail & BLE_STREAM_FIFO_MASK];
+    int32_t previous = first->value;
+    uint32_t period_ms = channel->period_ms;
+
+    /* A decimated channel keeps every n-th sample, the first gap sets the frame grid to a multiple of the period */
+    if (pending > 1) {
+        const int64_t gap = channel->samples[(channel->tail + 1) & BLE_STREAM_FIFO_MASK].timestamp_ms -
+                            first->timestamp_ms;
+        const int64_t multiple = (gap + channel->period_ms / 2) / channel->period_ms;
+
+        if (multiple > 1 && multiple <= BLE_STREAM_MAX_PERIOD_MULTIPLE) {
+            period_ms *= multiple;
+        }
+    }
+
+    size_t length = BLE_STREAM_HEADER_BYTES;
+    size_t encoded = 1;
+
+    for (; encoded < pending; encoded++) {
+        const ble_stream_sample_t * sample = &channel->samples[(channel->tail + encoded) & BLE_STREAM_FIFO_MASK];
+
+        /* Timestamps are implied by the period, a sample off the grid starts the next frame */
+        const int64_t drift = sample->timestamp_ms - first->timestamp_ms - (int64_t)encoded * period_ms;
+        if (drift > (int64_t)(period_ms / 2) || drift < -(int64_t)(period_ms / 2) ||
+            sample->quality != first->quality) {
+            *full = true;
+            break;
+        }
+
+        const size_t delta_length = putDelta(delta, (int32_t)((uint32_t)sample->value - (uint32_t)previous));
+        if (length + delta_length > max_length || encoded == BLE_STREAM_MAX_FRAME_SAMPLES) {
+            *full = true;
+            break;
+        }
+
+        if (frame != NULL) {
+            memcpy(&frame[length], delta, delta_length);
+        }
+        length += delta_length;
+        previous = sample->value;
+    }
+
+    if (length + BLE_STREAM_MAX_DELTA_BYTES > max_length) {
+        *full = true;
+    }
+
+    if (frame != NULL) {
+        putHeader(channel, first, (uint16_t)period_ms, encoded, frame);
+    }
+
+    *count = encoded;
+
+    return length;
+}
+
+uint32_t ble_stream_age_ms(const ble_stream_channel_t * channel, int64_t now_ms) {
+    if (channel->head == channel->tail) {
+        return 0;
+    }
+
+    const int64_t age = now_ms - channel->samples[channel->tail & BLE_STREAM_FIFO_MASK].timestamp_ms;
+
+    /* A clock stepped back past the sample reports the largest age, which releases it right away */
+    return (age < 0 || age > UINT32_MAX) ? UINT32_MAX : (uint32_t)age;
+}
+
+size_t ble_stream_encode_latest(const ble_stream_channel_t * channel, uint8_t * frame) {
+    if (!channel->latest_valid) {
+        return 0;
+    }
+
+    putHeader(channel, &channel->latest, channel->period_ms, 1, frame);
+
+    return BLE_STREAM_HEADER_BYTES;
+}
+
+void ble_stream_consume(ble_stream_channel_t * channel, size_t count) {
+    channel->tail += (uint32_t)count;
+    channel->sequence++;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,174 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_time.c
+  * @brief   This file is the BLE clock synchronization exchange implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include "ble_time.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "rtc_driver.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Exchange waiting for its completion */
+typedef struct {
+    bool pending;
+    uint8_t sequence;
+    int64_t t1_us;
+    int64_t t2_us;
+    int64_t t3_us;
+} ble_time_exchange_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_TIME";
+
+/** @abstract Latest request, one central syncs at a time and a new request replaces an unfinished one */
+static ble_time_exchange_t exchange;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putU64
+ *
+ * @abstract This function stores a little-endian uint64
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU64(uint8_t * data, uint64_t value);
+
+/*
+ * @function putU32
+ *
+ * @abstract This function stores a little-endian uint32
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU32(uint8_t * data, uint32_t value);
+
+/*
+ * @function getU64
+ *
+ * @abstract This function loads a little-endian uint64
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint64_t getU64(const uint8_t * data);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint8_t * putU64(uint8_t * data, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        data[i] = (uint8_t)(value >> (8 * i));
+    }
+    return data + 8;
+}
+
+static uint8_t * putU32(uint8_t * data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    return data + 4;
+}
+
+static uint64_t getU64(const uint8_t * data) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int ble_time_write(const uint8_t * data, size_t length, int64_t rx_us, uint8_t * reply) {
+    if (length != BLE_TIME_WRITE_BYTES) {
+        return -1;
+    }
+
+    const uint8_t sequence = data[1];
+    const int64_t stamp_us = (int64_t)getU64(&data[2]);
+    uint8_t * cursor = reply;
+
+    switch (data[0]) {
+        case BLE_TIME_OP_REQUEST:
+            exchange.pending = true;
+            exchange.sequence = sequence;
+            exchange.t1_us = stamp_us;
+            exchange.t2_us = rx_us;
+
+            *cursor++ = BLE_TIME_OP_RESPONSE;
+            *cursor++ = sequence;
+            cursor = putU64(cursor, (uint64_t)rx_us);
+
+            /* Stamped last, the caller hands the reply to the stack right away */
+            exchange.t3_us = rtc_now_us();
+            cursor = putU64(cursor, (uint64_t)exchange.t3_us);
+            return (int)(cursor - reply);
+
+        case BLE_TIME_OP_COMPLETE: {
+            if (!exchange.pending || sequence != exchange.sequence) {
+                return -1;
+            }
+            exchange.pending = false;
+
+            rtc_sync_result_t result;
+            rtc_sync_update(exchange.t1_us, exchange.t2_us, exchange.t3_us, stamp_us, &result);
+
+            ESP_LOGD(TAG, "Sync %u: offset %lld us, rtt %lld us%s", sequence, (long long)result.offset_us,
+                     (long long)result.rtt_us, result.stepped ? ", stepped" : result.applied ? ", slewing" : "");
+
+            const int64_t rtt_us = result.rtt_us < 0 ? 0 : result.rtt_us > UINT32_MAX ? UINT32_MAX : result.rtt_us;
+
+            *cursor++ = BLE_TIME_OP_RESULT;
+            *cursor++ = sequence;
+            cursor = putU64(cursor, (uint64_t)result.offset_us);
+            cursor = putU32(cursor, (uint32_t)rtt_us);
+            *cursor++ = (result.applied ? BLE_TIME_RESULT_APPLIED : 0) | (result.stepped ? BLE_TIME_RESULT_STEPPED : 0);
+            return (int)(cursor - reply);
+        }
+
+        default:
+            return -1;
+    }
+}
+
+size_t ble_time_status(uint8_t * status) {
+    rtc_sync_status_t sync;
+    rtc_get_sync_status(&sync);
+
+    const int64_t mono_us = esp_timer_get_time();
+    const int64_t rtt_us = sync.last_rtt_us > UINT32_MAX ? UINT32_MAX : sync.last_rtt_us;
+
+    uint8_t * cursor = status;
+    *cursor++ = sync.valid ? 0x01 : 0x00;
+    cursor = putU64(cursor, (uint64_t)rtc_wall_time_us(mono_us));
+    cursor = putU64(cursor, (uint64_t)mono_us);
+    cursor = putU64(cursor, (uint64_t)sync.last_offset_us);
+    cursor = putU32(cursor, (uint32_t)rtt_us);
+    cursor = putU32(cursor, sync.syncs);
+    cursor = putU32(cursor, (uint32_t)sync.skew_ppb);
+
+    return (size_t)(cursor - status);
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
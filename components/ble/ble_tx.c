@@ -0,0 +1,277 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_tx.c
+  * @brief   This file is the BLE notification transmit scheduler implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "ble_tx.h"
+#include "ble_conn.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "host/ble_hs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BLE_TX";
+
+/** @abstract Registered sources, served in registration order */
+static ble_tx_source_t * sources[BLE_TX_MAX_SOURCES];
+
+/** @abstract Number of registered sources */
+static size_t source_count = 0;
+
+/** @abstract Scheduler task handle */
+static TaskHandle_t tx_task = NULL;
+
+/** @abstract Guards the source counters, they are updated by the producers and the scheduler */
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function retryDelayMs
+ *
+ * @abstract This function returns the shortest connection interval, the soonest a full link can take data again
+ *
+ * @param None
+ *
+ * @return Delay in milliseconds, between BLE_TX_RETRY_MIN_MS and BLE_TX_RETRY_MAX_MS
+ */
+static uint32_t retryDelayMs(void);
+
+/*
+ * @function serveSource
+ *
+ * @abstract This function sends up to BLE_TX_BURST notifications of a source and counts the outcome
+ *
+ * @param[in,out] source: Source
+ *
+ * @param[out] blocked: Set when the link or the host buffers refused a notification
+ *
+ * @return Number of notifications sent
+ */
+static uint32_t serveSource(ble_tx_source_t * source, bool * blocked);
+
+/*
+ * @function vBleTxTask
+ *
+ * @abstract This function drains the sources, backing off while the link or the host buffers are full
+ *
+ * @param[in] pvParameters: Unused
+ *
+ * @return None
+ */
+static void vBleTxTask(void * pvParameters);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint32_t retryDelayMs(void) {
+    uint16_t handles[BLE_CONN_MAX];
+    const size_t count = ble_conn_list(0, handles);
+    uint32_t delay_ms = BLE_TX_RETRY_MAX_MS;
+
+    for (size_t i = 0; i < count; i++) {
+        ble_conn_state_t state;
+
+        if (ble_conn_get(handles[i], &state)) {
+            const uint32_t interval_ms = (state.conn_interval * 5u + 3u) / 4u;
+            if (interval_ms < delay_ms) {
+                delay_ms = interval_ms;
+            }
+        }
+    }
+
+    return delay_ms < BLE_TX_RETRY_MIN_MS ? BLE_TX_RETRY_MIN_MS : delay_ms;
+}
+
+static uint32_t serveSource(ble_tx_source_t * source, bool * blocked) {
+    uint32_t sent = 0;
+
+    for (uint32_t burst = 0; burst < BLE_TX_BURST; burst++) {
+        const int rc = source->send(source->context);
+
+        portENTER_CRITICAL(&stats_lock);
+
+        source->stats.subscribed = rc != BLE_HS_ENOTCONN;
+
+        if (rc == 0) {
+            source->stats.sent++;
+        } else if (rc == BLE_HS_EBUSY) {
+            source->stats.busy++;
+        } else if (rc == BLE_HS_ENOMEM) {
+            source->stats.no_memory++;
+        }
+
+        portEXIT_CRITICAL(&stats_lock);
+
+        if (rc != 0) {
+            /* The item stays queued, it is retried once the link drained */
+            *blocked |= rc == BLE_HS_EBUSY || rc == BLE_HS_ENOMEM;
+            break;
+        }
+
+        sent++;
+    }
+
+    return sent;
+}
+
+static void vBleTxTask(void * pvParameters) {
+    uint32_t backoff_ms = BLE_TX_RETRY_MIN_MS;
+
+    while (1) {
+        uint32_t sent = 0;
+        bool blocked = false;
+
+        for (size_t i = 0; i < source_count; i++) {
+            sent += serveSource(sources[i], &blocked);
+        }
+
+        if (sent > 0) {
+            /* A source may still hold ready items after its burst */
+            backoff_ms = retryDelayMs();
+            continue;
+        }
+
+        TickType_t wait = pdMS_TO_TICKS(BLE_TX_IDLE_MS);
+
+        if (blocked) {
+            /* Retry after the next connection event, backing off while the host buffers stay exhausted */
+            wait = pdMS_TO_TICKS(backoff_ms);
+            backoff_ms = backoff_ms * 2 > BLE_TX_RETRY_MAX_MS ? BLE_TX_RETRY_MAX_MS : backoff_ms * 2;
+        } else {
+            backoff_ms = retryDelayMs();
+        }
+
+        ulTaskNotifyTake(pdTRUE, wait > 0 ? wait : 1);
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+bool ble_tx_register(ble_tx_source_t * source, const char * name, ble_tx_send_t send, void * context,
+                     uint32_t capacity) {
+    if (source_count == BLE_TX_MAX_SOURCES || tx_task != NULL) {
+        return false;
+    }
+
+    memset(source, 0, sizeof(*source));
+    source->send = send;
+    source->context = context;
+    source->stats.name = name;
+    source->stats.capacity = capacity;
+    source->stats.decimation = 1;
+
+    sources[source_count++] = source;
+
+    return true;
+}
+
+bool ble_tx_start(void) {
+    if (tx_task != NULL) {
+        return true;
+    }
+
+    return xTaskCreate(vBleTxTask, "BLETX", BLE_TX_TASK_STACK_SIZE, NULL, BLE_TX_TASK_PRIORITY, &tx_task) == pdPASS;
+}
+
+void ble_tx_kick(void) {
+    if (tx_task != NULL) {
+        xTaskNotifyGive(tx_task);
+    }
+}
+
+bool ble_tx_admit(ble_tx_source_t * source, uint32_t depth) {
+    const int64_t now = esp_timer_get_time();
+    const uint32_t capacity = source->stats.capacity;
+    bool escalated = false;
+    bool recovered = false;
+    bool admitted = true;
+
+    portENTER_CRITICAL(&stats_lock);
+
+    ble_tx_stats_t * stats = &source->stats;
+    stats->depth = depth + 1;
+    if (stats->depth > stats->peak_depth) {
+        stats->peak_depth = stats->depth;
+    }
+
+    if (!stats->subscribed || depth * 100 <= capacity * BLE_TX_RECOVER_PERCENT) {
+        /* A backlog kept for a central that is away is not an overload */
+        source->overload_since_us = 0;
+        recovered = stats->decimation > 1 || stats->paused;
+        stats->decimation = 1;
+        stats->paused = false;
+    } else if (depth * 100 >= capacity * BLE_TX_OVERLOAD_PERCENT) {
+        if (source->overload_since_us == 0) {
+            source->overload_since_us = now;
+        } else if (now - source->overload_since_us >= (int64_t)BLE_TX_OVERLOAD_MS * 1000) {
+            /* Re-arm so a persisting overload escalates once per period */
+            source->overload_since_us = now;
+            stats->overloads++;
+            escalated = true;
+#if BLE_TX_OVERLOAD_POLICY == BLE_TX_POLICY_DECIMATE
+            if (stats->decimation < BLE_TX_MAX_DECIMATION) {
+                stats->decimation *= 2;
+            }
+#elif BLE_TX_OVERLOAD_POLICY == BLE_TX_POLICY_PAUSE
+            stats->paused = true;
+#endif
+        }
+    }
+
+    if (stats->paused) {
+        stats->paused_dropped++;
+        stats->depth = depth;
+        admitted = false;
+    } else if (stats->decimation > 1 && (source->decimation_phase++ & (stats->decimation - 1)) != 0) {
+        stats->decimated++;
+        stats->depth = depth;
+        admitted = false;
+    }
+
+    const uint8_t decimation = stats->decimation;
+    const bool paused = stats->paused;
+
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (escalated) {
+        ESP_LOGW(TAG, "%s overloaded at %lu/%lu queued, decimation 1/%u%s", stats->name, (unsigned long)depth,
+                 (unsigned long)capacity, decimation, paused ? ", paused" : "");
+    } else if (recovered) {
+        ESP_LOGI(TAG, "%s recovered", stats->name);
+    }
+
+    return admitted;
+}
+
+void ble_tx_dropped_oldest(ble_tx_source_t * source, uint32_t count) {
+    portENTER_CRITICAL(&stats_lock);
+    source->stats.dropped_oldest += count;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+bool ble_tx_get_stats(size_t index, ble_tx_stats_t * stats) {
+    if (index >= source_count) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&stats_lock);
+    *stats = sources[index]->stats;
+    portEXIT_CRITICAL(&stats_lock);
+
+    return true;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,93 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_beacon.h
+  * @brief   This file is the header file for the connectionless broadcast of live readings
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_BEACON_H_
+#define _BLE_BEACON_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract 1 broadcasts the readings in the advertising data and keeps advertising non-connectably while every
+ *            connection slot is taken, 0 advertises the name and service UUID only */
+#define BLE_BEACON_ENABLED 1
+
+/** @abstract Period of the advertising data refresh, receivers see each payload over several advertising events */
+#define BLE_BEACON_REFRESH_MS 1000
+
+/** @abstract Payload format, first byte of the service data */
+#define BLE_BEACON_VERSION 1
+
+/** @abstract Service data payload, little-endian:
+ *            [version u8][sequence u16][flags u8][temperature i16 0.01 degC][humidity u16 0.01 %RH]
+ *            [pressure u16 0.1 hPa][breath class u8] */
+#define BLE_BEACON_PAYLOAD_BYTES 11
+
+/** @abstract Flags byte: set for each reading the payload holds */
+#define BLE_BEACON_FLAG_ENVIRONMENT 0x01
+#define BLE_BEACON_FLAG_BREATH_CLASS 0x02
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_beacon_set_environment
+ *
+ * @abstract This function records the latest BME280 reading for the next payload
+ *
+ * @param[in] temperature: Temperature in 0.01 degC
+ *
+ * @param[in] humidity: Humidity in Q22.10 %RH
+ *
+ * @param[in] pressure: Pressure in Q24.8 Pa
+ *
+ * @return None
+ */
+void ble_beacon_set_environment(int32_t temperature, uint32_t humidity, uint32_t pressure);
+
+/*
+ * @function ble_beacon_set_breath_class
+ *
+ * @abstract This function records the latest breath classifier label for the next payload
+ *
+ * @param[in] label: breath_class_t value
+ *
+ * @return None
+ */
+void ble_beacon_set_breath_class(uint8_t label);
+
+/*
+ * @function ble_beacon_encode
+ *
+ * @abstract This function encodes the latest readings and advances the sequence counter
+ *
+ * @param[out] payload: BLE_BEACON_PAYLOAD_BYTES bytes
+ *
+ * @return Payload length
+ */
+size_t ble_beacon_encode(uint8_t * payload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_BEACON_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,150 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_bond.h
+  * @brief   This file is the header file for BLE bonding and fast reconnect
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_BOND_H_
+#define _BLE_BOND_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "host/ble_uuid.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+struct ble_gap_repeat_pairing;
+
+/** @brief Bonding counters
+ *
+ * pairings counts new bonds, reconnects counts links a bonded central encrypted with its stored keys and
+ * last_reconnect_ms is the time from the connection to the encrypted link of the latest one. Subscriptions are
+ * restored from the bond at that point, so it bounds the delay to the first notification.
+ *
+ */
+typedef struct ble_bond_stats_t {
+    uint32_t pairings;
+    uint32_t reconnects;
+    uint32_t repairings_refused;
+    uint32_t last_reconnect_ms;
+    uint32_t layout_hash;
+} ble_bond_stats_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract NVS namespace and key of the GATT layout hash the bonded centrals cached */
+#define BLE_BOND_NVS_NAMESPACE "ble_bond"
+#define BLE_BOND_NVS_LAYOUT_KEY "layout"
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * All functions except ble_bond_get_stats must be called from the NimBLE host task, i.e. from GATT registration and
+ * GAP event handling.
+ */
+
+/*
+ * @function ble_bond_layout_add
+ *
+ * @abstract This function folds a registered attribute into the GATT layout hash
+ *
+ * @param[in] handle: Attribute handle
+ *
+ * @param[in] uuid: Attribute UUID
+ *
+ * @param[in] flags: Characteristic or descriptor flags, 0 for services
+ *
+ * @return None
+ */
+void ble_bond_layout_add(uint16_t handle, const ble_uuid_t * uuid, uint16_t flags);
+
+/*
+ * @function ble_bond_layout_check
+ *
+ * @abstract This function compares the GATT layout hash with the one stored at the previous boot. If the layout
+ *           changed, bonded centrals are sent a Service Changed indication, now or when they reconnect, so they drop
+ *           their cached database. Otherwise they keep using it and skip discovery.
+ *
+ * @param None
+ *
+ * @return None
+ */
+void ble_bond_layout_check(void);
+
+/*
+ * @function ble_bond_on_connect
+ *
+ * @abstract This function asks a bonded central to encrypt the new link right away
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_bond_on_connect(uint16_t conn_handle);
+
+/*
+ * @function ble_bond_on_disconnect
+ *
+ * @abstract This function forgets a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_bond_on_disconnect(uint16_t conn_handle);
+
+/*
+ * @function ble_bond_on_encryption
+ *
+ * @abstract This function counts pairings and reconnects once the link is encrypted, a reconnect wakes the
+ *           transmit scheduler for the subscriptions restored from the bond
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] status: Encryption change status
+ *
+ * @return None
+ */
+void ble_bond_on_encryption(uint16_t conn_handle, int status);
+
+/*
+ * @function ble_bond_on_repeat_pairing
+ *
+ * @abstract This function decides whether a bonded central may pair again. It may if the new pairing is at least
+ *           as strong as the bond, which happens when the central lost its keys. A weaker attempt could come from a
+ *           device spoofing the central's address and is refused.
+ *
+ * @param[in] repeat_pairing: Repeat pairing event
+ *
+ * @return BLE_GAP_REPEAT_PAIRING_RETRY after deleting the old bond, BLE_GAP_REPEAT_PAIRING_IGNORE otherwise
+ */
+int ble_bond_on_repeat_pairing(const struct ble_gap_repeat_pairing * repeat_pairing);
+
+/*
+ * @function ble_bond_get_stats
+ *
+ * @abstract This function returns the bonding counters
+ *
+ * @param[out] stats: Counters
+ *
+ * @return None
+ */
+void ble_bond_get_stats(ble_bond_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_BOND_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,145 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_coc.h
+  * @brief   This file is the header file for the L2CAP connection-oriented bulk channel
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_COC_H_
+#define _BLE_COC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Bulk channel counters, bytes count record payload and headers */
+typedef struct ble_coc_stats_t {
+    bool connected;
+    uint16_t conn_handle;
+    uint16_t peer_sdu_size;
+    uint32_t sdus_sent;
+    uint32_t bytes_sent;
+    uint32_t stalls;
+    uint32_t sdus_received;
+    uint32_t bytes_received;
+    uint32_t bytes_per_s;
+} ble_coc_stats_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract LE protocol/service multiplexer the server listens on, from the dynamic range */
+#define BLE_COC_PSM 0x0080
+
+/** @abstract Largest SDU in either direction */
+#define BLE_COC_SDU_BYTES 512
+
+/** @abstract Receive SDU buffers, one posted to the stack while the other is processed */
+#define BLE_COC_RX_SDU_BUFFERS 2
+
+/** @abstract Records waiting for the channel, must be a power of two */
+#define BLE_COC_TX_BUFFER_BYTES 4096
+
+/** @abstract Record header: record type followed by the little-endian payload length (uint16) */
+#define BLE_COC_RECORD_HEADER_BYTES 3
+
+/** @abstract Record types: a raw sensor sample (stream id, int64 LE timestamp in epoch ms, int32 LE value, time
+ *            quality), an audio frame as notified on the Microphone Stream characteristic and a download frame as
+ *            notified on the Download Data characteristic */
+#define BLE_COC_RECORD_SENSOR 0x01
+#define BLE_COC_RECORD_AUDIO 0x02
+#define BLE_COC_RECORD_DOWNLOAD 0x03
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_coc_init
+ *
+ * @abstract This function starts the L2CAP CoC server and registers the channel with the transmit scheduler
+ *
+ * @param None
+ *
+ * @return 0 on success, NimBLE error code otherwise
+ */
+int ble_coc_init(void);
+
+/*
+ * @function ble_coc_write
+ *
+ * @abstract This function queues a record for the bulk channel. Records are packed back to back into SDUs of up to
+ *           BLE_COC_SDU_BYTES and the peer grants credits for them, so no per-record ATT header is paid.
+ *
+ * @param[in] type: BLE_COC_RECORD_* type
+ *
+ * @param[in] data: Record payload
+ *
+ * @param[in] length: Payload length
+ *
+ * @return
+ *  - 0 if the record was queued
+ *  - BLE_HS_ENOTCONN if no channel is open
+ *  - BLE_HS_EBUSY if the overload policy refused the record
+ *  - BLE_HS_EMSGSIZE if the record does not fit an SDU
+ */
+int ble_coc_write(uint8_t type, const void * data, uint16_t length);
+
+/*
+ * @function ble_coc_write_lossless
+ *
+ * @abstract This function queues a record only if the ring has room for it. Unlike ble_coc_write it never drops
+ *           queued records and bypasses the overload policy, for senders that keep a record until the central
+ *           acknowledged it.
+ *
+ * @param[in] type: BLE_COC_RECORD_* type
+ *
+ * @param[in] data: Record payload
+ *
+ * @param[in] length: Payload length
+ *
+ * @return
+ *  - 0 if the record was queued
+ *  - BLE_HS_ENOTCONN if no channel is open
+ *  - BLE_HS_EBUSY if the ring is full, retry once the channel drained
+ *  - BLE_HS_EMSGSIZE if the record does not fit an SDU
+ */
+int ble_coc_write_lossless(uint8_t type, const void * data, uint16_t length);
+
+/*
+ * @function ble_coc_payload_limit
+ *
+ * @abstract This function returns the largest record payload the channel carries to a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return Payload limit, 0 if the connection has no channel open
+ */
+uint16_t ble_coc_payload_limit(uint16_t conn_handle);
+
+/*
+ * @function ble_coc_get_stats
+ *
+ * @abstract This function returns the bulk channel counters, bytes_per_s covers the time since the previous call
+ *
+ * @param[out] stats: Counters
+ *
+ * @return None
+ */
+void ble_coc_get_stats(ble_coc_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_COC_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
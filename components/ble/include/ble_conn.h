@@ -0,0 +1,348 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_conn.h
+  * @brief   This file is the header file for the per-connection link state table
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_CONN_H_
+#define _BLE_CONN_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "sdkconfig.h"
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Connections tracked, matches the NimBLE connection limit */
+#define BLE_CONN_MAX CONFIG_BT_NIMBLE_MAX_CONNECTIONS
+
+/** @abstract ATT MTU before the exchange completes */
+#define BLE_CONN_DEFAULT_MTU 23
+
+/** @abstract Link-layer payload before data length extension */
+#define BLE_CONN_DEFAULT_OCTETS 27
+
+/** @abstract Link-layer PDU time before data length extension, in microseconds */
+#define BLE_CONN_DEFAULT_TIME 328
+
+/** @abstract PDUs a peer is assumed to drain per connection event when completion events go missing */
+#define BLE_CONN_PDUS_PER_EVENT 4
+
+/** @abstract Queued PDUs above which a peer skips notifications, about two 7.5 ms events of 4 PDUs
+ *            ahead of its drain rate, so a slow peer cannot hold the shared host buffers */
+#define BLE_CONN_MAX_QUEUE_PDUS 24
+
+/** @abstract Notifications awaiting their completion event, each holds at least one of the queue PDUs */
+#define BLE_CONN_MAX_PENDING BLE_CONN_MAX_QUEUE_PDUS
+
+/** @abstract Connection interval assumed before the controller reports one, in 1.25 ms units */
+#define BLE_CONN_DEFAULT_INTERVAL 24
+
+/** @abstract L2CAP basic header plus ATT notification header carried by each notification */
+#define BLE_CONN_NOTIFY_OVERHEAD (4 + 3)
+
+/** @abstract Subscription bits */
+#define BLE_CONN_SUB_TEMPERATURE (1u << 0)
+#define BLE_CONN_SUB_HUMIDITY (1u << 1)
+#define BLE_CONN_SUB_PRESSURE (1u << 2)
+#define BLE_CONN_SUB_AUDIO (1u << 3)
+#define BLE_CONN_SUB_SELFTEST (1u << 4)
+#define BLE_CONN_SUB_SELFTEST_PING (1u << 5)
+#define BLE_CONN_SUB_TEMPERATURE_STATUS (1u << 6)
+#define BLE_CONN_SUB_HUMIDITY_STATUS (1u << 7)
+#define BLE_CONN_SUB_PRESSURE_STATUS (1u << 8)
+#define BLE_CONN_SUB_AUDIO_STATUS (1u << 9)
+#define BLE_CONN_SUB_DOWNLOAD (1u << 10)
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Link state of one connection
+ *
+ * conn_interval is in 1.25 ms units and supervision_timeout in 10 ms units, as reported by the controller.
+ * queue_depth counts the link-layer PDUs of the notifications handed to the host and not yet reported by
+ * BLE_GAP_EVENT_NOTIFY_TX, oldest first in pending_handles and pending_pdus. When completion events go missing,
+ * every connection event since the last one drains BLE_CONN_PDUS_PER_EVENT of them instead. dropped counts
+ * notifications skipped because the queue was full, the host ran out of buffers or the stack reported a failure.
+ * gatt_tx_bytes and coc_tx_bytes count the payload delivered to the host over GATT notifications and over the
+ * L2CAP bulk channel since connected_us, so both transports compare on one central.
+ *
+ */
+typedef struct ble_conn_state_t {
+    uint16_t conn_handle;
+    uint16_t mtu;
+    uint16_t conn_interval;
+    uint16_t conn_latency;
+    uint16_t supervision_timeout;
+    uint8_t tx_phy;
+    uint8_t rx_phy;
+    uint16_t tx_octets;
+    uint16_t tx_time;
+    uint16_t rx_octets;
+    uint16_t rx_time;
+    uint32_t subscriptions;
+    uint16_t queue_depth;
+    int64_t queue_updated_us;
+    uint8_t pending_count;
+    uint16_t pending_handles[BLE_CONN_MAX_PENDING];
+    uint8_t pending_pdus[BLE_CONN_MAX_PENDING];
+    uint32_t dropped;
+    int64_t connected_us;
+    uint32_t gatt_tx_bytes;
+    uint32_t coc_tx_bytes;
+} ble_conn_state_t;
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_conn_add
+ *
+ * @abstract This function starts tracking a new connection with default link parameters
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return Pointer to the record, NULL if the table is full
+ */
+ble_conn_state_t * ble_conn_add(uint16_t conn_handle);
+
+/*
+ * @function ble_conn_remove
+ *
+ * @abstract This function stops tracking a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_conn_remove(uint16_t conn_handle);
+
+/*
+ * @function ble_conn_set_mtu
+ *
+ * @abstract This function records the negotiated ATT MTU
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] mtu: ATT MTU
+ *
+ * @return None
+ */
+void ble_conn_set_mtu(uint16_t conn_handle, uint16_t mtu);
+
+/*
+ * @function ble_conn_set_params
+ *
+ * @abstract This function records the connection parameters
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] interval: Connection interval in 1.25 ms units
+ *
+ * @param[in] latency: Peripheral latency in connection events
+ *
+ * @param[in] supervision_timeout: Supervision timeout in 10 ms units
+ *
+ * @return None
+ */
+void ble_conn_set_params(uint16_t conn_handle, uint16_t interval, uint16_t latency, uint16_t supervision_timeout);
+
+/*
+ * @function ble_conn_set_phy
+ *
+ * @abstract This function records the PHY in use
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] tx_phy: Transmit PHY
+ *
+ * @param[in] rx_phy: Receive PHY
+ *
+ * @return None
+ */
+void ble_conn_set_phy(uint16_t conn_handle, uint8_t tx_phy, uint8_t rx_phy);
+
+/*
+ * @function ble_conn_set_data_length
+ *
+ * @abstract This function records the link-layer data length
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] tx_octets: Maximum transmitted payload
+ *
+ * @param[in] tx_time: Maximum transmit time in microseconds
+ *
+ * @param[in] rx_octets: Maximum received payload
+ *
+ * @param[in] rx_time: Maximum receive time in microseconds
+ *
+ * @return None
+ */
+void ble_conn_set_data_length(uint16_t conn_handle, uint16_t tx_octets, uint16_t tx_time, uint16_t rx_octets,
+                              uint16_t rx_time);
+
+/*
+ * @function ble_conn_set_subscription
+ *
+ * @abstract This function sets or clears subscription bits
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] bits: BLE_CONN_SUB_* bits
+ *
+ * @param[in] enabled: true to set, false to clear
+ *
+ * @return None
+ */
+void ble_conn_set_subscription(uint16_t conn_handle, uint32_t bits, bool enabled);
+
+/*
+ * @function ble_conn_queue_reserve
+ *
+ * @abstract This function books the PDUs of a notification on a connection's queue until its
+ *           BLE_GAP_EVENT_NOTIFY_TX
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] attr_handle: Characteristic value handle the notification is sent on
+ *
+ * @param[in] length: Notification value length
+ *
+ * @return true if the notification may be sent, false if the peer is backlogged; the notification is then
+ *         counted as dropped
+ */
+bool ble_conn_queue_reserve(uint16_t conn_handle, uint16_t attr_handle, uint16_t length);
+
+/*
+ * @function ble_conn_queue_cancel
+ *
+ * @abstract This function returns the PDUs of the last reserved notification when it never reached the host, so no
+ *           completion event follows, and counts it as dropped
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_conn_queue_cancel(uint16_t conn_handle);
+
+/*
+ * @function ble_conn_queue_complete
+ *
+ * @abstract This function returns the PDUs of the oldest reserved notification on a value handle when the stack
+ *           reports it with BLE_GAP_EVENT_NOTIFY_TX, counting it as dropped on failure. Events for notifications
+ *           that were never reserved, or that the fallback drain already released, are ignored.
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] attr_handle: Characteristic value handle
+ *
+ * @param[in] status: Event status, 0 when the notification was sent
+ *
+ * @return None
+ */
+void ble_conn_queue_complete(uint16_t conn_handle, uint16_t attr_handle, int status);
+
+/*
+ * @function ble_conn_list
+ *
+ * @abstract This function lists the connections subscribed to any of the given bits
+ *
+ * @param[in] bits: BLE_CONN_SUB_* bits, 0 lists every connection
+ *
+ * @param[out] handles: Connection handles, BLE_CONN_MAX entries
+ *
+ * @return Number of connections listed
+ */
+size_t ble_conn_list(uint32_t bits, uint16_t * handles);
+
+/*
+ * @function ble_conn_get
+ *
+ * @abstract This function returns a copy of a connection record
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[out] state: Connection record
+ *
+ * @return true if the connection is tracked
+ */
+bool ble_conn_get(uint16_t conn_handle, ble_conn_state_t * state);
+
+/*
+ * @function ble_conn_payload_limit
+ *
+ * @abstract This function returns how many value bytes a notification should carry on a connection: at most
+ *           MTU - 3, rounded down so the packet fills whole link-layer PDUs when it spans several
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return Value bytes, 0 if the connection is not tracked
+ */
+uint16_t ble_conn_payload_limit(uint16_t conn_handle);
+
+/*
+ * @function ble_conn_min_payload_limit
+ *
+ * @abstract This function returns the smallest ble_conn_payload_limit among the subscribers, so one encoding
+ *           fits every one of them
+ *
+ * @param[in] bits: BLE_CONN_SUB_* bits
+ *
+ * @return Value bytes, 0 if nobody is subscribed
+ */
+uint16_t ble_conn_min_payload_limit(uint32_t bits);
+
+/*
+ * @function ble_conn_count_tx
+ *
+ * @abstract This function adds payload bytes handed to the host to the throughput counter of a transport
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] coc: true for the L2CAP bulk channel, false for GATT notifications
+ *
+ * @param[in] bytes: Payload bytes
+ *
+ * @return None
+ */
+void ble_conn_count_tx(uint16_t conn_handle, bool coc, uint32_t bytes);
+
+/*
+ * @function ble_conn_log_all
+ *
+ * @abstract This function logs the link state of every connection
+ *
+ * @param None
+ *
+ * @return None
+ */
+void ble_conn_log_all(void);
+
+/*
+ * @function ble_conn_log
+ *
+ * @abstract This function logs the link state of a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_conn_log(uint16_t conn_handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_CONN_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
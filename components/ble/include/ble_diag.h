@@ -0,0 +1,224 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_diag.h
+  * @brief   This file is the header file for the BLE throughput and latency self-test
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_DIAG_H_
+#define _BLE_DIAG_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Control characteristic operations: [op u8][frame bytes u16][rate Hz u16][duration s u16], little-endian.
+ *            A rate of 0 sends as fast as the link takes frames, a duration of 0 runs until stopped. */
+#define BLE_DIAG_OP_START 0x01
+#define BLE_DIAG_OP_STOP 0x02
+#define BLE_DIAG_OP_RESET 0x03
+#define BLE_DIAG_CONTROL_BYTES 7
+
+/** @abstract Ping characteristic record types, [type u8][id u32] followed by:
+ *            - PING, written by the central: up to 8 bytes of its own timestamp
+ *            - ECHO, notified in reply: the central bytes, device receive and transmit time (uint32 us each)
+ *            - PROBE, notified during a test: device transmit time (uint32 us)
+ *            - PROBE_REPLY, written back by the central: the probe unchanged apart from the type */
+#define BLE_DIAG_PING 0x01
+#define BLE_DIAG_ECHO 0x02
+#define BLE_DIAG_PROBE 0x03
+#define BLE_DIAG_PROBE_REPLY 0x04
+#define BLE_DIAG_PING_HEADER_BYTES 5
+#define BLE_DIAG_PING_STAMP_MAX_BYTES 8
+#define BLE_DIAG_PING_MAX_BYTES (BLE_DIAG_PING_HEADER_BYTES + BLE_DIAG_PING_STAMP_MAX_BYTES + 8)
+
+/** @abstract Synthetic stream frame: [sequence u32][device time u32 us] followed by (sequence + i) & 0xFF filler bytes,
+ *            so the central can check for gaps and corruption */
+#define BLE_DIAG_FRAME_HEADER_BYTES 8
+#define BLE_DIAG_FRAME_MAX_BYTES 244
+
+/** @abstract Frames a paced test lets fall behind before it drops the oldest due ones, like a bounded producer queue */
+#define BLE_DIAG_MAX_BACKLOG 8
+
+/** @abstract Probe period and the time after which an unanswered probe is given up */
+#define BLE_DIAG_PROBE_MS 1000
+
+/** @abstract Round-trip histogram: bin i counts times below 8 ms << i, the last bin everything above */
+#define BLE_DIAG_RTT_BINS 8
+#define BLE_DIAG_RTT_FIRST_BIN_US 8000
+
+/** @abstract Report characteristic value, little-endian:
+ *            [elapsed ms u32][frames sent u32][bytes sent u32][bytes/s u32][frames dropped u32][busy u32]
+ *            [no memory u32][packets per connection event x100 u16][connection interval 1.25 ms u16]
+ *            [rtt count u32][rtt min us u32][rtt mean us u32][rtt max us u32][histogram u16 x BLE_DIAG_RTT_BINS] */
+#define BLE_DIAG_REPORT_BYTES (7 * 4 + 2 * 2 + 4 * 4 + 2 * BLE_DIAG_RTT_BINS)
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Self-test state and counters
+ *
+ * The functions are not thread-safe; the caller serializes the control, transmit and report paths. Times are
+ * passed in, so the encoder runs unchanged off target.
+ *
+ */
+typedef struct ble_diag_t {
+    bool running;
+    uint16_t frame_bytes;
+    uint16_t rate_hz;
+    uint32_t duration_ms;
+    int64_t started_us;
+    int64_t stopped_us;
+    uint32_t sequence;
+    uint32_t frames_sent;
+    uint32_t bytes_sent;
+    uint32_t frames_dropped;
+    uint32_t busy;
+    uint32_t no_memory;
+    uint32_t probe_id;
+    int64_t probe_sent_us;
+    bool probe_pending;
+    uint32_t rtt_count;
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+    uint64_t rtt_sum_us;
+    uint16_t rtt_histogram[BLE_DIAG_RTT_BINS];
+} ble_diag_t;
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_diag_init
+ *
+ * @abstract This function stops a self-test and clears its counters
+ *
+ * @param[out] diag: Self-test
+ *
+ * @return None
+ */
+void ble_diag_init(ble_diag_t * diag);
+
+/*
+ * @function ble_diag_control
+ *
+ * @abstract This function applies a Control characteristic write
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[in] data: Written value
+ *
+ * @param[in] length: Value length
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return false if the value is malformed
+ */
+bool ble_diag_control(ble_diag_t * diag, const uint8_t * data, size_t length, int64_t now_us);
+
+/*
+ * @function ble_diag_next
+ *
+ * @abstract This function encodes the next due frame: a probe once per BLE_DIAG_PROBE_MS, otherwise a stream frame
+ *           when the pacing allows one. Nothing is consumed until ble_diag_sent, a test past its duration stops.
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[out] frame: Frame, BLE_DIAG_FRAME_MAX_BYTES bytes
+ *
+ * @param[in] max_length: Largest frame the link takes
+ *
+ * @param[in] now_us: Current time
+ *
+ * @param[out] probe: Set if the frame is a probe for the Ping characteristic
+ *
+ * @return Frame length, 0 if nothing is due
+ */
+size_t ble_diag_next(ble_diag_t * diag, uint8_t * frame, size_t max_length, int64_t now_us, bool * probe);
+
+/*
+ * @function ble_diag_sent
+ *
+ * @abstract This function accounts for a sent frame ble_diag_next returned
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[in] length: Frame length
+ *
+ * @param[in] probe: Probe flag ble_diag_next returned
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+void ble_diag_sent(ble_diag_t * diag, size_t length, bool probe, int64_t now_us);
+
+/*
+ * @function ble_diag_refused
+ *
+ * @abstract This function counts a frame the link refused, it stays due
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[in] no_memory: Set if the host buffers were exhausted rather than the link queue full
+ *
+ * @return None
+ */
+void ble_diag_refused(ble_diag_t * diag, bool no_memory);
+
+/*
+ * @function ble_diag_ping
+ *
+ * @abstract This function handles a Ping characteristic write: a ping is answered with an echo and a probe reply
+ *           adds a round trip to the histogram
+ *
+ * @param[in,out] diag: Self-test
+ *
+ * @param[in] data: Written record
+ *
+ * @param[in] length: Record length
+ *
+ * @param[out] echo: Echo, BLE_DIAG_PING_MAX_BYTES bytes
+ *
+ * @param[in] rx_us: Time the write arrived
+ *
+ * @param[in] tx_us: Time the echo goes out
+ *
+ * @return Echo length, 0 if nothing is to be sent, -1 if the record is malformed
+ */
+int ble_diag_ping(ble_diag_t * diag, const uint8_t * data, size_t length, uint8_t * echo, int64_t rx_us,
+                  int64_t tx_us);
+
+/*
+ * @function ble_diag_report
+ *
+ * @abstract This function encodes the Report characteristic value
+ *
+ * @param[in] diag: Self-test
+ *
+ * @param[out] report: BLE_DIAG_REPORT_BYTES bytes
+ *
+ * @param[in] conn_interval: Connection interval of the tested link in 1.25 ms units, 0 if unknown
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return Report length
+ */
+size_t ble_diag_report(const ble_diag_t * diag, uint8_t * report, uint16_t conn_interval, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_DIAG_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,308 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_download.h
+  * @brief   This file is the header file for the resumable download of recorded sessions
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_DOWNLOAD_H_
+#define _BLE_DOWNLOAD_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "session_store.h"
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Control characteristic operations, little-endian. Positions are session store log positions, the window
+ *            is the number of records the device sends ahead of the acknowledgements, 1 to BLE_DOWNLOAD_MAX_WINDOW.
+ *            - LIST: [op u8][position u64][window u8], the START and END records from position on
+ *            - READ: [op u8][from ms i64][to ms i64][window u8][level u8], the records of a time range
+ *            - RESUME: [op u8][position u64][to ms i64][window u8][level u8], a READ continued after a lost link
+ *            - ACK: [op u8][position u64], every frame up to that position arrived
+ *            - ABORT: [op u8]
+ *            The level is optional: without it the DATA records are sent, with it the SUMMARY records of that
+ *            session store summary level, so an overview of a night comes first and only the stretches zoomed into
+ *            are read at full rate. */
+#define BLE_DOWNLOAD_OP_LIST 0x01
+#define BLE_DOWNLOAD_OP_READ 0x02
+#define BLE_DOWNLOAD_OP_RESUME 0x03
+#define BLE_DOWNLOAD_OP_ACK 0x04
+#define BLE_DOWNLOAD_OP_ABORT 0x05
+#define BLE_DOWNLOAD_LIST_BYTES 10
+#define BLE_DOWNLOAD_READ_BYTES 18
+#define BLE_DOWNLOAD_ACK_BYTES 9
+#define BLE_DOWNLOAD_CONTROL_MAX_BYTES 19
+
+/** @abstract Level of a download of the DATA records */
+#define BLE_DOWNLOAD_LEVEL_RAW 0xFF
+
+/** @abstract Frame, sent over the L2CAP bulk channel when the downloading central has it open and notified on the
+ *            Download Data characteristic otherwise: [type u8][position u64][offset u16] followed by
+ *            - RECORD: bytes of a session store record from offset on, header included. A record larger than the
+ *              link payload is split over frames of the same position, which is where the next record is read. The
+ *              central acknowledges and resumes at the position of the last record it holds whole.
+ *            - DONE: [BLE_DOWNLOAD_RESULT_* u8], offset 0. Its position is where a RESUME continues.
+ *            Both transports deliver in order without loss while the link holds, so the central only has to drop the
+ *            frames it already holds by position after a retransmission. */
+#define BLE_DOWNLOAD_FRAME_RECORD 0x01
+#define BLE_DOWNLOAD_FRAME_DONE 0x02
+#define BLE_DOWNLOAD_FRAME_HEADER_BYTES 11
+#define BLE_DOWNLOAD_FRAME_MAX_BYTES (BLE_DOWNLOAD_FRAME_HEADER_BYTES + SESSION_STORE_RECORD_HEADER_BYTES + \
+                                      SESSION_STORE_RECORD_MAX_BYTES)
+
+/** @abstract Results: every record up to the end of the range was sent, the log ended before it, the store failed,
+ *            or the download was aborted by the central or the loss of its link */
+#define BLE_DOWNLOAD_RESULT_COMPLETE 0x00
+#define BLE_DOWNLOAD_RESULT_END_OF_LOG 0x01
+#define BLE_DOWNLOAD_RESULT_ERROR 0x02
+#define BLE_DOWNLOAD_RESULT_ABORTED 0x03
+
+/** @abstract States */
+#define BLE_DOWNLOAD_STATE_IDLE 0x00
+#define BLE_DOWNLOAD_STATE_LISTING 0x01
+#define BLE_DOWNLOAD_STATE_READING 0x02
+
+/** @abstract Largest window, records sent but not yet acknowledged */
+#define BLE_DOWNLOAD_MAX_WINDOW 32
+
+/** @abstract Time without an acknowledgement after which the unacknowledged records are sent again */
+#define BLE_DOWNLOAD_ACK_TIMEOUT_MS 2000
+
+/** @abstract Progress indication period while a download runs, state changes are indicated at once */
+#define BLE_DOWNLOAD_STATUS_MS 1000
+
+/** @abstract Memory Status indication value, little-endian: [state u8][last result u8][progress per mille u16]
+ *            [acknowledged position u64][bytes/s u32][retransmissions u32]. It fits the default ATT MTU. */
+#define BLE_DOWNLOAD_STATUS_BYTES 20
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Download state and counters
+ *
+ * One download runs at a time, a new request replaces it. The functions taking a download are not thread-safe; the
+ * caller serializes the control, transmit and status paths. The session store is only touched by ble_download_seek
+ * and ble_download_read, which the caller runs without that lock held. Times are passed in like in ble_diag.
+ *
+ */
+typedef struct ble_download_t {
+    uint8_t state;
+    uint8_t result;
+    uint8_t window;
+    uint8_t level;
+    int64_t from_ms;
+    int64_t to_ms;
+    uint64_t start_position;
+    uint64_t end_position;
+    uint64_t position;
+    uint64_t acked_position;
+    uint64_t sent_position;
+    uint64_t unacked[BLE_DOWNLOAD_MAX_WINDOW];
+    uint8_t unacked_head;
+    uint8_t unacked_count;
+    int64_t ack_wait_us;
+    uint8_t record[SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_RECORD_MAX_BYTES];
+    uint16_t record_length;
+    uint16_t record_offset;
+    bool done_pending;
+    bool done_sent;
+    int64_t started_us;
+    int64_t stopped_us;
+    uint32_t bytes_sent;
+    uint32_t retransmissions;
+    int64_t status_sent_us;
+    uint8_t status_state;
+} ble_download_t;
+
+/** @brief Log positions of a LIST, READ or RESUME request
+ *
+ * position is where the download starts, end_position the block holding the end of the range, which the progress
+ * runs up to.
+ *
+ */
+typedef struct ble_download_seek_t {
+    uint64_t position;
+    uint64_t end_position;
+} ble_download_seek_t;
+
+/** @brief Record read for a download
+ *
+ * The state, level, range and position of the download when the read was due; the download takes the result only if
+ * they still match. next is the position the download moves to, past the record or the records filtered out; done
+ * ends it with result instead of a record.
+ *
+ */
+typedef struct ble_download_read_t {
+    uint8_t state;
+    uint8_t level;
+    int64_t from_ms;
+    int64_t to_ms;
+    uint64_t position;
+    uint64_t next;
+    bool done;
+    uint8_t result;
+    uint8_t record[SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_RECORD_MAX_BYTES];
+    uint16_t record_length;
+} ble_download_read_t;
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_download_init
+ *
+ * @abstract This function stops a download and clears its counters
+ *
+ * @param[out] download: Download
+ *
+ * @return None
+ */
+void ble_download_init(ble_download_t * download);
+
+/*
+ * @function ble_download_seek
+ *
+ * @abstract This function finds the log positions of a LIST, READ or RESUME Control characteristic write. A READ
+ *           seeks to its start through the session store index, so it costs a few page reads however far back the
+ *           range lies. Other values are left to ble_download_control.
+ *
+ * @param[in] data: Written value
+ *
+ * @param[in] length: Value length
+ *
+ * @param[out] seek: Positions
+ *
+ * @return None
+ */
+void ble_download_seek(const uint8_t * data, size_t length, ble_download_seek_t * seek);
+
+/*
+ * @function ble_download_control
+ *
+ * @abstract This function applies a Control characteristic write
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[in] data: Written value
+ *
+ * @param[in] length: Value length
+ *
+ * @param[in] seek: Positions ble_download_seek found for the value, only read for LIST, READ and RESUME
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return false if the value is malformed
+ */
+bool ble_download_control(ble_download_t * download, const uint8_t * data, size_t length,
+                          const ble_download_seek_t * seek, int64_t now_us);
+
+/*
+ * @function ble_download_read_due
+ *
+ * @abstract This function tells whether the next frame needs a record read from the session store: the window has
+ *           room and nothing is waiting to be sent. Records unacknowledged for BLE_DOWNLOAD_ACK_TIMEOUT_MS are read
+ *           and sent again from the last acknowledged position.
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[out] read: Read to run with ble_download_read
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return true if a read is due
+ */
+bool ble_download_read_due(ble_download_t * download, ble_download_read_t * read, int64_t now_us);
+
+/*
+ * @function ble_download_read
+ *
+ * @abstract This function reads the next record a download sends, skipping those outside its range, or finds that
+ *           it ends
+ *
+ * @param[in,out] read: Read ble_download_read_due returned
+ *
+ * @return None
+ */
+void ble_download_read(ble_download_read_t * read);
+
+/*
+ * @function ble_download_next
+ *
+ * @abstract This function encodes the next frame, taking the record of a read if the download needs one and did not
+ *           move on since the read was due. Nothing is consumed until ble_download_sent.
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[in] read: Read done by ble_download_read, NULL if none
+ *
+ * @param[out] frame: Frame, BLE_DOWNLOAD_FRAME_MAX_BYTES bytes
+ *
+ * @param[in] max_length: Largest frame the link takes
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return Frame length, 0 if nothing is due
+ */
+size_t ble_download_next(ble_download_t * download, const ble_download_read_t * read, uint8_t * frame,
+                         size_t max_length, int64_t now_us);
+
+/*
+ * @function ble_download_sent
+ *
+ * @abstract This function accounts for a sent frame ble_download_next returned
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[in] length: Frame length
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return None
+ */
+void ble_download_sent(ble_download_t * download, size_t length, int64_t now_us);
+
+/*
+ * @function ble_download_status_due
+ *
+ * @abstract This function tells whether a Memory Status indication is due: once per BLE_DOWNLOAD_STATUS_MS while a
+ *           download runs and on every state change
+ *
+ * @param[in] download: Download
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return true if ble_download_status should be indicated
+ */
+bool ble_download_status_due(const ble_download_t * download, int64_t now_us);
+
+/*
+ * @function ble_download_status
+ *
+ * @abstract This function encodes the Memory Status indication value and marks it sent
+ *
+ * @param[in,out] download: Download
+ *
+ * @param[out] status: BLE_DOWNLOAD_STATUS_BYTES bytes
+ *
+ * @param[in] now_us: Current time
+ *
+ * @return Status length
+ */
+size_t ble_download_status(ble_download_t * download, uint8_t * status, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_DOWNLOAD_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
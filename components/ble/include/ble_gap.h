@@ -32,16 +32,6 @@ struct ble_gatt_register_ctxt;
 /* Macros ---------------------------------------------------------------------------------------------------*/
 
 /* Variables ------------------------------------------------------------------------------------------------*/
-/** @abstract BLE connection handle */
-extern uint16_t conn_handle;
-/** @abstract Flag storing temperature notifications characteristic subscription state */
-extern uint8_t temperature_notification_enabled;
-/** @abstract Flag storing humidity notifications characteristic subscription state */
-extern uint8_t humidity_notification_enabled;
-/** @abstract Flag storing pressure notifications characteristic subscription state */
-extern uint8_t pressure_notification_enabled;
-/** @abstract Flag storing audio notifications characteristic subscription state */
-extern uint8_t audio_notification_enabled;
 
 /* Functions ------------------------------------------------------------------------------------------------*/
 /*
@@ -16,13 +16,35 @@ extern "C" {
 #endif
 
 /* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdint.h>
 
 /* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief NimBLE msys pool usage of the notification paths */
+typedef struct gatt_svr_mbuf_stats_t {
+    uint32_t allocated;
+    uint32_t alloc_failures;
+    uint32_t returned;
+    uint16_t free_blocks;
+    uint16_t min_free_blocks;
+    uint16_t total_blocks;
+} gatt_svr_mbuf_stats_t;
 
 /* Constants ------------------------------------------------------------------------------------------------*/
 /** @abstract BLE advertise service UUID */
 #define DEVICE_SVR_SVC_UUID 0x0011
 
+/** @abstract Nominal sensor sampling period, sets the implied timestamps of stream frames */
+#define SENSOR_STREAM_PERIOD_MS 100
+
+/** @abstract Longest time a sample waits for its stream frame to fill up */
+#define SENSOR_STREAM_MAX_LATENCY_MS 1000
+
+/** @abstract Audio frames queued while the link is busy */
+#define AUDIO_STREAM_QUEUE_FRAMES 8
+
+/** @abstract Longest audio frame, one data-length-extended PDU without its L2CAP and ATT headers */
+#define AUDIO_STREAM_FRAME_MAX_BYTES 244
+
 /* Macros ---------------------------------------------------------------------------------------------------*/
 
 /* Variables ------------------------------------------------------------------------------------------------*/
@@ -48,48 +70,90 @@ extern uint16_t audio_notify_handle;
 int gatt_svr_init(void);
 
 /*
- * @function send_temperature_notification
+ * @function gatt_svr_get_mbuf_stats
  *
- * @abstract This function is used to send a notification with an information regarding temperature
+ * @abstract This function returns the notification mbuf counters and the current msys pool occupancy
  *
- * @param None
+ * @param[out] stats: mbuf statistics
  *
  * @return None
  */
-void send_temperature_notification(void);
+void gatt_svr_get_mbuf_stats(gatt_svr_mbuf_stats_t * stats);
+
+/*
+ * @function gatt_svr_subscription
+ *
+ * @abstract This function looks up the subscription bit of a characteristic in the dispatch table
+ *
+ * @param[in] attr_handle: Characteristic value handle
+ *
+ * @return BLE_CONN_SUB_* bit, 0 for characteristics without a stream
+ */
+uint32_t gatt_svr_subscription(uint16_t attr_handle);
 
 /*
- * @function send_humidity_notification
+ * @function push_temperature_sample
  *
- * @abstract This function is used to send a notification with an information regarding humidity
+ * @abstract This function queues a temperature sample for the Temperature Stream characteristic. The transmit scheduler
+ *           notifies every subscribed central with delta-encoded batches sized to the negotiated ATT MTU, once a
+ *           batch is full or its oldest sample waited SENSOR_STREAM_MAX_LATENCY_MS.
  *
- * @param  None
+ * @param[in] timestamp_ms: Sample time, ms of the drift-corrected device clock (rtc_now_us)
+ *
+ * @param[in] temperature: Raw temperature in 0.01 degC
  *
  * @return None
  */
-void send_humidity_notification(void);
+void push_temperature_sample(int64_t timestamp_ms, int32_t temperature);
 
 /*
- * @function send_pressure_notification
+ * @function push_humidity_sample
+ *
+ * @abstract This function queues a humidity sample for the Humidity Stream characteristic. The transmit scheduler
+ *           notifies every subscribed central with delta-encoded batches sized to the negotiated ATT MTU, once a
+ *           batch is full or its oldest sample waited SENSOR_STREAM_MAX_LATENCY_MS.
  *
- * @abstract This function is used to send a notification with an information regarding pressure
+ * @param[in] timestamp_ms: Sample time, ms of the drift-corrected device clock (rtc_now_us)
  *
- * @param  None
+ * @param[in] humidity: Raw humidity in Q22.10 %RH
  *
  * @return None
  */
-void send_pressure_notification(void);
+void push_humidity_sample(int64_t timestamp_ms, uint32_t humidity);
 
 /*
- * @function send_audio_notification
+ * @function push_pressure_sample
+ *
+ * @abstract This function queues a pressure sample for the Pressure Stream characteristic. The transmit scheduler
+ *           notifies every subscribed central with delta-encoded batches sized to the negotiated ATT MTU, once a
+ *           batch is full or its oldest sample waited SENSOR_STREAM_MAX_LATENCY_MS.
  *
- * @abstract This function is used to send a notification with an information regarding audio
+ * @param[in] timestamp_ms: Sample time, ms of the drift-corrected device clock (rtc_now_us)
  *
- * @param  None
+ * @param[in] pressure: Raw pressure in Q24.8 Pa
  *
  * @return None
  */
-void send_audio_notification(void);
+void push_pressure_sample(int64_t timestamp_ms, uint32_t pressure);
+
+/*
+ * @function push_audio_frame
+ *
+ * @abstract This function queues an encoded audio frame for the Microphone Stream characteristic and the L2CAP bulk
+ *           channel. The transmit scheduler sends it to every subscribed central and retries while the link or the
+ *           host buffers are full.
+ *
+ * @param[in] data: Encoded audio frame
+ *
+ * @param[in] length: Frame length, at most AUDIO_STREAM_FRAME_MAX_BYTES and the negotiated ATT MTU - 3
+ *
+ * @return
+ *  - 0 if the frame was queued
+ *  - BLE_HS_ENOTCONN if nobody is subscribed and no bulk channel is open
+ *  - BLE_HS_EBUSY if the overload policy refused the frame
+ *  - BLE_HS_EMSGSIZE if the frame is longer than AUDIO_STREAM_FRAME_MAX_BYTES
+ */
+int push_audio_frame(const uint8_t * data, uint16_t length);
 
 #ifdef __cplusplus
 }
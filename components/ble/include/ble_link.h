@@ -0,0 +1,154 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_link.h
+  * @brief   This file is the header file for the link tuning state machine
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_LINK_H_
+#define _BLE_LINK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Tuning steps run after a connection is established */
+typedef enum ble_link_step_t {
+    BLE_LINK_STEP_PHY = 0,
+    BLE_LINK_STEP_PARAMS,
+    BLE_LINK_STEP_READY,
+} ble_link_step_t;
+
+/** @brief Tuning progress of one connection */
+typedef struct ble_link_status_t {
+    ble_link_step_t step;
+    bool streaming_wanted;
+    bool streaming_applied;
+    bool params_pending;
+    bool phy_refused;
+    bool data_length_refused;
+    uint8_t params_refusals;
+} ble_link_status_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Link-layer payload requested with data length extension */
+#define BLE_LINK_TX_OCTETS 251
+
+/** @abstract Link-layer PDU time matching BLE_LINK_TX_OCTETS on the 1M PHY, in microseconds */
+#define BLE_LINK_TX_TIME 2120
+
+/** @abstract Connection parameter requests per mode before the current parameters are accepted */
+#define BLE_LINK_PARAM_ATTEMPTS 2
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * All functions except ble_link_get_status must be called from the NimBLE host task, i.e. from GAP event handling.
+ */
+
+/*
+ * @function ble_link_on_connect
+ *
+ * @abstract This function starts tuning a new connection: 2M PHY and maximum data length first, then the idle
+ *           connection interval
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_link_on_connect(uint16_t conn_handle);
+
+/*
+ * @function ble_link_on_disconnect
+ *
+ * @abstract This function forgets a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @return None
+ */
+void ble_link_on_disconnect(uint16_t conn_handle);
+
+/*
+ * @function ble_link_on_phy_update
+ *
+ * @abstract This function advances tuning once the PHY update procedure finished
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] status: Procedure status
+ *
+ * @return None
+ */
+void ble_link_on_phy_update(uint16_t conn_handle, int status);
+
+/*
+ * @function ble_link_on_data_len_change
+ *
+ * @abstract This function records the outcome of the data length update
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] max_tx_octets: Link-layer payload the controller now transmits
+ *
+ * @return None
+ */
+void ble_link_on_data_len_change(uint16_t conn_handle, uint16_t max_tx_octets);
+
+/*
+ * @function ble_link_on_conn_update
+ *
+ * @abstract This function handles the end of a connection parameter update, ours or the central's
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] status: Procedure status
+ *
+ * @return None
+ */
+void ble_link_on_conn_update(uint16_t conn_handle, int status);
+
+/*
+ * @function ble_link_set_streaming
+ *
+ * @abstract This function selects the short streaming or the long idle connection interval
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[in] streaming: true while the central is subscribed to any stream
+ *
+ * @return None
+ */
+void ble_link_set_streaming(uint16_t conn_handle, bool streaming);
+
+/*
+ * @function ble_link_get_status
+ *
+ * @abstract This function returns the tuning progress of a connection
+ *
+ * @param[in] conn_handle: Connection handle
+ *
+ * @param[out] status: Tuning progress
+ *
+ * @return true if the connection is known
+ */
+bool ble_link_get_status(uint16_t conn_handle, ble_link_status_t * status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_LINK_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
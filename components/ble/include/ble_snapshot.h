@@ -0,0 +1,95 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_snapshot.h
+  * @brief   This file is the header file for the lock-free latest-value store
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_SNAPSHOT_H_
+#define _BLE_SNAPSHOT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Largest value a snapshot holds */
+#define BLE_SNAPSHOT_MAX_BYTES 32
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief One published copy of the value */
+typedef struct ble_snapshot_slot_t {
+    uint8_t length;
+    uint8_t data[BLE_SNAPSHOT_MAX_BYTES];
+} ble_snapshot_slot_t;
+
+/** @brief Double-buffered value guarded by a sequence counter
+ *
+ * A single writer fills the slot readers are not pointed at and then publishes it by advancing the sequence.
+ * Readers never block the writer; they retry only when a new value was published while they were copying, so a
+ * reader preempting the writer mid-update still completes on the first attempt.
+ *
+ */
+typedef struct ble_snapshot_t {
+    uint32_t sequence;
+    ble_snapshot_slot_t slots[2];
+} ble_snapshot_t;
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_snapshot_init
+ *
+ * @abstract This function empties a snapshot
+ *
+ * @param[out] snapshot: Snapshot
+ *
+ * @return None
+ */
+void ble_snapshot_init(ble_snapshot_t * snapshot);
+
+/*
+ * @function ble_snapshot_write
+ *
+ * @abstract This function publishes a new value, it must always be called from the same task
+ *
+ * @param[in,out] snapshot: Snapshot
+ *
+ * @param[in] data: Value
+ *
+ * @param[in] length: Value length, truncated to BLE_SNAPSHOT_MAX_BYTES
+ *
+ * @return None
+ */
+void ble_snapshot_write(ble_snapshot_t * snapshot, const void * data, size_t length);
+
+/*
+ * @function ble_snapshot_read
+ *
+ * @abstract This function copies a consistent value from any task without locking
+ *
+ * @param[in] snapshot: Snapshot
+ *
+ * @param[out] data: Destination buffer, at least BLE_SNAPSHOT_MAX_BYTES long
+ *
+ * @return Value length, 0 if nothing was published yet
+ */
+size_t ble_snapshot_read(const ble_snapshot_t * snapshot, void * data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_SNAPSHOT_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,204 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_stream.h
+  * @brief   This file is the header file for the batched sensor stream encoder
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_STREAM_H_
+#define _BLE_STREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Samples buffered per channel, must be a power of two */
+#define BLE_STREAM_FIFO_SAMPLES 256
+
+/** @abstract Frame header: id, sequence (uint16 LE), base timestamp in epoch ms (int64 LE), sample period in ms
+ *            (uint16 LE), sample count, time quality of the samples (rtc_time_quality), first sample value
+ *            (int32 LE) */
+#define BLE_STREAM_HEADER_BYTES 19
+
+/** @abstract Longest encoded sample delta (zigzag varint of a 32-bit difference) */
+#define BLE_STREAM_MAX_DELTA_BYTES 5
+
+/** @abstract Samples per frame, bounded by the count field */
+#define BLE_STREAM_MAX_FRAME_SAMPLES 255
+
+/** @abstract Largest multiple of the nominal period a frame grid may use, set by decimation */
+#define BLE_STREAM_MAX_PERIOD_MULTIPLE 16
+
+/** @abstract Channel identifiers carried in the first header byte */
+#define BLE_STREAM_ID_TEMPERATURE 0x01
+#define BLE_STREAM_ID_HUMIDITY 0x02
+#define BLE_STREAM_ID_PRESSURE 0x03
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Timestamped raw sensor sample, quality tells how far its timestamp can be trusted */
+typedef struct ble_stream_sample_t {
+    int64_t timestamp_ms;
+    int32_t value;
+    uint8_t quality;
+} ble_stream_sample_t;
+
+/** @brief Sample FIFO and frame state of one stream characteristic
+ *
+ * All functions must be called from the same task or under the same lock; readers in other tasks go through a
+ * ble_snapshot_t.
+ *
+ */
+typedef struct ble_stream_channel_t {
+    uint8_t id;
+    uint16_t period_ms;
+    uint16_t sequence;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t dropped;
+    bool latest_valid;
+    ble_stream_sample_t latest;
+    ble_stream_sample_t samples[BLE_STREAM_FIFO_SAMPLES];
+} ble_stream_channel_t;
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_stream_init
+ *
+ * @abstract This function resets a stream channel
+ *
+ * @param[out] channel: Channel
+ *
+ * @param[in] id: Channel identifier
+ *
+ * @param[in] period_ms: Nominal sampling period; samples off the grid by more than half of it start a new frame
+ *
+ * @return None
+ */
+void ble_stream_init(ble_stream_channel_t * channel, uint8_t id, uint16_t period_ms);
+
+/*
+ * @function ble_stream_push
+ *
+ * @abstract This function appends a sample, dropping the oldest one when the FIFO is full
+ *
+ * @param[in,out] channel: Channel
+ *
+ * @param[in] timestamp_ms: Sample time
+ *
+ * @param[in] value: Raw sample value
+ *
+ * @param[in] quality: Time quality of the timestamp
+ *
+ * @return None
+ */
+void ble_stream_push(ble_stream_channel_t * channel, int64_t timestamp_ms, int32_t value, uint8_t quality);
+
+/*
+ * @function ble_stream_observe
+ *
+ * @abstract This function records a sample as the latest one without queuing it
+ *
+ * @param[in,out] channel: Channel
+ *
+ * @param[in] timestamp_ms: Sample time
+ *
+ * @param[in] value: Raw sample value
+ *
+ * @param[in] quality: Time quality of the timestamp
+ *
+ * @return None
+ */
+void ble_stream_observe(ble_stream_channel_t * channel, int64_t timestamp_ms, int32_t value, uint8_t quality);
+
+/*
+ * @function ble_stream_pending
+ *
+ * @abstract This function returns the number of samples waiting to be sent
+ *
+ * @param[in] channel: Channel
+ *
+ * @return Number of samples
+ */
+size_t ble_stream_pending(const ble_stream_channel_t * channel);
+
+/*
+ * @function ble_stream_encode
+ *
+ * @abstract This function encodes the oldest pending samples into one frame without consuming them. The frame
+ *           period is the nominal one, or a multiple of it when the first two samples are that far apart. A change
+ *           of the time quality starts the next frame.
+ *
+ * @param[in] channel: Channel
+ *
+ * @param[out] frame: Destination buffer, NULL only sizes the frame
+ *
+ * @param[in] max_length: Frame size limit, at least BLE_STREAM_HEADER_BYTES
+ *
+ * @param[out] count: Number of samples encoded
+ *
+ * @param[out] full: Set when no further sample would fit the frame
+ *
+ * @return Frame length, 0 if nothing is pending
+ */
+size_t ble_stream_encode(const ble_stream_channel_t * channel, uint8_t * frame, size_t max_length, size_t * count,
+                         bool * full);
+
+/*
+ * @function ble_stream_age_ms
+ *
+ * @abstract This function returns how long the oldest pending sample has been waiting
+ *
+ * @param[in] channel: Channel
+ *
+ * @param[in] now_ms: Current time on the clock of the sample timestamps
+ *
+ * @return Age in milliseconds, 0 if nothing is pending, UINT32_MAX when the clock stepped back past the sample
+ */
+uint32_t ble_stream_age_ms(const ble_stream_channel_t * channel, int64_t now_ms);
+
+/*
+ * @function ble_stream_encode_latest
+ *
+ * @abstract This function encodes the most recent sample as a single-sample frame
+ *
+ * @param[in] channel: Channel
+ *
+ * @param[out] frame: Destination buffer, at least BLE_STREAM_HEADER_BYTES long
+ *
+ * @return Frame length, 0 if no sample was pushed yet
+ */
+size_t ble_stream_encode_latest(const ble_stream_channel_t * channel, uint8_t * frame);
+
+/*
+ * @function ble_stream_consume
+ *
+ * @abstract This function drops samples that were sent and advances the frame sequence number
+ *
+ * @param[in,out] channel: Channel
+ *
+ * @param[in] count: Number of samples returned by ble_stream_encode
+ *
+ * @return None
+ */
+void ble_stream_consume(ble_stream_channel_t * channel, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_STREAM_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,93 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_time.h
+  * @brief   This file is the header file for the BLE clock synchronization exchange
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_TIME_H_
+#define _BLE_TIME_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stddef.h>
+#include <stdint.h>
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Time Sync characteristic records, [op u8][sequence u8] followed by, little-endian, times in us since
+ *            the epoch:
+ *            - REQUEST, written by the central: its time t1 when it sent the write (int64)
+ *            - RESPONSE, notified in reply: device receive time t2 and transmit time t3 (int64 each)
+ *            - COMPLETE, written by the central: its time t4 when the response arrived (int64)
+ *            - RESULT, notified in reply: device clock offset (int64), round trip (uint32) and BLE_TIME_RESULT_*
+ *            A central runs a burst of exchanges, the device applies those with the shortest round trips. */
+#define BLE_TIME_OP_REQUEST 0x01
+#define BLE_TIME_OP_RESPONSE 0x02
+#define BLE_TIME_OP_COMPLETE 0x03
+#define BLE_TIME_OP_RESULT 0x04
+#define BLE_TIME_WRITE_BYTES 10
+#define BLE_TIME_REPLY_MAX_BYTES 18
+
+/** @abstract RESULT flags */
+#define BLE_TIME_RESULT_APPLIED 0x01
+#define BLE_TIME_RESULT_STEPPED 0x02
+
+/** @abstract Time Sync characteristic value read, little-endian:
+ *            [flags u8, bit 0 clock set][device time us i64][esp_timer us i64][last offset us i64][last rtt us u32]
+ *            [syncs u32][skew ppb i32]. Device time and esp_timer are taken together, so a central can relate
+ *            esp_timer based diagnostics to the device clock. */
+#define BLE_TIME_STATUS_BYTES (1 + 3 * 8 + 3 * 4)
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * Both functions must be called from the NimBLE host task.
+ */
+
+/*
+ * @function ble_time_write
+ *
+ * @abstract This function handles a Time Sync characteristic write: a request is answered with the device receive
+ *           and transmit times, a completion of the pending request is applied to the device clock
+ *
+ * @param[in] data: Written record
+ *
+ * @param[in] length: Record length
+ *
+ * @param[in] rx_us: Device time, rtc_now_us(), the write arrived
+ *
+ * @param[out] reply: Reply, BLE_TIME_REPLY_MAX_BYTES bytes
+ *
+ * @return Reply length, -1 if the record is malformed or completes no pending request
+ */
+int ble_time_write(const uint8_t * data, size_t length, int64_t rx_us, uint8_t * reply);
+
+/*
+ * @function ble_time_status
+ *
+ * @abstract This function encodes the Time Sync characteristic value
+ *
+ * @param[out] status: BLE_TIME_STATUS_BYTES bytes
+ *
+ * @return Value length
+ */
+size_t ble_time_status(uint8_t * status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_TIME_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,197 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_tx.h
+  * @brief   This file is the header file for the BLE notification transmit scheduler
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BLE_TX_H_
+#define _BLE_TX_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/*
+ * @abstract Sends the next ready notification of a source
+ *
+ * @return 0 if a notification was sent, BLE_HS_EAGAIN if nothing is ready, BLE_HS_ENOTCONN without subscribers,
+ *         BLE_HS_EBUSY or BLE_HS_ENOMEM when the link or the host buffers are full
+ */
+typedef int (* ble_tx_send_t)(void * context);
+
+/** @brief Queue and loss counters of one source
+ *
+ * depth and peak_depth count queued items against capacity. dropped_oldest counts items the full queue
+ * overwrote, decimated and paused_dropped count items the overload policy refused. busy and no_memory count
+ * send attempts refused by the backpressure estimate and by the host buffer pool, each retried later.
+ *
+ */
+typedef struct ble_tx_stats_t {
+    const char * name;
+    uint32_t sent;
+    uint32_t busy;
+    uint32_t no_memory;
+    uint32_t dropped_oldest;
+    uint32_t decimated;
+    uint32_t paused_dropped;
+    uint32_t overloads;
+    uint32_t depth;
+    uint32_t peak_depth;
+    uint32_t capacity;
+    uint8_t decimation;
+    bool paused;
+    bool subscribed;
+} ble_tx_stats_t;
+
+/** @brief Notification source served by the scheduler */
+typedef struct ble_tx_source_t {
+    ble_tx_send_t send;
+    void * context;
+    int64_t overload_since_us;
+    uint32_t decimation_phase;
+    ble_tx_stats_t stats;
+} ble_tx_source_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Overload policies */
+#define BLE_TX_POLICY_DROP_OLDEST 0
+#define BLE_TX_POLICY_DECIMATE 1
+#define BLE_TX_POLICY_PAUSE 2
+
+/** @abstract Policy applied once a queue stays above BLE_TX_OVERLOAD_PERCENT for BLE_TX_OVERLOAD_MS: keep queuing and
+ *            let the full queue overwrite its oldest items, halve the accepted rate again every BLE_TX_OVERLOAD_MS,
+ *            or refuse new items until the queue drained */
+#define BLE_TX_OVERLOAD_POLICY BLE_TX_POLICY_DECIMATE
+
+/** @abstract Queue occupancy that starts the overload timer, in percent of the capacity */
+#define BLE_TX_OVERLOAD_PERCENT 75
+
+/** @abstract Queue occupancy that ends an overload, in percent of the capacity */
+#define BLE_TX_RECOVER_PERCENT 25
+
+/** @abstract Time a queue must stay above BLE_TX_OVERLOAD_PERCENT before the policy acts */
+#define BLE_TX_OVERLOAD_MS 2000
+
+/** @abstract Largest decimation factor, a power of two */
+#define BLE_TX_MAX_DECIMATION 8
+
+/** @abstract Bounds of the retry delay after the link or the host buffers refused a notification */
+#define BLE_TX_RETRY_MIN_MS 8
+#define BLE_TX_RETRY_MAX_MS 500
+
+/** @abstract Scheduler wake-up period without a kick, bounds the latency of time-based batches */
+#define BLE_TX_IDLE_MS 100
+
+/** @abstract Notifications one source may send before the next source gets its turn */
+#define BLE_TX_BURST 4
+
+/** @abstract Sources the scheduler serves */
+#define BLE_TX_MAX_SOURCES 8
+
+/** @abstract Scheduler task configuration */
+#define BLE_TX_TASK_STACK_SIZE 3072
+#define BLE_TX_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function ble_tx_register
+ *
+ * @abstract This function adds a notification source, before ble_tx_start
+ *
+ * @param[out] source: Source, must stay valid
+ *
+ * @param[in] name: Name used in logs
+ *
+ * @param[in] send: Send callback, called from the scheduler task
+ *
+ * @param[in] context: Send callback argument
+ *
+ * @param[in] capacity: Items the source queues at most
+ *
+ * @return true on success, false if BLE_TX_MAX_SOURCES are registered
+ */
+bool ble_tx_register(ble_tx_source_t * source, const char * name, ble_tx_send_t send, void * context,
+                     uint32_t capacity);
+
+/*
+ * @function ble_tx_start
+ *
+ * @abstract This function starts the scheduler task
+ *
+ * @param None
+ *
+ * @return true on success
+ */
+bool ble_tx_start(void);
+
+/*
+ * @function ble_tx_kick
+ *
+ * @abstract This function wakes the scheduler, after new data was queued or the link may have room again
+ *
+ * @param None
+ *
+ * @return None
+ */
+void ble_tx_kick(void);
+
+/*
+ * @function ble_tx_admit
+ *
+ * @abstract This function applies the overload policy to an item about to be queued
+ *
+ * @param[in,out] source: Source
+ *
+ * @param[in] depth: Items queued before this one
+ *
+ * @return true if the item should be queued
+ */
+bool ble_tx_admit(ble_tx_source_t * source, uint32_t depth);
+
+/*
+ * @function ble_tx_dropped_oldest
+ *
+ * @abstract This function counts items the full queue of a source overwrote
+ *
+ * @param[in,out] source: Source
+ *
+ * @param[in] count: Items lost
+ *
+ * @return None
+ */
+void ble_tx_dropped_oldest(ble_tx_source_t * source, uint32_t count);
+
+/*
+ * @function ble_tx_get_stats
+ *
+ * @abstract This function returns the counters of a registered source
+ *
+ * @param[in] index: Registration index
+ *
+ * @param[out] stats: Counters
+ *
+ * @return false if no source has that index
+ */
+bool ble_tx_get_stats(size_t index, ble_tx_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BLE_TX_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,208 @@
+/**
+  **********************************************************************************************************************
+  * @file    breath_classifier.c
+  * @brief   This file is the on-device breath pattern classifier implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "breath_classifier.h"
+#include "breath_model.h"
+#include "nn_int8.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Raw sample kept in the feature window */
+typedef struct breath_sample_t {
+    int32_t temperature;
+    int32_t humidity;
+    int32_t pressure;
+} breath_sample_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "BREATH_CLASSIFIER";
+
+/** @abstract Circular window of raw samples */
+static breath_sample_t window_samples[BREATH_MODEL_WINDOW_LENGTH];
+
+/** @abstract Index of the next sample to overwrite */
+static uint16_t window_head = 0;
+
+/** @abstract Number of valid samples in the window */
+static uint16_t window_count = 0;
+
+/** @abstract Samples pushed since the last classification */
+static uint16_t samples_since_run = 0;
+
+/** @abstract Most recent classification result */
+static breath_class_t last_label = BREATH_CLASS_NORMAL;
+
+/** @abstract Flag storing whether last_label holds a result */
+static bool last_label_valid = false;
+
+/** @abstract Printable class names */
+static const char * const label_names[BREATH_MODEL_CLASSES] = {
+    "normal",
+    "shallow",
+    "deep",
+    "cough",
+};
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function quantizeFeature
+ *
+ * @abstract This function scales a detrended sample to int8 with saturation
+ *
+ * @param[in] value: Detrended value
+ *
+ * @param[in] shift: Right shift
+ *
+ * @return Quantized feature
+ */
+static int8_t quantizeFeature(int32_t value, uint8_t shift);
+
+/*
+ * @function buildInputWindow
+ *
+ * @abstract This function converts the circular sample window to the time-ordered int8 model input
+ *
+ * @param[out] input: Model input [BREATH_MODEL_WINDOW_LENGTH][BREATH_MODEL_CHANNELS]
+ *
+ * @return None
+ */
+static void buildInputWindow(int8_t * input);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int8_t quantizeFeature(int32_t value, uint8_t shift) {
+    value >>= shift;
+
+    if (value > INT8_MAX) {
+        return INT8_MAX;
+    }
+    if (value < INT8_MIN) {
+        return INT8_MIN;
+    }
+
+    return (int8_t)value;
+}
+
+static void buildInputWindow(int8_t * input) {
+    int64_t sum_temperature = 0;
+    int64_t sum_humidity = 0;
+    int64_t sum_pressure = 0;
+
+    for (uint16_t i = 0; i < BREATH_MODEL_WINDOW_LENGTH; i++) {
+        sum_temperature += window_samples[i].temperature;
+        sum_humidity += window_samples[i].humidity;
+        sum_pressure += window_samples[i].pressure;
+    }
+
+    /* Remove the slow baseline so the model only sees the breathing component */
+    const int32_t mean_temperature = (int32_t)(sum_temperature / BREATH_MODEL_WINDOW_LENGTH);
+    const int32_t mean_humidity = (int32_t)(sum_humidity / BREATH_MODEL_WINDOW_LENGTH);
+    const int32_t mean_pressure = (int32_t)(sum_pressure / BREATH_MODEL_WINDOW_LENGTH);
+
+    for (uint16_t t = 0; t < BREATH_MODEL_WINDOW_LENGTH; t++) {
+        const breath_sample_t * sample = &window_samples[(window_head + t) % BREATH_MODEL_WINDOW_LENGTH];
+        int8_t * row = &input[t * BREATH_MODEL_CHANNELS];
+
+        row[0] = quantizeFeature(sample->temperature - mean_temperature, BREATH_CLASSIFIER_TEMPERATURE_SHIFT);
+        row[1] = quantizeFeature(sample->humidity - mean_humidity, BREATH_CLASSIFIER_HUMIDITY_SHIFT);
+        row[2] = quantizeFeature(sample->pressure - mean_pressure, BREATH_CLASSIFIER_PRESSURE_SHIFT);
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+bool breath_classifier_push_sample(int32_t temperature, uint32_t humidity, uint32_t pressure, breath_class_t * label) {
+    int8_t input[BREATH_MODEL_WINDOW_LENGTH * BREATH_MODEL_CHANNELS];
+    int8_t logits[BREATH_MODEL_CLASSES];
+
+    window_samples[window_head].temperature = temperature;
+    window_samples[window_head].humidity = (int32_t)humidity;
+    window_samples[window_head].pressure = (int32_t)pressure;
+    window_head = (window_head + 1) % BREATH_MODEL_WINDOW_LENGTH;
+
+    if (window_count < BREATH_MODEL_WINDOW_LENGTH) {
+        window_count++;
+    }
+    samples_since_run++;
+
+    if (window_count < BREATH_MODEL_WINDOW_LENGTH || samples_since_run < BREATH_CLASSIFIER_HOP) {
+        return false;
+    }
+    samples_since_run = 0;
+
+    buildInputWindow(input);
+
+    if (nn_int8_run(&breath_model, input, logits) != 0) {
+        ESP_LOGE(TAG, "Model does not fit the inference arena");
+        return false;
+    }
+
+    last_label = (breath_class_t)nn_int8_argmax(logits, BREATH_MODEL_CLASSES);
+
+    /* Keep running inference for timing, but never report a label computed from placeholder parameters */
+    if (!BREATH_MODEL_TRAINED) {
+        return false;
+    }
+    last_label_valid = true;
+    *label = last_label;
+
+    return true;
+}
+
+bool breath_classifier_get_last_label(breath_class_t * label) {
+    if (last_label_valid) {
+        *label = last_label;
+    }
+
+    return last_label_valid;
+}
+
+const char * breath_classifier_label_name(breath_class_t label) {
+    if ((uint32_t)label >= BREATH_MODEL_CLASSES) {
+        return "unknown";
+    }
+
+    return label_names[label];
+}
+
+bool breath_classifier_benchmark(uint32_t iterations) {
+    int8_t input[BREATH_MODEL_WINDOW_LENGTH * BREATH_MODEL_CHANNELS];
+    nn_benchmark_t result;
+
+    /* Synthetic breathing-like ramp covering the full int8 range on every channel */
+    for (uint16_t i = 0; i < sizeof(input); i++) {
+        input[i] = (int8_t)((i * 37) & 0xFF);
+    }
+
+    nn_int8_benchmark(&breath_model, input, iterations, &result);
+
+    ESP_LOGI(TAG, "Benchmark: %lu iterations, reference %lu inf/s, %s %lu inf/s, bit-exact: %s",
+             (unsigned long)result.iterations,
+             (unsigned long)result.reference_inferences_per_s,
+             NN_INT8_HAS_SIMD ? "SIMD" : "SIMD (unavailable, reference)",
+             (unsigned long)result.simd_inferences_per_s,
+             result.bit_exact ? "yes" : "NO");
+    ESP_LOGI(TAG, "Peak RAM: arena %u B of %u B, window %u B, stack high water mark %u B",
+             (unsigned)result.peak_arena_bytes,
+             (unsigned)NN_INT8_ARENA_SIZE,
+             (unsigned)sizeof(window_samples),
+             (unsigned)uxTaskGetStackHighWaterMark(NULL));
+
+    return result.bit_exact;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
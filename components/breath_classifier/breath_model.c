@@ -0,0 +1,263 @@
+/**
+  **********************************************************************************************************************
+  * @file    breath_model.c
+  * @brief   This file holds the quantized breath pattern model parameters
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  *
+  * The parameters below are placeholders with the final layer shapes and scales. They keep the firmware, the
+  * benchmark and the bit-exactness check running until the trained network is exported in the same layout:
+  * symmetric int8 weights, rows ordered [kernel][channel] and zero-padded to NN_INT8_ALIGN bytes, int32 bias and
+  * a Q31 multiplier with an extra right shift per layer.
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include "breath_model.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract conv1 weights [8][16] */
+static const int8_t breath_model_conv1_weights[8 * 16] __attribute__((aligned(NN_INT8_ALIGN))) = {
+    1, -20, -33, 24, 4, 56, -11, -46, -64, -32, 57, -53, -6, 48, -28, 0,
+    -52, -12, 16, 13, -53, 46, -21, -16, 34, -50, 53, 62, 31, 7, 43, 0,
+    -12, 41, -18, 30, -15, -33, -27, -52, -41, 13, 14, 32, 7, 43, -38, 0,
+    59, 43, -37, -17, -9, 41, 55, 59, -18, 64, -55, 52, 28, -15, -39, 0,
+    -56, -28, 31, 28, 6, 10, 24, 48, -4, -48, -62, -49, 1, 55, -53, 0,
+    -59, 27, -45, 5, 58, -9, -32, 21, -29, 11, 11, -13, -36, -38, 20, 0,
+    3, 38, -39, -21, 52, -51, 15, -48, 48, 47, -20, -33, -37, 45, 48, 0,
+    45, -43, 37, -43, 3, 10, 60, -34, 45, 23, 23, -7, 31, 64, 29, 0,
+};
+
+/** @abstract conv1 bias */
+static const int32_t breath_model_conv1_bias[8] = {
+    115, 176, 114, -169, 188, -134, 20, 136,
+};
+
+/** @abstract conv2 weights [16][32] */
+static const int8_t breath_model_conv2_weights[16 * 32] __attribute__((aligned(NN_INT8_ALIGN))) = {
+    -47, -7, 43, -24, 44, 0, 51, 34, 52, 13, -20, -39, 64, -34, 35, -3,
+    31, -30, 16, 3, 1, -9, -19, 38, 0, 0, 0, 0, 0, 0, 0, 0,
+    10, -32, -14, 27, 4, -50, 45, 32, 36, 17, 37, -56, 45, -61, -57, 17,
+    -48, 37, -20, -53, -40, 39, 7, -61, 0, 0, 0, 0, 0, 0, 0, 0,
+    -50, -36, -11, 20, 54, -5, 54, 59, -52, -28, 3, -32, -35, -40, -56, 33,
+    54, -7, 28, -51, -9, 38, 21, -45, 0, 0, 0, 0, 0, 0, 0, 0,
+    16, 58, 29, 42, -39, 25, -62, 17, 45, 17, -64, -8, 16, -44, -35, 59,
+    24, 3, -46, -4, -40, 16, 45, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    -26, -54, -41, 4, 38, -22, 58, 7, -1, -19, -61, 63, 39, 21, 52, 14,
+    40, 34, 58, 50, 6, -21, 26, -55, 0, 0, 0, 0, 0, 0, 0, 0,
+    4, 22, -53, 47, -40, -2, -24, 47, 53, -60, 34, 30, -16, 39, 60, 46,
+    62, -29, -39, -2, -27, -62, -27, -12, 0, 0, 0, 0, 0, 0, 0, 0,
+    -56, 4, 7, 17, -42, -33, -3, 8, 36, 48, -3, -50, -61, 5, -59, -19,
+    4, -38, 50, 50, 7, 38, -2, 7, 0, 0, 0, 0, 0, 0, 0, 0,
+    20, 9, -60, -12, 43, -50, -28, -27, 14, 52, 23, 48, -58, 10, -46, -9,
+    3, -57, -34, 3, 59, 49, 49, 55, 0, 0, 0, 0, 0, 0, 0, 0,
+    54, 36, -16, -29, 11, -47, -38, 22, -41, 28, 41, -35, 29, -46, 46, 18,
+    53, -32, -8, 39, -16, 8, -31, -2, 0, 0, 0, 0, 0, 0, 0, 0,
+    -55, -34, 10, -60, -50, 13, 8, -41, -6, 12, 46, 53, -6, -61, -37, 63,
+    -50, -59, 29, 11, 58, 2, -58, -49, 0, 0, 0, 0, 0, 0, 0, 0,
+    -48, 28, -21, 1, 61, 54, 27, -10, -14, 17, -24, -37, -63, -30, -26, -12,
+    -29, 3, -36, -31, 5, -27, 58, -3, 0, 0, 0, 0, 0, 0, 0, 0,
+    59, 62, 0, -20, -51, 12, -45, -42, -59, -57, 18, -44, 39, -15, 60, -57,
+    18, -39, -5, 35, 21, -40, 63, 21, 0, 0, 0, 0, 0, 0, 0, 0,
+    11, -59, 10, -7, -37, -41, -10, 4, 25, -15, 0, 9, 3, 32, 5, 21,
+    -2, 58, -52, 8, 45, 31, -48, -35, 0, 0, 0, 0, 0, 0, 0, 0,
+    -50, -29, 6, -43, 41, -6, 8, -56, 48, -13, 17, 21, -31, 46, -47, 47,
+    49, 48, -1, 22, 25, 60, -41, 31, 0, 0, 0, 0, 0, 0, 0, 0,
+    -3, 42, -38, -37, -48, 30, -57, 45, 9, -60, 22, 3, 22, 20, 47, -64,
+    48, 64, -16, -62, -34, 25, -4, 6, 0, 0, 0, 0, 0, 0, 0, 0,
+    -49, -42, -56, -52, 26, 59, 2, 50, -64, -61, -32, -12, -11, -49, -57, -40,
+    -61, -12, -2, 48, -58, -20, 34, 60, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+/** @abstract conv2 bias */
+static const int32_t breath_model_conv2_bias[16] = {
+    140, 174, 206, 32, -84, -182, -5, -22,
+    14, 69, -188, 249, -6, 207, -190, -31,
+};
+
+/** @abstract dense1 weights [16][96] */
+static const int8_t breath_model_dense1_weights[16 * 96] __attribute__((aligned(NN_INT8_ALIGN))) = {
+    27, 32, 32, 32, -18, 5, 54, 25, 63, 37, 47, -13, -6, 10, 24, -12,
+    50, 55, 62, -25, 5, 42, 52, -40, 13, 40, 39, 3, -36, 55, -10, -10,
+    -63, 48, 13, -1, -22, 52, -41, -59, 1, -55, 42, 34, 14, 33, -5, -20,
+    45, -35, -49, -45, 24, 31, 25, -50, 60, -16, 9, 6, -1, 63, 35, 53,
+    -34, 13, -37, 0, 46, -39, 47, 10, -48, -35, -49, -31, 16, 11, 44, 20,
+    -59, -27, -24, -48, 9, -56, -35, -4, 48, 46, 44, 9, -1, -40, -26, 47,
+    -15, 13, 28, -61, -14, 35, -62, -12, -12, -23, 27, -38, 37, -2, -22, -9,
+    12, 3, 62, 55, 45, -48, -20, -17, 45, 4, -63, -41, -46, 55, -48, -37,
+    -36, -35, 55, -6, -30, -31, 55, 42, 13, 53, 55, -42, -52, -55, 42, -63,
+    6, 33, 6, 25, 42, 59, 41, -55, -2, -34, 49, -59, 59, 46, 9, -37,
+    -37, -33, -40, 47, -46, 24, -12, -7, -10, 32, -48, 17, 40, -9, -33, 35,
+    25, 30, 45, -22, 34, -22, -31, 37, 15, -35, 46, 33, 28, -59, 49, 21,
+    -53, 47, 37, 5, -31, 24, -12, 35, -46, 36, -23, 5, -27, 56, 31, -52,
+    -27, 23, -31, 62, -45, 22, 46, -25, -18, -19, 18, 3, 12, -18, -46, 39,
+    44, -32, -62, 36, 15, -24, 43, -15, 19, -19, -38, 35, -8, 22, -28, -32,
+    24, -38, -28, 49, -4, -42, -2, 54, -4, -42, -15, -58, -9, -7, -17, 17,
+    -53, -2, 23, -62, 62, 23, 8, 25, 9, 30, -25, 35, 25, 19, 26, -64,
+    41, -52, -17, 47, 46, 64, -32, -30, 35, -14, -31, 42, -36, 60, 31, 7,
+    -38, -29, -62, -17, -19, -20, 53, 21, 62, -11, 61, -62, 37, -60, 32, 55,
+    -59, 7, -42, -33, 35, -7, -5, -56, 30, -56, -46, -1, 1, -3, 31, 31,
+    21, -41, 8, 43, -11, -9, 18, -8, -15, 28, 5, -17, -39, 49, 48, 11,
+    -51, 36, -21, -52, 57, -54, -20, -37, -56, -34, -24, -37, -40, 40, 45, 49,
+    -27, 36, -35, 24, 39, 33, 45, -24, -16, 1, -29, 28, 8, -10, -53, -7,
+    -22, -19, -57, -47, 43, -50, 61, 37, -38, 38, 39, 33, -58, 64, -6, 59,
+    51, -12, -10, 20, -19, 3, -44, -46, 12, 39, -29, 43, 0, -36, -45, 59,
+    48, -52, 48, -47, 52, 20, 49, -2, -47, 1, -23, -47, 4, -15, -38, 15,
+    33, 37, 28, -8, 40, 6, -41, 64, 22, 28, 58, 58, -40, 55, -18, 46,
+    -34, -4, -41, -33, -26, 51, -47, 58, 36, -64, 36, -28, -64, 50, -57, 29,
+    53, -1, -4, 54, -40, -53, 63, -40, 9, -59, -43, 46, 14, 63, -15, -60,
+    -57, -28, -57, 36, 12, 12, -27, 13, 10, -46, -21, -27, -21, -27, 55, -53,
+    -63, 24, -1, 5, 1, -49, -34, -33, 20, 48, 11, 11, 47, -9, -64, 30,
+    -55, 64, -53, 26, 6, 22, -45, -42, 52, -32, 56, 22, -63, -34, -54, 44,
+    -40, 59, 36, -23, -33, 58, 47, 33, 20, 23, -20, 50, 14, -3, 49, -59,
+    19, -5, -25, 8, 4, -33, 16, 24, 64, 20, -39, -9, 15, -18, 55, 59,
+    56, -10, -14, -25, 28, 9, 45, 15, -54, 7, 57, -19, 13, -7, -31, -41,
+    17, 29, 46, 8, -38, 34, 19, 17, 8, 3, -9, 30, 64, 11, 23, -18,
+    -28, 35, 57, 20, 16, 6, -31, 55, -15, 40, 8, 20, 22, 37, -24, -31,
+    -56, 30, -40, -9, -33, -49, 52, -17, -6, 46, 28, 26, -17, -1, 51, -13,
+    17, 6, 59, -56, -58, 25, -23, 40, 57, 55, -47, 13, 35, 3, -33, -39,
+    -7, -18, 49, -44, -36, -36, -16, -59, 18, -51, 54, 41, 61, 53, -45, 26,
+    58, 45, -26, 43, -27, 42, -17, 45, 8, -30, -57, 0, 33, -43, -52, 44,
+    55, -38, 41, 44, 28, 49, -21, 35, 20, 32, 42, 10, 34, 5, -6, -6,
+    17, 22, 49, 41, -55, 11, 48, 52, 40, 0, -40, -47, 64, -19, 60, -16,
+    28, 12, 22, 48, 1, -9, 0, 15, -48, 6, -1, -3, -46, -29, -44, -48,
+    55, -12, -40, -3, -39, 62, -11, 12, -18, 24, 53, -63, -56, -43, 53, 22,
+    62, -30, 2, -44, 42, 51, -33, 2, -31, 49, 53, -59, -34, 49, 10, 60,
+    -57, -50, -51, 37, -44, 34, -8, -40, -2, -45, -22, -6, 38, -19, 30, -27,
+    -47, 60, -16, -14, -10, 37, -28, 11, -19, -44, -18, -50, 27, 9, -64, 10,
+    -18, 3, -56, 36, 0, -27, -17, -43, -46, -11, 7, 0, -17, 10, -62, 53,
+    28, 58, 16, -51, -46, -46, 49, -40, -20, 9, -61, 15, 7, 15, -60, 17,
+    -43, 37, -61, 37, -43, -36, 56, -58, -56, -2, -31, 36, 63, 39, -48, -58,
+    -20, 12, -59, -38, 6, 8, 35, 28, -56, -45, 40, -25, -15, -24, 56, 33,
+    20, 39, -40, -64, 41, -26, 45, 44, -36, 32, -24, 57, 18, -5, -62, 23,
+    -63, 22, -3, -60, 32, 5, 40, -11, -1, 59, 8, 57, 64, 9, 0, -5,
+    -50, -54, 58, -64, 62, 31, -45, -18, -16, -63, -64, 19, 58, -17, -35, -60,
+    -50, 1, -36, 31, 12, 34, -44, 60, 57, 51, -4, 10, 58, 64, 41, 34,
+    42, -41, -15, -9, 50, 57, 51, 51, -2, -11, -39, 8, -29, -1, -12, 1,
+    -26, -51, 8, 5, 0, -51, 44, -60, -2, 3, -13, 4, 10, -49, -25, -11,
+    -8, -4, -4, -49, 10, -59, 51, -28, -4, 48, -42, 23, 11, -32, 27, 28,
+    -29, -11, 19, 36, 26, 5, -44, 37, 49, -61, -48, 61, 55, -17, -62, 31,
+    50, 53, 29, -26, 48, 58, 24, -37, -32, -57, -53, -4, -40, 45, -13, 50,
+    -58, -10, -31, 26, -45, -3, -45, -8, 44, 14, -59, 2, 2, 4, -10, 16,
+    12, 61, -39, 21, 35, -27, -8, 23, -22, -33, 29, 35, 52, -57, 21, 57,
+    -54, -37, 23, -59, -51, 33, -5, 4, 59, 32, 35, 20, -18, -17, 7, -51,
+    -22, -17, -20, -35, 50, 25, 55, -20, 8, -29, 47, 64, -18, 52, 0, 15,
+    34, -21, -8, -61, -42, -50, -26, -10, -51, -10, 26, 62, 28, 61, 25, -52,
+    -59, 27, 62, 15, 9, -58, 16, 10, -6, 30, 10, 29, 31, 47, 61, -58,
+    19, 41, 27, -46, -62, -53, 18, 12, -4, 35, -44, -18, -28, -62, -39, 20,
+    33, 50, 48, 55, -14, -63, 2, 34, 9, 58, -53, -50, -21, 0, 15, 4,
+    48, 62, -45, -26, -9, -47, 5, -26, 30, 50, -34, 47, -40, 51, 55, -51,
+    -31, -40, -51, 45, -1, -12, -21, -23, 38, 59, 31, 36, -29, -35, -63, 37,
+    37, 37, 25, -19, -55, 45, -53, 37, 12, 22, -59, 36, 25, 63, -11, -8,
+    -31, -14, -38, -55, 40, 13, -5, 7, -33, -47, -28, 57, -27, 27, 11, -56,
+    -51, 50, -38, 21, 28, -17, 10, -11, -35, 11, 24, 26, 20, -63, 59, -21,
+    60, 62, -31, 23, -42, -17, -7, -2, -15, 24, -59, 59, -55, -34, -55, -13,
+    -26, -59, -63, 31, -45, 61, -26, 14, -18, -4, -41, 30, 59, -45, 15, 54,
+    19, -11, -33, 57, 32, 8, -43, 25, -40, 55, -19, -6, -49, -8, -40, -23,
+    -48, -45, 54, -62, 49, 32, 42, 15, -22, -32, 12, -61, 34, 14, -32, -5,
+    -18, -31, 1, 62, -51, -10, 36, -29, -44, -47, 48, 54, -26, 16, 39, 57,
+    -10, -25, 59, 50, -19, -60, -26, -38, -48, -26, -41, -7, 23, 61, -43, 41,
+    -27, 9, -6, 49, 11, 35, -35, 21, 31, -61, 12, 7, -26, -18, -20, 13,
+    26, 62, 26, 4, 18, 10, 35, -51, -28, -3, 39, -30, 51, 24, -47, -33,
+    -53, -6, 53, -56, -60, 58, 20, 33, -46, -54, 32, -37, 29, 62, 45, 5,
+    -27, -36, 19, 63, 34, 36, 33, 7, 6, -56, 23, -30, -6, 31, -25, 26,
+    22, 54, 50, 1, 63, -24, 1, -8, 36, -12, -1, -25, 31, -10, -19, -64,
+    32, -44, -51, -30, -29, 49, -59, -21, -62, 40, -51, 45, -6, -13, 15, 49,
+    64, 18, 3, -49, 15, 29, 49, -6, 11, 28, 11, 28, 47, -29, -1, 21,
+    36, -24, -52, 18, -64, -49, -8, -1, 51, -61, 49, 25, 22, -37, 42, -15,
+    26, 8, -58, 30, -49, 29, -10, 8, 4, -61, 57, 9, 9, -59, 3, 33,
+    -32, 39, 49, -59, -2, -30, 22, -15, -31, -36, 47, -21, 58, 27, -24, -33,
+    33, 61, 30, 8, -20, -55, -23, 56, -50, 63, 63, 31, -27, -47, 36, -56,
+    -32, 10, -18, -1, -51, 63, -22, -28, 20, 24, -38, -38, 17, -15, -25, -43,
+    37, -36, -40, 29, -29, 28, -6, 53, -44, -29, 7, -31, -26, -18, -19, 63,
+    59, 4, 15, 55, -7, -9, -1, -38, -46, -58, 6, -61, -53, 25, 58, -54,
+    -51, -20, -46, -28, -29, 44, 22, -35, 63, 37, 59, 15, -12, -15, -22, 10,
+    -26, 47, 16, -44, -15, 56, 7, -8, -29, -33, -9, -49, -20, 15, 46, 40,
+};
+
+/** @abstract dense1 bias */
+static const int32_t breath_model_dense1_bias[16] = {
+    46, -160, 52, 80, 54, -8, -251, -37,
+    96, 69, -84, -236, 150, 152, 128, 219,
+};
+
+/** @abstract dense2 weights [4][16] */
+static const int8_t breath_model_dense2_weights[4 * 16] __attribute__((aligned(NN_INT8_ALIGN))) = {
+    22, -6, 58, -64, -63, 11, -64, -48, -33, 31, -45, -9, 45, 33, -9, 33,
+    -40, -15, -11, 34, 53, 38, 24, 2, 5, -7, -36, 50, 30, -29, 38, -33,
+    6, 9, -7, 35, 1, 21, 13, 20, 15, -5, -21, -49, 27, -38, -27, -31,
+    48, 31, -24, 16, 61, 52, -22, -35, 41, 23, 31, 51, 53, 14, -22, -62,
+};
+
+/** @abstract dense2 bias */
+static const int32_t breath_model_dense2_bias[4] = {
+    107, -86, 1, -158,
+};
+
+/** @abstract Layer table */
+static const nn_layer_t breath_model_layers[] = {
+    {
+        .type = NN_LAYER_CONV1D,
+        .in_channels = 3,
+        .out_channels = 8,
+        .kernel_size = 5,
+        .stride = 2,
+        .relu = true,
+        .weights = breath_model_conv1_weights,
+        .bias = breath_model_conv1_bias,
+        .multiplier = 1478607716,
+        .shift = 6,
+    },
+    {
+        .type = NN_LAYER_CONV1D,
+        .in_channels = 8,
+        .out_channels = 16,
+        .kernel_size = 3,
+        .stride = 2,
+        .relu = true,
+        .weights = breath_model_conv2_weights,
+        .bias = breath_model_conv2_bias,
+        .multiplier = 1168942037,
+        .shift = 6,
+    },
+    {
+        .type = NN_LAYER_DENSE,
+        .in_channels = 96,
+        .out_channels = 16,
+        .kernel_size = 1,
+        .stride = 1,
+        .relu = true,
+        .weights = breath_model_dense1_weights,
+        .bias = breath_model_dense1_bias,
+        .multiplier = 1168942037,
+        .shift = 7,
+    },
+    {
+        .type = NN_LAYER_DENSE,
+        .in_channels = 16,
+        .out_channels = 4,
+        .kernel_size = 1,
+        .stride = 1,
+        .relu = false,
+        .weights = breath_model_dense2_weights,
+        .bias = breath_model_dense2_bias,
+        .multiplier = 1431655765,
+        .shift = 6,
+    },
+};
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+const nn_model_t breath_model = {
+    .layers = breath_model_layers,
+    .num_layers = sizeof(breath_model_layers) / sizeof(breath_model_layers[0]),
+    .input_length = BREATH_MODEL_WINDOW_LENGTH,
+    .input_channels = BREATH_MODEL_CHANNELS,
+};
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
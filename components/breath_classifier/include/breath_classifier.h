@@ -0,0 +1,114 @@
+/**
+  **********************************************************************************************************************
+  * @file    breath_classifier.h
+  * @brief   This file is the header file for the on-device breath pattern classifier
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BREATH_CLASSIFIER_H_
+#define _BREATH_CLASSIFIER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Breath pattern classes, in model output order */
+typedef enum breath_class_t {
+    BREATH_CLASS_NORMAL = 0,
+    BREATH_CLASS_SHALLOW,
+    BREATH_CLASS_DEEP,
+    BREATH_CLASS_COUGH,
+} breath_class_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Number of new samples between two classifications (half a window) */
+#define BREATH_CLASSIFIER_HOP 16
+
+/** @abstract Right shift applied to detrended temperature (0.01 degC units) before int8 saturation */
+#define BREATH_CLASSIFIER_TEMPERATURE_SHIFT 0
+/** @abstract Right shift applied to detrended humidity (1/1024 %RH units) before int8 saturation */
+#define BREATH_CLASSIFIER_HUMIDITY_SHIFT 7
+/** @abstract Right shift applied to detrended pressure (1/256 Pa units) before int8 saturation */
+#define BREATH_CLASSIFIER_PRESSURE_SHIFT 4
+
+/** @abstract Number of inferences per kernel run by breath_classifier_benchmark */
+#define BREATH_CLASSIFIER_BENCHMARK_ITERATIONS 200
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function breath_classifier_push_sample
+ *
+ * @abstract This function appends one compensated BME280 sample to the feature window and classifies the window
+ *           every BREATH_CLASSIFIER_HOP samples once it is full
+ *
+ * @param[in] temperature: Temperature in 0.01 degC
+ *
+ * @param[in] humidity: Humidity in 1/1024 %RH
+ *
+ * @param[in] pressure: Pressure in 1/256 Pa
+ *
+ * @param[out] label: Breath pattern, written only when the function returns true
+ *
+ * @return
+ *      - true: A new label was produced
+ *      - false: Window not ready yet, or the model is not trained (BREATH_MODEL_TRAINED)
+ */
+bool breath_classifier_push_sample(int32_t temperature, uint32_t humidity, uint32_t pressure, breath_class_t * label);
+
+/*
+ * @function breath_classifier_get_last_label
+ *
+ * @abstract This function returns the most recent classification result
+ *
+ * @param[out] label: Breath pattern
+ *
+ * @return
+ *      - true: A label is available
+ *      - false: Nothing has been classified yet, or the model is not trained
+ */
+bool breath_classifier_get_last_label(breath_class_t * label);
+
+/*
+ * @function breath_classifier_label_name
+ *
+ * @abstract This function returns a printable name of a breath pattern
+ *
+ * @param[in] label: Breath pattern
+ *
+ * @return Label name
+ */
+const char * breath_classifier_label_name(breath_class_t label);
+
+/*
+ * @function breath_classifier_benchmark
+ *
+ * @abstract This function logs inferences/s of the reference and vector kernels, checks that they are bit-exact
+ *           and logs the peak RAM used by inference
+ *
+ * @param[in] iterations: Number of inferences per kernel
+ *
+ * @return
+ *      - true: Both kernels produced identical outputs
+ *      - false: Outputs differ
+ */
+bool breath_classifier_benchmark(uint32_t iterations);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BREATH_CLASSIFIER_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
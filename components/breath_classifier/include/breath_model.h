@@ -0,0 +1,47 @@
+/**
+  **********************************************************************************************************************
+  * @file    breath_model.h
+  * @brief   This file is the header file for the quantized breath pattern model
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _BREATH_MODEL_H_
+#define _BREATH_MODEL_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include "nn_int8.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Number of time steps in one input window */
+#define BREATH_MODEL_WINDOW_LENGTH 32
+/** @abstract Number of input channels (temperature, humidity, pressure) */
+#define BREATH_MODEL_CHANNELS 3
+/** @abstract Number of output classes */
+#define BREATH_MODEL_CLASSES 4
+/** @abstract 1 once breath_model.c holds trained parameters; the placeholder tables produce meaningless labels */
+#define BREATH_MODEL_TRAINED 0
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+/** @abstract Breath pattern model: conv1d(3->8, k5, s2) -> conv1d(8->16, k3, s2) -> dense(96->16) -> dense(16->4) */
+extern const nn_model_t breath_model;
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _BREATH_MODEL_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,173 @@
+/**
+  **********************************************************************************************************************
+  * @file    nn_int8.h
+  * @brief   This file is the header file for the int8 neural network inference engine
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _NN_INT8_H_
+#define _NN_INT8_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Supported layer types */
+typedef enum nn_layer_type_t {
+    NN_LAYER_CONV1D = 0,
+    NN_LAYER_DENSE,
+} nn_layer_type_t;
+
+/** @brief Dot product kernel selection */
+typedef enum nn_kernel_t {
+    NN_KERNEL_REFERENCE = 0,
+    NN_KERNEL_SIMD,
+} nn_kernel_t;
+
+/** @brief Quantized layer description
+ *
+ * All tensors are symmetric int8 (zero point 0). Activations are stored time-major ([time][channel]).
+ * Each weight row holds kernel_size * in_channels values (in_channels for dense layers) ordered as
+ * [kernel][channel] and is zero-padded up to a multiple of NN_INT8_ALIGN bytes.
+ *
+ */
+typedef struct nn_layer_t {
+    nn_layer_type_t type;
+    uint16_t in_channels;
+    uint16_t out_channels;
+    uint8_t kernel_size;
+    uint8_t stride;
+    bool relu;
+    const int8_t * weights;
+    const int32_t * bias;
+    int32_t multiplier;
+    uint8_t shift;
+} nn_layer_t;
+
+/** @brief Quantized model description */
+typedef struct nn_model_t {
+    const nn_layer_t * layers;
+    uint8_t num_layers;
+    uint16_t input_length;
+    uint16_t input_channels;
+} nn_model_t;
+
+/** @brief Benchmark results */
+typedef struct nn_benchmark_t {
+    uint32_t iterations;
+    uint32_t reference_inferences_per_s;
+    uint32_t simd_inferences_per_s;
+    size_t peak_arena_bytes;
+    bool bit_exact;
+} nn_benchmark_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Alignment of weight rows and activation buffers in bytes (one 128-bit vector register) */
+#define NN_INT8_ALIGN 16
+
+/** @abstract Size of the static activation arena in bytes */
+#define NN_INT8_ARENA_SIZE 1024
+
+/** @abstract Vector dot product is available when building for ESP32-S3 */
+#if defined(CONFIG_IDF_TARGET_ESP32S3)
+#define NN_INT8_HAS_SIMD 1
+#else
+#define NN_INT8_HAS_SIMD 0
+#endif
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+/** @abstract Rounds size up to the vector alignment */
+#define NN_INT8_ALIGN_UP(size) (((size) + (NN_INT8_ALIGN - 1)) & ~(NN_INT8_ALIGN - 1))
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function nn_int8_set_kernel
+ *
+ * @abstract This function selects the dot product kernel used by nn_int8_run. SIMD falls back to the reference
+ *           kernel on targets without vector instructions.
+ *
+ * @param[in] kernel: Kernel to use
+ *
+ * @return None
+ */
+void nn_int8_set_kernel(nn_kernel_t kernel);
+
+/*
+ * @function nn_int8_run
+ *
+ * @abstract This function runs the model on a quantized input window
+ *
+ * @param[in] model: Model description
+ *
+ * @param[in] input: Input window, input_length * input_channels values, time-major
+ *
+ * @param[out] output: Output logits, out_channels of the last layer
+ *
+ * @return
+ *      - 0 on success
+ *      - -1 if the model does not fit the arena
+ */
+int nn_int8_run(const nn_model_t * model, const int8_t * input, int8_t * output);
+
+/*
+ * @function nn_int8_argmax
+ *
+ * @abstract This function returns the index of the largest value
+ *
+ * @param[in] values: Values
+ *
+ * @param[in] count: Number of values
+ *
+ * @return Index of the largest value
+ */
+uint8_t nn_int8_argmax(const int8_t * values, uint8_t count);
+
+/*
+ * @function nn_int8_peak_arena_bytes
+ *
+ * @abstract This function returns the largest arena footprint needed by any layer of the model
+ *
+ * @param[in] model: Model description
+ *
+ * @return Peak arena usage in bytes
+ */
+size_t nn_int8_peak_arena_bytes(const nn_model_t * model);
+
+/*
+ * @function nn_int8_benchmark
+ *
+ * @abstract This function times the model with both kernels and checks that their outputs are identical
+ *
+ * @param[in] model: Model description
+ *
+ * @param[in] input: Input window
+ *
+ * @param[in] iterations: Number of inferences per kernel
+ *
+ * @param[out] result: Benchmark results
+ *
+ * @return None
+ */
+void nn_int8_benchmark(const nn_model_t * model, const int8_t * input, uint32_t iterations, nn_benchmark_t * result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _NN_INT8_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
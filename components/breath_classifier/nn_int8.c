@@ -0,0 +1,372 @@
+/**
+  **********************************************************************************************************************
+  * @file    nn_int8.c
+  * @brief   This file is the int8 neural network inference engine implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <string.h>
+#include "nn_int8.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define NN_INT8_MIN (-128)
+#define NN_INT8_MAX 127
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#define layerRowBytes(layer) NN_INT8_ALIGN_UP((uint32_t)(layer)->kernel_size * (layer)->in_channels)
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Activation arena: two ping-pong activation buffers followed by the im2col row */
+static int8_t nn_arena[NN_INT8_ARENA_SIZE] __attribute__((aligned(NN_INT8_ALIGN)));
+
+/** @abstract Currently selected dot product kernel */
+static nn_kernel_t nn_kernel = NN_KERNEL_SIMD;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+#if NN_INT8_HAS_SIMD
+/*
+ * @function nn_int8_dot_s3
+ *
+ * @abstract This function computes an int8 dot product with the ESP32-S3 vector unit (nn_int8_s3.S)
+ *
+ * @param[in] a: First vector, 16-byte aligned
+ *
+ * @param[in] b: Second vector, 16-byte aligned
+ *
+ * @param[in] blocks: Vector length in 16-byte blocks
+ *
+ * @return Dot product
+ */
+extern int32_t nn_int8_dot_s3(const int8_t * a, const int8_t * b, uint32_t blocks);
+#endif
+
+/*
+ * @function dotReference
+ *
+ * @abstract This function computes an int8 dot product in portable C
+ *
+ * @param[in] a: First vector
+ *
+ * @param[in] b: Second vector
+ *
+ * @param[in] length: Vector length
+ *
+ * @return Dot product
+ */
+static int32_t dotReference(const int8_t * a, const int8_t * b, uint32_t length);
+
+/*
+ * @function dot
+ *
+ * @abstract This function computes an int8 dot product with the selected kernel
+ *
+ * @param[in] a: First vector, 16-byte aligned
+ *
+ * @param[in] b: Second vector, 16-byte aligned
+ *
+ * @param[in] length: Vector length, multiple of NN_INT8_ALIGN
+ *
+ * @return Dot product
+ */
+static int32_t dot(const int8_t * a, const int8_t * b, uint32_t length);
+
+/*
+ * @function requantize
+ *
+ * @abstract This function scales a 32-bit accumulator back to int8 with round-half-up
+ *
+ * @param[in] accumulator: Accumulated value including bias
+ *
+ * @param[in] layer: Layer holding the fixed-point multiplier, shift and activation
+ *
+ * @return Quantized activation
+ */
+static int8_t requantize(int32_t accumulator, const nn_layer_t * layer);
+
+/*
+ * @function layerOutputLength
+ *
+ * @abstract This function returns the number of output time steps of a layer
+ *
+ * @param[in] layer: Layer description
+ *
+ * @param[in] input_length: Number of input time steps
+ *
+ * @return Number of output time steps
+ */
+static uint16_t layerOutputLength(const nn_layer_t * layer, uint16_t input_length);
+
+/*
+ * @function runConv1D
+ *
+ * @abstract This function runs a 1D convolution layer
+ *
+ * @param[in] layer: Layer description
+ *
+ * @param[in] input: Input activations [input_length][in_channels]
+ *
+ * @param[in] input_length: Number of input time steps
+ *
+ * @param[in] column: Aligned scratch row used for im2col
+ *
+ * @param[out] output: Output activations [output_length][out_channels]
+ *
+ * @return None
+ */
+static void runConv1D(const nn_layer_t * layer, const int8_t * input, uint16_t input_length, int8_t * column,
+                      int8_t * output);
+
+/*
+ * @function runDense
+ *
+ * @abstract This function runs a fully connected layer
+ *
+ * @param[in] layer: Layer description
+ *
+ * @param[in] input: Aligned input vector
+ *
+ * @param[out] output: Output activations
+ *
+ * @return None
+ */
+static void runDense(const nn_layer_t * layer, const int8_t * input, int8_t * output);
+
+/*
+ * @function arenaLayout
+ *
+ * @abstract This function computes the arena partitioning needed by a model
+ *
+ * @param[in] model: Model description
+ *
+ * @param[out] activation_bytes: Size of each of the two activation buffers
+ *
+ * @param[out] column_bytes: Size of the im2col row
+ *
+ * @return None
+ */
+static void arenaLayout(const nn_model_t * model, uint32_t * activation_bytes, uint32_t * column_bytes);
+
+/*
+ * @function nowMicroseconds
+ *
+ * @abstract This function returns a monotonic timestamp
+ *
+ * @param None
+ *
+ * @return Time in microseconds
+ */
+static int64_t nowMicroseconds(void);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int32_t dotReference(const int8_t * a, const int8_t * b, uint32_t length) {
+    int32_t accumulator = 0;
+
+    for (uint32_t i = 0; i < length; i++) {
+        accumulator += (int32_t)a[i] * (int32_t)b[i];
+    }
+
+    return accumulator;
+}
+
+static int32_t dot(const int8_t * a, const int8_t * b, uint32_t length) {
+#if NN_INT8_HAS_SIMD
+    if (nn_kernel == NN_KERNEL_SIMD) {
+        return nn_int8_dot_s3(a, b, length / NN_INT8_ALIGN);
+    }
+#endif
+    return dotReference(a, b, length);
+}
+
+static int8_t requantize(int32_t accumulator, const nn_layer_t * layer) {
+    const uint32_t total_shift = 31u + layer->shift;
+    int64_t scaled = (int64_t)accumulator * layer->multiplier;
+
+    scaled = (scaled + ((int64_t)1 << (total_shift - 1))) >> total_shift;
+
+    const int64_t low = layer->relu ? 0 : NN_INT8_MIN;
+    if (scaled < low) {
+        return (int8_t)low;
+    }
+    if (scaled > NN_INT8_MAX) {
+        return NN_INT8_MAX;
+    }
+
+    return (int8_t)scaled;
+}
+
+static uint16_t layerOutputLength(const nn_layer_t * layer, uint16_t input_length) {
+    if (layer->type == NN_LAYER_DENSE) {
+        return 1;
+    }
+
+    return (uint16_t)((input_length - layer->kernel_size) / layer->stride + 1);
+}
+
+static void runConv1D(const nn_layer_t * layer, const int8_t * input, uint16_t input_length, int8_t * column,
+                      int8_t * output) {
+    const uint32_t row_bytes = layerRowBytes(layer);
+    const uint32_t window_bytes = (uint32_t)layer->kernel_size * layer->in_channels;
+    const uint16_t output_length = layerOutputLength(layer, input_length);
+
+    for (uint16_t t = 0; t < output_length; t++) {
+        /* Copy the receptive field into an aligned row; the zero padding of the weight rows masks the tail */
+        memcpy(column, &input[(uint32_t)t * layer->stride * layer->in_channels], window_bytes);
+
+        for (uint16_t oc = 0; oc < layer->out_channels; oc++) {
+            int32_t accumulator = layer->bias[oc] + dot(column, &layer->weights[oc * row_bytes], row_bytes);
+            output[(uint32_t)t * layer->out_channels + oc] = requantize(accumulator, layer);
+        }
+    }
+}
+
+static void runDense(const nn_layer_t * layer, const int8_t * input, int8_t * output) {
+    const uint32_t row_bytes = layerRowBytes(layer);
+
+    for (uint16_t oc = 0; oc < layer->out_channels; oc++) {
+        int32_t accumulator = layer->bias[oc] + dot(input, &layer->weights[oc * row_bytes], row_bytes);
+        output[oc] = requantize(accumulator, layer);
+    }
+}
+
+static void arenaLayout(const nn_model_t * model, uint32_t * activation_bytes, uint32_t * column_bytes) {
+    uint16_t length = model->input_length;
+
+    *activation_bytes = NN_INT8_ALIGN_UP((uint32_t)model->input_length * model->input_channels);
+    *column_bytes = 0;
+
+    for (uint8_t i = 0; i < model->num_layers; i++) {
+        const nn_layer_t * layer = &model->layers[i];
+        length = layerOutputLength(layer, length);
+
+        uint32_t out_bytes = NN_INT8_ALIGN_UP((uint32_t)length * layer->out_channels);
+        if (out_bytes > *activation_bytes) {
+            *activation_bytes = out_bytes;
+        }
+        if (layer->type == NN_LAYER_CONV1D && layerRowBytes(layer) > *column_bytes) {
+            *column_bytes = layerRowBytes(layer);
+        }
+    }
+}
+
+static int64_t nowMicroseconds(void) {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void nn_int8_set_kernel(nn_kernel_t kernel) {
+    nn_kernel = kernel;
+}
+
+size_t nn_int8_peak_arena_bytes(const nn_model_t * model) {
+    uint32_t activation_bytes;
+    uint32_t column_bytes;
+
+    arenaLayout(model, &activation_bytes, &column_bytes);
+
+    return 2 * activation_bytes + column_bytes;
+}
+
+int nn_int8_run(const nn_model_t * model, const int8_t * input, int8_t * output) {
+    uint32_t activation_bytes;
+    uint32_t column_bytes;
+
+    arenaLayout(model, &activation_bytes, &column_bytes);
+
+    if (2 * activation_bytes + column_bytes > sizeof(nn_arena)) {
+        return -1;
+    }
+
+    int8_t * current = nn_arena;
+    int8_t * next = &nn_arena[activation_bytes];
+    int8_t * column = &nn_arena[2 * activation_bytes];
+    uint16_t length = model->input_length;
+
+    memcpy(current, input, (size_t)model->input_length * model->input_channels);
+
+    for (uint8_t i = 0; i < model->num_layers; i++) {
+        const nn_layer_t * layer = &model->layers[i];
+
+        if (layer->type == NN_LAYER_CONV1D) {
+            runConv1D(layer, current, length, column, next);
+        } else {
+            runDense(layer, current, next);
+        }
+        length = layerOutputLength(layer, length);
+
+        int8_t * swap = current;
+        current = next;
+        next = swap;
+    }
+
+    memcpy(output, current, model->layers[model->num_layers - 1].out_channels);
+
+    return 0;
+}
+
+uint8_t nn_int8_argmax(const int8_t * values, uint8_t count) {
+    uint8_t best = 0;
+
+    for (uint8_t i = 1; i < count; i++) {
+        if (values[i] > values[best]) {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+void nn_int8_benchmark(const nn_model_t * model, const int8_t * input, uint32_t iterations, nn_benchmark_t * result) {
+    int8_t reference_output[NN_INT8_ALIGN * 4];
+    int8_t simd_output[NN_INT8_ALIGN * 4];
+    const nn_kernel_t previous_kernel = nn_kernel;
+    int64_t start;
+
+    memset(result, 0, sizeof(*result));
+    result->iterations = iterations;
+    result->peak_arena_bytes = nn_int8_peak_arena_bytes(model);
+
+    if (iterations == 0 || model->layers[model->num_layers - 1].out_channels > sizeof(reference_output)) {
+        return;
+    }
+
+    nn_int8_set_kernel(NN_KERNEL_REFERENCE);
+    start = nowMicroseconds();
+    for (uint32_t i = 0; i < iterations; i++) {
+        nn_int8_run(model, input, reference_output);
+    }
+    int64_t reference_us = nowMicroseconds() - start;
+
+    nn_int8_set_kernel(NN_KERNEL_SIMD);
+    start = nowMicroseconds();
+    for (uint32_t i = 0; i < iterations; i++) {
+        nn_int8_run(model, input, simd_output);
+    }
+    int64_t simd_us = nowMicroseconds() - start;
+
+    nn_int8_set_kernel(previous_kernel);
+
+    result->reference_inferences_per_s =
+            reference_us > 0 ? (uint32_t)((int64_t)iterations * 1000000 / reference_us) : 0;
+    result->simd_inferences_per_s = simd_us > 0 ? (uint32_t)((int64_t)iterations * 1000000 / simd_us) : 0;
+    result->bit_exact = memcmp(reference_output, simd_output, model->layers[model->num_layers - 1].out_channels) == 0;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -16,6 +16,7 @@ extern "C" {
 #endif
 
 /* Includes ----------------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
 #include <stdint.h>
 
 /* Types -------------------------------------------------------------------------------------------------------------*/
@@ -27,18 +28,131 @@ typedef struct {
     uint8_t minute;
     uint8_t second;
     uint8_t day_of_week;
-    uint8_t milliseconds;
+    uint16_t milliseconds;
     uint8_t adjust_reason;
 } rtc_time_t;
 
+/** @brief Result of one sync exchange
+ *
+ * offset_us is the device clock minus the reference clock at the exchange, rtt_us the round trip without the device
+ * processing time. The offset is exact when both directions take equally long, otherwise it is off by at most
+ * rtt_us / 2.
+ *
+ */
+typedef struct {
+    int64_t offset_us;
+    int64_t rtt_us;
+    bool applied;
+    bool stepped;
+} rtc_sync_result_t;
+
+/** @brief Clock synchronization state
+ *
+ * source is one of RTC_SOURCE_*, last_sync_wall_us the clock time of the latest set or applied sync, kept across
+ * resets so the age of the time survives them.
+ *
+ */
+typedef struct {
+    bool valid;
+    uint8_t source;
+    uint8_t adjust_reason;
+    uint32_t syncs;
+    uint32_t rejected;
+    uint32_t steps;
+    int64_t last_offset_us;
+    int64_t last_rtt_us;
+    int64_t last_sync_us;
+    int64_t last_sync_wall_us;
+    int64_t slew_remaining_us;
+    int32_t skew_ppb;
+    uint8_t drift_points;
+} rtc_sync_status_t;
+
 /* Constants ---------------------------------------------------------------------------------------------------------*/
-#define ADJUST_REASON 0xE0
+/** @abstract Current Time adjust reasons: manual update and external reference time update */
+#define ADJUST_REASON_MANUAL 0x01
+#define ADJUST_REASON_EXTERNAL 0x02
+
+/** @abstract Fastest rate a correction is slewed in, the clock never runs backwards and never jumps */
+#define RTC_SLEW_MAX_PPM 1000
+
+/** @abstract Corrections above this are stepped, slewing them in would take longer than the samples are useful */
+#define RTC_STEP_THRESHOLD_US 100000
+
+/** @abstract Exchanges with a longer round trip are discarded, their offset error bound is too wide */
+#define RTC_SYNC_MAX_RTT_US 250000
+
+/** @abstract Exchanges within this margin of the shortest round trip of a burst are applied, slower ones only
+ *            counted. A burst ends after RTC_SYNC_BURST_GAP_US without an exchange. */
+#define RTC_SYNC_RTT_MARGIN_US 2000
+#define RTC_SYNC_BURST_GAP_US 10000000
+
+/** @abstract Drift fit: the best exchange of each of the latest RTC_DRIFT_POINTS bursts. The rate correction is
+ *            fitted once RTC_DRIFT_MIN_POINTS of them span RTC_DRIFT_MIN_SPAN_US, with 1 ms offset noise a shorter
+ *            span would make the fit worse than the crystal. */
+#define RTC_DRIFT_POINTS 16
+#define RTC_DRIFT_MIN_POINTS 3
+#define RTC_DRIFT_MIN_SPAN_US 300000000LL
+
+/** @abstract Largest rate correction taken from a fit, well beyond the crystal tolerance */
+#define RTC_DRIFT_MAX_PPB 200000
+
+/** @abstract The rate correction is written to NVS when it moved this much, not after every sync */
+#define RTC_DRIFT_PERSIST_PPB 500
+
+/** @abstract NVS namespace and keys of the rate correction, the clock and the time of the last set or sync */
+#define RTC_NVS_NAMESPACE "rtc"
+#define RTC_NVS_SKEW_KEY "skew_ppb"
+#define RTC_NVS_TIME_KEY "wall_us"
+#define RTC_NVS_SYNC_KEY "sync_us"
+
+/** @abstract The clock is saved to RTC slow memory this often and on every adjustment, restart and deep sleep entry,
+ *            which RTC memory survives. NVS, the fallback after a power loss, is written every
+ *            RTC_NVS_CHECKPOINT_PERIOD_MS and on every set or step. */
+#define RTC_CHECKPOINT_PERIOD_MS 10000
+#define RTC_NVS_CHECKPOINT_PERIOD_MS 600000
+
+/** @abstract Clock sources, bits 0-1 of the time quality byte:
+ *            - UNSET: never set, the time counts from boot
+ *            - SYNCED: set or synced since boot
+ *            - RESTORED: carried over a reset or deep sleep in RTC memory, off by the RTC timer error since then; only
+ *              with an external 32 kHz crystal or oscillator as RTC slow clock
+ *            - ESTIMATED: restored from NVS after a power loss, missing the time the device was off, or carried over
+ *              in RTC memory timed on the internal RC oscillator, off by up to several percent of the time since */
+#define RTC_SOURCE_UNSET 0x00
+#define RTC_SOURCE_SYNCED 0x01
+#define RTC_SOURCE_RESTORED 0x02
+#define RTC_SOURCE_ESTIMATED 0x03
+
+/** @abstract Time quality bits 2-7: hours since the clock was last set or synced, saturating, also for UNSET */
+#define RTC_QUALITY_AGE_SHIFT 2
+#define RTC_QUALITY_AGE_MAX 63
 
 /* Macros ------------------------------------------------------------------------------------------------------------*/
 
 /* Variables ---------------------------------------------------------------------------------------------------------*/
 
 /* Functions ---------------------------------------------------------------------------------------------------------*/
+/*
+ * @function rtc_init
+ *
+ * @abstract Restores the clock early in boot: from RTC slow memory after a reset or deep sleep, from NVS after a
+ *           power loss, together with the rate correction fitted before. Samples taken from then on carry a usable
+ *           time without waiting for a central. Starts the periodic checkpoints.
+ *
+ * @return None
+ */
+void rtc_init(void);
+
+/*
+ * @function rtc_time_quality
+ *
+ * @abstract Retrieves the time quality byte stored with every sample: the clock source and its age.
+ *
+ * @return RTC_SOURCE_* | hours since the last set or sync << RTC_QUALITY_AGE_SHIFT
+ */
+uint8_t rtc_time_quality(void);
+
 /*
  * @function set_time
  *
@@ -53,11 +167,14 @@ typedef struct {
  *            - Byte 5: Minute
  *            - Byte 6: Second
  *            - Byte 7: Day of the week
- *            - Byte 8: Milliseconds
+ *            - Byte 8: Fractions of a second in 1/256 s
  *            - Byte 9: Adjust reason
- * @return None
+ *
+ * The clock is stepped, use rtc_sync_update to correct a running clock.
+ *
+ * @return true if the time was set, false if the payload is not a valid date
  */
-void set_time(const uint8_t payload[10]);
+bool set_time(const uint8_t payload[10]);
 
 /*
  * @function get_time
@@ -73,11 +190,62 @@ void set_time(const uint8_t payload[10]);
  *         - Byte 5: Minute
  *         - Byte 6: Second
  *         - Byte 7: Day of the week
- *         - Byte 8: Milliseconds
- *         - Byte 9: Adjust reason
+ *         - Byte 8: Fractions of a second in 1/256 s
+ *         - Byte 9: Adjust reason of the latest update
  */
 uint8_t* get_time();
 
+/*
+ * @function rtc_now_us
+ *
+ * @abstract Retrieves the current time in microseconds since the epoch, or since boot while the clock is not set.
+ *
+ * @return Current time in microseconds
+ */
+int64_t rtc_now_us(void);
+
+/*
+ * @function rtc_wall_time_us
+ *
+ * @abstract Converts an esp_timer timestamp, e.g. of a sample, to time since the epoch, corrected for the slew and
+ *           the fitted drift.
+ *
+ * @param[in] mono_us: esp_timer_get_time() value
+ *
+ * @return Time in microseconds since the epoch, or since boot while the clock is not set
+ */
+int64_t rtc_wall_time_us(int64_t mono_us);
+
+/*
+ * @function rtc_sync_update
+ *
+ * @abstract Applies one NTP-style exchange with a reference clock: the reference sends at t1, the device receives at
+ *           t2 and replies at t3, the reply arrives at t4. The offset is ((t2 - t1) + (t3 - t4)) / 2 and the round
+ *           trip (t4 - t1) - (t3 - t2). The correction is slewed in at up to RTC_SLEW_MAX_PPM, it is only stepped
+ *           while the clock is not set or when it is off by more than RTC_STEP_THRESHOLD_US. The exchange also
+ *           feeds the drift fit, which sets the clock rate and is persisted.
+ *
+ * @param[in] t1_us, t4_us: Reference clock stamps
+ *
+ * @param[in] t2_us, t3_us: Device clock stamps, rtc_now_us() values
+ *
+ * @param[out] result: Offset, round trip and what was done
+ *
+ * @return true if the exchange was applied
+ */
+bool rtc_sync_update(int64_t t1_us, int64_t t2_us, int64_t t3_us, int64_t t4_us, rtc_sync_result_t *result);
+
+/*
+ * @function rtc_get_sync_status
+ *
+ * @abstract Retrieves the clock synchronization state.
+ *
+ * @param[out] status: Synchronization state
+ *
+ * @return None
+ */
+void rtc_get_sync_status(rtc_sync_status_t *status);
+
 #endif //RTC_DRIVER_H
 
 /* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -8,26 +8,262 @@
   */
 
 /* Includes -------------------------------------------------------------------------------------------------*/
+#include <esp_attr.h>
 #include <esp_log.h>
+#include <esp_rtc_time.h>
+#include <esp_sleep.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/time.h>
 #include <time.h>
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "nvs_flash.h"
 #include "rtc_driver.h"
 
 /* Private typedef ---------------------------------------------------------------------------------------------------*/
+/*
+ * Software clock on top of esp_timer: time = base_wall_us + elapsed * (1 + skew) + slewed part of slew_us, elapsed
+ * counted from base_mono_us. Every adjustment re-bases the clock at the current time, so it stays continuous.
+ */
+typedef struct {
+    int64_t base_mono_us;
+    int64_t base_wall_us;
+    int64_t slew_us;
+    int32_t skew_ppb;
+} rtc_clock_t;
+
+/*
+ * Sync point for the drift fit: esp_timer at the middle of an exchange and the reference clock minus esp_timer
+ * there. Independent of the corrections applied to the clock, so the points of successive bursts line up.
+ */
+typedef struct {
+    int64_t mono_us;
+    int64_t offset_us;
+    int64_t rtt_us;
+} rtc_sync_point_t;
+
+/*
+ * Clock state kept in RTC slow memory: the clock and the RTC timer, which keeps counting through deep sleep and
+ * software resets, taken together. checksum covers the fields before it.
+ */
+typedef struct {
+    uint32_t magic;
+    int64_t wall_us;
+    int64_t rtc_us;
+    int64_t last_sync_wall_us;
+    int32_t skew_ppb;
+    uint8_t source;
+    uint8_t adjust_reason;
+    uint32_t checksum;
+} rtc_checkpoint_t;
 
 /* Private define ----------------------------------------------------------------------------------------------------*/
+#define RTC_CHECKPOINT_MAGIC 0x52544331u
+
+/* The RTC timer is only as good as its slow clock: a 32 kHz crystal or oscillator holds tens of ppm, the internal
+ * RC oscillator drifts by several percent, so a restore timed on it is no better than an estimate */
+#if defined(CONFIG_RTC_CLK_SRC_EXT_CRYS) || defined(CONFIG_RTC_CLK_SRC_EXT_OSC)
+#define RTC_TIMER_ACCURATE 1
+#else
+#define RTC_TIMER_ACCURATE 0
+#endif
+
+/* 32-bit FNV-1a parameters */
+#define FNV_OFFSET_BASIS 0x811C9DC5u
+#define FNV_PRIME 0x01000193u
 
 /* Private macros ----------------------------------------------------------------------------------------------------*/
 
 /* Private variables -------------------------------------------------------------------------------------------------*/
 static const char *TAG = "RTC_DRIVER";
 static rtc_time_t rtc_register;
+static rtc_clock_t rtc_clock;
+static rtc_sync_status_t sync_status;
+
+/* Shortest round trip of the current sync burst and the time of its latest exchange */
+static int64_t burst_min_rtt_us = INT64_MAX;
+static int64_t burst_last_us = 0;
+
+/* Drift fit points, oldest first, one per sync burst. Only touched by rtc_sync_update. */
+static rtc_sync_point_t sync_points[RTC_DRIFT_POINTS];
+static size_t sync_point_count = 0;
+
+/* Skew last written to NVS */
+static int32_t persisted_skew_ppb = 0;
+
+/* Survives deep sleep and software resets, validated by magic and checksum since power-on leaves it random */
+static RTC_NOINIT_ATTR rtc_checkpoint_t rtc_checkpoint;
+
+/* Refreshes the checkpoint while the clock runs */
+static esp_timer_handle_t checkpoint_timer = NULL;
+static uint32_t checkpoint_ticks = 0;
+
+/* Guards the clock, it is read by every task and adjusted from the BLE host task */
+static portMUX_TYPE rtc_lock = portMUX_INITIALIZER_UNLOCKED;
 
 /* External variables ------------------------------------------------------------------------------------------------*/
 
 /* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function slewed_part
+ *
+ * @abstract Computes how much of the pending correction is slewed in, rtc_lock must be held
+ *
+ * @param[in] elapsed_us: Time since the clock was re-based
+ *
+ * @return Slewed part of slew_us
+ */
+static int64_t slewed_part(int64_t elapsed_us);
+
+/*
+ * @function clock_at
+ *
+ * @abstract Evaluates the software clock, rtc_lock must be held
+ *
+ * @param[in] mono_us: esp_timer timestamp
+ *
+ * @return Clock time at mono_us
+ */
+static int64_t clock_at(int64_t mono_us);
+
+/*
+ * @function rebase_clock
+ *
+ * @abstract Steps or starts slewing the software clock at the current time, rtc_lock must be held
+ *
+ * @param[in] correction_us: Correction to add to the clock
+ *
+ * @param[in] step: Applies the correction at once if true, slews it in otherwise
+ *
+ * @param[in] reason: Adjust reason reported by get_time
+ *
+ * @return None
+ */
+static void rebase_clock(int64_t correction_us, bool step, uint8_t reason);
+
+/*
+ * @function sync_system_time
+ *
+ * @abstract Carries a clock adjustment over to the C library time, for the log and time() users
+ *
+ * @param[in] correction_us: Correction added to the clock
+ *
+ * @param[in] step: The correction was stepped
+ *
+ * @return None
+ */
+static void sync_system_time(int64_t correction_us, bool step);
+
+/*
+ * @function add_sync_point
+ *
+ * @abstract Records an applied exchange for the drift fit, an exchange of the same burst replaces the point if
+ *           its round trip is shorter
+ *
+ * @param[in] point: Sync point
+ *
+ * @param[in] new_burst: The exchange starts a new burst
+ *
+ * @return None
+ */
+static void add_sync_point(const rtc_sync_point_t *point, bool new_burst);
+
+/*
+ * @function fit_skew
+ *
+ * @abstract Fits a line through the sync points by least squares, its slope is the rate error of esp_timer
+ *
+ * @param[out] skew_ppb: Rate correction in parts per billion
+ *
+ * @return true if the points span enough time for a fit
+ */
+static bool fit_skew(int32_t *skew_ppb);
+
+/*
+ * @function set_skew
+ *
+ * @abstract Changes the rate correction of the clock without a jump, the pending slew continues
+ *
+ * @param[in] skew_ppb: Rate correction in parts per billion
+ *
+ * @return None
+ */
+static void set_skew(int32_t skew_ppb);
+
+/*
+ * @function persist_skew
+ *
+ * @abstract Stores the rate correction in NVS when it moved by RTC_DRIFT_PERSIST_PPB or more since the last write
+ *
+ * @param[in] skew_ppb: Rate correction in parts per billion
+ *
+ * @return None
+ */
+static void persist_skew(int32_t skew_ppb);
+
+/*
+ * @function checkpoint_checksum
+ *
+ * @abstract Computes the checksum of an RTC memory checkpoint
+ *
+ * @param[in] checkpoint: Checkpoint
+ *
+ * @return FNV-1a hash of the fields before the checksum
+ */
+static uint32_t checkpoint_checksum(const rtc_checkpoint_t *checkpoint);
+
+/*
+ * @function save_checkpoint
+ *
+ * @abstract Stores the clock in RTC slow memory, rtc_lock must be held
+ *
+ * @return None
+ */
+static void save_checkpoint(void);
+
+/*
+ * @function persist_time
+ *
+ * @abstract Stores the clock and the time of the last set or sync in NVS, the fallback after a power loss
+ *
+ * @return None
+ */
+static void persist_time(void);
+
+/*
+ * @function restore_time
+ *
+ * @abstract Restores the clock from RTC slow memory, or from NVS as an estimate if the RTC memory did not survive
+ *
+ * @return true when the clock came from the checkpoint in RTC slow memory
+ */
+static bool restore_time(void);
+
+/*
+ * @function checkpoint_timer_cb
+ *
+ * @abstract Refreshes the RTC memory checkpoint and, less often, the NVS copy
+ *
+ * @param[in] arg: Unused
+ *
+ * @return None
+ */
+static void checkpoint_timer_cb(void *arg);
+
+/*
+ * @function shutdown_handler
+ *
+ * @abstract Saves the clock before a software restart or deep sleep
+ *
+ * @return None
+ */
+static void shutdown_handler(void);
+
 /*
  * @function timeval_to_rtc
  *
@@ -64,6 +300,254 @@ static void set_current_time(int year, int month, int day, int hour, int minute,
 static void get_current_time(int *year, int *month, int *day, int *hour, int *minute, int *second, int *milliseconds, int *weekday);
 
 /* Private function definitions --------------------------------------------------------------------------------------*/
+static int64_t slewed_part(int64_t elapsed_us) {
+    if (elapsed_us <= 0 || rtc_clock.slew_us == 0) {
+        return 0;
+    }
+
+    const int64_t limit_us = elapsed_us * RTC_SLEW_MAX_PPM / 1000000;
+    if (rtc_clock.slew_us > 0) {
+        return rtc_clock.slew_us < limit_us ? rtc_clock.slew_us : limit_us;
+    }
+    return rtc_clock.slew_us > -limit_us ? rtc_clock.slew_us : -limit_us;
+}
+
+static int64_t clock_at(int64_t mono_us) {
+    const int64_t elapsed_us = mono_us - rtc_clock.base_mono_us;
+    // Split at 10^9 us, the same result as elapsed * skew / 10^9 without its overflow after ~1.5 years at
+    // RTC_DRIFT_MAX_PPB; only a sync or skew change moves base_mono_us
+    const int64_t drift_us = elapsed_us / 1000000000 * rtc_clock.skew_ppb +
+                             elapsed_us % 1000000000 * rtc_clock.skew_ppb / 1000000000;
+
+    return rtc_clock.base_wall_us + elapsed_us + drift_us + slewed_part(elapsed_us);
+}
+
+static void rebase_clock(int64_t correction_us, bool step, uint8_t reason) {
+    const int64_t now_us = esp_timer_get_time();
+    const int64_t wall_us = clock_at(now_us);
+
+    // A correction replaces whatever is left of the previous one, it was measured against the clock as it is now
+    rtc_clock.base_mono_us = now_us;
+    rtc_clock.base_wall_us = step ? wall_us + correction_us : wall_us;
+    rtc_clock.slew_us = step ? 0 : correction_us;
+
+    sync_status.valid = true;
+    sync_status.source = RTC_SOURCE_SYNCED;
+    sync_status.adjust_reason = reason;
+    sync_status.last_sync_wall_us = rtc_clock.base_wall_us;
+    if (step) {
+        sync_status.steps++;
+    }
+
+    save_checkpoint();
+}
+
+static void sync_system_time(int64_t correction_us, bool step) {
+    if (step) {
+        const int64_t now_us = rtc_now_us();
+        struct timeval tv = { .tv_sec = now_us / 1000000, .tv_usec = now_us % 1000000 };
+        if (settimeofday(&tv, NULL) != 0) {
+            ESP_LOGE(TAG, "Failed to set system time");
+        }
+    } else {
+        struct timeval delta = { .tv_sec = correction_us / 1000000, .tv_usec = correction_us % 1000000 };
+        if (adjtime(&delta, NULL) != 0) {
+            ESP_LOGW(TAG, "Failed to slew system time");
+        }
+    }
+}
+
+static void add_sync_point(const rtc_sync_point_t *point, bool new_burst) {
+    if (!new_burst && sync_point_count > 0) {
+        if (point->rtt_us < sync_points[sync_point_count - 1].rtt_us) {
+            sync_points[sync_point_count - 1] = *point;
+        }
+        return;
+    }
+
+    if (sync_point_count == RTC_DRIFT_POINTS) {
+        memmove(&sync_points[0], &sync_points[1], (RTC_DRIFT_POINTS - 1) * sizeof(sync_points[0]));
+        sync_point_count--;
+    }
+    sync_points[sync_point_count++] = *point;
+}
+
+static bool fit_skew(int32_t *skew_ppb) {
+    if (sync_point_count < RTC_DRIFT_MIN_POINTS ||
+        sync_points[sync_point_count - 1].mono_us - sync_points[0].mono_us < RTC_DRIFT_MIN_SPAN_US) {
+        return false;
+    }
+
+    // Relative to the oldest point, so the sums keep their precision
+    double sum_x = 0, sum_y = 0, sum_xx = 0, sum_xy = 0;
+    for (size_t i = 0; i < sync_point_count; i++) {
+        const double x = (double)(sync_points[i].mono_us - sync_points[0].mono_us);
+        const double y = (double)(sync_points[i].offset_us - sync_points[0].offset_us);
+        sum_x += x;
+        sum_y += y;
+        sum_xx += x * x;
+        sum_xy += x * y;
+    }
+
+    const double n = (double)sync_point_count;
+    const double slope = (n * sum_xy - sum_x * sum_y) / (n * sum_xx - sum_x * sum_x);
+    const double ppb = slope * 1e9;
+
+    *skew_ppb = ppb > RTC_DRIFT_MAX_PPB ? RTC_DRIFT_MAX_PPB : ppb < -RTC_DRIFT_MAX_PPB ? -RTC_DRIFT_MAX_PPB :
+                (int32_t)ppb;
+    return true;
+}
+
+static void set_skew(int32_t skew_ppb) {
+    const int64_t now_us = esp_timer_get_time();
+    const int64_t wall_us = clock_at(now_us);
+
+    rtc_clock.slew_us -= slewed_part(now_us - rtc_clock.base_mono_us);
+    rtc_clock.base_mono_us = now_us;
+    rtc_clock.base_wall_us = wall_us;
+    rtc_clock.skew_ppb = skew_ppb;
+
+    save_checkpoint();
+}
+
+static void persist_skew(int32_t skew_ppb) {
+    nvs_handle_t nvs;
+
+    if (abs(skew_ppb - persisted_skew_ppb) < RTC_DRIFT_PERSIST_PPB) {
+        return;
+    }
+
+    if (nvs_open(RTC_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        ESP_LOGW(TAG, "Skew not persisted");
+        return;
+    }
+
+    if (nvs_set_i32(nvs, RTC_NVS_SKEW_KEY, skew_ppb) == ESP_OK && nvs_commit(nvs) == ESP_OK) {
+        persisted_skew_ppb = skew_ppb;
+    }
+
+    nvs_close(nvs);
+}
+
+static uint32_t checkpoint_checksum(const rtc_checkpoint_t *checkpoint) {
+    const uint8_t *bytes = (const uint8_t *)checkpoint;
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < offsetof(rtc_checkpoint_t, checksum); i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void save_checkpoint(void) {
+    if (!sync_status.valid) {
+        return;
+    }
+
+    // Zeroed first so the padding the checksum covers is defined
+    memset(&rtc_checkpoint, 0, sizeof(rtc_checkpoint));
+    rtc_checkpoint.magic = RTC_CHECKPOINT_MAGIC;
+    rtc_checkpoint.wall_us = clock_at(esp_timer_get_time());
+    rtc_checkpoint.rtc_us = (int64_t)esp_rtc_get_time_us();
+    rtc_checkpoint.last_sync_wall_us = sync_status.last_sync_wall_us;
+    rtc_checkpoint.skew_ppb = rtc_clock.skew_ppb;
+    rtc_checkpoint.source = sync_status.source;
+    rtc_checkpoint.adjust_reason = sync_status.adjust_reason;
+    rtc_checkpoint.checksum = checkpoint_checksum(&rtc_checkpoint);
+}
+
+static void persist_time(void) {
+    nvs_handle_t nvs;
+
+    portENTER_CRITICAL(&rtc_lock);
+    const bool valid = sync_status.valid;
+    const int64_t wall_us = clock_at(esp_timer_get_time());
+    const int64_t last_sync_wall_us = sync_status.last_sync_wall_us;
+    portEXIT_CRITICAL(&rtc_lock);
+
+    if (!valid || nvs_open(RTC_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;
+    }
+
+    if (nvs_set_i64(nvs, RTC_NVS_TIME_KEY, wall_us) != ESP_OK ||
+        nvs_set_i64(nvs, RTC_NVS_SYNC_KEY, last_sync_wall_us) != ESP_OK || nvs_commit(nvs) != ESP_OK) {
+        ESP_LOGW(TAG, "Time not persisted");
+    }
+
+    nvs_close(nvs);
+}
+
+static bool restore_time(void) {
+    const int64_t rtc_us = (int64_t)esp_rtc_get_time_us();
+    nvs_handle_t nvs;
+
+    // The RTC timer restarts at power-on, a checkpoint from its future is stale
+    if (rtc_checkpoint.magic == RTC_CHECKPOINT_MAGIC &&
+        rtc_checkpoint.checksum == checkpoint_checksum(&rtc_checkpoint) && rtc_us >= rtc_checkpoint.rtc_us) {
+        portENTER_CRITICAL(&rtc_lock);
+        rtc_clock.base_mono_us = esp_timer_get_time();
+        rtc_clock.base_wall_us = rtc_checkpoint.wall_us + (rtc_us - rtc_checkpoint.rtc_us);
+        rtc_clock.slew_us = 0;
+        rtc_clock.skew_ppb = rtc_checkpoint.skew_ppb;
+        sync_status.valid = true;
+        sync_status.source = rtc_checkpoint.source == RTC_SOURCE_ESTIMATED || !RTC_TIMER_ACCURATE ?
+                             RTC_SOURCE_ESTIMATED : RTC_SOURCE_RESTORED;
+        sync_status.adjust_reason = rtc_checkpoint.adjust_reason;
+        sync_status.last_sync_wall_us = rtc_checkpoint.last_sync_wall_us;
+        sync_status.skew_ppb = rtc_checkpoint.skew_ppb;
+        portEXIT_CRITICAL(&rtc_lock);
+
+        ESP_LOGI(TAG, "Clock restored from RTC memory, %lld ms since the checkpoint%s",
+                 (long long)((rtc_us - rtc_checkpoint.rtc_us) / 1000),
+                 RTC_TIMER_ACCURATE ? "" : " timed on the RC oscillator");
+        return true;
+    }
+
+    if (nvs_open(RTC_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return false;
+    }
+
+    int64_t wall_us;
+    int64_t last_sync_wall_us;
+    if (nvs_get_i64(nvs, RTC_NVS_TIME_KEY, &wall_us) == ESP_OK &&
+        nvs_get_i64(nvs, RTC_NVS_SYNC_KEY, &last_sync_wall_us) == ESP_OK) {
+        // How long the device was off is unknown and the saved time carries the error of the clock that wrote it,
+        // which may have run fast, so it is an estimate rather than a bound
+        portENTER_CRITICAL(&rtc_lock);
+        rtc_clock.base_mono_us = esp_timer_get_time();
+        rtc_clock.base_wall_us = wall_us;
+        rtc_clock.slew_us = 0;
+        sync_status.valid = true;
+        sync_status.source = RTC_SOURCE_ESTIMATED;
+        sync_status.adjust_reason = ADJUST_REASON_MANUAL;
+        sync_status.last_sync_wall_us = last_sync_wall_us;
+        save_checkpoint();
+        portEXIT_CRITICAL(&rtc_lock);
+
+        ESP_LOGW(TAG, "Clock estimated from NVS, it misses the time the device was off");
+    }
+
+    nvs_close(nvs);
+
+    return false;
+}
+
+static void checkpoint_timer_cb(void *arg) {
+    portENTER_CRITICAL(&rtc_lock);
+    save_checkpoint();
+    portEXIT_CRITICAL(&rtc_lock);
+
+    if (++checkpoint_ticks % (RTC_NVS_CHECKPOINT_PERIOD_MS / RTC_CHECKPOINT_PERIOD_MS) == 0) {
+        persist_time();
+    }
+}
+
+static void shutdown_handler(void) {
+    portENTER_CRITICAL(&rtc_lock);
+    save_checkpoint();
+    portEXIT_CRITICAL(&rtc_lock);
+}
+
 static void timeval_to_rtc(const struct timeval *tv, rtc_time_t *rtc_time) {
     struct tm t;
     localtime_r(&tv->tv_sec, &t);
@@ -87,27 +571,33 @@ static void set_current_time(int year, int month, int day, int hour, int minute,
     t.tm_sec = second;
     t.tm_isdst = -1;  // Not considering daylight saving time
 
-    ESP_LOGI(TAG, "Setting time: %d-%d-%d %d:%d:%d.%d", year, month, day, hour, minute, second, milliseconds);
+    ESP_LOGI(TAG, "Setting time: %d-%d-%d %d:%d:%d.%03d", year, month, day, hour, minute, second, milliseconds);
 
     time_t time = mktime(&t);
     if (time == -1) {
         ESP_LOGE(TAG, "Failed to convert time");
+        return;
     }
 
-    struct timeval tv = { .tv_sec = time, .tv_usec = milliseconds * 1000 };
-    if (settimeofday(&tv, NULL) != 0) {
-        ESP_LOGE(TAG, "Failed to set system time");
-    }
+    const int64_t wall_us = (int64_t)time * 1000000 + (int64_t)milliseconds * 1000;
+
+    portENTER_CRITICAL(&rtc_lock);
+    rebase_clock(wall_us - clock_at(esp_timer_get_time()), true, ADJUST_REASON_MANUAL);
+    portEXIT_CRITICAL(&rtc_lock);
 
+    sync_system_time(0, true);
+    persist_time();
+
+    struct timeval tv = { .tv_sec = time, .tv_usec = milliseconds * 1000 };
     timeval_to_rtc(&tv, &rtc_register);
 }
 
 static void get_current_time(int *year, int *month, int *day, int *hour, int *minute, int *second, int *milliseconds, int *weekday) {
-    struct timeval tv_now;
-    gettimeofday(&tv_now, NULL);
+    const int64_t now_us = rtc_now_us();
+    const time_t seconds = (time_t)(now_us / 1000000);
     struct tm t;
-    localtime_r(&tv_now.tv_sec, &t);
-    *milliseconds = tv_now.tv_usec / 1000;
+    localtime_r(&seconds, &t);
+    *milliseconds = (int)(now_us % 1000000 / 1000);
 
     *year = t.tm_year + 1900;
     *month = t.tm_mon + 1;
@@ -119,16 +609,61 @@ static void get_current_time(int *year, int *month, int *day, int *hour, int *mi
 }
 
 /* Exported function definitions -------------------------------------------------------------------------------------*/
-void set_time(const uint8_t payload[10]) {
+void rtc_init(void) {
+    nvs_handle_t nvs;
+    int32_t skew_ppb = 0;
+
+    // Also done by ble_init, which erases a full partition; until then the NVS fallback is skipped
+    nvs_flash_init();
+
+    const bool from_checkpoint = restore_time();
+
+    if (nvs_open(RTC_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        if (nvs_get_i32(nvs, RTC_NVS_SKEW_KEY, &skew_ppb) == ESP_OK && abs(skew_ppb) <= RTC_DRIFT_MAX_PPB) {
+            persisted_skew_ppb = skew_ppb;
+
+            portENTER_CRITICAL(&rtc_lock);
+            // The checkpoint carries the latest fit, NVS only one that moved enough to be written
+            if (!from_checkpoint) {
+                set_skew(skew_ppb);
+                sync_status.skew_ppb = skew_ppb;
+            }
+            portEXIT_CRITICAL(&rtc_lock);
+
+            ESP_LOGI(TAG, "Restored clock skew %ld ppb", (long)skew_ppb);
+        }
+
+        nvs_close(nvs);
+    }
+
+    const esp_timer_create_args_t checkpoint_timer_args = {
+            .callback = checkpoint_timer_cb,
+            .name = "rtc_checkpoint",
+    };
+    if (esp_timer_create(&checkpoint_timer_args, &checkpoint_timer) == ESP_OK) {
+        esp_timer_start_periodic(checkpoint_timer, (uint64_t)RTC_CHECKPOINT_PERIOD_MS * 1000);
+    }
+
+    esp_register_shutdown_handler(shutdown_handler);
+    esp_deep_sleep_register_hook(shutdown_handler);
+}
+
+bool set_time(const uint8_t payload[10]) {
     int year = payload[0] | (payload[1] << 8);
     int month = payload[2];
     int day = payload[3];
     int hour = payload[4];
     int minute = payload[5];
     int second = payload[6];
-    int milliseconds = payload[8];
+    int milliseconds = (payload[8] * 1000 + 128) / 256;
 
-    set_current_time(year, month, day, hour, minute, second, milliseconds);
+    if (year < 1970 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 59) {
+        ESP_LOGW(TAG, "Invalid time %d-%d-%d %d:%d:%d", year, month, day, hour, minute, second);
+        return false;
+    }
+
+    set_current_time(year, month, day, hour, minute, second, milliseconds > 999 ? 999 : milliseconds);
+    return true;
 }
 
 
@@ -137,6 +672,10 @@ uint8_t* get_time(void) {
     int year, month, day, hour, minute, second, milliseconds, weekday;
     get_current_time(&year, &month, &day, &hour, &minute, &second, &milliseconds, &weekday);
 
+    portENTER_CRITICAL(&rtc_lock);
+    const uint8_t reason = sync_status.adjust_reason;
+    portEXIT_CRITICAL(&rtc_lock);
+
     payload[0] = year & 0xFF;
     payload[1] = (year >> 8) & 0xFF;
     payload[2] = month;
@@ -144,11 +683,119 @@ uint8_t* get_time(void) {
     payload[4] = hour;
     payload[5] = minute;
     payload[6] = second;
-    payload[7] = weekday;
-    payload[8] = milliseconds;
-    payload[9] = ADJUST_REASON;
+    payload[7] = weekday == 0 ? 7 : weekday;  // Current Time counts Monday as 1 and Sunday as 7
+    payload[8] = milliseconds * 256 / 1000;
+    payload[9] = reason;
 
     return payload;
 }
 
+int64_t rtc_now_us(void) {
+    return rtc_wall_time_us(esp_timer_get_time());
+}
+
+int64_t rtc_wall_time_us(int64_t mono_us) {
+    portENTER_CRITICAL(&rtc_lock);
+    const int64_t wall_us = clock_at(mono_us);
+    portEXIT_CRITICAL(&rtc_lock);
+
+    return wall_us;
+}
+
+bool rtc_sync_update(int64_t t1_us, int64_t t2_us, int64_t t3_us, int64_t t4_us, rtc_sync_result_t *result) {
+    const int64_t now_us = esp_timer_get_time();
+
+    result->offset_us = ((t2_us - t1_us) + (t3_us - t4_us)) / 2;
+    result->rtt_us = (t4_us - t1_us) - (t3_us - t2_us);
+    result->applied = false;
+    result->stepped = false;
+
+    portENTER_CRITICAL(&rtc_lock);
+
+    const bool new_burst = burst_last_us == 0 || now_us - burst_last_us > RTC_SYNC_BURST_GAP_US;
+    if (new_burst) {
+        burst_min_rtt_us = INT64_MAX;
+    }
+    burst_last_us = now_us;
+
+    if (result->rtt_us >= 0 && result->rtt_us <= RTC_SYNC_MAX_RTT_US && result->rtt_us < burst_min_rtt_us) {
+        burst_min_rtt_us = result->rtt_us;
+    }
+
+    // Queuing delay only ever adds to the round trip, the fastest exchanges carry the most accurate offsets
+    if (result->rtt_us < 0 || result->rtt_us > RTC_SYNC_MAX_RTT_US ||
+        result->rtt_us > burst_min_rtt_us + RTC_SYNC_RTT_MARGIN_US) {
+        sync_status.rejected++;
+        portEXIT_CRITICAL(&rtc_lock);
+        return false;
+    }
+
+    result->stepped = !sync_status.valid || llabs(result->offset_us) > RTC_STEP_THRESHOLD_US;
+    result->applied = true;
+
+    // The middle of the exchange on both clocks, the device one mapped back to esp_timer
+    const int64_t device_mid_us = t2_us + (t3_us - t2_us) / 2;
+    const int64_t mono_mid_us = now_us - (clock_at(now_us) - device_mid_us);
+    const rtc_sync_point_t point = {
+        .mono_us = mono_mid_us,
+        .offset_us = t1_us + (t4_us - t1_us) / 2 - mono_mid_us,
+        .rtt_us = result->rtt_us,
+    };
+
+    rebase_clock(-result->offset_us, result->stepped, ADJUST_REASON_EXTERNAL);
+    sync_status.syncs++;
+    sync_status.last_offset_us = result->offset_us;
+    sync_status.last_rtt_us = result->rtt_us;
+    sync_status.last_sync_us = now_us;
+
+    portEXIT_CRITICAL(&rtc_lock);
+
+    sync_system_time(-result->offset_us, result->stepped);
+    if (result->stepped) {
+        persist_time();
+    }
+
+    add_sync_point(&point, new_burst);
+
+    int32_t skew_ppb;
+    if (fit_skew(&skew_ppb)) {
+        portENTER_CRITICAL(&rtc_lock);
+        set_skew(skew_ppb);
+        sync_status.skew_ppb = skew_ppb;
+        sync_status.drift_points = (uint8_t)sync_point_count;
+        portEXIT_CRITICAL(&rtc_lock);
+
+        persist_skew(skew_ppb);
+    } else {
+        portENTER_CRITICAL(&rtc_lock);
+        sync_status.drift_points = (uint8_t)sync_point_count;
+        portEXIT_CRITICAL(&rtc_lock);
+    }
+
+    return true;
+}
+
+uint8_t rtc_time_quality(void) {
+    portENTER_CRITICAL(&rtc_lock);
+    const uint8_t source = sync_status.valid ? sync_status.source : RTC_SOURCE_UNSET;
+    const int64_t age_us = clock_at(esp_timer_get_time()) - sync_status.last_sync_wall_us;
+    portEXIT_CRITICAL(&rtc_lock);
+
+    int64_t age_h = source == RTC_SOURCE_UNSET || age_us < 0 ? RTC_QUALITY_AGE_MAX : age_us / 3600000000LL;
+    if (age_h > RTC_QUALITY_AGE_MAX) {
+        age_h = RTC_QUALITY_AGE_MAX;
+    }
+
+    return (uint8_t)(source | age_h << RTC_QUALITY_AGE_SHIFT);
+}
+
+void rtc_get_sync_status(rtc_sync_status_t *status) {
+    const int64_t now_us = esp_timer_get_time();
+
+    portENTER_CRITICAL(&rtc_lock);
+    *status = sync_status;
+    status->slew_remaining_us = rtc_clock.slew_us - slewed_part(now_us - rtc_clock.base_mono_us);
+    portEXIT_CRITICAL(&rtc_lock);
+}
+
 /* END OF FILE -------------------------------------------------------------------------------------------------------*/
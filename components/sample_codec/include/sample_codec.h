@@ -0,0 +1,172 @@
+/**
+  **********************************************************************************************************************
+  * @file    sample_codec.h
+  * @brief   This file is the header file for the lossless sensor sample block codec
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _SAMPLE_CODEC_H_
+#define _SAMPLE_CODEC_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Block summary decoded from the header and the time column only */
+typedef struct sample_codec_info_t {
+    uint8_t count;
+    uint8_t channels;
+    int64_t first_ms;
+    int64_t last_ms;
+} sample_codec_info_t;
+
+/** @brief Benchmark results, raw bytes count an int64 time and an int32 per channel for every sample */
+typedef struct sample_codec_benchmark_t {
+    uint32_t samples;
+    uint32_t blocks;
+    uint32_t raw_bytes;
+    uint32_t encoded_bytes;
+    uint32_t ratio_x100;
+    uint32_t encode_bytes_per_s;
+    uint32_t decode_bytes_per_s;
+    bool lossless;
+} sample_codec_benchmark_t;
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Channels and samples a block holds, bounded by the header fields. The session store summaries take
+ *            three columns per sensor channel. */
+#define SAMPLE_CODEC_MAX_CHANNELS 16
+#define SAMPLE_CODEC_MAX_SAMPLES 255
+
+/** @abstract Block header: [sample count u8][channel count u8][first time ms i64 LE] followed by, per channel,
+ *            [mode u8][first value i32 LE]. The mode holds the residual width in bits 0-5 and the predictor in
+ *            bit 6: 0 codes the difference to the previous value, 1 to the linear extrapolation of the previous two.
+ *            Every block decodes on its own, so a reader can start at any block. */
+#define SAMPLE_CODEC_HEADER_BYTES 10
+#define SAMPLE_CODEC_CHANNEL_HEADER_BYTES 5
+#define SAMPLE_CODEC_MODE_WIDTH_MASK 0x3F
+#define SAMPLE_CODEC_MODE_LINEAR 0x40
+
+/** @abstract Widest residual, the second difference of int32 values */
+#define SAMPLE_CODEC_MAX_WIDTH 34
+
+/** @abstract Bit stream after the header, least significant bit first. For every sample after the first, the
+ *            zigzag delta-of-delta of its time, the first delta taken against 0:
+ *            - '0': unchanged interval
+ *            - '1' '0' + 7 bits, '1' '1' '0' + 12 bits, '1' '1' '1' '0' + 20 bits, '1' '1' '1' '1' + 64 bits
+ *            then the channels one after the other, each as zigzag residuals of its mode width. */
+#define SAMPLE_CODEC_TIME_BITS_SHORT 7
+#define SAMPLE_CODEC_TIME_BITS_MEDIUM 12
+#define SAMPLE_CODEC_TIME_BITS_LONG 20
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+/** @abstract Largest encoded block: every time escaped and every residual of the widest width */
+#define SAMPLE_CODEC_MAX_BYTES(count, channels) \
+    (SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * (channels) + \
+     ((count) * (68 + SAMPLE_CODEC_MAX_WIDTH * (channels)) + 7) / 8)
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function sample_codec_encode
+ *
+ * @abstract This function encodes samples sharing a time column into one block. Each channel gets the predictor
+ *           and residual width that code it in the fewest bits, so slow breathing curves take a few bits per value.
+ *
+ * @param[in] times_ms: Sample times
+ *
+ * @param[in] values: Values, interleaved: values[i * channels + c]
+ *
+ * @param[in] count: Number of samples, 1 to SAMPLE_CODEC_MAX_SAMPLES
+ *
+ * @param[in] channels: Number of channels, 1 to SAMPLE_CODEC_MAX_CHANNELS
+ *
+ * @param[out] block: Encoded block
+ *
+ * @param[in] max_length: Size of block, SAMPLE_CODEC_MAX_BYTES(count, channels) always suffices
+ *
+ * @return Encoded block size in bytes, 0 if the arguments are out of range or the block does not fit
+ */
+size_t sample_codec_encode(const int64_t * times_ms, const int32_t * values, size_t count, size_t channels,
+                           uint8_t * block, size_t max_length);
+
+/*
+ * @function sample_codec_decode
+ *
+ * @abstract This function decodes one block
+ *
+ * @param[in] block: Encoded block
+ *
+ * @param[in] length: Encoded block size in bytes
+ *
+ * @param[out] times_ms: Sample times, may be NULL
+ *
+ * @param[out] values: Values, interleaved, may be NULL
+ *
+ * @param[in] max_count: Samples times_ms and values hold
+ *
+ * @param[in] max_channels: Channels values holds per sample
+ *
+ * @return Number of decoded samples, 0 if the block is malformed or does not fit
+ */
+size_t sample_codec_decode(const uint8_t * block, size_t length, int64_t * times_ms, int32_t * values,
+                           size_t max_count, size_t max_channels);
+
+/*
+ * @function sample_codec_peek
+ *
+ * @abstract This function returns the sample count, channels and time span of a block without decoding values
+ *
+ * @param[in] block: Encoded block
+ *
+ * @param[in] length: Encoded block size in bytes
+ *
+ * @param[out] info: Block summary
+ *
+ * @return false if the block is malformed
+ */
+bool sample_codec_peek(const uint8_t * block, size_t length, sample_codec_info_t * info);
+
+/*
+ * @function sample_codec_benchmark
+ *
+ * @abstract This function encodes a recording block by block, checks that decoding reproduces it exactly and
+ *           measures the compression ratio and throughput. It runs on the target and, built without ESP_PLATFORM,
+ *           on a host over exported sessions.
+ *
+ * @param[in] times_ms: Sample times
+ *
+ * @param[in] values: Values, interleaved
+ *
+ * @param[in] count: Number of samples
+ *
+ * @param[in] channels: Number of channels
+ *
+ * @param[in] block_samples: Samples per block
+ *
+ * @param[in] iterations: Number of passes over the recording
+ *
+ * @param[out] result: Benchmark results
+ *
+ * @return None
+ */
+void sample_codec_benchmark(const int64_t * times_ms, const int32_t * values, size_t count, size_t channels,
+                            size_t block_samples, uint32_t iterations, sample_codec_benchmark_t * result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SAMPLE_CODEC_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,561 @@
+/**
+  **********************************************************************************************************************
+  * @file    sample_codec.c
+  * @brief   This file is the lossless sensor sample block codec implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include "sample_codec.h"
+#ifdef ESP_PLATFORM
+#include "esp_timer.h"
+#else
+#include <time.h>
+#endif
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Least significant bit first bit stream over a byte buffer */
+typedef struct bit_stream_t {
+    uint8_t * data;
+    const uint8_t * source;
+    size_t bits;
+    size_t position;
+} bit_stream_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Time prefixes as written, least significant bit first: '10', '110', '1110' and '1111' */
+#define TIME_PREFIX_SHORT 0x1
+#define TIME_PREFIX_MEDIUM 0x3
+#define TIME_PREFIX_LONG 0x7
+#define TIME_PREFIX_ESCAPE 0xF
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#define zigzag(value) (((uint64_t)(value) << 1) ^ (uint64_t)((int64_t)(value) >> 63))
+#define unzigzag(value) ((int64_t)(((value) >> 1) ^ (0 - ((value) & 1))))
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putU32
+ *
+ * @abstract This function stores a little-endian uint32
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU32(uint8_t * data, uint32_t value);
+
+/*
+ * @function putU64
+ *
+ * @abstract This function stores a little-endian uint64
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU64(uint8_t * data, uint64_t value);
+
+/*
+ * @function getU32
+ *
+ * @abstract This function loads a little-endian uint32
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint32_t getU32(const uint8_t * data);
+
+/*
+ * @function getU64
+ *
+ * @abstract This function loads a little-endian uint64
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint64_t getU64(const uint8_t * data);
+
+/*
+ * @function bitWidth
+ *
+ * @abstract This function returns the number of bits an unsigned value needs
+ *
+ * @param[in] value: Value
+ *
+ * @return Bits, 0 for 0
+ */
+static uint8_t bitWidth(uint64_t value);
+
+/*
+ * @function writeBits
+ *
+ * @abstract This function appends the low bits of a value to a bit stream
+ *
+ * @param[in,out] stream: Bit stream
+ *
+ * @param[in] value: Value
+ *
+ * @param[in] width: Number of bits, up to 64
+ *
+ * @return false if the buffer is full
+ */
+static bool writeBits(bit_stream_t * stream, uint64_t value, uint8_t width);
+
+/*
+ * @function readBits
+ *
+ * @abstract This function takes bits from a bit stream
+ *
+ * @param[in,out] stream: Bit stream
+ *
+ * @param[in] width: Number of bits, up to 64
+ *
+ * @param[out] value: Value
+ *
+ * @return false if the stream ends first
+ */
+static bool readBits(bit_stream_t * stream, uint8_t width, uint64_t * value);
+
+/*
+ * @function writeTime
+ *
+ * @abstract This function appends a zigzag delta-of-delta with its length prefix
+ *
+ * @param[in,out] stream: Bit stream
+ *
+ * @param[in] value: Zigzag delta-of-delta
+ *
+ * @return false if the buffer is full
+ */
+static bool writeTime(bit_stream_t * stream, uint64_t value);
+
+/*
+ * @function readTimes
+ *
+ * @abstract This function decodes the time column of a block
+ *
+ * @param[in,out] stream: Bit stream, positioned at the time column
+ *
+ * @param[in] first_ms: Time of the first sample
+ *
+ * @param[in] count: Number of samples
+ *
+ * @param[out] times_ms: Sample times, may be NULL
+ *
+ * @param[out] last_ms: Time of the last sample
+ *
+ * @return false if the stream ends first
+ */
+static bool readTimes(bit_stream_t * stream, int64_t first_ms, size_t count, int64_t * times_ms, int64_t * last_ms);
+
+/*
+ * @function nowMicroseconds
+ *
+ * @abstract This function returns a monotonic timestamp
+ *
+ * @param None
+ *
+ * @return Time in microseconds
+ */
+static int64_t nowMicroseconds(void);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint8_t * putU32(uint8_t * data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    return data + 4;
+}
+
+static uint8_t * putU64(uint8_t * data, uint64_t value) {
+    return putU32(putU32(data, (uint32_t)value), (uint32_t)(value >> 32));
+}
+
+static uint32_t getU32(const uint8_t * data) {
+    return data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static uint64_t getU64(const uint8_t * data) {
+    return getU32(data) | (uint64_t)getU32(&data[4]) << 32;
+}
+
+static uint8_t bitWidth(uint64_t value) {
+    uint8_t width = 0;
+
+    while (value != 0) {
+        width++;
+        value >>= 1;
+    }
+
+    return width;
+}
+
+static bool writeBits(bit_stream_t * stream, uint64_t value, uint8_t width) {
+    if (stream->position + width > stream->bits) {
+        return false;
+    }
+
+    while (width > 0) {
+        const uint8_t shift = stream->position & 7;
+        const uint8_t taken = width < 8 - shift ? width : 8 - shift;
+        uint8_t * byte = &stream->data[stream->position >> 3];
+
+        /* Bytes are cleared as the stream reaches them, so the buffer needs no preparation */
+        if (shift == 0) {
+            *byte = 0;
+        }
+        *byte |= (uint8_t)((value & ((1u << taken) - 1)) << shift);
+
+        value >>= taken;
+        width -= taken;
+        stream->position += taken;
+    }
+
+    return true;
+}
+
+static bool readBits(bit_stream_t * stream, uint8_t width, uint64_t * value) {
+    if (stream->position + width > stream->bits) {
+        return false;
+    }
+
+    uint64_t result = 0;
+    uint8_t filled = 0;
+
+    while (filled < width) {
+        const uint8_t shift = stream->position & 7;
+        const uint8_t taken = width - filled < 8 - shift ? width - filled : 8 - shift;
+        const uint64_t bits = (stream->source[stream->position >> 3] >> shift) & ((1u << taken) - 1);
+
+        result |= bits << filled;
+        filled += taken;
+        stream->position += taken;
+    }
+
+    *value = result;
+    return true;
+}
+
+static bool writeTime(bit_stream_t * stream, uint64_t value) {
+    if (value == 0) {
+        return writeBits(stream, 0, 1);
+    }
+    if (value < (1u << SAMPLE_CODEC_TIME_BITS_SHORT)) {
+        return writeBits(stream, TIME_PREFIX_SHORT | value << 2, 2 + SAMPLE_CODEC_TIME_BITS_SHORT);
+    }
+    if (value < (1u << SAMPLE_CODEC_TIME_BITS_MEDIUM)) {
+        return writeBits(stream, TIME_PREFIX_MEDIUM | value << 3, 3 + SAMPLE_CODEC_TIME_BITS_MEDIUM);
+    }
+    if (value < (1u << SAMPLE_CODEC_TIME_BITS_LONG)) {
+        return writeBits(stream, TIME_PREFIX_LONG | value << 4, 4 + SAMPLE_CODEC_TIME_BITS_LONG);
+    }
+
+    return writeBits(stream, TIME_PREFIX_ESCAPE, 4) && writeBits(stream, value, 64);
+}
+
+static bool readTimes(bit_stream_t * stream, int64_t first_ms, size_t count, int64_t * times_ms, int64_t * last_ms) {
+    static const uint8_t widths[] = {
+        SAMPLE_CODEC_TIME_BITS_SHORT, SAMPLE_CODEC_TIME_BITS_MEDIUM, SAMPLE_CODEC_TIME_BITS_LONG, 64,
+    };
+    uint64_t time = (uint64_t)first_ms;
+    uint64_t delta = 0;
+
+    if (times_ms) {
+        times_ms[0] = first_ms;
+    }
+
+    for (size_t i = 1; i < count; i++) {
+        uint64_t bit = 0;
+        uint8_t ones = 0;
+
+        /* Up to four leading ones select the width, a zero ends the prefix early */
+        do {
+            if (!readBits(stream, 1, &bit)) {
+                return false;
+            }
+            ones += (uint8_t)bit;
+        } while (bit && ones < 4);
+
+        if (ones > 0) {
+            uint64_t value = 0;
+            if (!readBits(stream, widths[ones - 1], &value)) {
+                return false;
+            }
+            delta += (uint64_t)unzigzag(value);
+        }
+
+        /* Unsigned arithmetic wraps exactly as the encoder's did */
+        time += delta;
+        if (times_ms) {
+            times_ms[i] = (int64_t)time;
+        }
+    }
+
+    *last_ms = (int64_t)time;
+    return true;
+}
+
+static int64_t nowMicroseconds(void) {
+#ifdef ESP_PLATFORM
+    return esp_timer_get_time();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#endif
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+size_t sample_codec_encode(const int64_t * times_ms, const int32_t * values, size_t count, size_t channels,
+                           uint8_t * block, size_t max_length) {
+    const size_t header_bytes = SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * channels;
+
+    if (count < 1 || count > SAMPLE_CODEC_MAX_SAMPLES || channels < 1 || channels > SAMPLE_CODEC_MAX_CHANNELS ||
+        max_length < header_bytes) {
+        return 0;
+    }
+
+    uint8_t * cursor = block;
+    *cursor++ = (uint8_t)count;
+    *cursor++ = (uint8_t)channels;
+    cursor = putU64(cursor, (uint64_t)times_ms[0]);
+
+    /* One pass per channel finds the widest residual of either predictor, the narrower one wins */
+    uint8_t modes[SAMPLE_CODEC_MAX_CHANNELS];
+
+    for (size_t c = 0; c < channels; c++) {
+        int64_t previous = values[c];
+        int64_t before = previous;
+        uint64_t delta_bits = 0;
+        uint64_t linear_bits = 0;
+
+        for (size_t i = 1; i < count; i++) {
+            const int64_t value = values[i * channels + c];
+            delta_bits |= zigzag(value - previous);
+            linear_bits |= zigzag(value - 2 * previous + before);
+            before = previous;
+            previous = value;
+        }
+
+        const uint8_t delta_width = bitWidth(delta_bits);
+        const uint8_t linear_width = bitWidth(linear_bits);
+        modes[c] = linear_width < delta_width ? (uint8_t)(SAMPLE_CODEC_MODE_LINEAR | linear_width) : delta_width;
+
+        *cursor++ = modes[c];
+        cursor = putU32(cursor, (uint32_t)values[c]);
+    }
+
+    bit_stream_t stream = {
+        .data = cursor,
+        .bits = (max_length - header_bytes) * 8,
+    };
+
+    uint64_t delta = 0;
+    for (size_t i = 1; i < count; i++) {
+        const uint64_t next = (uint64_t)times_ms[i] - (uint64_t)times_ms[i - 1];
+        if (!writeTime(&stream, zigzag(next - delta))) {
+            return 0;
+        }
+        delta = next;
+    }
+
+    for (size_t c = 0; c < channels; c++) {
+        const uint8_t width = modes[c] & SAMPLE_CODEC_MODE_WIDTH_MASK;
+        const bool linear = modes[c] & SAMPLE_CODEC_MODE_LINEAR;
+        int64_t previous = values[c];
+        int64_t before = previous;
+
+        if (width == 0) {
+            continue;
+        }
+
+        for (size_t i = 1; i < count; i++) {
+            const int64_t value = values[i * channels + c];
+            const int64_t prediction = linear ? 2 * previous - before : previous;
+
+            if (!writeBits(&stream, zigzag(value - prediction), width)) {
+                return 0;
+            }
+            before = previous;
+            previous = value;
+        }
+    }
+
+    return header_bytes + (stream.position + 7) / 8;
+}
+
+size_t sample_codec_decode(const uint8_t * block, size_t length, int64_t * times_ms, int32_t * values,
+                           size_t max_count, size_t max_channels) {
+    sample_codec_info_t info;
+
+    if (!sample_codec_peek(block, length, &info) || info.count > max_count ||
+        (values && info.channels > max_channels)) {
+        return 0;
+    }
+
+    const size_t count = info.count;
+    const size_t channels = info.channels;
+    const size_t header_bytes = SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * channels;
+    int64_t last_ms;
+
+    bit_stream_t stream = {
+        .source = &block[header_bytes],
+        .bits = (length - header_bytes) * 8,
+    };
+
+    if (!readTimes(&stream, info.first_ms, count, times_ms, &last_ms)) {
+        return 0;
+    }
+
+    if (!values) {
+        return count;
+    }
+
+    for (size_t c = 0; c < channels; c++) {
+        const uint8_t * channel = &block[SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * c];
+        const uint8_t width = channel[0] & SAMPLE_CODEC_MODE_WIDTH_MASK;
+        const bool linear = channel[0] & SAMPLE_CODEC_MODE_LINEAR;
+        int64_t previous = (int32_t)getU32(&channel[1]);
+        int64_t before = previous;
+
+        values[c] = (int32_t)previous;
+
+        for (size_t i = 1; i < count; i++) {
+            uint64_t residual = 0;
+
+            if (width > 0 && !readBits(&stream, width, &residual)) {
+                return 0;
+            }
+
+            const int64_t value = (linear ? 2 * previous - before : previous) + unzigzag(residual);
+            values[i * max_channels + c] = (int32_t)value;
+            before = previous;
+            previous = value;
+        }
+    }
+
+    return count;
+}
+
+bool sample_codec_peek(const uint8_t * block, size_t length, sample_codec_info_t * info) {
+    if (length < SAMPLE_CODEC_HEADER_BYTES) {
+        return false;
+    }
+
+    const size_t count = block[0];
+    const size_t channels = block[1];
+    const size_t header_bytes = SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * channels;
+
+    if (count < 1 || channels < 1 || channels > SAMPLE_CODEC_MAX_CHANNELS || length < header_bytes) {
+        return false;
+    }
+
+    /* The residual columns are fixed width, so their size follows from the modes once the times are walked */
+    size_t residual_bits = 0;
+    for (size_t c = 0; c < channels; c++) {
+        const uint8_t mode = block[SAMPLE_CODEC_HEADER_BYTES + SAMPLE_CODEC_CHANNEL_HEADER_BYTES * c];
+        const uint8_t width = mode & SAMPLE_CODEC_MODE_WIDTH_MASK;
+
+        if (width > SAMPLE_CODEC_MAX_WIDTH || (mode & ~(SAMPLE_CODEC_MODE_LINEAR | SAMPLE_CODEC_MODE_WIDTH_MASK))) {
+            return false;
+        }
+        residual_bits += width * (count - 1);
+    }
+
+    bit_stream_t stream = {
+        .source = &block[header_bytes],
+        .bits = (length - header_bytes) * 8,
+    };
+
+    info->count = (uint8_t)count;
+    info->channels = (uint8_t)channels;
+    info->first_ms = (int64_t)getU64(&block[2]);
+
+    return readTimes(&stream, info->first_ms, count, NULL, &info->last_ms) &&
+           stream.position + residual_bits <= stream.bits;
+}
+
+void sample_codec_benchmark(const int64_t * times_ms, const int32_t * values, size_t count, size_t channels,
+                            size_t block_samples, uint32_t iterations, sample_codec_benchmark_t * result) {
+    memset(result, 0, sizeof(*result));
+
+    if (block_samples > SAMPLE_CODEC_MAX_SAMPLES) {
+        block_samples = SAMPLE_CODEC_MAX_SAMPLES;
+    }
+    if (block_samples < 1 || channels < 1 || channels > SAMPLE_CODEC_MAX_CHANNELS) {
+        return;
+    }
+
+    /* Blocks of 255 samples by 8 channels outgrow a task stack */
+    const size_t max_length = SAMPLE_CODEC_MAX_BYTES(block_samples, channels);
+    uint8_t * block = malloc(max_length);
+    int64_t * decoded_times = malloc(block_samples * sizeof(int64_t));
+    int32_t * decoded_values = malloc(block_samples * channels * sizeof(int32_t));
+    int64_t encode_us = 0;
+    int64_t decode_us = 0;
+
+    if (!block || !decoded_times || !decoded_values) {
+        free(block);
+        free(decoded_times);
+        free(decoded_values);
+        return;
+    }
+
+    result->lossless = true;
+
+    for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+        for (size_t offset = 0; offset < count; offset += block_samples) {
+            const size_t samples = count - offset < block_samples ? count - offset : block_samples;
+            const int32_t * source = &values[offset * channels];
+
+            int64_t start = nowMicroseconds();
+            size_t length = sample_codec_encode(&times_ms[offset], source, samples, channels, block, max_length);
+            int64_t middle = nowMicroseconds();
+            size_t decoded = sample_codec_decode(block, length, decoded_times, decoded_values, block_samples,
+                                                 channels);
+            decode_us += nowMicroseconds() - middle;
+            encode_us += middle - start;
+
+            if (length == 0 || decoded != samples ||
+                memcmp(decoded_times, &times_ms[offset], samples * sizeof(int64_t)) != 0 ||
+                memcmp(decoded_values, source, samples * channels * sizeof(int32_t)) != 0) {
+                result->lossless = false;
+            }
+
+            if (iteration == 0) {
+                result->blocks++;
+                result->encoded_bytes += (uint32_t)length;
+            }
+        }
+    }
+
+    free(block);
+    free(decoded_times);
+    free(decoded_values);
+
+    const uint64_t raw = (uint64_t)count * (sizeof(int64_t) + channels * sizeof(int32_t));
+    const uint64_t total = raw * iterations;
+    result->samples = (uint32_t)count;
+    result->raw_bytes = (uint32_t)raw;
+    result->ratio_x100 = result->encoded_bytes > 0 ? (uint32_t)(raw * 100 / result->encoded_bytes) : 0;
+    result->encode_bytes_per_s = encode_us > 0 ? (uint32_t)(total * 1000000 / (uint64_t)encode_us) : 0;
+    result->decode_bytes_per_s = decode_us > 0 ? (uint32_t)(total * 1000000 / (uint64_t)decode_us) : 0;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
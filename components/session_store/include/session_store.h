@@ -0,0 +1,419 @@
+/**
+  **********************************************************************************************************************
+  * @file    session_store.h
+  * @brief   This file is the header file for the log-structured on-flash session store
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -----------------------------------------------------------------------------*/
+#ifndef _SESSION_STORE_H_
+#define _SESSION_STORE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+/* Types ----------------------------------------------------------------------------------------------------*/
+/** @brief Session store counters
+ *
+ * record_bytes counts the records appended, headers included, and flash_bytes the bytes programmed, sector headers
+ * and the erased padding of flushed pages included. Their ratio is the write amplification on top of the record
+ * format; every programmed byte is erased exactly once per pass over the partition. data_bytes counts the DATA
+ * records alone, compression_x100 is what the samples take unencoded, SESSION_STORE_RAW_SAMPLE_BYTES each, over it.
+ * seek_sector_reads counts the sector indexes session_store_seek loaded, about log2 of the sectors used per seek.
+ * summaries_stored counts the summary intervals of all levels written and summary_bytes the SUMMARY records, which
+ * are not part of data_bytes.
+ *
+ */
+typedef struct session_store_stats_t {
+    bool mounted;
+    uint32_t session;
+    uint32_t sectors;
+    uint32_t sectors_used;
+    uint32_t sector_erases;
+    uint32_t flash_writes;
+    uint32_t records_written;
+    uint32_t records_dropped;
+    uint32_t samples_stored;
+    uint64_t record_bytes;
+    uint64_t flash_bytes;
+    uint32_t write_amplification_x100;
+    uint64_t data_bytes;
+    uint32_t compression_x100;
+    uint32_t records_recovered;
+    uint32_t records_corrupt;
+    uint32_t sessions_truncated;
+    uint32_t seeks;
+    uint32_t seek_sector_reads;
+    uint32_t summaries_stored;
+    uint64_t summary_bytes;
+} session_store_stats_t;
+
+/** @brief Range read callback
+ *
+ * Gets each record, header included, and its log position: sector sequence * SESSION_STORE_SECTOR_BYTES + offset
+ * in the sector. Positions only grow and a read can resume from one until its sector is overwritten. Returning false
+ * ends the read.
+ *
+ */
+typedef bool (*session_store_record_cb_t)(uint64_t position, const uint8_t * record, size_t length, void * arg);
+
+/* Constants ------------------------------------------------------------------------------------------------*/
+/** @abstract Data partition holding the log, see partitions.csv */
+#define SESSION_STORE_PARTITION_LABEL "sessions"
+#define SESSION_STORE_PARTITION_SUBTYPE 0x40
+
+/** @abstract Erase unit and program unit of the flash. The log never programs less than a page. */
+#define SESSION_STORE_SECTOR_BYTES 4096
+#define SESSION_STORE_PAGE_BYTES 256
+
+/** @abstract Sector header, little-endian: [magic u32][sequence u32][last session started u32][flags u32][crc32 u32].
+ *            The sequence grows by one per sector opened, the highest one is the head of the log. */
+#define SESSION_STORE_SECTOR_MAGIC 0x4C535331u
+#define SESSION_STORE_SECTOR_HEADER_BYTES 20
+#define SESSION_STORE_SECTOR_SESSION_OPEN 0x00000001u
+
+/** @abstract Record header, little-endian: [type u8][channels u8][payload length u16][crc32 u32]. The channels
+ *            byte holds the level of SUMMARY records and 0 in session records. The CRC covers the first four header
+ *            bytes and the payload. Records never straddle sectors and end before the index page, a 0xFF type marks
+ *            the erased rest of a flushed page. */
+#define SESSION_STORE_RECORD_HEADER_BYTES 8
+#define SESSION_STORE_RECORD_MAX_BYTES 512
+
+/** @abstract Sector index, the last page of a sector written when the log moves on. Little-endian:
+ *            [magic u32][entry count u16][reserved u16][crc32 u32 of the entries] followed by one entry per DATA
+ *            record stored with a set clock that starts at or after every time stored with a set clock before it:
+ *            [first time ms i64][record offset in the sector u16][sample count u8][channels u8]. A sector is closed
+ *            early once its index is full. */
+#define SESSION_STORE_INDEX_MAGIC 0x4C534931u
+#define SESSION_STORE_INDEX_BYTES SESSION_STORE_PAGE_BYTES
+#define SESSION_STORE_INDEX_HEADER_BYTES 12
+#define SESSION_STORE_INDEX_ENTRY_BYTES 12
+#define SESSION_STORE_INDEX_ENTRIES ((SESSION_STORE_INDEX_BYTES - SESSION_STORE_INDEX_HEADER_BYTES) / \
+                                     SESSION_STORE_INDEX_ENTRY_BYTES)
+#define SESSION_STORE_DATA_END (SESSION_STORE_SECTOR_BYTES - SESSION_STORE_INDEX_BYTES)
+
+/** @abstract Record types, payloads little-endian:
+ *            - START: [session u32][start time ms i64][sample period ms u16]
+ *            - DATA: [session u32][time quality u8] followed by a sample_codec block of the channels' samples, which
+ *              decodes on its own, so a DATA record is also sent as is over BLE
+ *            - END: [session u32][end time ms i64][samples u32][SESSION_STORE_END_* flags u8]
+ *            - SUMMARY: [session u32][level u8] followed by a sample_codec block with one sample per interval of the
+ *              level: its start time, then the minimum, maximum and mean of channel 0, of channel 1 and so on */
+#define SESSION_STORE_RECORD_START 0x01
+#define SESSION_STORE_RECORD_DATA 0x02
+#define SESSION_STORE_RECORD_END 0x03
+#define SESSION_STORE_RECORD_SUMMARY 0x04
+#define SESSION_STORE_RECORD_ERASED 0xFF
+
+/** @abstract END flags: the session was closed at the next boot, its end time is that of the last stored sample */
+#define SESSION_STORE_END_TRUNCATED 0x01
+
+/** @abstract Channels, in the order of the values main appends from the BME280 readings */
+#define SESSION_STORE_CHANNEL_TEMPERATURE 0
+#define SESSION_STORE_CHANNEL_HUMIDITY 1
+#define SESSION_STORE_CHANNEL_PRESSURE 2
+#define SESSION_STORE_CHANNELS 3
+
+/** @abstract A sample unencoded: its time as i64 and a value i32 per channel */
+#define SESSION_STORE_RAW_SAMPLE_BYTES (8 + 4 * SESSION_STORE_CHANNELS)
+
+/** @abstract Samples per block. A block is sealed earlier when the time quality changes, the clock steps back or it
+ *            is flushed, and split over several DATA records if it does not fit one. Longer blocks amortize the codec
+ *            header, at 10 Hz this one fills a record about when the flush is due. */
+#define SESSION_STORE_BLOCK_SAMPLES 120
+
+/** @abstract Summary levels, kept as samples are appended: the minimum, maximum and mean of every channel over
+ *            intervals of each period, aligned to multiples of it. An overview of a night is read from them without
+ *            touching the raw samples. */
+#define SESSION_STORE_SUMMARY_LEVELS 3
+#define SESSION_STORE_SUMMARY_PERIODS_MS {1000, 10000, 60000}
+#define SESSION_STORE_SUMMARY_STATS 3
+#define SESSION_STORE_SUMMARY_CHANNELS (SESSION_STORE_SUMMARY_STATS * SESSION_STORE_CHANNELS)
+
+/** @abstract Intervals per SUMMARY record. A level's block is sealed when full, on every flush and when the session
+ *            ends, so only the open intervals wait in RAM. A mount after a power cut rebuilds the intervals missing
+ *            from flash out of the session's DATA records before ending it. */
+#define SESSION_STORE_SUMMARY_BLOCK_INTERVALS 32
+
+/** @abstract Longest time a sample stays in RAM, bounding both the loss on a power cut and the padding written */
+#define SESSION_STORE_FLUSH_MS 12000
+
+/** @abstract Pages waiting for the writer task, enough to ride out a sector erase at any sample rate the sensors do */
+#define SESSION_STORE_QUEUE_PAGES 16
+
+/** @abstract Consecutive pages programmed in one flash write */
+#define SESSION_STORE_BATCH_PAGES 4
+
+/** @abstract Writer task stack size and priority, below the sensor task since it only drains the page queue */
+#define SESSION_STORE_TASK_STACK_SIZE 3072
+#define SESSION_STORE_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+
+/* Macros ---------------------------------------------------------------------------------------------------*/
+
+/* Variables ------------------------------------------------------------------------------------------------*/
+
+/* Functions ------------------------------------------------------------------------------------------------*/
+/*
+ * @function session_store_init
+ *
+ * @abstract This function mounts the log and starts the writer task. The head sector is scanned: the write position
+ *           resumes at its first erased page past the last valid record and past the length a torn record claims,
+ *           a torn record is skipped up to the next page, and a session a power cut left open gets its lost summary
+ *           intervals rebuilt from its samples and is closed with a truncated END record. A shutdown handler ends the
+ *           open session at its last sample and programs the log on every esp_restart.
+ *
+ * @param None
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t session_store_init(void);
+
+/*
+ * @function session_store_start
+ *
+ * @abstract This function opens a new session, ending the current one if any
+ *
+ * @param[in] time_ms: Start time in ms since the epoch
+ *
+ * @param[in] period_ms: Nominal sample period
+ *
+ * @param[out] id: Session id, may be NULL
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t session_store_start(int64_t time_ms, uint16_t period_ms, uint32_t * id);
+
+/*
+ * @function session_store_append
+ *
+ * @abstract This function adds a sample of every channel to the open block. It never waits for the flash: full
+ *           pages are handed to the writer task, and a record the page queue has no room for is dropped and counted.
+ *           The time is stored as given. Once a set clock steps back, e.g. restored from a lagging NVS copy and then
+ *           synced, the blocks before the latest time already stored are left out of the index.
+ *
+ * @param[in] time_ms: Sample time in ms since the epoch
+ *
+ * @param[in] values: SESSION_STORE_CHANNELS values, indexed by SESSION_STORE_CHANNEL_*
+ *
+ * @param[in] quality: Time quality of the sample, see rtc_time_quality
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_INVALID_STATE if no session is open
+ */
+esp_err_t session_store_append(int64_t time_ms, const int32_t * values, uint8_t quality);
+
+/*
+ * @function session_store_stop
+ *
+ * @abstract This function seals the open block, ends the session and returns once the log is programmed. Call it
+ *           before esp_deep_sleep_start: deep sleep hooks run in a critical section and cannot write flash.
+ *
+ * @param[in] time_ms: End time in ms since the epoch
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_INVALID_STATE if no session is open
+ */
+esp_err_t session_store_stop(int64_t time_ms);
+
+/*
+ * @function session_store_flush
+ *
+ * @abstract This function seals the open block and the closed summary intervals, pads the partial page with erased
+ *           bytes and returns once every queued page is programmed. The next record starts on the following page.
+ *
+ * @param None
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t session_store_flush(void);
+
+/*
+ * @function session_store_seek
+ *
+ * @abstract This function finds where samples of a time start in the log without scanning it: a binary search over
+ *           the sectors by the first time of their index, then over the entries of one index. The position returned
+ *           is that of the earliest block that may hold samples at or after the time. Blocks stored before the clock
+ *           was set count from boot, blocks stored after it stepped back overlap earlier ones; neither is indexed and
+ *           both are only reached by reading on.
+ *
+ * @param[in] time_ms: Time in ms since the epoch
+ *
+ * @param[out] position: Log position, see session_store_record_cb_t
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_NOT_FOUND if nothing was written yet
+ */
+esp_err_t session_store_seek(int64_t time_ms, uint64_t * position);
+
+/*
+ * @function session_store_read
+ *
+ * @abstract This function reads the next START, DATA or END record at or after a log position, skipping padding, torn
+ *           records, overwritten sectors and the summaries. Only records already programmed are returned, see
+ *           session_store_flush.
+ *
+ * @param[in,out] position: Log position, advanced past the record
+ *
+ * @param[out] record: Record, header included
+ *
+ * @param[in] max_length: Size of record, SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_RECORD_MAX_BYTES always
+ *                        suffices
+ *
+ * @param[out] length: Record length
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_NOT_FOUND at the end of the log
+ */
+esp_err_t session_store_read(uint64_t * position, uint8_t * record, size_t max_length, size_t * length);
+
+/*
+ * @function session_store_read_sessions
+ *
+ * @abstract This function reads the next START or END record at or after a log position. Sectors whose headers show
+ *           neither are skipped unread and only the headers of the other records are read, so listing the sessions of
+ *           a full partition takes a fraction of reading it.
+ *
+ * @param[in,out] position: Log position, advanced past the record
+ *
+ * @param[out] record: Record, header included
+ *
+ * @param[in] max_length: Size of record
+ *
+ * @param[out] length: Record length
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_NOT_FOUND at the end of the log
+ */
+esp_err_t session_store_read_sessions(uint64_t * position, uint8_t * record, size_t max_length, size_t * length);
+
+/*
+ * @function session_store_seek_summaries
+ *
+ * @abstract This function finds where the summaries of a level covering a time may start in the log. A SUMMARY
+ *           record is appended after the DATA records of its intervals, so the seek backs up by one interval and
+ *           the time a block waits in RAM.
+ *
+ * @param[in] level: Summary level, below SESSION_STORE_SUMMARY_LEVELS
+ *
+ * @param[in] time_ms: Time in ms since the epoch
+ *
+ * @param[out] position: Log position, see session_store_record_cb_t
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_NOT_FOUND if nothing was written yet
+ */
+esp_err_t session_store_seek_summaries(uint8_t level, int64_t time_ms, uint64_t * position);
+
+/*
+ * @function session_store_read_summaries
+ *
+ * @abstract This function reads the next START, END or SUMMARY record of a level at or after a log position. Only
+ *           the headers of the other records are read.
+ *
+ * @param[in] level: Summary level, below SESSION_STORE_SUMMARY_LEVELS
+ *
+ * @param[in,out] position: Log position, advanced past the record
+ *
+ * @param[out] record: Record, header included
+ *
+ * @param[in] max_length: Size of record
+ *
+ * @param[out] length: Record length
+ *
+ * @return
+ *      - esp_err_t status code, ESP_ERR_NOT_FOUND at the end of the log
+ */
+esp_err_t session_store_read_summaries(uint8_t level, uint64_t * position, uint8_t * record, size_t max_length,
+                                       size_t * length);
+
+/*
+ * @function session_store_read_range
+ *
+ * @abstract This function seeks to from_ms and streams the DATA records overlapping [from_ms, to_ms], and the
+ *           session records between them, in log order. Blocks stored before the clock was set are skipped, their
+ *           times count from boot. Blocks stored after the clock stepped back are only returned where they lie
+ *           between the indexed ones of the range.
+ *
+ * @param[in] from_ms: First time in ms since the epoch
+ *
+ * @param[in] to_ms: Last time in ms since the epoch
+ *
+ * @param[in] callback: Called for each record
+ *
+ * @param[in] arg: Passed to callback
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t session_store_read_range(int64_t from_ms, int64_t to_ms, session_store_record_cb_t callback, void * arg);
+
+/*
+ * @function session_store_read_summary_range
+ *
+ * @abstract This function streams the SUMMARY records of a level overlapping [from_ms, to_ms], and the session
+ *           records between them, in log order
+ *
+ * @param[in] level: Summary level, below SESSION_STORE_SUMMARY_LEVELS
+ *
+ * @param[in] from_ms: First time in ms since the epoch
+ *
+ * @param[in] to_ms: Last time in ms since the epoch
+ *
+ * @param[in] callback: Called for each record
+ *
+ * @param[in] arg: Passed to callback
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+esp_err_t session_store_read_summary_range(uint8_t level, int64_t from_ms, int64_t to_ms,
+                                           session_store_record_cb_t callback, void * arg);
+
+/*
+ * @function session_store_data_span
+ *
+ * @abstract This function returns the sample count and time span of a DATA or SUMMARY record from its block header
+ *           and time column, without decoding the values. The span of a summary runs to the end of its last interval.
+ *
+ * @param[in] record: Record, header included
+ *
+ * @param[in] length: Record length
+ *
+ * @param[out] first_ms: Time of the first sample
+ *
+ * @param[out] last_ms: Time of the last sample, or the last ms of the last interval
+ *
+ * @return Sample or interval count, 0 if the record is not a well-formed DATA or SUMMARY record
+ */
+uint8_t session_store_data_span(const uint8_t * record, size_t length, int64_t * first_ms, int64_t * last_ms);
+
+/*
+ * @function session_store_get_stats
+ *
+ * @abstract This function returns the session store counters
+ *
+ * @param[out] stats: Counters
+ *
+ * @return None
+ */
+void session_store_get_stats(session_store_stats_t * stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // _SESSION_STORE_H_
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
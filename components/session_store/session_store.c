@@ -0,0 +1,2098 @@
+/**
+  **********************************************************************************************************************
+  * @file    session_store.c
+  * @brief   This file is the log-structured on-flash session store implementation
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdlib.h>
+#include <string.h>
+#include "session_store.h"
+#include "sample_codec.h"
+#include "rtc_driver.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Samples waiting to be sealed into DATA records, values interleaved by channel */
+typedef struct {
+    uint8_t count;
+    uint8_t quality;
+    int64_t times_ms[SESSION_STORE_BLOCK_SAMPLES];
+    int32_t values[SESSION_STORE_BLOCK_SAMPLES * SESSION_STORE_CHANNELS];
+} session_block_t;
+
+/** @brief Summary level: the open interval of each channel and the closed intervals waiting to be sealed into a
+ *         SUMMARY record, statistics interleaved as in the record */
+typedef struct {
+    uint32_t count;
+    int64_t interval_ms;
+    int32_t minimum[SESSION_STORE_CHANNELS];
+    int32_t maximum[SESSION_STORE_CHANNELS];
+    int64_t sum[SESSION_STORE_CHANNELS];
+    uint8_t intervals;
+    int64_t times_ms[SESSION_STORE_SUMMARY_BLOCK_INTERVALS];
+    int32_t values[SESSION_STORE_SUMMARY_BLOCK_INTERVALS * SESSION_STORE_SUMMARY_CHANNELS];
+} session_summary_t;
+
+/** @brief Page handed to the writer task */
+typedef struct {
+    uint32_t sequence;
+    uint32_t address;
+    uint8_t data[SESSION_STORE_PAGE_BYTES];
+} session_page_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+#define SESSION_STORE_DATA_HEADER_BYTES 5
+#define SESSION_STORE_START_BYTES 14
+#define SESSION_STORE_END_BYTES 17
+#define SESSION_STORE_SUMMARY_HEADER_BYTES 5
+
+/** @abstract Sectors scanned back for the summaries of a session a power cut left open. Every flush seals the closed
+ *            intervals, so each level has a SUMMARY record within its period plus SESSION_STORE_FLUSH_MS of the last
+ *            sample, well inside three sectors of samples. */
+#define SESSION_STORE_REBUILD_SECTORS 3
+
+/** @abstract readRecord filters besides a summary level: START, DATA and END records, or START and END records */
+#define SESSION_STORE_READ_RAW (-2)
+#define SESSION_STORE_READ_SESSIONS (-1)
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+#define alignUp(value, unit) (((value) + (unit) - 1) / (unit) * (unit))
+
+/** @abstract Whether a time quality byte says the clock was set, rather than counting from boot */
+#define timeIsSet(quality) (((quality) & ((1u << RTC_QUALITY_AGE_SHIFT) - 1u)) != RTC_SOURCE_UNSET)
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+static const char * TAG = "SESSION_STORE";
+
+/** @abstract Sessions partition */
+static const esp_partition_t * partition = NULL;
+
+/** @abstract Guards everything below except the page queue */
+static SemaphoreHandle_t store_lock = NULL;
+
+/** @abstract Pages waiting for the writer task, in log order */
+static QueueHandle_t page_queue = NULL;
+
+/** @abstract Held by the writer task while it erases and by readers while they read, so no read sees a sector being
+ *            recycled */
+static SemaphoreHandle_t erase_lock = NULL;
+
+/** @abstract Held while pages are taken off the queue and programmed, so a synchronous flush never overtakes a page
+ *            the writer task took */
+static SemaphoreHandle_t write_lock = NULL;
+
+/** @abstract Pages programmed in one flash write and the page being taken off the queue, guarded by write_lock */
+static uint8_t batch[SESSION_STORE_BATCH_PAGES * SESSION_STORE_PAGE_BYTES];
+static session_page_t queued;
+
+/** @abstract Number of sectors in the partition */
+static uint32_t sector_count = 0;
+
+/** @abstract Head sector, its sequence number and the offset of the page being filled in it */
+static uint32_t head_sector = 0;
+static uint32_t head_sequence = 0;
+static uint32_t page_offset = 0;
+
+/** @abstract Page being filled and the bytes in it */
+static uint8_t page[SESSION_STORE_PAGE_BYTES];
+static uint32_t page_fill = 0;
+
+/** @abstract Index entries of the head sector, written as its last page when the log moves on */
+static uint8_t head_index[SESSION_STORE_INDEX_ENTRIES * SESSION_STORE_INDEX_ENTRY_BYTES];
+static uint32_t head_index_count = 0;
+
+/** @abstract Sector the writer task programmed last, its sequence and the end of the programmed pages in it. Readers
+ *            stop there, records behind it may still sit in the page queue. */
+static uint32_t written_sector = 0;
+static uint32_t written_sequence = 0;
+static uint32_t written_offset = 0;
+
+/** @abstract Sector indexes loaded by readers, guarded by erase_lock */
+static uint32_t index_reads = 0;
+
+/** @abstract Open session, 0 if none, the last one started and the next id */
+static uint32_t session = 0;
+static uint32_t last_session = 0;
+static uint32_t session_samples = 0;
+
+/** @abstract Time of the last sample appended to the open session, or its start time */
+static int64_t session_last_ms = 0;
+
+/** @abstract Latest time stored with a set clock. A DATA record starting before it, stored after the clock stepped
+ *            back, is left out of the index so the indexed times never run backwards, which session_store_seek
+ *            relies on. */
+static int64_t log_last_ms = INT64_MIN;
+
+/** @abstract Open block and the DATA payload it is encoded into */
+static session_block_t block;
+static uint8_t data_payload[SESSION_STORE_RECORD_MAX_BYTES];
+
+/** @abstract Summary levels and their periods */
+static session_summary_t summaries[SESSION_STORE_SUMMARY_LEVELS];
+static const uint32_t summary_periods_ms[SESSION_STORE_SUMMARY_LEVELS] = SESSION_STORE_SUMMARY_PERIODS_MS;
+
+/** @abstract esp_timer time the oldest sample not yet handed to the writer task was appended, 0 if none */
+static int64_t pending_since_us = 0;
+
+/** @abstract Counters */
+static session_store_stats_t stats;
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function putU16
+ *
+ * @abstract This function stores a little-endian uint16
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU16(uint8_t * data, uint16_t value);
+
+/*
+ * @function putU32
+ *
+ * @abstract This function stores a little-endian uint32
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU32(uint8_t * data, uint32_t value);
+
+/*
+ * @function putU64
+ *
+ * @abstract This function stores a little-endian uint64
+ *
+ * @param[out] data: Destination
+ *
+ * @param[in] value: Value
+ *
+ * @return Pointer past the value
+ */
+static uint8_t * putU64(uint8_t * data, uint64_t value);
+
+/*
+ * @function getU16
+ *
+ * @abstract This function loads a little-endian uint16
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint16_t getU16(const uint8_t * data);
+
+/*
+ * @function getU32
+ *
+ * @abstract This function loads a little-endian uint32
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint32_t getU32(const uint8_t * data);
+
+/*
+ * @function getU64
+ *
+ * @abstract This function loads a little-endian uint64
+ *
+ * @param[in] data: Source
+ *
+ * @return Value
+ */
+static uint64_t getU64(const uint8_t * data);
+
+/*
+ * @function recordCrc
+ *
+ * @abstract This function computes the CRC of a record
+ *
+ * @param[in] header: First four record header bytes
+ *
+ * @param[in] payload: Payload
+ *
+ * @param[in] length: Payload length
+ *
+ * @return CRC-32
+ */
+static uint32_t recordCrc(const uint8_t * header, const uint8_t * payload, uint16_t length);
+
+/*
+ * @function isErased
+ *
+ * @abstract This function checks whether a range reads as erased flash
+ *
+ * @param[in] data: Range
+ *
+ * @param[in] length: Range length
+ *
+ * @return true if every byte is 0xFF
+ */
+static bool isErased(const uint8_t * data, size_t length);
+
+/*
+ * @function putIndexEntry
+ *
+ * @abstract This function encodes a sector index entry
+ *
+ * @param[out] entry: SESSION_STORE_INDEX_ENTRY_BYTES bytes
+ *
+ * @param[in] first_ms: Time of the first sample of the block
+ *
+ * @param[in] offset: Record offset in the sector
+ *
+ * @param[in] count: Samples in the block
+ *
+ * @param[in] channels: Channels in the block
+ *
+ * @return None
+ */
+static void putIndexEntry(uint8_t * entry, int64_t first_ms, uint32_t offset, uint8_t count, uint8_t channels);
+
+/*
+ * @function dataRecordSpan
+ *
+ * @abstract This function decodes the time span of a DATA record from its time column, or of a SUMMARY record,
+ *           whose payload header is as long
+ *
+ * @param[in] record: Record, header included
+ *
+ * @param[in] length: Record length
+ *
+ * @param[out] first_ms: Time of the first sample
+ *
+ * @param[out] last_ms: Time of the last sample
+ *
+ * @return Sample count, 0 if the record is malformed
+ */
+static uint8_t dataRecordSpan(const uint8_t * record, size_t length, int64_t * first_ms, int64_t * last_ms);
+
+/*
+ * @function nextRecord
+ *
+ * @abstract This function finds the record at or after an offset of a sector image, skipping page padding
+ *
+ * @param[in] sector: Sector image
+ *
+ * @param[in,out] offset: Offset, left on the record
+ *
+ * @param[in] end: Offset records end before
+ *
+ * @return Record length, header included, 0 at the end of the records, -1 if the record at offset is torn
+ */
+static int nextRecord(const uint8_t * sector, uint32_t * offset, uint32_t end);
+
+/*
+ * @function queuePage
+ *
+ * @abstract This function pads a page of the head sector with erased bytes and hands it to the writer task. Callers
+ *           hold store_lock.
+ *
+ * @param[in] offset: Page offset in the sector
+ *
+ * @param[in] data: Page content
+ *
+ * @param[in] length: Content length
+ *
+ * @return None
+ */
+static void queuePage(uint32_t offset, const uint8_t * data, uint32_t length);
+
+/*
+ * @function emitPage
+ *
+ * @abstract This function queues the page being filled and moves to the next page. Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void emitPage(void);
+
+/*
+ * @function sealSector
+ *
+ * @abstract This function queues the index of the head sector as its last page. Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void sealSector(void);
+
+/*
+ * @function openSector
+ *
+ * @abstract This function moves the head to the next sector, overwriting the oldest one once the log wrapped, and
+ *           starts its first page with the sector header. Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void openSector(void);
+
+/*
+ * @function appendRecord
+ *
+ * @abstract This function appends a record to the log. Callers hold store_lock.
+ *
+ * @param[in] type: SESSION_STORE_RECORD_* type
+ *
+ * @param[in] channel: Channel, 0 for session records
+ *
+ * @param[in] payload: Payload
+ *
+ * @param[in] length: Payload length
+ *
+ * @param[out] offset: Record offset in the head sector, may be NULL
+ *
+ * @return false if the page queue has no room for the record
+ */
+static bool appendRecord(uint8_t type, uint8_t channel, const uint8_t * payload, uint16_t length, uint32_t * offset);
+
+/*
+ * @function sealBlock
+ *
+ * @abstract This function encodes the open block into DATA records, split in halves until each part fits a record.
+ *           Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void sealBlock(void);
+
+/*
+ * @function addToSummary
+ *
+ * @abstract This function adds a sample to the open interval of a summary level, closing the interval first if the
+ *           sample falls outside it. Callers hold store_lock.
+ *
+ * @param[in] level: Summary level
+ *
+ * @param[in] time_ms: Sample time in ms since the epoch
+ *
+ * @param[in] values: SESSION_STORE_CHANNELS values
+ *
+ * @return None
+ */
+static void addToSummary(size_t level, int64_t time_ms, const int32_t * values);
+
+/*
+ * @function addToSummaries
+ *
+ * @abstract This function adds a sample to every summary level. Callers hold store_lock.
+ *
+ * @param[in] time_ms: Sample time in ms since the epoch
+ *
+ * @param[in] values: SESSION_STORE_CHANNELS values
+ *
+ * @return None
+ */
+static void addToSummaries(int64_t time_ms, const int32_t * values);
+
+/*
+ * @function closeInterval
+ *
+ * @abstract This function moves the open interval of a summary level into its block, sealing the block when full.
+ *           Callers hold store_lock.
+ *
+ * @param[in] level: Summary level
+ *
+ * @return None
+ */
+static void closeInterval(size_t level);
+
+/*
+ * @function sealSummary
+ *
+ * @abstract This function encodes the block of a summary level into SUMMARY records, split in halves until each part
+ *           fits a record. Callers hold store_lock.
+ *
+ * @param[in] level: Summary level
+ *
+ * @return None
+ */
+static void sealSummary(size_t level);
+
+/*
+ * @function sealSummaries
+ *
+ * @abstract This function closes the open intervals and seals the blocks of every summary level, at the end of a
+ *           session. Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void sealSummaries(void);
+
+/*
+ * @function endSession
+ *
+ * @abstract This function appends the END record of a session. Callers hold store_lock.
+ *
+ * @param[in] id: Session id
+ *
+ * @param[in] time_ms: End time in ms since the epoch
+ *
+ * @param[in] samples: Samples stored in the session
+ *
+ * @param[in] flags: SESSION_STORE_END_* flags
+ *
+ * @return None
+ */
+static void endSession(uint32_t id, int64_t time_ms, uint32_t samples, uint8_t flags);
+
+/*
+ * @function closeSession
+ *
+ * @abstract This function seals the open block and summaries and ends the open session, store_lock must be held
+ *
+ * @param[in] time_ms: End time
+ *
+ * @return None
+ */
+static void closeSession(int64_t time_ms);
+
+/*
+ * @function flushLocked
+ *
+ * @abstract This function seals the open block and the closed summary intervals and queues the partial page. The
+ *           open intervals stay in RAM. Callers hold store_lock.
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void flushLocked(void);
+
+/*
+ * @function mountLog
+ *
+ * @abstract This function finds the head sector and the write position, recovering from a power cut
+ *
+ * @param None
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+static esp_err_t mountLog(void);
+
+/*
+ * @function loadSector
+ *
+ * @abstract This function reads the records of a sector and checks its header. Callers hold store_lock.
+ *
+ * @param[in] index: Sector index in the partition
+ *
+ * @param[in] sequence: Sequence the sector must carry
+ *
+ * @param[out] sector: Sector image, SESSION_STORE_DATA_END bytes
+ *
+ * @return true if the sector holds that sequence
+ */
+static bool loadSector(uint32_t index, uint32_t sequence, uint8_t * sector);
+
+/*
+ * @function rebuildSummaries
+ *
+ * @abstract This function rebuilds the summary intervals a power cut lost from the DATA records of a session and
+ *           seals them. Each level resumes past its last SUMMARY record, found at most SESSION_STORE_REBUILD_SECTORS
+ *           back; a level without one there restarts at the oldest sector scanned. Callers hold store_lock.
+ *
+ * @param[in] id: Session id
+ *
+ * @param[out] sector: Scratch buffer, SESSION_STORE_DATA_END bytes
+ *
+ * @return None
+ */
+static void rebuildSummaries(uint32_t id, uint8_t * sector);
+
+/*
+ * @function sectorAddress
+ *
+ * @abstract This function locates a programmed sector by its sequence and checks its header. Callers hold
+ *           erase_lock.
+ *
+ * @param[in] sequence: Sector sequence
+ *
+ * @param[out] address: Partition offset of the sector
+ *
+ * @return false if the sector was not written yet, was overwritten or is damaged
+ */
+static bool sectorAddress(uint32_t sequence, uint32_t * address);
+
+/*
+ * @function sectorHoldsSessions
+ *
+ * @abstract This function tells from the sector headers whether a sector may hold START or END records: a START
+ *           raises the last session of the next sector header, or of its own if it opened the sector, and an END
+ *           clears the open flag. Callers hold erase_lock.
+ *
+ * @param[in] sequence: Sector sequence
+ *
+ * @param[in] newest: Newest written sequence
+ *
+ * @return false if the sector holds DATA records only
+ */
+static bool sectorHoldsSessions(uint32_t sequence, uint32_t newest);
+
+/*
+ * @function loadIndex
+ *
+ * @abstract This function reads the index of a sector, rebuilding it from the records if the sector was not closed.
+ *           Callers hold erase_lock.
+ *
+ * @param[in] sequence: Sector sequence
+ *
+ * @param[out] entries: SESSION_STORE_INDEX_ENTRIES entries
+ *
+ * @return Number of entries, -1 if the sector is not available
+ */
+static int loadIndex(uint32_t sequence, uint8_t * entries);
+
+/*
+ * @function indexFloor
+ *
+ * @abstract This function returns the last time of the newest indexed DATA record before a sector. A record is
+ *           indexed only if it starts at or after it. Callers hold erase_lock.
+ *
+ * @param[in] sequence: Sector sequence
+ *
+ * @return Last time, INT64_MIN if no earlier sector still holds an indexed record
+ */
+static int64_t indexFloor(uint32_t sequence);
+
+/*
+ * @function sectorFirstTime
+ *
+ * @abstract This function returns the first block time of a sector, or of the next one holding blocks. Callers hold
+ *           erase_lock.
+ *
+ * @param[in] sequence: Sector sequence
+ *
+ * @param[in] last: Last sequence to look at
+ *
+ * @param[out] entries: Scratch, SESSION_STORE_INDEX_ENTRIES entries
+ *
+ * @param[out] first_ms: First block time
+ *
+ * @return false if none of the sectors holds a block
+ */
+static bool sectorFirstTime(uint32_t sequence, uint32_t last, uint8_t * entries, int64_t * first_ms);
+
+/*
+ * @function readRecord
+ *
+ * @abstract This function implements the session_store_read functions. Callers hold erase_lock.
+ *
+ * @param[in,out] position: Log position
+ *
+ * @param[out] record: Record
+ *
+ * @param[in] max_length: Size of record
+ *
+ * @param[out] length: Record length
+ *
+ * @param[in] filter: SESSION_STORE_READ_RAW, SESSION_STORE_READ_SESSIONS to also skip the sectors holding no session
+ *                    record, or a summary level
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+static esp_err_t readRecord(uint64_t * position, uint8_t * record, size_t max_length, size_t * length, int filter);
+
+/*
+ * @function readFiltered
+ *
+ * @abstract This function takes erase_lock around readRecord
+ *
+ * @param[in,out] position: Log position
+ *
+ * @param[out] record: Record
+ *
+ * @param[in] max_length: Size of record
+ *
+ * @param[out] length: Record length
+ *
+ * @param[in] filter: See readRecord
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+static esp_err_t readFiltered(uint64_t * position, uint8_t * record, size_t max_length, size_t * length, int filter);
+
+/*
+ * @function readRange
+ *
+ * @abstract This function implements session_store_read_range and session_store_read_summary_range
+ *
+ * @param[in] filter: SESSION_STORE_READ_RAW or a summary level
+ *
+ * @param[in] from_ms: First time in ms since the epoch
+ *
+ * @param[in] to_ms: Last time in ms since the epoch
+ *
+ * @param[in] callback: Called for each record
+ *
+ * @param[in] arg: Passed to callback
+ *
+ * @return
+ *      - esp_err_t status code
+ */
+static esp_err_t readRange(int filter, int64_t from_ms, int64_t to_ms, session_store_record_cb_t callback,
+                           void * arg);
+
+/*
+ * @function writePages
+ *
+ * @abstract This function programs consecutive pages, erasing the sector first when they start one
+ *
+ * @param[in] sequence: Sequence of the sector
+ *
+ * @param[in] address: Partition offset of the first page
+ *
+ * @param[in] data: Pages
+ *
+ * @param[in] length: Length, a multiple of SESSION_STORE_PAGE_BYTES
+ *
+ * @return None
+ */
+static void writePages(uint32_t sequence, uint32_t address, const uint8_t * data, size_t length);
+
+/*
+ * @function writeBatch
+ *
+ * @abstract This function takes the next page off the queue, together with the consecutive pages of the same sector
+ *           behind it, and programs them in one write, write_lock must be held
+ *
+ * @param None
+ *
+ * @return true if a page was taken
+ */
+static bool writeBatch(void);
+
+/*
+ * @function drainPages
+ *
+ * @abstract This function programs every queued page from the calling task before returning
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void drainPages(void);
+
+/*
+ * @function shutdownHandler
+ *
+ * @abstract This function ends the open session and programs the log before a software restart, so the session is
+ *           closed cleanly rather than truncated on the next mount
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void shutdownHandler(void);
+
+/*
+ * @function vSessionStoreTask
+ *
+ * @abstract This function is the writer task: it programs queued pages in batches and flushes samples that waited
+ *           SESSION_STORE_FLUSH_MS
+ *
+ * @param[in] pvParameters: Unused
+ *
+ * @return None
+ */
+static void vSessionStoreTask(void * pvParameters);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint8_t * putU16(uint8_t * data, uint16_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    return data + 2;
+}
+
+static uint8_t * putU32(uint8_t * data, uint32_t value) {
+    data[0] = (uint8_t)value;
+    data[1] = (uint8_t)(value >> 8);
+    data[2] = (uint8_t)(value >> 16);
+    data[3] = (uint8_t)(value >> 24);
+    return data + 4;
+}
+
+static uint8_t * putU64(uint8_t * data, uint64_t value) {
+    for (size_t i = 0; i < 8; i++) {
+        data[i] = (uint8_t)(value >> (8 * i));
+    }
+    return data + 8;
+}
+
+static uint16_t getU16(const uint8_t * data) {
+    return data[0] | (uint16_t)data[1] << 8;
+}
+
+static uint32_t getU32(const uint8_t * data) {
+    return data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static uint64_t getU64(const uint8_t * data) {
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < 8; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    return value;
+}
+
+static uint32_t recordCrc(const uint8_t * header, const uint8_t * payload, uint16_t length) {
+    return esp_rom_crc32_le(esp_rom_crc32_le(0, header, 4), payload, length);
+}
+
+static bool isErased(const uint8_t * data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        if (data[i] != 0xFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void putIndexEntry(uint8_t * entry, int64_t first_ms, uint32_t offset, uint8_t count, uint8_t channels) {
+    entry = putU64(entry, (uint64_t)first_ms);
+    entry = putU16(entry, (uint16_t)offset);
+    entry[0] = count;
+    entry[1] = channels;
+}
+
+static uint8_t dataRecordSpan(const uint8_t * record, size_t length, int64_t * first_ms, int64_t * last_ms) {
+    const size_t header_bytes = SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_DATA_HEADER_BYTES;
+    sample_codec_info_t info;
+
+    if (length < header_bytes || !sample_codec_peek(&record[header_bytes], length - header_bytes, &info)) {
+        return 0;
+    }
+
+    *first_ms = info.first_ms;
+    *last_ms = info.last_ms;
+    return info.count;
+}
+
+static int nextRecord(const uint8_t * sector, uint32_t * offset, uint32_t end) {
+    while (*offset + SESSION_STORE_RECORD_HEADER_BYTES <= end) {
+        const uint8_t * record = &sector[*offset];
+
+        if (record[0] == SESSION_STORE_RECORD_ERASED) {
+            /* Padding of a flushed page, or the end of the records on a page boundary */
+            if (*offset % SESSION_STORE_PAGE_BYTES == 0) {
+                return 0;
+            }
+            *offset = alignUp(*offset, SESSION_STORE_PAGE_BYTES);
+            continue;
+        }
+
+        const uint16_t length = getU16(&record[2]);
+
+        if (length > SESSION_STORE_RECORD_MAX_BYTES || *offset + SESSION_STORE_RECORD_HEADER_BYTES + length > end ||
+            getU32(&record[4]) != recordCrc(record, &record[SESSION_STORE_RECORD_HEADER_BYTES], length)) {
+            return -1;
+        }
+
+        return SESSION_STORE_RECORD_HEADER_BYTES + length;
+    }
+
+    return 0;
+}
+
+static void queuePage(uint32_t offset, const uint8_t * data, uint32_t length) {
+    session_page_t queued;
+
+    queued.sequence = head_sequence;
+    queued.address = head_sector * SESSION_STORE_SECTOR_BYTES + offset;
+    memcpy(queued.data, data, length);
+    memset(&queued.data[length], 0xFF, SESSION_STORE_PAGE_BYTES - length);
+
+    /* appendRecord made sure there is room, so the log never has a hole */
+    if (xQueueSend(page_queue, &queued, 0) != pdTRUE) {
+        ESP_LOGE(TAG, "Page queue overflow at 0x%08lx", (unsigned long)queued.address);
+    }
+}
+
+static void emitPage(void) {
+    queuePage(page_offset, page, page_fill);
+    page_offset += SESSION_STORE_PAGE_BYTES;
+    page_fill = 0;
+}
+
+static void sealSector(void) {
+    uint8_t index[SESSION_STORE_INDEX_BYTES];
+    const uint32_t entries_length = head_index_count * SESSION_STORE_INDEX_ENTRY_BYTES;
+    uint8_t * cursor = index;
+
+    cursor = putU32(cursor, SESSION_STORE_INDEX_MAGIC);
+    cursor = putU16(cursor, (uint16_t)head_index_count);
+    cursor = putU16(cursor, 0xFFFF);
+    cursor = putU32(cursor, esp_rom_crc32_le(0, head_index, entries_length));
+    memcpy(cursor, head_index, entries_length);
+
+    queuePage(SESSION_STORE_DATA_END, index, SESSION_STORE_INDEX_HEADER_BYTES + entries_length);
+    page_offset = SESSION_STORE_SECTOR_BYTES;
+}
+
+static void openSector(void) {
+    head_sector = (head_sector + 1) % sector_count;
+    head_sequence++;
+    page_offset = 0;
+    head_index_count = 0;
+
+    if (stats.sectors_used < sector_count) {
+        stats.sectors_used++;
+    }
+
+    uint8_t * cursor = page;
+    cursor = putU32(cursor, SESSION_STORE_SECTOR_MAGIC);
+    cursor = putU32(cursor, head_sequence);
+    cursor = putU32(cursor, last_session);
+    cursor = putU32(cursor, session != 0 ? SESSION_STORE_SECTOR_SESSION_OPEN : 0);
+    cursor = putU32(cursor, esp_rom_crc32_le(0, page, (uint32_t)(cursor - page)));
+    page_fill = (uint32_t)(cursor - page);
+}
+
+static bool appendRecord(uint8_t type, uint8_t channel, const uint8_t * payload, uint16_t length, uint32_t * offset) {
+    const uint32_t total = SESSION_STORE_RECORD_HEADER_BYTES + length;
+
+    /* Pages the record completes, the partial page behind it, the index and a sector header */
+    const uint32_t pages = (page_fill + total) / SESSION_STORE_PAGE_BYTES + 3;
+    if (uxQueueSpacesAvailable(page_queue) < pages) {
+        stats.records_dropped++;
+        return false;
+    }
+
+    /* The rest of the data area stays erased, the scan skips it like page padding */
+    if (page_offset + page_fill + total > SESSION_STORE_DATA_END ||
+        (type == SESSION_STORE_RECORD_DATA && head_index_count == SESSION_STORE_INDEX_ENTRIES)) {
+        if (page_fill > 0) {
+            emitPage();
+        }
+        if (page_offset < SESSION_STORE_SECTOR_BYTES) {
+            sealSector();
+        }
+        openSector();
+    }
+
+    if (offset != NULL) {
+        *offset = page_offset + page_fill;
+    }
+
+    uint8_t header[SESSION_STORE_RECORD_HEADER_BYTES];
+    header[0] = type;
+    header[1] = channel;
+    putU16(&header[2], length);
+    putU32(&header[4], recordCrc(header, payload, length));
+
+    const uint8_t * parts[2] = {header, payload};
+    const uint32_t part_lengths[2] = {SESSION_STORE_RECORD_HEADER_BYTES, length};
+
+    for (size_t i = 0; i < 2; i++) {
+        uint32_t done = 0;
+
+        while (done < part_lengths[i]) {
+            uint32_t chunk = SESSION_STORE_PAGE_BYTES - page_fill;
+            if (chunk > part_lengths[i] - done) {
+                chunk = part_lengths[i] - done;
+            }
+
+            memcpy(&page[page_fill], &parts[i][done], chunk);
+            page_fill += chunk;
+            done += chunk;
+
+            if (page_fill == SESSION_STORE_PAGE_BYTES) {
+                emitPage();
+            }
+        }
+    }
+
+    stats.records_written++;
+    stats.record_bytes += total;
+    return true;
+}
+
+static void sealBlock(void) {
+    size_t done = 0;
+
+    putU32(data_payload, session);
+    data_payload[4] = block.quality;
+
+    while (done < block.count) {
+        size_t count = block.count - done;
+        size_t length;
+
+        /* Noisy stretches compress worse, a block that outgrows the record is halved until it fits */
+        while ((length = sample_codec_encode(&block.times_ms[done], &block.values[done * SESSION_STORE_CHANNELS],
+                                             count, SESSION_STORE_CHANNELS,
+                                             &data_payload[SESSION_STORE_DATA_HEADER_BYTES],
+                                             sizeof(data_payload) - SESSION_STORE_DATA_HEADER_BYTES)) == 0) {
+            count = (count + 1) / 2;
+        }
+
+        uint32_t offset;
+        const uint16_t total = (uint16_t)(SESSION_STORE_DATA_HEADER_BYTES + length);
+
+        if (appendRecord(SESSION_STORE_RECORD_DATA, SESSION_STORE_CHANNELS, data_payload, total, &offset)) {
+            if (timeIsSet(block.quality)) {
+                if (block.times_ms[done] >= log_last_ms) {
+                    putIndexEntry(&head_index[head_index_count * SESSION_STORE_INDEX_ENTRY_BYTES],
+                                  block.times_ms[done], offset, (uint8_t)count, SESSION_STORE_CHANNELS);
+                    head_index_count++;
+                }
+                if (block.times_ms[done + count - 1] > log_last_ms) {
+                    log_last_ms = block.times_ms[done + count - 1];
+                }
+            }
+            stats.samples_stored += (uint32_t)count;
+            stats.data_bytes += SESSION_STORE_RECORD_HEADER_BYTES + total;
+            session_samples += (uint32_t)count;
+        }
+
+        done += count;
+    }
+
+    block.count = 0;
+}
+
+static void addToSummary(size_t level, int64_t time_ms, const int32_t * values) {
+    session_summary_t * summary = &summaries[level];
+    const int64_t period = summary_periods_ms[level];
+    const int64_t interval_ms = time_ms - ((time_ms % period) + period) % period;
+
+    if (summary->count > 0 && interval_ms != summary->interval_ms) {
+        closeInterval(level);
+    }
+
+    for (size_t c = 0; c < SESSION_STORE_CHANNELS; c++) {
+        if (summary->count == 0 || values[c] < summary->minimum[c]) {
+            summary->minimum[c] = values[c];
+        }
+        if (summary->count == 0 || values[c] > summary->maximum[c]) {
+            summary->maximum[c] = values[c];
+        }
+        summary->sum[c] = (summary->count == 0 ? 0 : summary->sum[c]) + values[c];
+    }
+
+    summary->interval_ms = interval_ms;
+    summary->count++;
+}
+
+static void addToSummaries(int64_t time_ms, const int32_t * values) {
+    for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+        addToSummary(level, time_ms, values);
+    }
+}
+
+static void closeInterval(size_t level) {
+    session_summary_t * summary = &summaries[level];
+
+    if (summary->count == 0) {
+        return;
+    }
+
+    int32_t * values = &summary->values[summary->intervals * SESSION_STORE_SUMMARY_CHANNELS];
+    const int64_t count = summary->count;
+
+    for (size_t c = 0; c < SESSION_STORE_CHANNELS; c++) {
+        const int64_t sum = summary->sum[c];
+
+        /* Rounded to the nearest, half away from zero */
+        *values++ = summary->minimum[c];
+        *values++ = summary->maximum[c];
+        *values++ = (int32_t)((sum >= 0 ? sum + count / 2 : sum - count / 2) / count);
+    }
+
+    summary->times_ms[summary->intervals] = summary->interval_ms;
+    summary->intervals++;
+    summary->count = 0;
+    stats.summaries_stored++;
+
+    if (summary->intervals == SESSION_STORE_SUMMARY_BLOCK_INTERVALS) {
+        sealSummary(level);
+    }
+}
+
+static void sealSummary(size_t level) {
+    session_summary_t * summary = &summaries[level];
+    size_t done = 0;
+
+    putU32(data_payload, session);
+    data_payload[4] = (uint8_t)level;
+
+    while (done < summary->intervals) {
+        size_t count = summary->intervals - done;
+        size_t length;
+
+        while ((length = sample_codec_encode(&summary->times_ms[done],
+                                             &summary->values[done * SESSION_STORE_SUMMARY_CHANNELS], count,
+                                             SESSION_STORE_SUMMARY_CHANNELS,
+                                             &data_payload[SESSION_STORE_SUMMARY_HEADER_BYTES],
+                                             sizeof(data_payload) - SESSION_STORE_SUMMARY_HEADER_BYTES)) == 0) {
+            count = (count + 1) / 2;
+        }
+
+        const uint16_t total = (uint16_t)(SESSION_STORE_SUMMARY_HEADER_BYTES + length);
+
+        if (appendRecord(SESSION_STORE_RECORD_SUMMARY, (uint8_t)level, data_payload, total, NULL)) {
+            stats.summary_bytes += SESSION_STORE_RECORD_HEADER_BYTES + total;
+        }
+
+        done += count;
+    }
+
+    summary->intervals = 0;
+}
+
+static void sealSummaries(void) {
+    for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+        closeInterval(level);
+        sealSummary(level);
+    }
+}
+
+static void endSession(uint32_t id, int64_t time_ms, uint32_t samples, uint8_t flags) {
+    uint8_t payload[SESSION_STORE_END_BYTES];
+    uint8_t * cursor = payload;
+
+    cursor = putU32(cursor, id);
+    cursor = putU64(cursor, (uint64_t)time_ms);
+    cursor = putU32(cursor, samples);
+    *cursor++ = flags;
+
+    appendRecord(SESSION_STORE_RECORD_END, 0, payload, (uint16_t)(cursor - payload), NULL);
+}
+
+static void closeSession(int64_t time_ms) {
+    sealBlock();
+    sealSummaries();
+    endSession(session, time_ms, session_samples, 0);
+    session = 0;
+    stats.session = 0;
+}
+
+static void flushLocked(void) {
+    sealBlock();
+
+    /* Summaries trail the samples by the open intervals only, which a mount after a power cut rebuilds */
+    for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+        sealSummary(level);
+    }
+
+    if (page_fill > 0) {
+        emitPage();
+    }
+
+    pending_since_us = 0;
+}
+
+static esp_err_t mountLog(void) {
+    uint8_t header[SESSION_STORE_SECTOR_HEADER_BYTES];
+    bool found = false;
+
+    sector_count = partition->size / SESSION_STORE_SECTOR_BYTES;
+    stats.sectors = sector_count;
+
+    for (uint32_t i = 0; i < sector_count; i++) {
+        esp_err_t error = esp_partition_read(partition, i * SESSION_STORE_SECTOR_BYTES, header, sizeof(header));
+        if (error != ESP_OK) {
+            return error;
+        }
+
+        if (getU32(header) != SESSION_STORE_SECTOR_MAGIC ||
+            getU32(&header[16]) != esp_rom_crc32_le(0, header, 16)) {
+            continue;
+        }
+
+        stats.sectors_used++;
+
+        const uint32_t sequence = getU32(&header[4]);
+        if (!found || sequence > head_sequence) {
+            found = true;
+            head_sector = i;
+            head_sequence = sequence;
+        }
+    }
+
+    if (!found) {
+        /* Empty log, the first record opens sector 0 */
+        head_sector = sector_count - 1;
+        head_sequence = 0;
+        page_offset = SESSION_STORE_SECTOR_BYTES;
+        ESP_LOGI(TAG, "Empty log, %lu sectors", (unsigned long)sector_count);
+        return ESP_OK;
+    }
+
+    uint8_t * sector = malloc(SESSION_STORE_SECTOR_BYTES);
+    if (sector == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t error = esp_partition_read(partition, head_sector * SESSION_STORE_SECTOR_BYTES, sector,
+                                         SESSION_STORE_SECTOR_BYTES);
+    if (error != ESP_OK) {
+        free(sector);
+        return error;
+    }
+
+    /* The index goes on from the last indexed time of the sectors before */
+    written_sector = head_sector;
+    written_sequence = head_sequence;
+    log_last_ms = indexFloor(head_sequence);
+
+    last_session = getU32(&sector[8]);
+    uint32_t open_session = (getU32(&sector[12]) & SESSION_STORE_SECTOR_SESSION_OPEN) ? last_session : 0;
+    uint32_t open_samples = 0;
+    int64_t last_ms = 0;
+    uint32_t torn_end = 0;
+    uint32_t offset = SESSION_STORE_SECTOR_HEADER_BYTES;
+    int length;
+
+    while ((length = nextRecord(sector, &offset, SESSION_STORE_DATA_END)) != 0) {
+        if (length < 0) {
+            /* Torn by a power cut during programming. Writes resumed on the next erased page after it, so the
+             * scan does too rather than losing what a later boot appended to this sector. */
+            const uint32_t claimed_end = offset + SESSION_STORE_RECORD_HEADER_BYTES + getU16(&sector[offset + 2]);
+
+            if (claimed_end <= SESSION_STORE_DATA_END && claimed_end > torn_end) {
+                torn_end = claimed_end;
+            }
+
+            stats.records_corrupt++;
+            offset = alignUp(offset + 1, SESSION_STORE_PAGE_BYTES);
+            continue;
+        }
+
+        const uint8_t * record = &sector[offset];
+        const uint8_t * payload = &record[SESSION_STORE_RECORD_HEADER_BYTES];
+        int64_t first_ms;
+        uint8_t count;
+
+        switch (record[0]) {
+            case SESSION_STORE_RECORD_START:
+                if (length >= SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_START_BYTES) {
+                    open_session = getU32(payload);
+                    last_session = open_session;
+                    open_samples = 0;
+                    last_ms = (int64_t)getU64(&payload[4]);
+                }
+                break;
+
+            case SESSION_STORE_RECORD_DATA:
+                count = dataRecordSpan(record, (size_t)length, &first_ms, &last_ms);
+                if (count > 0 && timeIsSet(payload[4])) {
+                    if (first_ms >= log_last_ms && head_index_count < SESSION_STORE_INDEX_ENTRIES) {
+                        putIndexEntry(&head_index[head_index_count * SESSION_STORE_INDEX_ENTRY_BYTES], first_ms,
+                                      offset, count, record[1]);
+                        head_index_count++;
+                    }
+                    if (last_ms > log_last_ms) {
+                        log_last_ms = last_ms;
+                    }
+                }
+                open_samples += count;
+                break;
+
+            case SESSION_STORE_RECORD_END:
+                if (length >= SESSION_STORE_RECORD_HEADER_BYTES + 4 && getU32(payload) == open_session) {
+                    open_session = 0;
+                }
+                break;
+
+            default:
+                break;
+        }
+
+        stats.records_recovered++;
+        offset += (uint32_t)length;
+    }
+
+    /* Writes resume on the first page a power cut left fully erased */
+    offset = alignUp(offset, SESSION_STORE_PAGE_BYTES);
+    while (offset < SESSION_STORE_DATA_END && !isErased(&sector[offset], SESSION_STORE_PAGE_BYTES)) {
+        offset += SESSION_STORE_PAGE_BYTES;
+    }
+
+    /* Readers step over a record they filter out by its length without checking it, so nothing is written where a
+     * torn record claims to reach: the step lands on erased bytes and moves on to the next page */
+    page_offset = offset > alignUp(torn_end, SESSION_STORE_PAGE_BYTES) ? offset :
+                  alignUp(torn_end, SESSION_STORE_PAGE_BYTES);
+
+    /* A sector whose index page was programmed is closed, even if the cut tore the index */
+    if (!isErased(&sector[SESSION_STORE_DATA_END], SESSION_STORE_INDEX_BYTES)) {
+        page_offset = SESSION_STORE_SECTOR_BYTES;
+    }
+
+    written_offset = page_offset;
+
+    ESP_LOGI(TAG, "Head sector %lu (sequence %lu) at 0x%03lx, %lu records, %lu corrupt, last session %lu",
+             (unsigned long)head_sector, (unsigned long)head_sequence, (unsigned long)page_offset,
+             (unsigned long)stats.records_recovered, (unsigned long)stats.records_corrupt,
+             (unsigned long)last_session);
+
+    /* A session without END was cut short, its samples up to the last record are kept. Sessions started in an
+     * earlier sector only count the samples of the head sector. */
+    if (open_session != 0) {
+        ESP_LOGW(TAG, "Session %lu was not closed, truncating", (unsigned long)open_session);
+        rebuildSummaries(open_session, sector);
+        endSession(open_session, last_ms, open_samples, SESSION_STORE_END_TRUNCATED);
+        stats.sessions_truncated++;
+    }
+    free(sector);
+
+    return ESP_OK;
+}
+
+static bool loadSector(uint32_t index, uint32_t sequence, uint8_t * sector) {
+    const uint32_t address = index * SESSION_STORE_SECTOR_BYTES;
+
+    return esp_partition_read(partition, address, sector, SESSION_STORE_DATA_END) == ESP_OK &&
+           getU32(sector) == SESSION_STORE_SECTOR_MAGIC && getU32(&sector[4]) == sequence &&
+           getU32(&sector[16]) == esp_rom_crc32_le(0, sector, 16);
+}
+
+static void rebuildSummaries(uint32_t id, uint8_t * sector) {
+    /* Sealing a full summary block may open a sector, so the walk is anchored to the head found by the scan */
+    const uint32_t newest_sector = head_sector;
+    const uint32_t newest = head_sequence;
+    int64_t from_ms[SESSION_STORE_SUMMARY_LEVELS];
+    bool found[SESSION_STORE_SUMMARY_LEVELS];
+    int64_t oldest_ms = INT64_MAX;
+    size_t resolved = 0;
+    bool started = false;
+    uint32_t sectors = 0;
+
+    for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+        from_ms[level] = INT64_MIN;
+        found[level] = false;
+    }
+
+    /* Back from the head until every level's last SUMMARY record and the samples past it, or the START of the
+     * session, are found. A flush writes the SUMMARY records behind the DATA records, which may end the sector
+     * before. */
+    while (resolved < SESSION_STORE_SUMMARY_LEVELS && !started && sectors < SESSION_STORE_REBUILD_SECTORS &&
+           sectors < newest && sectors < sector_count &&
+           loadSector((newest_sector + sector_count - sectors) % sector_count, newest - sectors, sector)) {
+        uint32_t offset = SESSION_STORE_SECTOR_HEADER_BYTES;
+        int length;
+
+        while ((length = nextRecord(sector, &offset, SESSION_STORE_DATA_END)) != 0) {
+            if (length < 0) {
+                offset = alignUp(offset + 1, SESSION_STORE_PAGE_BYTES);
+                continue;
+            }
+
+            const uint8_t * record = &sector[offset];
+            const uint8_t * payload = &record[SESSION_STORE_RECORD_HEADER_BYTES];
+            const size_t header_bytes = SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_SUMMARY_HEADER_BYTES;
+            sample_codec_info_t info;
+            int64_t first_ms;
+            int64_t last_ms;
+
+            if (record[0] == SESSION_STORE_RECORD_START &&
+                length >= SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_START_BYTES && getU32(payload) == id) {
+                started = true;
+            } else if (record[0] == SESSION_STORE_RECORD_SUMMARY && record[1] < SESSION_STORE_SUMMARY_LEVELS &&
+                       !found[record[1]] && getU32(payload) == id && (size_t)length > header_bytes &&
+                       sample_codec_peek(&record[header_bytes], (size_t)length - header_bytes, &info)) {
+                /* Records are in time order, the last one of the level in the newest sector wins */
+                from_ms[record[1]] = info.last_ms + summary_periods_ms[record[1]];
+            } else if (record[0] == SESSION_STORE_RECORD_DATA && getU32(payload) == id &&
+                       dataRecordSpan(record, (size_t)length, &first_ms, &last_ms) > 0 && first_ms < oldest_ms) {
+                oldest_ms = first_ms;
+            }
+
+            offset += (uint32_t)length;
+        }
+
+        sectors++;
+        resolved = 0;
+        for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+            found[level] = from_ms[level] != INT64_MIN;
+            resolved += found[level] && oldest_ms < from_ms[level];
+        }
+    }
+
+    /* Oldest sector first, each level fed the samples past its last stored interval. The empty open block serves as
+     * decode buffer. */
+    while (sectors > 0) {
+        sectors--;
+
+        if (!loadSector((newest_sector + sector_count - sectors) % sector_count, newest - sectors, sector)) {
+            continue;
+        }
+
+        uint32_t offset = SESSION_STORE_SECTOR_HEADER_BYTES;
+        int length;
+
+        while ((length = nextRecord(sector, &offset, SESSION_STORE_DATA_END)) != 0) {
+            if (length < 0) {
+                offset = alignUp(offset + 1, SESSION_STORE_PAGE_BYTES);
+                continue;
+            }
+
+            const uint8_t * record = &sector[offset];
+            const size_t header_bytes = SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_DATA_HEADER_BYTES;
+
+            if (record[0] == SESSION_STORE_RECORD_DATA && (size_t)length > header_bytes &&
+                getU32(&record[SESSION_STORE_RECORD_HEADER_BYTES]) == id) {
+                const size_t count = sample_codec_decode(&record[header_bytes], (size_t)length - header_bytes,
+                                                         block.times_ms, block.values, SESSION_STORE_BLOCK_SAMPLES,
+                                                         SESSION_STORE_CHANNELS);
+
+                for (size_t i = 0; i < count; i++) {
+                    for (size_t level = 0; level < SESSION_STORE_SUMMARY_LEVELS; level++) {
+                        if (block.times_ms[i] >= from_ms[level]) {
+                            addToSummary(level, block.times_ms[i], &block.values[i * SESSION_STORE_CHANNELS]);
+                        }
+                    }
+                }
+            }
+
+            offset += (uint32_t)length;
+        }
+    }
+
+    /* The SUMMARY records carry the open session */
+    session = id;
+    sealSummaries();
+    session = 0;
+}
+
+static bool sectorAddress(uint32_t sequence, uint32_t * address) {
+    uint8_t header[SESSION_STORE_SECTOR_HEADER_BYTES];
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    const uint32_t newest = written_sequence;
+    const uint32_t newest_sector = written_sector;
+    xSemaphoreGive(store_lock);
+
+    if (sequence == 0 || sequence > newest || newest - sequence >= sector_count) {
+        return false;
+    }
+
+    *address = (newest_sector + sector_count - (newest - sequence)) % sector_count * SESSION_STORE_SECTOR_BYTES;
+
+    return esp_partition_read(partition, *address, header, sizeof(header)) == ESP_OK &&
+           getU32(header) == SESSION_STORE_SECTOR_MAGIC && getU32(&header[4]) == sequence &&
+           getU32(&header[16]) == esp_rom_crc32_le(0, header, 16);
+}
+
+static bool sectorHoldsSessions(uint32_t sequence, uint32_t newest) {
+    uint8_t headers[3][SESSION_STORE_SECTOR_HEADER_BYTES];
+
+    for (uint32_t i = 0; i < 3; i++) {
+        uint32_t address;
+
+        /* A neighbour that is gone or not written yet gives no evidence, the sector is scanned */
+        if (sequence + i < 1 || sequence + i - 1 > newest || !sectorAddress(sequence + i - 1, &address) ||
+            esp_partition_read(partition, address, headers[i], SESSION_STORE_SECTOR_HEADER_BYTES) != ESP_OK) {
+            return true;
+        }
+    }
+
+    /* Last session started and flags */
+    return memcmp(&headers[0][8], &headers[1][8], 8) != 0 || memcmp(&headers[1][8], &headers[2][8], 8) != 0;
+}
+
+static int loadIndex(uint32_t sequence, uint8_t * entries) {
+    uint8_t header[SESSION_STORE_INDEX_HEADER_BYTES];
+    uint32_t address;
+
+    index_reads++;
+
+    if (!sectorAddress(sequence, &address) ||
+        esp_partition_read(partition, address + SESSION_STORE_DATA_END, header, sizeof(header)) != ESP_OK) {
+        return -1;
+    }
+
+    const uint16_t count = getU16(&header[4]);
+
+    if (getU32(header) == SESSION_STORE_INDEX_MAGIC && count <= SESSION_STORE_INDEX_ENTRIES &&
+        esp_partition_read(partition, address + SESSION_STORE_DATA_END + SESSION_STORE_INDEX_HEADER_BYTES, entries,
+                           count * SESSION_STORE_INDEX_ENTRY_BYTES) == ESP_OK &&
+        getU32(&header[8]) == esp_rom_crc32_le(0, entries, count * SESSION_STORE_INDEX_ENTRY_BYTES)) {
+        return count;
+    }
+
+    /* The head sector, or one whose index a power cut tore, is scanned. Its entries go on from the last indexed time
+     * of the sectors before, as the writer's did. */
+    int64_t floor_ms = indexFloor(sequence);
+    uint8_t * sector = malloc(SESSION_STORE_DATA_END);
+    if (sector == NULL || esp_partition_read(partition, address, sector, SESSION_STORE_DATA_END) != ESP_OK) {
+        free(sector);
+        return -1;
+    }
+
+    uint32_t offset = SESSION_STORE_SECTOR_HEADER_BYTES;
+    int entry_count = 0;
+    int length;
+
+    while (entry_count < SESSION_STORE_INDEX_ENTRIES &&
+           (length = nextRecord(sector, &offset, SESSION_STORE_DATA_END)) != 0) {
+        if (length < 0) {
+            offset = alignUp(offset + 1, SESSION_STORE_PAGE_BYTES);
+            continue;
+        }
+
+        int64_t first_ms;
+        int64_t last_ms;
+        const uint8_t count = sector[offset] == SESSION_STORE_RECORD_DATA &&
+                              timeIsSet(sector[offset + SESSION_STORE_RECORD_HEADER_BYTES + 4]) ?
+                              dataRecordSpan(&sector[offset], (size_t)length, &first_ms, &last_ms) : 0;
+
+        if (count > 0) {
+            if (first_ms >= floor_ms) {
+                putIndexEntry(&entries[entry_count * SESSION_STORE_INDEX_ENTRY_BYTES], first_ms, offset, count,
+                              sector[offset + 1]);
+                entry_count++;
+            }
+            if (last_ms > floor_ms) {
+                floor_ms = last_ms;
+            }
+        }
+        offset += (uint32_t)length;
+    }
+
+    free(sector);
+    return entry_count;
+}
+
+static int64_t indexFloor(uint32_t sequence) {
+    const size_t entries_length = SESSION_STORE_INDEX_ENTRIES * SESSION_STORE_INDEX_ENTRY_BYTES;
+    uint8_t * entries = malloc(entries_length + SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_RECORD_MAX_BYTES);
+    int64_t floor_ms = INT64_MIN;
+    int count = 0;
+
+    if (entries == NULL) {
+        return floor_ms;
+    }
+
+    /* Sectors of unset or stepped back times index nothing, a sector that is gone ends the search */
+    while (--sequence > 0 && (count = loadIndex(sequence, entries)) == 0) {
+    }
+
+    if (count > 0) {
+        uint8_t * record = &entries[entries_length];
+        const uint8_t * entry = &entries[(count - 1) * SESSION_STORE_INDEX_ENTRY_BYTES];
+        const uint32_t offset = getU16(&entry[8]);
+        uint32_t address;
+        int64_t first_ms;
+        int64_t last_ms;
+
+        /* The record is read back for its last time, an unreadable one still starts at the entry time */
+        floor_ms = (int64_t)getU64(entry);
+        if (sectorAddress(sequence, &address) &&
+            esp_partition_read(partition, address + offset, record, SESSION_STORE_RECORD_HEADER_BYTES) == ESP_OK &&
+            getU16(&record[2]) <= SESSION_STORE_RECORD_MAX_BYTES &&
+            esp_partition_read(partition, address + offset + SESSION_STORE_RECORD_HEADER_BYTES,
+                               &record[SESSION_STORE_RECORD_HEADER_BYTES], getU16(&record[2])) == ESP_OK &&
+            dataRecordSpan(record, SESSION_STORE_RECORD_HEADER_BYTES + getU16(&record[2]), &first_ms,
+                           &last_ms) > 0) {
+            floor_ms = last_ms;
+        }
+    }
+
+    free(entries);
+    return floor_ms;
+}
+
+static bool sectorFirstTime(uint32_t sequence, uint32_t last, uint8_t * entries, int64_t * first_ms) {
+    for (; sequence <= last; sequence++) {
+        if (loadIndex(sequence, entries) > 0) {
+            *first_ms = (int64_t)getU64(entries);
+            return true;
+        }
+    }
+    return false;
+}
+
+static esp_err_t readRecord(uint64_t * position, uint8_t * record, size_t max_length, size_t * length, int filter) {
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    const uint32_t newest = written_sequence;
+    const uint32_t newest_offset = written_offset;
+    xSemaphoreGive(store_lock);
+
+    if (newest == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    const uint32_t oldest = newest >= sector_count ? newest - sector_count + 1 : 1;
+    uint32_t sequence = (uint32_t)(*position / SESSION_STORE_SECTOR_BYTES);
+    uint32_t offset = (uint32_t)(*position % SESSION_STORE_SECTOR_BYTES);
+    uint32_t address = 0;
+    bool located = false;
+
+    /* The oldest data was overwritten since the position was taken */
+    if (sequence < oldest) {
+        sequence = oldest;
+        offset = 0;
+    }
+
+    while (sequence <= newest) {
+        const uint32_t end = sequence == newest && newest_offset < SESSION_STORE_DATA_END ?
+                             newest_offset : SESSION_STORE_DATA_END;
+        uint8_t header[SESSION_STORE_RECORD_HEADER_BYTES];
+
+        if (!located) {
+            if (!sectorAddress(sequence, &address) ||
+                (filter == SESSION_STORE_READ_SESSIONS && offset <= SESSION_STORE_SECTOR_HEADER_BYTES &&
+                 sequence < newest && !sectorHoldsSessions(sequence, newest))) {
+                sequence++;
+                offset = 0;
+                continue;
+            }
+            located = true;
+        }
+
+        if (offset < SESSION_STORE_SECTOR_HEADER_BYTES) {
+            offset = SESSION_STORE_SECTOR_HEADER_BYTES;
+        }
+
+        if (offset + SESSION_STORE_RECORD_HEADER_BYTES > end ||
+            esp_partition_read(partition, address + offset, header, sizeof(header)) != ESP_OK ||
+            (header[0] == SESSION_STORE_RECORD_ERASED && offset % SESSION_STORE_PAGE_BYTES == 0)) {
+            if (sequence == newest) {
+                break;
+            }
+            sequence++;
+            offset = 0;
+            located = false;
+            continue;
+        }
+
+        if (header[0] == SESSION_STORE_RECORD_ERASED) {
+            offset = alignUp(offset, SESSION_STORE_PAGE_BYTES);
+            continue;
+        }
+
+        const uint16_t payload_length = getU16(&header[2]);
+        const uint32_t record_end = offset + SESSION_STORE_RECORD_HEADER_BYTES + payload_length;
+
+        /* The rest of the record is still on its way to the flash */
+        if (sequence == newest && record_end > end && record_end <= SESSION_STORE_DATA_END &&
+            payload_length <= SESSION_STORE_RECORD_MAX_BYTES) {
+            break;
+        }
+
+        /* Only the header of a record the filter drops is read, a torn one is caught at the next header */
+        const bool wanted = header[0] == SESSION_STORE_RECORD_START || header[0] == SESSION_STORE_RECORD_END ||
+                            (header[0] == SESSION_STORE_RECORD_DATA && filter == SESSION_STORE_READ_RAW) ||
+                            (header[0] == SESSION_STORE_RECORD_SUMMARY && header[1] == filter);
+        if (!wanted && record_end <= end) {
+            offset = record_end;
+            continue;
+        }
+
+        if (SESSION_STORE_RECORD_HEADER_BYTES + (size_t)payload_length > max_length &&
+            payload_length <= SESSION_STORE_RECORD_MAX_BYTES) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        memcpy(record, header, sizeof(header));
+        if (payload_length > SESSION_STORE_RECORD_MAX_BYTES || record_end > end ||
+            esp_partition_read(partition, address + offset + SESSION_STORE_RECORD_HEADER_BYTES,
+                               &record[SESSION_STORE_RECORD_HEADER_BYTES], payload_length) != ESP_OK ||
+            getU32(&header[4]) != recordCrc(header, &record[SESSION_STORE_RECORD_HEADER_BYTES], payload_length)) {
+            /* Torn record, writes resumed on a page boundary after it */
+            offset = alignUp(offset + 1, SESSION_STORE_PAGE_BYTES);
+            continue;
+        }
+
+        *length = SESSION_STORE_RECORD_HEADER_BYTES + payload_length;
+        *position = (uint64_t)sequence * SESSION_STORE_SECTOR_BYTES + record_end;
+        return ESP_OK;
+    }
+
+    /* Nothing more was programmed, a later read resumes here */
+    *position = (uint64_t)sequence * SESSION_STORE_SECTOR_BYTES + offset;
+    return ESP_ERR_NOT_FOUND;
+}
+
+static esp_err_t readFiltered(uint64_t * position, uint8_t * record, size_t max_length, size_t * length, int filter) {
+    xSemaphoreTake(erase_lock, portMAX_DELAY);
+    const esp_err_t error = readRecord(position, record, max_length, length, filter);
+    xSemaphoreGive(erase_lock);
+
+    return error;
+}
+
+static esp_err_t readRange(int filter, int64_t from_ms, int64_t to_ms, session_store_record_cb_t callback,
+                           void * arg) {
+    uint8_t record[SESSION_STORE_RECORD_HEADER_BYTES + SESSION_STORE_RECORD_MAX_BYTES];
+    uint64_t position;
+    size_t length;
+
+    esp_err_t error = filter == SESSION_STORE_READ_RAW ? session_store_seek(from_ms, &position) :
+                      session_store_seek_summaries((uint8_t)filter, from_ms, &position);
+
+    while (error == ESP_OK && (error = readFiltered(&position, record, sizeof(record), &length, filter)) == ESP_OK) {
+        int64_t first_ms;
+        int64_t last_ms;
+
+        if (record[0] == SESSION_STORE_RECORD_DATA || record[0] == SESSION_STORE_RECORD_SUMMARY) {
+            if (session_store_data_span(record, length, &first_ms, &last_ms) == 0 || last_ms < from_ms ||
+                (record[0] == SESSION_STORE_RECORD_DATA && !timeIsSet(record[SESSION_STORE_RECORD_HEADER_BYTES + 4]))) {
+                continue;
+            }
+            if (first_ms > to_ms) {
+                break;
+            }
+        }
+
+        if (!callback(position - length, record, length, arg)) {
+            break;
+        }
+    }
+
+    return error == ESP_ERR_NOT_FOUND ? ESP_OK : error;
+}
+
+static void writePages(uint32_t sequence, uint32_t address, const uint8_t * data, size_t length) {
+    esp_err_t error;
+
+    if (address % SESSION_STORE_SECTOR_BYTES == 0) {
+        xSemaphoreTake(erase_lock, portMAX_DELAY);
+        error = esp_partition_erase_range(partition, address, SESSION_STORE_SECTOR_BYTES);
+        xSemaphoreGive(erase_lock);
+
+        if (error != ESP_OK) {
+            ESP_LOGE(TAG, "Erase at 0x%08lx failed; err=%s", (unsigned long)address, esp_err_to_name(error));
+            return;
+        }
+
+        xSemaphoreTake(store_lock, portMAX_DELAY);
+        stats.sector_erases++;
+        xSemaphoreGive(store_lock);
+    }
+
+    error = esp_partition_write(partition, address, data, length);
+    if (error != ESP_OK) {
+        ESP_LOGE(TAG, "Write at 0x%08lx failed; err=%s", (unsigned long)address, esp_err_to_name(error));
+        return;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    stats.flash_writes++;
+    stats.flash_bytes += length;
+    written_sector = address / SESSION_STORE_SECTOR_BYTES;
+    written_sequence = sequence;
+    written_offset = address % SESSION_STORE_SECTOR_BYTES + length;
+    xSemaphoreGive(store_lock);
+}
+
+static bool writeBatch(void) {
+    if (xQueueReceive(page_queue, &queued, 0) != pdTRUE) {
+        return false;
+    }
+
+    const uint32_t sequence = queued.sequence;
+    const uint32_t address = queued.address;
+    size_t length = SESSION_STORE_PAGE_BYTES;
+
+    memcpy(batch, queued.data, SESSION_STORE_PAGE_BYTES);
+
+    /* Consecutive pages of the same sector go out in one write */
+    while (length < sizeof(batch) && xQueuePeek(page_queue, &queued, 0) == pdTRUE &&
+           queued.address == address + length && queued.address % SESSION_STORE_SECTOR_BYTES != 0) {
+        xQueueReceive(page_queue, &queued, 0);
+        memcpy(&batch[length], queued.data, SESSION_STORE_PAGE_BYTES);
+        length += SESSION_STORE_PAGE_BYTES;
+    }
+
+    writePages(sequence, address, batch, length);
+    return true;
+}
+
+static void drainPages(void) {
+    xSemaphoreTake(write_lock, portMAX_DELAY);
+    while (writeBatch()) {
+    }
+    xSemaphoreGive(write_lock);
+}
+
+static void shutdownHandler(void) {
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    if (session != 0) {
+        closeSession(session_last_ms);
+    }
+    flushLocked();
+    xSemaphoreGive(store_lock);
+
+    drainPages();
+}
+
+static void vSessionStoreTask(void * pvParameters) {
+    static session_page_t waiting;
+
+    while (1) {
+        /* Only waits here, the page is taken under write_lock so a synchronous flush may have taken it first */
+        if (xQueuePeek(page_queue, &waiting, pdMS_TO_TICKS(SESSION_STORE_FLUSH_MS / 4)) == pdTRUE) {
+            xSemaphoreTake(write_lock, portMAX_DELAY);
+            writeBatch();
+            xSemaphoreGive(write_lock);
+        }
+
+        xSemaphoreTake(store_lock, portMAX_DELAY);
+        if (pending_since_us != 0 &&
+            esp_timer_get_time() - pending_since_us >= (int64_t)SESSION_STORE_FLUSH_MS * 1000) {
+            flushLocked();
+        }
+        xSemaphoreGive(store_lock);
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+esp_err_t session_store_init(void) {
+    if (store_lock != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, SESSION_STORE_PARTITION_SUBTYPE,
+                                         SESSION_STORE_PARTITION_LABEL);
+    if (partition == NULL || partition->size < 2 * SESSION_STORE_SECTOR_BYTES) {
+        ESP_LOGE(TAG, "Partition \"%s\" not found", SESSION_STORE_PARTITION_LABEL);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    store_lock = xSemaphoreCreateMutex();
+    erase_lock = xSemaphoreCreateMutex();
+    write_lock = xSemaphoreCreateMutex();
+    page_queue = xQueueCreate(SESSION_STORE_QUEUE_PAGES, sizeof(session_page_t));
+    if (store_lock == NULL || erase_lock == NULL || write_lock == NULL || page_queue == NULL) {
+        ESP_LOGE(TAG, "Failed allocating the page queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    esp_err_t error = mountLog();
+    if (error == ESP_OK) {
+        flushLocked();
+        stats.mounted = true;
+    }
+    xSemaphoreGive(store_lock);
+
+    if (error != ESP_OK) {
+        ESP_LOGE(TAG, "Mount failed; err=%s", esp_err_to_name(error));
+        return error;
+    }
+
+    if (xTaskCreate(vSessionStoreTask, "SESSIONSTORE", SESSION_STORE_TASK_STACK_SIZE, NULL,
+                    SESSION_STORE_TASK_PRIORITY, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* Deep sleep hooks run in a critical section and cannot program flash, see session_store_stop */
+    esp_register_shutdown_handler(shutdownHandler);
+
+    return ESP_OK;
+}
+
+esp_err_t session_store_start(int64_t time_ms, uint16_t period_ms, uint32_t * id) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+
+    if (session != 0) {
+        closeSession(time_ms);
+    }
+
+    uint8_t payload[SESSION_STORE_START_BYTES];
+    uint8_t * cursor = payload;
+
+    last_session++;
+    cursor = putU32(cursor, last_session);
+    cursor = putU64(cursor, (uint64_t)time_ms);
+    cursor = putU16(cursor, period_ms);
+
+    /* Set first, so a sector the START record opens is marked as holding an open session */
+    session = last_session;
+    session_samples = 0;
+    session_last_ms = time_ms;
+
+    const bool appended = appendRecord(SESSION_STORE_RECORD_START, 0, payload, (uint16_t)(cursor - payload), NULL);
+    if (!appended) {
+        session = 0;
+    } else {
+        stats.session = session;
+        if (id != NULL) {
+            *id = session;
+        }
+    }
+
+    xSemaphoreGive(store_lock);
+
+    return appended ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+esp_err_t session_store_append(int64_t time_ms, const int32_t * values, uint8_t quality) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+
+    if (session == 0) {
+        xSemaphoreGive(store_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* A block holds one time quality and ascending times, so its span is its first and last time */
+    if (block.count > 0 && (quality != block.quality || time_ms < block.times_ms[block.count - 1])) {
+        sealBlock();
+    }
+
+    block.quality = quality;
+    block.times_ms[block.count] = time_ms;
+    memcpy(&block.values[block.count * SESSION_STORE_CHANNELS], values, sizeof(int32_t) * SESSION_STORE_CHANNELS);
+    block.count++;
+
+    if (block.count == SESSION_STORE_BLOCK_SAMPLES) {
+        sealBlock();
+    }
+
+    addToSummaries(time_ms, values);
+    session_last_ms = time_ms;
+
+    if (pending_since_us == 0) {
+        pending_since_us = esp_timer_get_time();
+    }
+
+    xSemaphoreGive(store_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t session_store_stop(int64_t time_ms) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+
+    if (session == 0) {
+        xSemaphoreGive(store_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    closeSession(time_ms);
+    flushLocked();
+
+    xSemaphoreGive(store_lock);
+
+    drainPages();
+
+    return ESP_OK;
+}
+
+esp_err_t session_store_flush(void) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    flushLocked();
+    xSemaphoreGive(store_lock);
+
+    drainPages();
+
+    return ESP_OK;
+}
+
+esp_err_t session_store_seek(int64_t time_ms, uint64_t * position) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    uint8_t * entries = malloc(SESSION_STORE_INDEX_ENTRIES * SESSION_STORE_INDEX_ENTRY_BYTES);
+    if (entries == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(erase_lock, portMAX_DELAY);
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    const uint32_t newest = written_sequence;
+    xSemaphoreGive(store_lock);
+
+    if (newest == 0) {
+        xSemaphoreGive(erase_lock);
+        free(entries);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* Last sector whose first block starts at or before time_ms, a sector without blocks takes the next one's time */
+    const uint32_t oldest = newest >= sector_count ? newest - sector_count + 1 : 1;
+    const uint32_t reads_before = index_reads;
+    uint32_t low = oldest;
+    uint32_t high = newest;
+
+    while (low < high) {
+        const uint32_t middle = low + (high - low + 1) / 2;
+        int64_t first_ms;
+
+        if (!sectorFirstTime(middle, high, entries, &first_ms) || first_ms > time_ms) {
+            high = middle - 1;
+        } else {
+            low = middle;
+        }
+    }
+
+    /* First entry past time_ms, backed up by one block since the one before may reach past time_ms */
+    int count = loadIndex(low, entries);
+    int lower = 0;
+    int upper = count > 0 ? count : 0;
+
+    while (lower < upper) {
+        const int middle = (lower + upper) / 2;
+
+        if ((int64_t)getU64(&entries[middle * SESSION_STORE_INDEX_ENTRY_BYTES]) <= time_ms) {
+            lower = middle + 1;
+        } else {
+            upper = middle;
+        }
+    }
+
+    int entry = lower - 1;
+    uint32_t sequence = low;
+
+    if (entry < 0 && low > oldest && (count = loadIndex(low - 1, entries)) > 0) {
+        sequence = low - 1;
+        entry = count + entry > 0 ? count + entry : 0;
+    }
+
+    *position = (uint64_t)sequence * SESSION_STORE_SECTOR_BYTES +
+                (entry >= 0 && count > 0 ? getU16(&entries[entry * SESSION_STORE_INDEX_ENTRY_BYTES + 8]) : 0);
+
+    const uint32_t reads = index_reads - reads_before;
+    xSemaphoreGive(erase_lock);
+    free(entries);
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    stats.seeks++;
+    stats.seek_sector_reads += reads;
+    xSemaphoreGive(store_lock);
+
+    return ESP_OK;
+}
+
+esp_err_t session_store_seek_summaries(uint8_t level, int64_t time_ms, uint64_t * position) {
+    if (level >= SESSION_STORE_SUMMARY_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* A raw block waits up to SESSION_STORE_FLUSH_MS, and a writer task period more, before it is appended, while
+     * a summary is appended once a sample falls past its last interval */
+    const int64_t back_ms = summary_periods_ms[level] + 2 * (int64_t)SESSION_STORE_FLUSH_MS;
+
+    return session_store_seek(time_ms > INT64_MIN + back_ms ? time_ms - back_ms : INT64_MIN, position);
+}
+
+esp_err_t session_store_read(uint64_t * position, uint8_t * record, size_t max_length, size_t * length) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return readFiltered(position, record, max_length, length, SESSION_STORE_READ_RAW);
+}
+
+esp_err_t session_store_read_sessions(uint64_t * position, uint8_t * record, size_t max_length, size_t * length) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    return readFiltered(position, record, max_length, length, SESSION_STORE_READ_SESSIONS);
+}
+
+esp_err_t session_store_read_summaries(uint8_t level, uint64_t * position, uint8_t * record, size_t max_length,
+                                       size_t * length) {
+    if (!stats.mounted) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (level >= SESSION_STORE_SUMMARY_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return readFiltered(position, record, max_length, length, level);
+}
+
+esp_err_t session_store_read_range(int64_t from_ms, int64_t to_ms, session_store_record_cb_t callback, void * arg) {
+    return readRange(SESSION_STORE_READ_RAW, from_ms, to_ms, callback, arg);
+}
+
+esp_err_t session_store_read_summary_range(uint8_t level, int64_t from_ms, int64_t to_ms,
+                                           session_store_record_cb_t callback, void * arg) {
+    if (level >= SESSION_STORE_SUMMARY_LEVELS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return readRange(level, from_ms, to_ms, callback, arg);
+}
+
+uint8_t session_store_data_span(const uint8_t * record, size_t length, int64_t * first_ms, int64_t * last_ms) {
+    const bool summary = length >= 2 && record[0] == SESSION_STORE_RECORD_SUMMARY &&
+                         record[1] < SESSION_STORE_SUMMARY_LEVELS;
+
+    if (length < 1 || (record[0] != SESSION_STORE_RECORD_DATA && !summary)) {
+        return 0;
+    }
+
+    const uint8_t count = dataRecordSpan(record, length, first_ms, last_ms);
+
+    if (count > 0 && summary) {
+        *last_ms += summary_periods_ms[record[1]] - 1;
+    }
+    return count;
+}
+
+void session_store_get_stats(session_store_stats_t * out) {
+    if (store_lock == NULL) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+    *out = stats;
+    xSemaphoreGive(store_lock);
+
+    out->write_amplification_x100 = out->record_bytes > 0 ?
+                                    (uint32_t)(out->flash_bytes * 100 / out->record_bytes) : 0;
+    out->compression_x100 = out->data_bytes > 0 ?
+                            (uint32_t)((uint64_t)out->samples_stored * SESSION_STORE_RAW_SAMPLE_BYTES * 100 /
+                                       out->data_bytes) : 0;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -16,6 +16,7 @@
 #include "esp_chip_info.h"
 #include "esp_flash.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "bme280_app.h"
 #include "bme280_driver.h"
 #include "driver/i2c_master.h"
@@ -23,23 +24,172 @@
 #include "ble_gap.h"
 #include "nvs_flash.h"
 #include "rtc_driver.h"
+#include "breath_classifier.h"
+#include "audio_capture.h"
+#include "ima_adpcm.h"
+#include "audio_features.h"
+#include "audio_gate.h"
+#include "ble_gatt.h"
+#include "ble_tx.h"
+#include "ble_coc.h"
+#include "ble_beacon.h"
+#include "ble_bond.h"
+#include "ble_conn.h"
+#include "session_store.h"
 
 /* Private typedef ---------------------------------------------------------------------------------------------------*/
 
 /* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract BME280 sampling period; 32 samples span one breath classifier window and stream frames imply it */
+#define BME280_SAMPLE_PERIOD_MS SENSOR_STREAM_PERIOD_MS
+/** @abstract Microphone sample rate */
+#define AUDIO_SAMPLE_RATE_HZ 16000
+/** @abstract Audio frame header: frame type followed by the little-endian index of the first block it carries,
+ *            counted over all captured blocks so that gaps left by the activity gate show up as jumps */
+#define AUDIO_FRAME_HEADER_BYTES 3
+/** @abstract Audio frame type carrying one IMA-ADPCM block */
+#define AUDIO_FRAME_TYPE_ADPCM 0x01
+/** @abstract Audio frame type carrying a record count followed by packed spectral feature records */
+#define AUDIO_FRAME_TYPE_FEATURES 0x02
+/** @abstract Feature records batched per notification (256 ms at 16 kHz) */
+#define AUDIO_FEATURE_RECORDS_PER_FRAME 8
+/** @abstract Audio stream content: 1 sends spectral features, 0 sends ADPCM-coded audio */
+#define AUDIO_STREAM_FEATURES 1
+/** @abstract Audio stream gating: 1 streams only around breath events, 0 streams continuously */
+#define AUDIO_STREAM_GATED 1
+/** @abstract ADPCM blocks per feature frame */
+#define AUDIO_ADPCM_BLOCKS_PER_FRAME (AUDIO_FEATURES_FRAME_SAMPLES / IMA_ADPCM_BLOCK_SAMPLES)
 
 /* Private macros ----------------------------------------------------------------------------------------------------*/
 
 /* Private variables -------------------------------------------------------------------------------------------------*/
 static const char * TAG = "MAIN";
 
+/** @abstract Feature records waiting for a notification, preceded by the frame header and record count */
+static uint8_t feature_batch[AUDIO_FRAME_HEADER_BYTES + 1 + AUDIO_FEATURE_RECORDS_PER_FRAME *
+                             AUDIO_FEATURES_RECORD_BYTES];
+
+/** @abstract Number of records in feature_batch */
+static uint8_t feature_batch_count = 0;
+
 /* External variables ------------------------------------------------------------------------------------------------*/
 TaskHandle_t xChipInfoHandle = NULL;
 TaskHandle_t xBME280Handle = NULL;
+TaskHandle_t xAudioStreamHandle = NULL;
 
 /* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function streamAdpcmFrame
+ *
+ * @abstract This function encodes one feature frame as IMA-ADPCM blocks and notifies each of them
+ *
+ * @param[in] pcm: AUDIO_FEATURES_FRAME_SAMPLES PCM samples
+ *
+ * @param[in] frame_index: Index of the frame in the capture
+ *
+ * @return None
+ */
+static void streamAdpcmFrame(const int16_t * pcm, uint16_t frame_index);
+
+/*
+ * @function streamFeatureRecord
+ *
+ * @abstract This function appends a feature record to the pending batch and notifies the batch once full
+ *
+ * @param[in] features: Frame features
+ *
+ * @param[in] frame_index: Index of the frame in the capture
+ *
+ * @return None
+ */
+static void streamFeatureRecord(const audio_features_t * features, uint16_t frame_index);
+
+/*
+ * @function flushFeatureBatch
+ *
+ * @abstract This function notifies the pending feature records, if any
+ *
+ * @param None
+ *
+ * @return None
+ */
+static void flushFeatureBatch(void);
+
+/*
+ * @function readAudio
+ *
+ * @abstract This function blocks until count samples were read from the capture ring
+ *
+ * @param[out] samples: Destination buffer
+ *
+ * @param[in] count: Number of samples
+ *
+ * @return None
+ */
+static void readAudio(int16_t * samples, size_t count);
 
 /* Private function definitions --------------------------------------------------------------------------------------*/
+static void readAudio(int16_t * samples, size_t count) {
+    size_t done = 0;
+
+    while (done < count) {
+        done += audio_capture_read(&samples[done], count - done, portMAX_DELAY);
+    }
+}
+
+static void streamAdpcmFrame(const int16_t * pcm, uint16_t frame_index) {
+    static uint8_t frame[AUDIO_FRAME_HEADER_BYTES + IMA_ADPCM_BLOCK_BYTES];
+    static ima_adpcm_state_t state;
+
+    for (uint16_t i = 0; i < AUDIO_ADPCM_BLOCKS_PER_FRAME; i++) {
+        /* Encode even without subscribers so the predictor stays in step with the signal */
+        size_t length = ima_adpcm_encode_block(&state, &pcm[i * IMA_ADPCM_BLOCK_SAMPLES], IMA_ADPCM_BLOCK_SAMPLES,
+                                               &frame[AUDIO_FRAME_HEADER_BYTES], NULL);
+        const uint16_t block_index = (uint16_t)(frame_index * AUDIO_ADPCM_BLOCKS_PER_FRAME + i);
+
+        frame[0] = AUDIO_FRAME_TYPE_ADPCM;
+        frame[1] = (uint8_t)(block_index & 0xFF);
+        frame[2] = (uint8_t)(block_index >> 8);
+
+        push_audio_frame(frame, (uint16_t)(AUDIO_FRAME_HEADER_BYTES + length));
+    }
+}
+
+static void streamFeatureRecord(const audio_features_t * features, uint16_t frame_index) {
+    /* A batch only holds consecutive frames */
+    if (feature_batch_count > 0 &&
+        (uint16_t)(feature_batch[1] | (feature_batch[2] << 8)) + feature_batch_count != frame_index) {
+        flushFeatureBatch();
+    }
+
+    if (feature_batch_count == 0) {
+        feature_batch[0] = AUDIO_FRAME_TYPE_FEATURES;
+        feature_batch[1] = (uint8_t)(frame_index & 0xFF);
+        feature_batch[2] = (uint8_t)(frame_index >> 8);
+    }
+
+    audio_features_pack(features, &feature_batch[AUDIO_FRAME_HEADER_BYTES + 1 +
+                                                 feature_batch_count * AUDIO_FEATURES_RECORD_BYTES]);
+    feature_batch_count++;
+
+    if (feature_batch_count == AUDIO_FEATURE_RECORDS_PER_FRAME) {
+        flushFeatureBatch();
+    }
+}
+
+static void flushFeatureBatch(void) {
+    if (feature_batch_count == 0) {
+        return;
+    }
+
+    feature_batch[AUDIO_FRAME_HEADER_BYTES] = feature_batch_count;
+
+    push_audio_frame(feature_batch, (uint16_t)(AUDIO_FRAME_HEADER_BYTES + 1 +
+                                               feature_batch_count * AUDIO_FEATURES_RECORD_BYTES));
+
+    feature_batch_count = 0;
+}
+
 
 /* Exported function definitions -------------------------------------------------------------------------------------*/
 void vChipInfoTask(void * pvParameters) {
@@ -67,6 +217,80 @@ void vChipInfoTask(void * pvParameters) {
         printf("%" PRIu32 "MB %s flash\n", flash_size / (uint32_t)(1024 * 1024),
                (chip_info.features & CHIP_FEATURE_EMB_FLASH) ? "embedded" : "external");
 
+        /* Print audio capture statistics */
+        audio_capture_stats_t audio_stats;
+        audio_capture_get_stats(&audio_stats);
+        printf("Audio: %" PRIu32 "/%" PRIu32 " samples buffered (peak %" PRIu32 "), "
+               "%" PRIu32 " DMA overruns, %" PRIu32 " ring overruns\n",
+               audio_stats.occupancy, audio_stats.capacity, audio_stats.peak_occupancy,
+               audio_stats.dma_overruns, audio_stats.ring_overruns);
+
+        /* Print activity gate statistics */
+        audio_gate_stats_t gate_stats;
+        audio_gate_get_stats(&gate_stats);
+        printf("Audio gate: %" PRIu32 " of %" PRIu32 " frames streamed, %" PRIu32 " selected by the detector "
+               "in %" PRIu32 " events, noise floor %u\n",
+               gate_stats.frames_streamed, gate_stats.frames_in, gate_stats.frames_open, gate_stats.events,
+               (unsigned)gate_stats.noise_floor);
+
+        /* Print notification buffer pool pressure */
+        gatt_svr_mbuf_stats_t mbuf_stats;
+        gatt_svr_get_mbuf_stats(&mbuf_stats);
+        printf("BLE mbufs: %u/%u free (low %u), %" PRIu32 " allocated, %" PRIu32 " failed, %" PRIu32 " returned\n",
+               mbuf_stats.free_blocks, mbuf_stats.total_blocks, mbuf_stats.min_free_blocks, mbuf_stats.allocated,
+               mbuf_stats.alloc_failures, mbuf_stats.returned);
+
+        /* Print transmit queue and loss counters */
+        ble_tx_stats_t tx_stats;
+        for (size_t i = 0; ble_tx_get_stats(i, &tx_stats); i++) {
+            printf("%s: %" PRIu32 " sent, queue %" PRIu32 "/%" PRIu32 " (peak %" PRIu32 "), %" PRIu32 " busy, "
+                   "%" PRIu32 " no memory, lost %" PRIu32 " oldest, %" PRIu32 " decimated, %" PRIu32 " paused, "
+                   "%" PRIu32 " overloads\n",
+                   tx_stats.name, tx_stats.sent, tx_stats.depth, tx_stats.capacity, tx_stats.peak_depth,
+                   tx_stats.busy, tx_stats.no_memory, tx_stats.dropped_oldest, tx_stats.decimated,
+                   tx_stats.paused_dropped, tx_stats.overloads);
+        }
+
+        /* Print bulk channel throughput and the per-connection GATT and L2CAP byte counts */
+        ble_coc_stats_t coc_stats;
+        ble_coc_get_stats(&coc_stats);
+        printf("L2CAP bulk: %s, %" PRIu32 " B/s, %" PRIu32 " SDUs (%" PRIu32 " B) sent, %" PRIu32 " stalls, "
+               "peer SDU %u\n",
+               coc_stats.connected ? "open" : "closed", coc_stats.bytes_per_s, coc_stats.sdus_sent,
+               coc_stats.bytes_sent, coc_stats.stalls, coc_stats.peer_sdu_size);
+        ble_conn_log_all();
+
+        /* Print bonding counters */
+        ble_bond_stats_t bond_stats;
+        ble_bond_get_stats(&bond_stats);
+        printf("BLE bonds: %" PRIu32 " paired, %" PRIu32 " reconnects (last encrypted after %" PRIu32 " ms), "
+               "%" PRIu32 " repairings refused, GATT layout %08" PRIx32 "\n",
+               bond_stats.pairings, bond_stats.reconnects, bond_stats.last_reconnect_ms, bond_stats.repairings_refused,
+               bond_stats.layout_hash);
+
+        /* Print clock synchronization state */
+        rtc_sync_status_t sync_status;
+        rtc_get_sync_status(&sync_status);
+        static const char * const clock_sources[] = {"not set", "synced", "restored", "estimated"};
+        printf("Clock: %s (quality %02x), %" PRIu32 " syncs (%" PRIu32 " rejected, %" PRIu32 " steps), "
+               "last offset %lld us rtt %lld us, %lld us left to slew, skew %" PRId32 " ppb from %u points\n",
+               clock_sources[sync_status.valid ? sync_status.source : RTC_SOURCE_UNSET], rtc_time_quality(),
+               sync_status.syncs, sync_status.rejected, sync_status.steps,
+               (long long)sync_status.last_offset_us, (long long)sync_status.last_rtt_us,
+               (long long)sync_status.slew_remaining_us, sync_status.skew_ppb, sync_status.drift_points);
+
+        /* Print session store usage, compression and write amplification */
+        session_store_stats_t store_stats;
+        session_store_get_stats(&store_stats);
+        printf("Session store: session %" PRIu32 ", %" PRIu32 " samples in %" PRIu32 " records (%" PRIu32 " dropped), "
+               "%" PRIu32 "/%" PRIu32 " sectors used, %" PRIu32 " erases, compression %" PRIu32 ".%02" PRIu32
+               ", write amplification %" PRIu32 ".%02" PRIu32 ", %" PRIu32 " summary intervals in %" PRIu64 " bytes\n",
+               store_stats.session, store_stats.samples_stored, store_stats.records_written,
+               store_stats.records_dropped, store_stats.sectors_used, store_stats.sectors, store_stats.sector_erases,
+               store_stats.compression_x100 / 100, store_stats.compression_x100 % 100,
+               store_stats.write_amplification_x100 / 100, store_stats.write_amplification_x100 % 100,
+               store_stats.summaries_stored, store_stats.summary_bytes);
+
         vTaskDelay(10000 / portTICK_PERIOD_MS);
     }
 }
@@ -80,28 +304,116 @@ void vBME280Task(void * pvParameters) {
 
     ESP_ERROR_CHECK(setBME280Mode(bme280, BME280_MODE_CYCLE));
 
+    TickType_t wake_time = xTaskGetTickCount();
+
     while (1) {
 
         do {
             vTaskDelay(pdMS_TO_TICKS(1));
         } while(isBME280Sampling(bme280));
 
-        vTaskDelay(3000 / portTICK_PERIOD_MS);
+        int32_t temperature;
+        uint32_t humidity;
+        uint32_t pressure;
+        breath_class_t label;
+
+        /* Temperature must be read first, it updates the fine temperature used by the other compensations */
+        if (readBME280Temperature(bme280, &temperature) == ESP_OK &&
+            readBME280Pressure(bme280, &pressure) == ESP_OK &&
+            readBME280Humidity(bme280, &humidity) == ESP_OK) {
+            /* Synchronized and drift-corrected, so the samples of several devices line up */
+            const int64_t time_ms = rtc_now_us() / 1000;
+            const uint8_t quality = rtc_time_quality();
+            int32_t values[SESSION_STORE_CHANNELS];
+
+            push_temperature_sample(time_ms, temperature);
+            push_humidity_sample(time_ms, humidity);
+            push_pressure_sample(time_ms, pressure);
+
+            /* Recorded whether or not a central is connected */
+            values[SESSION_STORE_CHANNEL_TEMPERATURE] = temperature;
+            values[SESSION_STORE_CHANNEL_HUMIDITY] = (int32_t)humidity;
+            values[SESSION_STORE_CHANNEL_PRESSURE] = (int32_t)pressure;
+            session_store_append(time_ms, values, quality);
+            ble_beacon_set_environment(temperature, humidity, pressure);
+
+            if (breath_classifier_push_sample(temperature, humidity, pressure, &label)) {
+                ESP_LOGI(TAG, "Breath pattern: %s", breath_classifier_label_name(label));
+                ble_beacon_set_breath_class((uint8_t)label);
+            }
+        }
+
+        /* Fixed-rate wake-ups keep samples on the period grid the stream frames imply */
+        xTaskDelayUntil(&wake_time, pdMS_TO_TICKS(BME280_SAMPLE_PERIOD_MS));
     }
 
     removeBME280(bme280);
     i2c_del_master_bus(i2c_bus_handle);
 }
 
+void vAudioStreamTask(void * pvParameters) {
+
+    static int16_t pcm[AUDIO_FEATURES_FRAME_SAMPLES] __attribute__((aligned(FFT_Q15_ALIGN)));
+    static int16_t delayed_pcm[AUDIO_FEATURES_FRAME_SAMPLES];
+    audio_features_t features;
+    audio_features_t delayed_features;
+    uint16_t frame_index = 0;
+
+    audio_gate_init(AUDIO_STREAM_GATED);
+
+    /* The frame buffer doubles as scratch before capture starts filling it */
+    if (!fft_q15_check_kernel(pcm)) {
+        ESP_LOGE(TAG, "FFT vector kernel not bit-exact, using the reference kernel");
+    }
+
+    while (1) {
+        readAudio(pcm, AUDIO_FEATURES_FRAME_SAMPLES);
+        audio_features_compute(pcm, AUDIO_SAMPLE_RATE_HZ, &features);
+
+        /* The gate releases frames AUDIO_GATE_PREROLL_FRAMES late so events keep their onset */
+        const uint16_t delayed_index = (uint16_t)(frame_index - AUDIO_GATE_PREROLL_FRAMES);
+        frame_index++;
+
+        if (audio_gate_process(pcm, &features, delayed_pcm, &delayed_features)) {
+#if AUDIO_STREAM_FEATURES
+            streamFeatureRecord(&delayed_features, delayed_index);
+#else
+            streamAdpcmFrame(delayed_pcm, delayed_index);
+#endif
+        } else {
+            flushFeatureBatch();
+        }
+    }
+}
+
 void app_main(void) {
 
     ESP_LOGI(TAG, "Starting app");
 
+    /* First, so every sample carries a time from the start */
+    rtc_init();
+
+    /* Every boot records a new session, one a power cut left open is closed here */
+    if (session_store_init() != ESP_OK ||
+        session_store_start(rtc_now_us() / 1000, BME280_SAMPLE_PERIOD_MS, NULL) != ESP_OK) {
+        ESP_LOGE(TAG, "Session store unavailable, samples are only streamed");
+    }
+
     ESP_LOGI(TAG, "Initializing BLE");
 
     ble_init();
 
-    xTaskCreate(vChipInfoTask, "CHIPINFO", 2048, NULL, tskIDLE_PRIORITY + 1, &xChipInfoHandle);
+    breath_classifier_benchmark(BREATH_CLASSIFIER_BENCHMARK_ITERATIONS);
+
+    ESP_LOGI(TAG, "Initializing audio capture");
+
+    if (audio_capture_init(AUDIO_SAMPLE_RATE_HZ) != ESP_OK || audio_capture_start() != ESP_OK) {
+        ESP_LOGE(TAG, "Audio capture unavailable");
+    } else {
+        xTaskCreate(vAudioStreamTask, "AUDIOSTREAM", 4096, NULL, tskIDLE_PRIORITY + 3, &xAudioStreamHandle);
+    }
+
+    xTaskCreate(vChipInfoTask, "CHIPINFO", 3072, NULL, tskIDLE_PRIORITY + 1, &xChipInfoHandle);
     xTaskCreate(vBME280Task, "BME280", 8192, NULL, tskIDLE_PRIORITY + 2, &xBME280Handle);
 
 }
@@ -0,0 +1,141 @@
+/**
+  **********************************************************************************************************************
+  * @file    audio_bench.c
+  * @brief   This file is the host throughput benchmark of the audio codec and spectral feature stage
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "audio_features.h"
+#include "ima_adpcm.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Length of the synthetic signal used without a recording, one second at 16 kHz rounded to blocks */
+#define AUDIO_BENCH_SYNTHETIC_SAMPLES (63 * IMA_ADPCM_BLOCK_SAMPLES)
+/** @abstract Passes over the signal */
+#define AUDIO_BENCH_ITERATIONS 200
+/** @abstract Frames processed by the feature stage benchmark */
+#define AUDIO_BENCH_FEATURE_FRAMES 5000
+/** @abstract Capture sample rate, sets the frame rate needed in real time */
+#define AUDIO_BENCH_SAMPLE_RATE_HZ 16000
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function buildSignal
+ *
+ * @abstract This function synthesizes a slow triangle envelope modulating pseudo-random noise, close to an
+ *           airflow sound
+ *
+ * @param[out] count: Number of samples
+ *
+ * @return Signal, NULL when out of memory
+ */
+static int16_t * buildSignal(size_t * count);
+
+/*
+ * @function loadSignal
+ *
+ * @abstract This function reads a raw 16-bit little-endian mono recording, truncated to whole codec blocks
+ *
+ * @param[in] path: File path
+ *
+ * @param[out] count: Number of samples
+ *
+ * @return Signal, NULL when the file cannot be read or holds less than one block
+ */
+static int16_t * loadSignal(const char * path, size_t * count);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int16_t * buildSignal(size_t * count) {
+    int16_t * signal = malloc(AUDIO_BENCH_SYNTHETIC_SAMPLES * sizeof(int16_t));
+    uint32_t noise = 0x12345678;
+
+    if (signal == NULL) {
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < AUDIO_BENCH_SYNTHETIC_SAMPLES; i++) {
+        noise = noise * 1664525u + 1013904223u;
+        int32_t envelope = (int32_t)(i % 1024);
+        envelope = envelope < 512 ? envelope : 1024 - envelope;
+        signal[i] = (int16_t)(((int32_t)(int16_t)(noise >> 16) * envelope) >> 9);
+    }
+
+    *count = AUDIO_BENCH_SYNTHETIC_SAMPLES;
+    return signal;
+}
+
+static int16_t * loadSignal(const char * path, size_t * count) {
+    FILE * file = fopen(path, "rb");
+    int16_t * signal = NULL;
+    uint8_t bytes[2];
+    size_t length = 0;
+    size_t capacity = 0;
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    while (fread(bytes, 1, sizeof(bytes), file) == sizeof(bytes)) {
+        if (length == capacity) {
+            capacity = capacity ? 2 * capacity : 16 * IMA_ADPCM_BLOCK_SAMPLES;
+            int16_t * grown = realloc(signal, capacity * sizeof(int16_t));
+            if (grown == NULL) {
+                break;
+            }
+            signal = grown;
+        }
+        signal[length++] = (int16_t)(bytes[0] | (bytes[1] << 8));
+    }
+    fclose(file);
+
+    length -= length % IMA_ADPCM_BLOCK_SAMPLES;
+    if (length == 0) {
+        free(signal);
+        return NULL;
+    }
+
+    *count = length;
+    return signal;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int main(int argc, char ** argv) {
+    size_t count = 0;
+    int16_t * signal = argc > 1 ? loadSignal(argv[1], &count) : buildSignal(&count);
+    ima_adpcm_benchmark_t adpcm;
+    audio_features_benchmark_t features;
+
+    if (signal == NULL) {
+        printf("usage: %s [recording.s16le]\n", argv[0]);
+        return 1;
+    }
+
+    ima_adpcm_benchmark(signal, count, AUDIO_BENCH_ITERATIONS, &adpcm);
+    free(signal);
+
+    printf("ADPCM: %zu samples, encode %u samples/s, decode %u samples/s, SNR %d.%02d dB, bit-exact: %s\n",
+           count, (unsigned)adpcm.encode_samples_per_s, (unsigned)adpcm.decode_samples_per_s,
+           (int)(adpcm.snr_centi_db / 100), (int)(adpcm.snr_centi_db % 100), adpcm.bit_exact ? "yes" : "NO");
+
+    audio_features_benchmark(AUDIO_BENCH_FEATURE_FRAMES, &features);
+
+    printf("Spectral features: %u frames/s (%u needed in real time)\n", (unsigned)features.frames_per_s,
+           (unsigned)(AUDIO_BENCH_SAMPLE_RATE_HZ / AUDIO_FEATURES_FRAME_SAMPLES));
+
+    return adpcm.bit_exact ? 0 : 1;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
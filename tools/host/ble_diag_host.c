@@ -0,0 +1,314 @@
+/**
+  **********************************************************************************************************************
+  * @file    ble_diag_host.c
+  * @brief   This file is the host harness of the BLE self-test, a simulated link and central driving ble_diag
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "ble_diag.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Simulated connection */
+typedef struct sim_link_t {
+    uint16_t conn_interval;
+    uint8_t packets_per_event;
+    uint16_t max_frame;
+} sim_link_t;
+
+/** @brief What the simulated central saw */
+typedef struct sim_central_t {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t next_sequence;
+    uint32_t gaps;
+    uint32_t corrupt;
+    uint32_t echoes;
+    bool reply_pending;
+    uint8_t reply[BLE_DIAG_PING_HEADER_BYTES + 4];
+} sim_central_t;
+
+/** @brief Decoded Report characteristic */
+typedef struct sim_report_t {
+    uint32_t elapsed_ms;
+    uint32_t frames_sent;
+    uint32_t bytes_sent;
+    uint32_t bytes_per_s;
+    uint32_t frames_dropped;
+    uint32_t busy;
+    uint32_t no_memory;
+    uint16_t packets_per_event_x100;
+    uint16_t conn_interval;
+    uint32_t rtt_count;
+    uint32_t rtt_min_us;
+    uint32_t rtt_mean_us;
+    uint32_t rtt_max_us;
+    uint16_t rtt_histogram[BLE_DIAG_RTT_BINS];
+} sim_report_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Connection interval unit in microseconds */
+#define SIM_INTERVAL_UNIT_US 1250
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function getU16
+ *
+ * @abstract This function loads a little-endian uint16 and advances the cursor
+ *
+ * @param[in,out] cursor: Source
+ *
+ * @return Value
+ */
+static uint16_t getU16(const uint8_t ** cursor);
+
+/*
+ * @function getU32
+ *
+ * @abstract This function loads a little-endian uint32 and advances the cursor
+ *
+ * @param[in,out] cursor: Source
+ *
+ * @return Value
+ */
+static uint32_t getU32(const uint8_t ** cursor);
+
+/*
+ * @function decodeReport
+ *
+ * @abstract This function decodes the Report characteristic the way a central does
+ *
+ * @param[in] data: BLE_DIAG_REPORT_BYTES bytes
+ *
+ * @param[out] report: Decoded report
+ *
+ * @return None
+ */
+static void decodeReport(const uint8_t * data, sim_report_t * report);
+
+/*
+ * @function receiveFrame
+ *
+ * @abstract This function checks a stream frame for sequence gaps and corrupted filler
+ *
+ * @param[in,out] central: Central
+ *
+ * @param[in] frame: Frame
+ *
+ * @param[in] length: Frame length
+ *
+ * @return None
+ */
+static void receiveFrame(sim_central_t * central, const uint8_t * frame, size_t length);
+
+/*
+ * @function runTest
+ *
+ * @abstract This function runs one self-test over the simulated link, answering probes and pinging once per
+ *           second, then decodes the report and checks it against what the central received
+ *
+ * @param[in] link: Simulated connection
+ *
+ * @param[in] frame_bytes: Requested frame size
+ *
+ * @param[in] rate_hz: Requested rate, 0 for as fast as the link takes frames
+ *
+ * @param[in] duration_s: Test duration
+ *
+ * @return Number of failed checks
+ */
+static int runTest(const sim_link_t * link, uint16_t frame_bytes, uint16_t rate_hz, uint16_t duration_s);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint16_t getU16(const uint8_t ** cursor) {
+    const uint8_t * data = *cursor;
+    *cursor += 2;
+    return (uint16_t)(data[0] | data[1] << 8);
+}
+
+static uint32_t getU32(const uint8_t ** cursor) {
+    const uint8_t * data = *cursor;
+    *cursor += 4;
+    return data[0] | (uint32_t)data[1] << 8 | (uint32_t)data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+static void decodeReport(const uint8_t * data, sim_report_t * report) {
+    report->elapsed_ms = getU32(&data);
+    report->frames_sent = getU32(&data);
+    report->bytes_sent = getU32(&data);
+    report->bytes_per_s = getU32(&data);
+    report->frames_dropped = getU32(&data);
+    report->busy = getU32(&data);
+    report->no_memory = getU32(&data);
+    report->packets_per_event_x100 = getU16(&data);
+    report->conn_interval = getU16(&data);
+    report->rtt_count = getU32(&data);
+    report->rtt_min_us = getU32(&data);
+    report->rtt_mean_us = getU32(&data);
+    report->rtt_max_us = getU32(&data);
+    for (size_t i = 0; i < BLE_DIAG_RTT_BINS; i++) {
+        report->rtt_histogram[i] = getU16(&data);
+    }
+}
+
+static void receiveFrame(sim_central_t * central, const uint8_t * frame, size_t length) {
+    const uint8_t * cursor = frame;
+    const uint32_t sequence = getU32(&cursor);
+
+    if (sequence != central->next_sequence) {
+        central->gaps++;
+    }
+    central->next_sequence = sequence + 1;
+
+    for (size_t i = BLE_DIAG_FRAME_HEADER_BYTES; i < length; i++) {
+        if (frame[i] != (uint8_t)(sequence + i)) {
+            central->corrupt++;
+            break;
+        }
+    }
+
+    central->frames++;
+    central->bytes += (uint32_t)length;
+}
+
+static int runTest(const sim_link_t * link, uint16_t frame_bytes, uint16_t rate_hz, uint16_t duration_s) {
+    const int64_t interval_us = (int64_t)link->conn_interval * SIM_INTERVAL_UNIT_US;
+    const uint8_t start[BLE_DIAG_CONTROL_BYTES] = {
+        BLE_DIAG_OP_START,
+        (uint8_t)frame_bytes, (uint8_t)(frame_bytes >> 8),
+        (uint8_t)rate_hz, (uint8_t)(rate_hz >> 8),
+        (uint8_t)duration_s, (uint8_t)(duration_s >> 8),
+    };
+    uint8_t frame[BLE_DIAG_FRAME_MAX_BYTES];
+    uint8_t echo[BLE_DIAG_PING_MAX_BYTES];
+    uint8_t data[BLE_DIAG_REPORT_BYTES];
+    sim_central_t central = { 0 };
+    sim_report_t report;
+    ble_diag_t diag;
+    int64_t now_us = 1000000;
+    uint32_t ping_id = 0;
+    int failures = 0;
+
+    ble_diag_init(&diag);
+    if (!ble_diag_control(&diag, start, sizeof(start), now_us)) {
+        printf("START refused\n");
+        return 1;
+    }
+
+    while (diag.running) {
+        /* Writes from the central land at the start of the connection event */
+        if (central.reply_pending) {
+            central.reply_pending = false;
+            ble_diag_ping(&diag, central.reply, sizeof(central.reply), echo, now_us, now_us);
+        }
+
+        if (now_us % 1000000 < interval_us) {
+            const uint8_t ping[BLE_DIAG_PING_HEADER_BYTES + 4] = {
+                BLE_DIAG_PING, (uint8_t)++ping_id, 0, 0, 0, 0xA5, 0x5A, 0xA5, 0x5A
+            };
+            const int length = ble_diag_ping(&diag, ping, sizeof(ping), echo, now_us, now_us + 100);
+
+            if (length == (int)sizeof(ping) + 8 && echo[0] == BLE_DIAG_ECHO && echo[1] == (uint8_t)ping_id &&
+                echo[5] == 0xA5 && echo[8] == 0x5A) {
+                central.echoes++;
+            }
+        }
+
+        /* The device fills the event up to what the controller takes, the rest is refused as busy */
+        for (uint8_t packet = 0; ; packet++) {
+            bool probe;
+            const size_t length = ble_diag_next(&diag, frame, link->max_frame, now_us, &probe);
+
+            if (length == 0) {
+                break;
+            }
+            if (packet == link->packets_per_event) {
+                ble_diag_refused(&diag, false);
+                break;
+            }
+
+            if (probe) {
+                central.reply[0] = BLE_DIAG_PROBE_REPLY;
+                for (size_t i = 1; i < length; i++) {
+                    central.reply[i] = frame[i];
+                }
+                central.reply_pending = true;
+            } else {
+                receiveFrame(&central, frame, length);
+            }
+            ble_diag_sent(&diag, length, probe, now_us);
+        }
+
+        now_us += interval_us;
+    }
+
+    ble_diag_report(&diag, data, link->conn_interval, now_us);
+    decodeReport(data, &report);
+
+    printf("%u B frames at %u Hz for %u s, interval %u x 1.25 ms, %u packets/event:\n",
+           (unsigned)frame_bytes, (unsigned)rate_hz, (unsigned)duration_s, (unsigned)link->conn_interval,
+           (unsigned)link->packets_per_event);
+    printf("  %u ms, %u frames, %u B, %u B/s, dropped %u, busy %u, no memory %u, %u.%02u packets/event\n",
+           (unsigned)report.elapsed_ms, (unsigned)report.frames_sent, (unsigned)report.bytes_sent,
+           (unsigned)report.bytes_per_s, (unsigned)report.frames_dropped, (unsigned)report.busy,
+           (unsigned)report.no_memory, (unsigned)(report.packets_per_event_x100 / 100),
+           (unsigned)(report.packets_per_event_x100 % 100));
+    printf("  rtt %u probes, min %u us, mean %u us, max %u us, histogram", (unsigned)report.rtt_count,
+           (unsigned)report.rtt_min_us, (unsigned)report.rtt_mean_us, (unsigned)report.rtt_max_us);
+    for (size_t i = 0; i < BLE_DIAG_RTT_BINS; i++) {
+        printf(" %u", (unsigned)report.rtt_histogram[i]);
+    }
+    printf("\n  central: %u frames, %u B, %u gaps, %u corrupt, %u echoes\n", (unsigned)central.frames,
+           (unsigned)central.bytes, (unsigned)central.gaps, (unsigned)central.corrupt, (unsigned)central.echoes);
+
+    /* The report must agree with what arrived, gaps are only allowed where the device says it dropped frames */
+    failures += report.elapsed_ms != (uint32_t)duration_s * 1000u;
+    failures += report.frames_sent != central.frames || report.bytes_sent != central.bytes;
+    failures += central.corrupt != 0 || (central.gaps != 0 && report.frames_dropped == 0);
+    failures += report.bytes_per_s != (uint32_t)((uint64_t)central.bytes * 1000 / report.elapsed_ms);
+    failures += report.rtt_count == 0 || report.rtt_min_us != (uint32_t)interval_us;
+    failures += central.echoes != ping_id;
+
+    if (failures != 0) {
+        printf("  %d checks FAILED\n", failures);
+    }
+
+    return failures;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int main(int argc, char ** argv) {
+    if (argc == 6) {
+        const sim_link_t link = {
+            (uint16_t)atoi(argv[4]), (uint8_t)atoi(argv[5]), BLE_DIAG_FRAME_MAX_BYTES
+        };
+        return runTest(&link, (uint16_t)atoi(argv[1]), (uint16_t)atoi(argv[2]), (uint16_t)atoi(argv[3])) != 0;
+    }
+    if (argc != 1) {
+        printf("usage: %s [frame_bytes rate_hz duration_s interval_1.25ms packets_per_event]\n", argv[0]);
+        return 1;
+    }
+
+    /* Saturated 2M PHY link, a paced stream the link keeps up with and one it cannot */
+    const sim_link_t fast = { 12, 6, BLE_DIAG_FRAME_MAX_BYTES };
+    const sim_link_t slow = { 40, 1, 100 };
+    int failures = 0;
+
+    failures += runTest(&fast, BLE_DIAG_FRAME_MAX_BYTES, 0, 5);
+    failures += runTest(&fast, 64, 50, 4);
+    failures += runTest(&slow, 100, 100, 3);
+
+    return failures != 0;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,120 @@
+/**
+  **********************************************************************************************************************
+  * @file    breath_reference.c
+  * @brief   This file is the host reference build of the breath pattern model
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "breath_model.h"
+#include "nn_int8.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Number of golden input windows */
+#define GOLDEN_WINDOWS 4
+
+/** @abstract Number of int8 values in one input window */
+#define WINDOW_VALUES (BREATH_MODEL_WINDOW_LENGTH * BREATH_MODEL_CHANNELS)
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Reference kernel logits for the windows built by buildWindow; regenerate with --print whenever
+ *             breath_model.c changes */
+static const int8_t golden_logits[GOLDEN_WINDOWS][BREATH_MODEL_CLASSES] = {
+    { -1, 3, -2, 3 },
+    { 107, -103, -39, 92 },
+    { -77, 67, -50, 127 },
+    { 9, -6, 2, 117 },
+};
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function buildWindow
+ *
+ * @abstract This function fills one deterministic input window: silence, the on-device benchmark ramp,
+ *           a slow breathing-like triangle and pseudo-random noise
+ *
+ * @param[in] index: Window index, below GOLDEN_WINDOWS
+ *
+ * @param[out] input: Model input [BREATH_MODEL_WINDOW_LENGTH][BREATH_MODEL_CHANNELS]
+ *
+ * @return None
+ */
+static void buildWindow(uint8_t index, int8_t * input);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static void buildWindow(uint8_t index, int8_t * input) {
+    uint32_t seed = 0x12345678u;
+
+    for (uint16_t i = 0; i < WINDOW_VALUES; i++) {
+        const uint16_t t = i / BREATH_MODEL_CHANNELS;
+        const uint16_t c = i % BREATH_MODEL_CHANNELS;
+        const int32_t phase = (int32_t)((t * 8 + c * 5) % 32);
+
+        switch (index) {
+        case 0:
+            input[i] = 0;
+            break;
+        case 1:
+            input[i] = (int8_t)((i * 37) & 0xFF);
+            break;
+        case 2:
+            input[i] = (int8_t)((phase < 16 ? phase : 32 - phase) * 15 - 120);
+            break;
+        default:
+            seed = seed * 1664525u + 1013904223u;
+            input[i] = (int8_t)(seed >> 24);
+            break;
+        }
+    }
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int main(int argc, char ** argv) {
+    int8_t input[WINDOW_VALUES];
+    int8_t logits[BREATH_MODEL_CLASSES];
+    const int print = argc > 1 && strcmp(argv[1], "--print") == 0;
+    int mismatches = 0;
+
+    nn_int8_set_kernel(NN_KERNEL_REFERENCE);
+
+    for (uint8_t w = 0; w < GOLDEN_WINDOWS; w++) {
+        buildWindow(w, input);
+
+        if (nn_int8_run(&breath_model, input, logits) != 0) {
+            printf("window %u: model does not fit the inference arena\n", (unsigned)w);
+            return 1;
+        }
+
+        if (print) {
+            printf("    {");
+            for (uint8_t k = 0; k < BREATH_MODEL_CLASSES; k++) {
+                printf(" %d%s", logits[k], k + 1 < BREATH_MODEL_CLASSES ? "," : " },\n");
+            }
+            continue;
+        }
+
+        if (memcmp(logits, golden_logits[w], sizeof(logits)) != 0) {
+            printf("window %u: logits differ from golden\n", (unsigned)w);
+            mismatches++;
+        }
+    }
+
+    if (!print) {
+        printf("%d of %d windows bit-exact, peak arena %u B\n", GOLDEN_WINDOWS - mismatches, GOLDEN_WINDOWS,
+               (unsigned)nn_int8_peak_arena_bytes(&breath_model));
+    }
+
+    return mismatches == 0 ? 0 : 1;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
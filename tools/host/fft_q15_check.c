@@ -0,0 +1,268 @@
+/**
+  **********************************************************************************************************************
+  * @file    fft_q15_check.c
+  * @brief   This file is the host check of the ESP32-S3 FFT stage against the portable kernel
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fft_q15.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief One 128-bit vector register as eight 16-bit lanes */
+typedef struct vector_t {
+    int16_t lane[8];
+} vector_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/** @abstract Random frames compared between the kernels */
+#define FFT_CHECK_RANDOM_FRAMES 2000
+/** @abstract Largest error against a double precision DFT scaled by 1/FFT_Q15_POINTS, in LSB */
+#define FFT_CHECK_MAX_ERROR_LSB 6.0
+/** @abstract SAR value fft_q15_s3.S sets before the butterflies */
+#define FFT_CHECK_SAR 14
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+/** @abstract Lane constants of fft_q15_s3.S */
+static const vector_t lane_half = { { 8192, 8192, 8192, 8192, 8192, 8192, 8192, 8192 } };
+static const vector_t lane_minus_j = { { 0, -16384, 0, -16384, 0, -16384, 0, -16384 } };
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function saturate
+ *
+ * @abstract This function clamps a value to a 16-bit lane
+ *
+ * @param[in] value: Value
+ *
+ * @return Saturated value
+ */
+static int16_t saturate(int32_t value);
+
+/*
+ * @function vaddsS16
+ *
+ * @abstract This function models EE.VADDS.S16: saturating lane addition
+ *
+ * @return Sum
+ */
+static vector_t vaddsS16(vector_t x, vector_t y);
+
+/*
+ * @function vsubsS16
+ *
+ * @abstract This function models EE.VSUBS.S16: saturating lane subtraction
+ *
+ * @return Difference
+ */
+static vector_t vsubsS16(vector_t x, vector_t y);
+
+/*
+ * @function vmulS16
+ *
+ * @abstract This function models EE.VMUL.S16: lane products shifted right by SAR, low 16 bits kept
+ *
+ * @return Products
+ */
+static vector_t vmulS16(vector_t x, vector_t y);
+
+/*
+ * @function cmulS16
+ *
+ * @abstract This function models EE.CMUL.S16 with sel4 0 or 1: complex products of the low or high two complex
+ *           values shifted right by SAR, the other half of z kept
+ *
+ * @return Updated z
+ */
+static vector_t cmulS16(vector_t z, vector_t x, vector_t y, int sel4);
+
+/*
+ * @function compareKernels
+ *
+ * @abstract This function runs one frame through both kernels
+ *
+ * @param[in] input: FFT_Q15_POINTS interleaved values
+ *
+ * @return true when the outputs are identical
+ */
+static bool compareKernels(const int16_t * input);
+
+/*
+ * @function referenceError
+ *
+ * @abstract This function returns the largest component error of the reference kernel against a double DFT
+ *
+ * @param[in] input: FFT_Q15_POINTS interleaved values
+ *
+ * @return Error in LSB
+ */
+static double referenceError(const int16_t * input);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static int16_t saturate(int32_t value) {
+    return (int16_t)(value > INT16_MAX ? INT16_MAX : (value < INT16_MIN ? INT16_MIN : value));
+}
+
+static vector_t vaddsS16(vector_t x, vector_t y) {
+    for (int i = 0; i < 8; i++) {
+        x.lane[i] = saturate(x.lane[i] + y.lane[i]);
+    }
+    return x;
+}
+
+static vector_t vsubsS16(vector_t x, vector_t y) {
+    for (int i = 0; i < 8; i++) {
+        x.lane[i] = saturate(x.lane[i] - y.lane[i]);
+    }
+    return x;
+}
+
+static vector_t vmulS16(vector_t x, vector_t y) {
+    for (int i = 0; i < 8; i++) {
+        x.lane[i] = (int16_t)((x.lane[i] * y.lane[i]) >> FFT_CHECK_SAR);
+    }
+    return x;
+}
+
+static vector_t cmulS16(vector_t z, vector_t x, vector_t y, int sel4) {
+    for (int i = 4 * sel4; i < 4 * sel4 + 4; i += 2) {
+        const int32_t re = x.lane[i] * y.lane[i] - x.lane[i + 1] * y.lane[i + 1];
+        const int32_t im = x.lane[i] * y.lane[i + 1] + x.lane[i + 1] * y.lane[i];
+        z.lane[i] = (int16_t)(re >> FFT_CHECK_SAR);
+        z.lane[i + 1] = (int16_t)(im >> FFT_CHECK_SAR);
+    }
+    return z;
+}
+
+static bool compareKernels(const int16_t * input) {
+    static int16_t reference[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+    static int16_t simd[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+
+    memcpy(reference, input, sizeof(reference));
+    fft_q15_set_kernel(FFT_Q15_KERNEL_REFERENCE);
+    fft_q15_complex(reference);
+
+    memcpy(simd, input, sizeof(simd));
+    fft_q15_set_kernel(FFT_Q15_KERNEL_SIMD);
+    fft_q15_complex(simd);
+
+    return memcmp(reference, simd, sizeof(reference)) == 0;
+}
+
+static double referenceError(const int16_t * input) {
+    static int16_t output[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+    double error = 0.0;
+
+    memcpy(output, input, sizeof(output));
+    fft_q15_set_kernel(FFT_Q15_KERNEL_REFERENCE);
+    fft_q15_complex(output);
+
+    for (int k = 0; k < FFT_Q15_POINTS; k++) {
+        double re = 0.0;
+        double im = 0.0;
+
+        for (int n = 0; n < FFT_Q15_POINTS; n++) {
+            const double angle = -2.0 * M_PI * (double)((k * n) % FFT_Q15_POINTS) / FFT_Q15_POINTS;
+            re += input[2 * n] * cos(angle) - input[2 * n + 1] * sin(angle);
+            im += input[2 * n] * sin(angle) + input[2 * n + 1] * cos(angle);
+        }
+
+        error = fmax(error, fabs(re / FFT_Q15_POINTS - output[2 * k]));
+        error = fmax(error, fabs(im / FFT_Q15_POINTS - output[2 * k + 1]));
+    }
+
+    return error;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+void fft_q15_stage_s3(int16_t * data, const int16_t * twiddles, uint32_t quarter, uint32_t groups) {
+    /* Instruction for instruction what fft_q15_s3.S executes, registers named after the q registers it uses */
+    for (uint32_t group = 0; group < groups; group++) {
+        vector_t * x0 = (vector_t *)&data[8 * quarter * group];
+        vector_t * x1 = x0 + quarter / 4;
+        vector_t * x2 = x1 + quarter / 4;
+        vector_t * x3 = x2 + quarter / 4;
+        const vector_t * twiddle = (const vector_t *)twiddles;
+
+        for (uint32_t block = 0; block < quarter / 4; block++) {
+            vector_t q0 = *x0, q1 = *x1, q2 = *x2, q3 = *x3, q4, q5;
+
+            q0 = vmulS16(q0, lane_half);
+            q1 = vmulS16(q1, lane_half);
+            q2 = vmulS16(q2, lane_half);
+            q3 = vmulS16(q3, lane_half);
+            q4 = vsubsS16(q0, q2);
+            q0 = vaddsS16(q0, q2);
+            q5 = vsubsS16(q1, q3);
+            q1 = vaddsS16(q1, q3);
+            q0 = vmulS16(q0, lane_half);
+            q1 = vmulS16(q1, lane_half);
+            q4 = vmulS16(q4, lane_half);
+            q5 = vmulS16(q5, lane_half);
+            q2 = vaddsS16(q0, q1);
+            *x0++ = q2;
+            q0 = vsubsS16(q0, q1);
+            q1 = cmulS16(q1, q5, lane_minus_j, 0);
+            q1 = cmulS16(q1, q5, lane_minus_j, 1);
+            q3 = vaddsS16(q4, q1);
+            q4 = vsubsS16(q4, q1);
+            q5 = *twiddle++;
+            q1 = cmulS16(q1, q3, q5, 0);
+            q1 = cmulS16(q1, q3, q5, 1);
+            *x1++ = q1;
+            q5 = *twiddle++;
+            q1 = cmulS16(q1, q0, q5, 0);
+            q1 = cmulS16(q1, q0, q5, 1);
+            *x2++ = q1;
+            q5 = *twiddle++;
+            q1 = cmulS16(q1, q4, q5, 0);
+            q1 = cmulS16(q1, q4, q5, 1);
+            *x3++ = q1;
+        }
+    }
+}
+
+int main(void) {
+    static int16_t input[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+    static int16_t work[2 * FFT_Q15_POINTS] __attribute__((aligned(FFT_Q15_ALIGN)));
+    uint32_t noise = 0x12345678;
+    uint32_t mismatches = 0;
+    double error = 0.0;
+
+    /* Uniform noise, then full-scale corners that push every lane to the edge of its headroom */
+    for (uint32_t frame = 0; frame < FFT_CHECK_RANDOM_FRAMES; frame++) {
+        for (uint32_t n = 0; n < 2 * FFT_Q15_POINTS; n++) {
+            noise = noise * 1664525u + 1013904223u;
+            input[n] = frame % 2 ? (int16_t)((int32_t)(noise >> 17) - 16384) : ((noise >> 31) ? 16384 : -16384);
+        }
+
+        mismatches += compareKernels(input) ? 0 : 1;
+        if (frame < 8) {
+            error = fmax(error, referenceError(input));
+        }
+    }
+
+    const bool device_check = fft_q15_check_kernel(work);
+
+    printf("FFT vector stage: %u of %u frames differ from the reference, device check %s, "
+           "reference error %.2f LSB\n", (unsigned)mismatches, (unsigned)FFT_CHECK_RANDOM_FRAMES,
+           device_check ? "passes" : "FAILS", error);
+
+    return mismatches == 0 && device_check && error <= FFT_CHECK_MAX_ERROR_LSB ? 0 : 1;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,351 @@
+/**
+  **********************************************************************************************************************
+  * @file    session_bench.c
+  * @brief   This file is the host compression benchmark of the sample codec over a downloaded session dump
+  * @authors patrykmonarcha
+  * @date Oct 18, 2026
+  **********************************************************************************************************************
+  */
+
+/* Includes -------------------------------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sample_codec.h"
+
+/* Private typedef ---------------------------------------------------------------------------------------------------*/
+/** @brief Samples decoded from a dump and what the DATA records took to store them */
+typedef struct session_bench_recording_t {
+    int64_t * times_ms;
+    int32_t * values;
+    size_t count;
+    size_t capacity;
+    uint32_t records;
+    uint32_t data_records;
+    uint32_t rejected;
+    uint32_t stored_bytes;
+} session_bench_recording_t;
+
+/* Private define ----------------------------------------------------------------------------------------------------*/
+/*
+ * Session store record layout, see session_store.h. The header pulls in ESP-IDF, so the few values needed here are
+ * repeated: [type u8][channels u8][length u16][crc u32] then the payload, a DATA payload being [session u32]
+ * [quality u8] followed by a codec block.
+ */
+/** @abstract Record header size */
+#define SESSION_BENCH_RECORD_HEADER_BYTES 8
+/** @abstract DATA record type */
+#define SESSION_BENCH_RECORD_DATA 0x02
+/** @abstract DATA payload bytes ahead of the codec block */
+#define SESSION_BENCH_DATA_HEADER_BYTES 5
+/** @abstract Channels of a DATA block: temperature, humidity, pressure */
+#define SESSION_BENCH_CHANNELS 3
+/** @abstract Samples per DATA block the store seals */
+#define SESSION_BENCH_BLOCK_SAMPLES 120
+/** @abstract Sample period of the synthetic recording */
+#define SESSION_BENCH_PERIOD_MS 100
+/** @abstract Length of the synthetic recording used without a dump, two minutes of BME280 samples */
+#define SESSION_BENCH_SYNTHETIC_SAMPLES 1200
+/** @abstract Passes over the recording */
+#define SESSION_BENCH_ITERATIONS 50
+
+/* Private macros ----------------------------------------------------------------------------------------------------*/
+
+/* Private variables -------------------------------------------------------------------------------------------------*/
+
+/* External variables ------------------------------------------------------------------------------------------------*/
+
+/* Private function declarations -------------------------------------------------------------------------------------*/
+/*
+ * @function crc32Le
+ *
+ * @abstract This function continues a little-endian CRC-32 the way esp_rom_crc32_le does
+ *
+ * @param[in] crc: CRC so far, 0 to start
+ *
+ * @param[in] data: Data
+ *
+ * @param[in] length: Data size in bytes
+ *
+ * @return CRC
+ */
+static uint32_t crc32Le(uint32_t crc, const uint8_t * data, size_t length);
+
+/*
+ * @function addBlock
+ *
+ * @abstract This function decodes a DATA codec block and appends its samples to the recording
+ *
+ * @param[in,out] recording: Recording
+ *
+ * @param[in] block: Codec block
+ *
+ * @param[in] length: Codec block size in bytes
+ *
+ * @return false if the block is malformed or out of memory
+ */
+static bool addBlock(session_bench_recording_t * recording, const uint8_t * block, size_t length);
+
+/*
+ * @function parseDump
+ *
+ * @abstract This function walks concatenated session store records, checking their CRC and decoding the DATA blocks
+ *
+ * @param[in,out] recording: Recording
+ *
+ * @param[in] dump: Records
+ *
+ * @param[in] length: Dump size in bytes
+ *
+ * @return None
+ */
+static void parseDump(session_bench_recording_t * recording, const uint8_t * dump, size_t length);
+
+/*
+ * @function buildDump
+ *
+ * @abstract This function packs a synthetic breathing recording into DATA records the way the store seals them
+ *
+ * @param[out] length: Dump size in bytes
+ *
+ * @return Records, NULL when out of memory
+ */
+static uint8_t * buildDump(size_t * length);
+
+/*
+ * @function loadDump
+ *
+ * @abstract This function reads a dump: the records of a download, header included, in the order received, as a
+ *           central stores them once the RECORD frames of each position are joined
+ *
+ * @param[in] path: File path
+ *
+ * @param[out] length: Dump size in bytes
+ *
+ * @return Records, NULL when the file cannot be read or is empty
+ */
+static uint8_t * loadDump(const char * path, size_t * length);
+
+/* Private function definitions --------------------------------------------------------------------------------------*/
+static uint32_t crc32Le(uint32_t crc, const uint8_t * data, size_t length) {
+    crc = ~crc;
+
+    for (size_t i = 0; i < length; i++) {
+        crc ^= data[i];
+        for (uint32_t bit = 0; bit < 8; bit++) {
+            crc = crc & 1u ? crc >> 1 ^ 0xEDB88320u : crc >> 1;
+        }
+    }
+
+    return ~crc;
+}
+
+static bool addBlock(session_bench_recording_t * recording, const uint8_t * block, size_t length) {
+    if (recording->capacity - recording->count < SAMPLE_CODEC_MAX_SAMPLES) {
+        const size_t capacity = recording->capacity ? 2 * recording->capacity : 16 * SAMPLE_CODEC_MAX_SAMPLES;
+        int64_t * times_ms = realloc(recording->times_ms, capacity * sizeof(int64_t));
+        if (times_ms == NULL) {
+            return false;
+        }
+        recording->times_ms = times_ms;
+
+        int32_t * values = realloc(recording->values, capacity * SESSION_BENCH_CHANNELS * sizeof(int32_t));
+        if (values == NULL) {
+            return false;
+        }
+        recording->values = values;
+        recording->capacity = capacity;
+    }
+
+    const size_t count = sample_codec_decode(block, length, &recording->times_ms[recording->count],
+                                             &recording->values[recording->count * SESSION_BENCH_CHANNELS],
+                                             SAMPLE_CODEC_MAX_SAMPLES, SESSION_BENCH_CHANNELS);
+
+    recording->count += count;
+    return count > 0;
+}
+
+static void parseDump(session_bench_recording_t * recording, const uint8_t * dump, size_t length) {
+    size_t position = 0;
+
+    while (length - position >= SESSION_BENCH_RECORD_HEADER_BYTES) {
+        const uint8_t * header = &dump[position];
+        const uint16_t payload_length = header[2] | (uint16_t)header[3] << 8;
+        const uint32_t crc = header[4] | (uint32_t)header[5] << 8 | (uint32_t)header[6] << 16 |
+                             (uint32_t)header[7] << 24;
+
+        /* A truncated last record ends the dump */
+        if (length - position - SESSION_BENCH_RECORD_HEADER_BYTES < payload_length) {
+            break;
+        }
+
+        const uint8_t * payload = &header[SESSION_BENCH_RECORD_HEADER_BYTES];
+        position += SESSION_BENCH_RECORD_HEADER_BYTES + payload_length;
+        recording->records++;
+
+        if (crc32Le(crc32Le(0, header, 4), payload, payload_length) != crc) {
+            recording->rejected++;
+            continue;
+        }
+
+        if (header[0] != SESSION_BENCH_RECORD_DATA) {
+            continue;
+        }
+
+        if (header[1] != SESSION_BENCH_CHANNELS || payload_length <= SESSION_BENCH_DATA_HEADER_BYTES ||
+            !addBlock(recording, &payload[SESSION_BENCH_DATA_HEADER_BYTES],
+                      payload_length - SESSION_BENCH_DATA_HEADER_BYTES)) {
+            recording->rejected++;
+            continue;
+        }
+
+        recording->data_records++;
+        recording->stored_bytes += SESSION_BENCH_RECORD_HEADER_BYTES + payload_length;
+    }
+}
+
+static uint8_t * buildDump(size_t * length) {
+    static int64_t times_ms[SESSION_BENCH_SYNTHETIC_SAMPLES];
+    static int32_t values[SESSION_BENCH_SYNTHETIC_SAMPLES * SESSION_BENCH_CHANNELS];
+    const size_t block_bytes = SAMPLE_CODEC_MAX_BYTES(SESSION_BENCH_BLOCK_SAMPLES, SESSION_BENCH_CHANNELS);
+    const size_t record_bytes = SESSION_BENCH_RECORD_HEADER_BYTES + SESSION_BENCH_DATA_HEADER_BYTES + block_bytes;
+    const size_t blocks = (SESSION_BENCH_SYNTHETIC_SAMPLES + SESSION_BENCH_BLOCK_SAMPLES - 1) /
+                          SESSION_BENCH_BLOCK_SAMPLES;
+    uint8_t * dump = malloc(blocks * record_bytes);
+    uint32_t noise = 0x12345678;
+    size_t position = 0;
+
+    if (dump == NULL) {
+        return NULL;
+    }
+
+    /* 4 s breaths as a triangle on every channel plus sensor noise, with the odd late wake-up of the sensor task */
+    for (uint32_t i = 0; i < SESSION_BENCH_SYNTHETIC_SAMPLES; i++) {
+        noise = noise * 1664525u + 1013904223u;
+        int32_t breath = (int32_t)(i % 40);
+        breath = breath < 20 ? breath : 40 - breath;
+
+        times_ms[i] = 1700000000000LL + (int64_t)i * SESSION_BENCH_PERIOD_MS + ((noise >> 8) % 16 == 0 ? 1 : 0);
+        values[i * SESSION_BENCH_CHANNELS + 0] = 3400 + 4 * breath + (int32_t)((noise >> 12) % 3) - 1;
+        values[i * SESSION_BENCH_CHANNELS + 1] = 46080 + 300 * breath + (int32_t)((noise >> 16) % 61) - 30;
+        values[i * SESSION_BENCH_CHANNELS + 2] = 101325 * 256 + 1280 * breath + (int32_t)((noise >> 20) % 401) - 200;
+    }
+
+    for (size_t done = 0; done < SESSION_BENCH_SYNTHETIC_SAMPLES; done += SESSION_BENCH_BLOCK_SAMPLES) {
+        const size_t left = SESSION_BENCH_SYNTHETIC_SAMPLES - done;
+        const size_t count = left < SESSION_BENCH_BLOCK_SAMPLES ? left : SESSION_BENCH_BLOCK_SAMPLES;
+        uint8_t * header = &dump[position];
+        uint8_t * payload = &header[SESSION_BENCH_RECORD_HEADER_BYTES];
+
+        /* Session 1, clock synced from the central */
+        memset(payload, 0, SESSION_BENCH_DATA_HEADER_BYTES);
+        payload[0] = 1;
+        payload[4] = 0x01;
+
+        const size_t block_length = sample_codec_encode(&times_ms[done], &values[done * SESSION_BENCH_CHANNELS],
+                                                        count, SESSION_BENCH_CHANNELS,
+                                                        &payload[SESSION_BENCH_DATA_HEADER_BYTES], block_bytes);
+        const uint16_t payload_length = (uint16_t)(SESSION_BENCH_DATA_HEADER_BYTES + block_length);
+
+        header[0] = SESSION_BENCH_RECORD_DATA;
+        header[1] = SESSION_BENCH_CHANNELS;
+        header[2] = (uint8_t)payload_length;
+        header[3] = (uint8_t)(payload_length >> 8);
+
+        const uint32_t crc = crc32Le(crc32Le(0, header, 4), payload, payload_length);
+        for (size_t i = 0; i < 4; i++) {
+            header[4 + i] = (uint8_t)(crc >> (8 * i));
+        }
+
+        position += SESSION_BENCH_RECORD_HEADER_BYTES + payload_length;
+    }
+
+    *length = position;
+    return dump;
+}
+
+static uint8_t * loadDump(const char * path, size_t * length) {
+    FILE * file = fopen(path, "rb");
+    uint8_t * dump = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    while (1) {
+        if (size == capacity) {
+            capacity = capacity ? 2 * capacity : 64 * 1024;
+            uint8_t * grown = realloc(dump, capacity);
+            if (grown == NULL) {
+                break;
+            }
+            dump = grown;
+        }
+
+        const size_t read = fread(&dump[size], 1, capacity - size, file);
+        if (read == 0) {
+            break;
+        }
+        size += read;
+    }
+    fclose(file);
+
+    if (size == 0) {
+        free(dump);
+        return NULL;
+    }
+
+    *length = size;
+    return dump;
+}
+
+/* Exported function definitions -------------------------------------------------------------------------------------*/
+int main(int argc, char ** argv) {
+    size_t length = 0;
+    uint8_t * dump = argc > 1 ? loadDump(argv[1], &length) : buildDump(&length);
+    session_bench_recording_t recording = {0};
+    sample_codec_benchmark_t result;
+
+    if (dump == NULL) {
+        printf("usage: %s [session.dump]\n", argv[0]);
+        return 1;
+    }
+
+    parseDump(&recording, dump, length);
+    free(dump);
+
+    if (recording.count == 0) {
+        printf("No DATA samples in %u records (%u rejected)\n", (unsigned)recording.records,
+               (unsigned)recording.rejected);
+        free(recording.times_ms);
+        free(recording.values);
+        return 1;
+    }
+
+    /* As stored: whole DATA records, headers included, against an int64 time and an int32 per channel */
+    const uint64_t raw_bytes = (uint64_t)recording.count * (8 + 4 * SESSION_BENCH_CHANNELS);
+    const uint32_t stored_x100 = (uint32_t)(raw_bytes * 100 / recording.stored_bytes);
+
+    printf("Dump: %u records, %u DATA (%u rejected), %zu samples, %llu -> %u bytes stored (ratio %u.%02u)\n",
+           (unsigned)recording.records, (unsigned)recording.data_records, (unsigned)recording.rejected,
+           recording.count, (unsigned long long)raw_bytes, (unsigned)recording.stored_bytes,
+           (unsigned)(stored_x100 / 100), (unsigned)(stored_x100 % 100));
+
+    sample_codec_benchmark(recording.times_ms, recording.values, recording.count, SESSION_BENCH_CHANNELS,
+                           SESSION_BENCH_BLOCK_SAMPLES, SESSION_BENCH_ITERATIONS, &result);
+    free(recording.times_ms);
+    free(recording.values);
+
+    printf("Sample codec: %u -> %u bytes (ratio %u.%02u), encode %u.%02u MB/s, decode %u.%02u MB/s, lossless: %s\n",
+           (unsigned)result.raw_bytes, (unsigned)result.encoded_bytes,
+           (unsigned)(result.ratio_x100 / 100), (unsigned)(result.ratio_x100 % 100),
+           (unsigned)(result.encode_bytes_per_s / 1000000), (unsigned)(result.encode_bytes_per_s / 10000 % 100),
+           (unsigned)(result.decode_bytes_per_s / 1000000), (unsigned)(result.decode_bytes_per_s / 10000 % 100),
+           result.lossless ? "yes" : "NO");
+
+    return result.lossless ? 0 : 1;
+}
+
+/* END OF FILE -------------------------------------------------------------------------------------------------------*/